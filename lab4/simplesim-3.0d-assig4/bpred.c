@@ -62,6 +62,9 @@
 /* turn this on to enable the SimpleScalar 2.0 RAS bug */
 /* #define RAS_BUG_COMPATIBLE */
 
+/* TAGE usefulness counters are halved every BPRED_TAGE_U_PERIOD updates */
+#define BPRED_TAGE_U_PERIOD	(256*1024)
+
 /* create a branch predictor */
 struct bpred_t *			/* branch predictory instance */
 bpred_create(enum bpred_class class,	/* type of predictor to create */
@@ -108,6 +111,16 @@ bpred_create(enum bpred_class class,	/* type of predictor to create */
     pred->dirpred.bimod = 
       bpred_dir_create(class, bimod_size, 0, 0, 0);
 
+    break;
+
+  case BPredTAGE:
+    /* bimodal base component, the tagged tables are created by
+       bpred_tage_create() */
+    pred->dirpred.bimod = 
+      bpred_dir_create(BPred2bit, bimod_size, 0, 0, 0);
+
+    break;
+
   case BPredTaken:
   case BPredNotTaken:
     /* no other state */
@@ -122,6 +135,7 @@ bpred_create(enum bpred_class class,	/* type of predictor to create */
   case BPredComb:
   case BPred2Level:
   case BPred2bit:
+  case BPredTAGE:
     {
       int i;
 
@@ -136,19 +150,12 @@ bpred_create(enum bpred_class class,	/* type of predictor to create */
 	fatal("cannot allocate BTB");
 
       pred->btb.sets = btb_sets;
+      pred->btb.log_sets = log_base2(btb_sets);
       pred->btb.assoc = btb_assoc;
 
-      if (pred->btb.assoc > 1)
-	for (i=0; i < (pred->btb.assoc*pred->btb.sets); i++)
-	  {
-	    if (i % pred->btb.assoc != pred->btb.assoc - 1)
-	      pred->btb.btb_data[i].next = &pred->btb.btb_data[i+1];
-	    else
-	      pred->btb.btb_data[i].next = NULL;
-	    
-	    if (i % pred->btb.assoc != pred->btb.assoc - 1)
-	      pred->btb.btb_data[i+1].prev = &pred->btb.btb_data[i];
-	  }
+      /* initial LRU order of each set is the order of its entries */
+      for (i=0; i < (pred->btb.assoc*pred->btb.sets); i++)
+	pred->btb.btb_data[i].lru = i % pred->btb.assoc;
 
       /* allocate retstack */
       if ((retstack_size & (retstack_size-1)) != 0)
@@ -176,6 +183,152 @@ bpred_create(enum bpred_class class,	/* type of predictor to create */
   return pred;
 }
 
+/* initialize the speculative global history HIST of NTABLES tagged tables,
+   the history lengths form a geometric series from MIN_HIST to MAX_HIST */
+static void
+hist_init(struct bpred_hist_t *hist,	/* history to initialize */
+	  unsigned int ntables,		/* number of tagged tables */
+	  unsigned int table_size,	/* entries per tagged table */
+	  unsigned int tag_width,	/* tag width in bits */
+	  unsigned int min_hist,	/* shortest history length */
+	  unsigned int max_hist)	/* longest history length */
+{
+  int i;
+
+  hist->ntables = ntables;
+  hist->idx_width = log_base2(table_size);
+  hist->tag_width = tag_width;
+
+  for (i=0; i < (int)ntables; i++)
+    {
+      if (ntables == 1)
+	hist->hist_len[i] = min_hist;
+      else
+	hist->hist_len[i] =
+	  (int)(min_hist * pow((double)max_hist / (double)min_hist,
+			       (double)i / (double)(ntables - 1)) + 0.5);
+    }
+
+  if (!(hist->ghist = calloc(BPRED_TAGE_HIST_SIZE, sizeof(unsigned char))))
+    fatal("cannot allocate branch history");
+  hist->ghist_ptr = 0;
+}
+
+/* check the parameters of a tagged predictor, NAME is used in messages */
+static void
+tagged_check(char *name,		/* predictor name */
+	     unsigned int ntables,	/* number of tagged tables */
+	     unsigned int table_size,	/* entries per tagged table */
+	     unsigned int tag_width,	/* tag width in bits */
+	     unsigned int min_hist,	/* shortest history length */
+	     unsigned int max_hist)	/* longest history length */
+{
+  if (!ntables || ntables > BPRED_TAGE_MAX_TABLES)
+    fatal("number of %s tables, `%d', must be between 1 and %d",
+	  name, ntables, BPRED_TAGE_MAX_TABLES);
+  if (table_size < 16 || table_size > 65536
+      || (table_size & (table_size-1)) != 0)
+    fatal("%s table size, `%d', must be a power of two in 16..65536",
+	  name, table_size);
+  if (tag_width < 4 || tag_width > 16)
+    fatal("%s tag width, `%d', must be between 4 and 16", name, tag_width);
+  if (!min_hist || max_hist < min_hist
+      || max_hist > BPRED_TAGE_HIST_SIZE/2)
+    fatal("%s history lengths, `%d..%d', must be in 1..%d",
+	  name, min_hist, max_hist, BPRED_TAGE_HIST_SIZE/2);
+}
+
+/* create the tagged tables of a TAGE direction predictor */
+static struct bpred_dir_t *	/* TAGE tagged tables */
+tage_dir_create(unsigned int ntables,	/* number of tagged tables */
+		unsigned int table_size,/* entries per tagged table */
+		unsigned int tag_width,	/* tag width in bits */
+		unsigned int min_hist,	/* shortest history length */
+		unsigned int max_hist)	/* longest history length */
+{
+  struct bpred_dir_t *pred_dir;
+  int i;
+
+  tagged_check("TAGE", ntables, table_size, tag_width, min_hist, max_hist);
+
+  if (!(pred_dir = calloc(1, sizeof(struct bpred_dir_t))))
+    fatal("out of virtual memory");
+
+  pred_dir->class = BPredTAGE;
+  pred_dir->config.tage.size = table_size;
+  hist_init(&pred_dir->config.tage.hist,
+	    ntables, table_size, tag_width, min_hist, max_hist);
+
+  for (i=0; i < (int)ntables; i++)
+    {
+      if (!(pred_dir->config.tage.table[i] =
+	    calloc(table_size, sizeof(struct bpred_tage_ent_t))))
+	fatal("cannot allocate TAGE table");
+    }
+
+  /* start out preferring the provider over the alternate prediction */
+  pred_dir->config.tage.use_alt = 7;
+  pred_dir->config.tage.seed = 1;
+
+  return pred_dir;
+}
+
+/* create a TAGE branch predictor */
+struct bpred_t *			/* branch predictory instance */
+bpred_tage_create(unsigned int bimod_size,/* base predictor table size */
+		  unsigned int ntables,	/* number of tagged tables */
+		  unsigned int table_size,/* entries per tagged table */
+		  unsigned int tag_width,/* tag width in bits */
+		  unsigned int min_hist,/* shortest history length */
+		  unsigned int max_hist,/* longest history length */
+		  unsigned int btb_sets,/* number of sets in BTB */
+		  unsigned int btb_assoc,/* BTB associativity */
+		  unsigned int retstack_size)/* num entries in ret-addr stack */
+{
+  struct bpred_t *pred;
+
+  pred = bpred_create(BPredTAGE, bimod_size,
+		      /* l1 size */0, /* l2 size */0, /* meta size */0,
+		      /* shift width */0, /* xor */0,
+		      btb_sets, btb_assoc, retstack_size);
+  pred->dirpred.tage =
+    tage_dir_create(ntables, table_size, tag_width, min_hist, max_hist);
+
+  return pred;
+}
+
+/* attach an ITTAGE indirect target predictor to branch predictor PRED */
+void
+bpred_ind_create(struct bpred_t *pred,	/* branch predictor instance */
+		 unsigned int ntables,	/* number of tagged tables */
+		 unsigned int table_size,/* entries per tagged table */
+		 unsigned int tag_width,/* tag width in bits */
+		 unsigned int min_hist,	/* shortest history length */
+		 unsigned int max_hist)	/* longest history length */
+{
+  struct bpred_ind_t *ind;
+  int i;
+
+  if (pred->class == BPredTaken || pred->class == BPredNotTaken)
+    fatal("ITTAGE requires a stateful branch predictor");
+  tagged_check("ITTAGE", ntables, table_size, tag_width, min_hist, max_hist);
+
+  if (!(ind = calloc(1, sizeof(struct bpred_ind_t))))
+    fatal("out of virtual memory");
+
+  ind->size = table_size;
+  hist_init(&ind->hist, ntables, table_size, tag_width, min_hist, max_hist);
+
+  for (i=0; i < (int)ntables; i++)
+    {
+      if (!(ind->table[i] = calloc(table_size, sizeof(struct bpred_ind_ent_t))))
+	fatal("cannot allocate ITTAGE table");
+    }
+  ind->seed = 1;
+
+  pred->ind = ind;
+}
+
 /* create a branch direction predictor */
 struct bpred_dir_t *		/* branch direction predictor instance */
 bpred_dir_create (
@@ -283,6 +436,17 @@ bpred_dir_config(
       name, pred_dir->config.bimod.size);
     break;
 
+  case BPredTAGE:
+    fprintf(stream,
+      "pred_dir: %s: TAGE: %d tables x %d entries, %d-bit tags, "
+      "%d..%d history bits\n",
+      name, pred_dir->config.tage.hist.ntables, pred_dir->config.tage.size,
+      pred_dir->config.tage.hist.tag_width,
+      pred_dir->config.tage.hist.hist_len[0],
+      pred_dir->config.tage.hist.hist_len[pred_dir->config.tage.hist.ntables
+					   - 1]);
+    break;
+
   case BPredTaken:
     fprintf(stream, "pred_dir: %s: predict taken\n", name);
     break;
@@ -325,6 +489,14 @@ bpred_config(struct bpred_t *pred,	/* branch predictor instance */
     fprintf(stream, "ret_stack: %d entries", pred->retstack.size);
     break;
 
+  case BPredTAGE:
+    bpred_dir_config (pred->dirpred.bimod, "bimod", stream);
+    bpred_dir_config (pred->dirpred.tage, "tage", stream);
+    fprintf(stream, "btb: %d sets x %d associativity", 
+	    pred->btb.sets, pred->btb.assoc);
+    fprintf(stream, "ret_stack: %d entries", pred->retstack.size);
+    break;
+
   case BPredTaken:
     bpred_dir_config (pred->dirpred.bimod, "taken", stream);
     break;
@@ -335,6 +507,14 @@ bpred_config(struct bpred_t *pred,	/* branch predictor instance */
   default:
     panic("bogus branch predictor class");
   }
+
+  if (pred->ind)
+    fprintf(stream,
+	    "ittage: %d tables x %d entries, %d-bit tags, "
+	    "%d..%d path history bits\n",
+	    pred->ind->hist.ntables, pred->ind->size, pred->ind->hist.tag_width,
+	    pred->ind->hist.hist_len[0],
+	    pred->ind->hist.hist_len[pred->ind->hist.ntables - 1]);
 }
 
 /* print predictor stats */
@@ -353,7 +533,7 @@ void
 bpred_reg_stats(struct bpred_t *pred,	/* branch predictor instance */
 		struct stat_sdb_t *sdb)	/* stats database */
 {
-  char buf[512], buf1[512], *name;
+  char buf[512], buf1[1024], pname[256], *name;
 
   /* get a name for this predictor */
   switch (pred->class)
@@ -373,91 +553,147 @@ bpred_reg_stats(struct bpred_t *pred,	/* branch predictor instance */
     case BPredNotTaken:
       name = "bpred_nottaken";
       break;
+    case BPredTAGE:
+      name = "bpred_tage";
+      break;
     default:
       panic("bogus branch predictor class");
     }
+  if (pred->prefix)
+    {
+      snprintf(pname, sizeof(pname), "%s%s", pred->prefix, name);
+      name = pname;
+    }
 
-  sprintf(buf, "%s.lookups", name);
+  snprintf(buf, sizeof(buf), "%s.lookups", name);
   stat_reg_counter(sdb, buf, "total number of bpred lookups",
 		   &pred->lookups, 0, NULL);
-  sprintf(buf, "%s.updates", name);
-  sprintf(buf1, "%s.dir_hits + %s.misses", name, name);
+  snprintf(buf, sizeof(buf), "%s.updates", name);
+  snprintf(buf1, sizeof(buf1), "%s.dir_hits + %s.misses", name, name);
   stat_reg_formula(sdb, buf, "total number of updates", buf1, "%12.0f");
-  sprintf(buf, "%s.addr_hits", name);
+  snprintf(buf, sizeof(buf), "%s.addr_hits", name);
   stat_reg_counter(sdb, buf, "total number of address-predicted hits", 
 		   &pred->addr_hits, 0, NULL);
-  sprintf(buf, "%s.dir_hits", name);
+  snprintf(buf, sizeof(buf), "%s.dir_hits", name);
   stat_reg_counter(sdb, buf, 
 		   "total number of direction-predicted hits "
 		   "(includes addr-hits)", 
 		   &pred->dir_hits, 0, NULL);
   if (pred->class == BPredComb)
     {
-      sprintf(buf, "%s.used_bimod", name);
+      snprintf(buf, sizeof(buf), "%s.used_bimod", name);
       stat_reg_counter(sdb, buf, 
 		       "total number of bimodal predictions used", 
 		       &pred->used_bimod, 0, NULL);
-      sprintf(buf, "%s.used_2lev", name);
+      snprintf(buf, sizeof(buf), "%s.used_2lev", name);
       stat_reg_counter(sdb, buf, 
 		       "total number of 2-level predictions used", 
 		       &pred->used_2lev, 0, NULL);
     }
-  sprintf(buf, "%s.misses", name);
+  if (pred->class == BPredTAGE)
+    {
+      snprintf(buf, sizeof(buf), "%s.used_tagged", name);
+      stat_reg_counter(sdb, buf, 
+		       "total number of tagged table predictions used", 
+		       &pred->used_tagged, 0, NULL);
+      snprintf(buf, sizeof(buf), "%s.used_alt", name);
+      stat_reg_counter(sdb, buf, 
+		       "total number of alternate predictions used "
+		       "(for new entries)", 
+		       &pred->used_alt, 0, NULL);
+      snprintf(buf, sizeof(buf), "%s.tage_allocs", name);
+      stat_reg_counter(sdb, buf, 
+		       "total number of tagged table entries allocated", 
+		       &pred->tage_allocs, 0, NULL);
+    }
+  snprintf(buf, sizeof(buf), "%s.misses", name);
   stat_reg_counter(sdb, buf, "total number of misses", &pred->misses, 0, NULL);
-  sprintf(buf, "%s.jr_hits", name);
+  snprintf(buf, sizeof(buf), "%s.jr_hits", name);
   stat_reg_counter(sdb, buf,
 		   "total number of address-predicted hits for JR's",
 		   &pred->jr_hits, 0, NULL);
-  sprintf(buf, "%s.jr_seen", name);
+  snprintf(buf, sizeof(buf), "%s.jr_seen", name);
   stat_reg_counter(sdb, buf,
 		   "total number of JR's seen",
 		   &pred->jr_seen, 0, NULL);
-  sprintf(buf, "%s.jr_non_ras_hits.PP", name);
+  snprintf(buf, sizeof(buf), "%s.jr_non_ras_hits.PP", name);
   stat_reg_counter(sdb, buf,
 		   "total number of address-predicted hits for non-RAS JR's",
 		   &pred->jr_non_ras_hits, 0, NULL);
-  sprintf(buf, "%s.jr_non_ras_seen.PP", name);
+  snprintf(buf, sizeof(buf), "%s.jr_non_ras_seen.PP", name);
   stat_reg_counter(sdb, buf,
 		   "total number of non-RAS JR's seen",
 		   &pred->jr_non_ras_seen, 0, NULL);
-  sprintf(buf, "%s.bpred_addr_rate", name);
-  sprintf(buf1, "%s.addr_hits / %s.updates", name, name);
+  snprintf(buf, sizeof(buf), "%s.bpred_addr_rate", name);
+  snprintf(buf1, sizeof(buf1), "%s.addr_hits / %s.updates", name, name);
   stat_reg_formula(sdb, buf,
 		   "branch address-prediction rate (i.e., addr-hits/updates)",
 		   buf1, "%9.4f");
-  sprintf(buf, "%s.bpred_dir_rate", name);
-  sprintf(buf1, "%s.dir_hits / %s.updates", name, name);
+  snprintf(buf, sizeof(buf), "%s.bpred_dir_rate", name);
+  snprintf(buf1, sizeof(buf1), "%s.dir_hits / %s.updates", name, name);
   stat_reg_formula(sdb, buf,
 		  "branch direction-prediction rate (i.e., all-hits/updates)",
 		  buf1, "%9.4f");
-  sprintf(buf, "%s.bpred_jr_rate", name);
-  sprintf(buf1, "%s.jr_hits / %s.jr_seen", name, name);
+  snprintf(buf, sizeof(buf), "%s.bpred_jr_rate", name);
+  snprintf(buf1, sizeof(buf1), "%s.jr_hits / %s.jr_seen", name, name);
   stat_reg_formula(sdb, buf,
 		  "JR address-prediction rate (i.e., JR addr-hits/JRs seen)",
 		  buf1, "%9.4f");
-  sprintf(buf, "%s.bpred_jr_non_ras_rate.PP", name);
-  sprintf(buf1, "%s.jr_non_ras_hits.PP / %s.jr_non_ras_seen.PP", name, name);
+  snprintf(buf, sizeof(buf), "%s.bpred_jr_non_ras_rate.PP", name);
+  snprintf(buf1, sizeof(buf1),
+	   "%s.jr_non_ras_hits.PP / %s.jr_non_ras_seen.PP", name, name);
   stat_reg_formula(sdb, buf,
 		   "non-RAS JR addr-pred rate (ie, non-RAS JR hits/JRs seen)",
 		   buf1, "%9.4f");
-  sprintf(buf, "%s.retstack_pushes", name);
+  snprintf(buf, sizeof(buf), "%s.indir_misses", name);
+  stat_reg_counter(sdb, buf,
+		   "total number of non-RAS JR target mispredictions",
+		   &pred->indir_misses, 0, NULL);
+  snprintf(buf, sizeof(buf), "%s.indir_miss_rate", name);
+  snprintf(buf1, sizeof(buf1),
+	   "%s.indir_misses / %s.jr_non_ras_seen.PP", name, name);
+  stat_reg_formula(sdb, buf,
+		   "non-RAS JR target misprediction rate",
+		   buf1, "%9.4f");
+  if (pred->ind)
+    {
+      snprintf(buf, sizeof(buf), "%s.ittage_used", name);
+      stat_reg_counter(sdb, buf,
+		       "total number of ITTAGE target predictions used",
+		       &pred->ind_used, 0, NULL);
+      snprintf(buf, sizeof(buf), "%s.ittage_hits", name);
+      stat_reg_counter(sdb, buf,
+		       "total number of correct ITTAGE target predictions",
+		       &pred->ind_hits, 0, NULL);
+      snprintf(buf, sizeof(buf), "%s.ittage_allocs", name);
+      stat_reg_counter(sdb, buf,
+		       "total number of ITTAGE entries allocated",
+		       &pred->ind_allocs, 0, NULL);
+      snprintf(buf, sizeof(buf), "%s.ittage_rate", name);
+      snprintf(buf1, sizeof(buf1),
+	       "%s.ittage_hits / %s.ittage_used", name, name);
+      stat_reg_formula(sdb, buf,
+		       "ITTAGE target prediction rate (i.e., hits/used)",
+		       buf1, "%9.4f");
+    }
+  snprintf(buf, sizeof(buf), "%s.retstack_pushes", name);
   stat_reg_counter(sdb, buf,
 		   "total number of address pushed onto ret-addr stack",
 		   &pred->retstack_pushes, 0, NULL);
-  sprintf(buf, "%s.retstack_pops", name);
+  snprintf(buf, sizeof(buf), "%s.retstack_pops", name);
   stat_reg_counter(sdb, buf,
 		   "total number of address popped off of ret-addr stack",
 		   &pred->retstack_pops, 0, NULL);
-  sprintf(buf, "%s.used_ras.PP", name);
+  snprintf(buf, sizeof(buf), "%s.used_ras.PP", name);
   stat_reg_counter(sdb, buf,
 		   "total number of RAS predictions used",
 		   &pred->used_ras, 0, NULL);
-  sprintf(buf, "%s.ras_hits.PP", name);
+  snprintf(buf, sizeof(buf), "%s.ras_hits.PP", name);
   stat_reg_counter(sdb, buf,
 		   "total number of RAS hits",
 		   &pred->ras_hits, 0, NULL);
-  sprintf(buf, "%s.ras_rate.PP", name);
-  sprintf(buf1, "%s.ras_hits.PP / %s.used_ras.PP", name, name);
+  snprintf(buf, sizeof(buf), "%s.ras_rate.PP", name);
+  snprintf(buf1, sizeof(buf1), "%s.ras_hits.PP / %s.used_ras.PP", name, name);
   stat_reg_formula(sdb, buf,
 		   "RAS prediction rate (i.e., RAS hits/used RAS)",
 		   buf1, "%9.4f");
@@ -475,8 +711,17 @@ bpred_after_priming(struct bpred_t *bpred)
   bpred->used_ras = 0;
   bpred->used_bimod = 0;
   bpred->used_2lev = 0;
+  bpred->used_tagged = 0;
+  bpred->used_alt = 0;
+  bpred->tage_allocs = 0;
   bpred->jr_hits = 0;
   bpred->jr_seen = 0;
+  bpred->jr_non_ras_hits = 0;
+  bpred->jr_non_ras_seen = 0;
+  bpred->indir_misses = 0;
+  bpred->ind_used = 0;
+  bpred->ind_hits = 0;
+  bpred->ind_allocs = 0;
   bpred->misses = 0;
   bpred->retstack_pops = 0;
   bpred->retstack_pushes = 0;
@@ -543,6 +788,407 @@ bpred_dir_lookup(struct bpred_dir_t *pred_dir,	/* branch dir predictor inst */
   return (char *)p;
 }
 
+/* BTB set index, hashes the upper branch address bits into the set index */
+#define BTB_HASH(PRED, ADDR)						\
+  ((((ADDR) >> MD_BR_SHIFT)						\
+    ^ ((ADDR) >> (MD_BR_SHIFT + (PRED)->btb.log_sets)))			\
+   & ((PRED)->btb.sets - 1))
+
+/* tagged table T index and tag of branch address ADDR, under the current
+   folded global histories of history H */
+#define TAGE_PC(ADDR)		((ADDR) >> MD_BR_SHIFT)
+#define TAGE_INDEX(H, ADDR, T)						\
+  ((TAGE_PC(ADDR) ^ (TAGE_PC(ADDR) >> ((T) + 1)) ^ (H)->fidx[T])		\
+   & ((1 << (H)->idx_width) - 1))
+#define TAGE_TAG(H, ADDR, T)						\
+  ((TAGE_PC(ADDR) ^ (H)->ftag0[T] ^ ((H)->ftag1[T] << 1))		\
+   & ((1 << (H)->tag_width) - 1))
+
+/* fold history bit NEW into the CLEN bit folded history COMP, OLD is the
+   bit leaving the OLEN bit global history */
+#define TAGE_FOLD(COMP, NEW, OLD, OLEN, CLEN)				\
+  ((COMP) = ((COMP) << 1) | (NEW),					\
+   (COMP) ^= (OLD) << ((OLEN) % (CLEN)),				\
+   (COMP) ^= (COMP) >> (CLEN),						\
+   (COMP) &= (1 << (CLEN)) - 1)
+
+/* ITTAGE path history bit of the jump at ADDR */
+#define IND_PATH_BIT(ADDR)						\
+  ((((ADDR) >> MD_BR_SHIFT) ^ ((ADDR) >> (MD_BR_SHIFT + 3))) & 1)
+
+/* append bit BIT to global history HIST */
+static void
+hist_push(struct bpred_hist_t *hist,	/* global history */
+	  int bit)			/* history bit */
+{
+  int i, old;
+
+  bit = !!bit;
+  hist->ghist_ptr = (hist->ghist_ptr + 1) & (BPRED_TAGE_HIST_SIZE - 1);
+  hist->ghist[hist->ghist_ptr] = bit;
+
+  for (i=0; i < hist->ntables; i++)
+    {
+      old = hist->ghist[(hist->ghist_ptr - hist->hist_len[i])
+			& (BPRED_TAGE_HIST_SIZE - 1)];
+      TAGE_FOLD(hist->fidx[i], bit, old, hist->hist_len[i], hist->idx_width);
+      TAGE_FOLD(hist->ftag0[i], bit, old, hist->hist_len[i], hist->tag_width);
+      TAGE_FOLD(hist->ftag1[i], bit, old,
+		hist->hist_len[i], hist->tag_width - 1);
+    }
+}
+
+/* checkpoint global history HIST into *CKPT */
+static void
+hist_save(struct bpred_hist_t *hist,	/* global history */
+	  struct bpred_hist_ckpt_t *ckpt)/* checkpoint */
+{
+  int i;
+
+  ckpt->ghist_ptr = hist->ghist_ptr;
+  for (i=0; i < hist->ntables; i++)
+    {
+      ckpt->fidx[i] = hist->fidx[i];
+      ckpt->ftag0[i] = hist->ftag0[i];
+      ckpt->ftag1[i] = hist->ftag1[i];
+    }
+}
+
+/* restore global history HIST from checkpoint *CKPT */
+static void
+hist_restore(struct bpred_hist_t *hist,	/* global history */
+	     struct bpred_hist_ckpt_t *ckpt)/* checkpoint */
+{
+  int i;
+
+  hist->ghist_ptr = ckpt->ghist_ptr;
+  for (i=0; i < hist->ntables; i++)
+    {
+      hist->fidx[i] = ckpt->fidx[i];
+      hist->ftag0[i] = ckpt->ftag0[i];
+      hist->ftag1[i] = ckpt->ftag1[i];
+    }
+}
+
+/* predict the direction of the conditional branch at BADDR with TAGE
+   predictor PRED, lookup state is recorded in *DIR_UPDATE_PTR */
+static int				/* non-zero if predicted taken */
+tage_lookup(struct bpred_t *pred,	/* branch predictor instance */
+	    md_addr_t baddr,		/* branch address */
+	    struct bpred_update_t *dir_update_ptr)/* pred state pointer */
+{
+  struct bpred_dir_t *tage = pred->dirpred.tage;
+  struct bpred_tage_ent_t *ent;
+  char *base;
+  int i, provider = -1, altprov = -1;
+
+  for (i = tage->config.tage.hist.ntables - 1; i >= 0; i--)
+    {
+      dir_update_ptr->tage.index[i] =
+	TAGE_INDEX(&tage->config.tage.hist, baddr, i);
+      dir_update_ptr->tage.tag[i] = TAGE_TAG(&tage->config.tage.hist, baddr, i);
+
+      /* the two longest history matches provide the prediction */
+      if (altprov < 0
+	  && (tage->config.tage.table[i][dir_update_ptr->tage.index[i]].tag
+	      == dir_update_ptr->tage.tag[i]))
+	{
+	  if (provider < 0)
+	    provider = i;
+	  else
+	    altprov = i;
+	}
+    }
+  dir_update_ptr->tage.provider = provider;
+  dir_update_ptr->tage.altprov = altprov;
+
+  /* the base predictor is the alternate without a second match */
+  base = bpred_dir_lookup(pred->dirpred.bimod, baddr);
+  if (altprov >= 0)
+    dir_update_ptr->dir.alt =
+      (tage->config.tage.table[altprov][dir_update_ptr->tage.index[altprov]]
+       .ctr >= 0);
+  else
+    dir_update_ptr->dir.alt = (*base >= 2);
+
+  if (provider >= 0)
+    {
+      ent = &tage->config.tage.table[provider]
+	[dir_update_ptr->tage.index[provider]];
+      dir_update_ptr->dir.prov = (ent->ctr >= 0);
+
+      /* newly allocated entries are unreliable, the alternate prediction
+	 may be the better one */
+      dir_update_ptr->dir.newent =
+	((ent->ctr == 0 || ent->ctr == -1) && ent->u == 0);
+      dir_update_ptr->dir.usealt =
+	(dir_update_ptr->dir.newent && tage->config.tage.use_alt >= 8);
+      dir_update_ptr->dir.tage =
+	(dir_update_ptr->dir.usealt
+	 ? dir_update_ptr->dir.alt
+	 : dir_update_ptr->dir.prov);
+
+      /* the base predictor is only trained when it provides */
+      dir_update_ptr->pdir1 = NULL;
+    }
+  else
+    {
+      dir_update_ptr->dir.prov = dir_update_ptr->dir.alt;
+      dir_update_ptr->dir.newent = FALSE;
+      dir_update_ptr->dir.usealt = FALSE;
+      dir_update_ptr->dir.tage = dir_update_ptr->dir.alt;
+      dir_update_ptr->pdir1 = base;
+    }
+
+  /* speculatively update the global history with the prediction */
+  hist_push(&tage->config.tage.hist, dir_update_ptr->dir.tage);
+  dir_update_ptr->dir.pushed = TRUE;
+
+  return dir_update_ptr->dir.tage;
+}
+
+/* train the TAGE tagged tables of PRED with the resolved direction TAKEN
+   of the conditional branch looked up into *DIR_UPDATE_PTR */
+static void
+tage_update(struct bpred_t *pred,	/* branch predictor instance */
+	    int taken,			/* non-zero if branch was taken */
+	    struct bpred_update_t *dir_update_ptr)/* pred state pointer */
+{
+  struct bpred_dir_t *tage = pred->dirpred.tage;
+  struct bpred_tage_ent_t *ent;
+  int i, start, provider = dir_update_ptr->tage.provider;
+
+  taken = !!taken;
+
+  /* on a misprediction, allocate an entry in a longer history table */
+  if (dir_update_ptr->dir.tage != (unsigned int)taken
+      && provider < tage->config.tage.hist.ntables - 1)
+    {
+      /* randomly skip the first candidate table, to spread allocations */
+      start = provider + 1;
+      tage->config.tage.seed = tage->config.tage.seed * 1103515245 + 12345;
+      if (start < tage->config.tage.hist.ntables - 1
+	  && ((tage->config.tage.seed >> 16) & 1))
+	start++;
+
+      for (i = start; i < tage->config.tage.hist.ntables; i++)
+	{
+	  ent = &tage->config.tage.table[i][dir_update_ptr->tage.index[i]];
+	  if (ent->u == 0)
+	    {
+	      ent->tag = dir_update_ptr->tage.tag[i];
+	      ent->ctr = taken ? 0 : -1;
+	      pred->tage_allocs++;
+	      break;
+	    }
+	}
+
+      /* no entry available, age the candidates */
+      if (i == tage->config.tage.hist.ntables)
+	{
+	  for (i = provider + 1; i < tage->config.tage.hist.ntables; i++)
+	    {
+	      ent = &tage->config.tage.table[i][dir_update_ptr->tage.index[i]];
+	      if (ent->u > 0)
+		ent->u--;
+	    }
+	}
+    }
+
+  /* train the provider, unless it was replaced since the lookup */
+  if (provider >= 0)
+    {
+      ent = &tage->config.tage.table[provider]
+	[dir_update_ptr->tage.index[provider]];
+      if (ent->tag == dir_update_ptr->tage.tag[provider])
+	{
+	  /* learn if new entries or their alternates are more reliable */
+	  if (dir_update_ptr->dir.newent
+	      && dir_update_ptr->dir.prov != dir_update_ptr->dir.alt)
+	    {
+	      if (dir_update_ptr->dir.alt == (unsigned int)taken)
+		{
+		  if (tage->config.tage.use_alt < 15)
+		    tage->config.tage.use_alt++;
+		}
+	      else if (tage->config.tage.use_alt > 0)
+		tage->config.tage.use_alt--;
+	    }
+
+	  if (taken)
+	    {
+	      if (ent->ctr < 3)
+		ent->ctr++;
+	    }
+	  else
+	    {
+	      if (ent->ctr > -4)
+		ent->ctr--;
+	    }
+
+	  /* the provider is useful if it differs from a correct alternate */
+	  if (dir_update_ptr->dir.prov != dir_update_ptr->dir.alt)
+	    {
+	      if (dir_update_ptr->dir.prov == (unsigned int)taken)
+		{
+		  if (ent->u < 3)
+		    ent->u++;
+		}
+	      else if (ent->u > 0)
+		ent->u--;
+	    }
+	}
+    }
+
+  /* periodically decay usefulness, so stale entries can be replaced */
+  if (++tage->config.tage.tick >= BPRED_TAGE_U_PERIOD)
+    {
+      int j;
+
+      tage->config.tage.tick = 0;
+      for (i=0; i < tage->config.tage.hist.ntables; i++)
+	for (j=0; j < tage->config.tage.size; j++)
+	  tage->config.tage.table[i][j].u >>= 1;
+    }
+}
+
+/* look up the target of the indirect jump at BADDR in the ITTAGE tables
+   of PRED, BTB_TARGET is the BTB target (or zero on a BTB miss), lookup
+   state is recorded in *DIR_UPDATE_PTR */
+static md_addr_t			/* predicted target */
+ind_lookup(struct bpred_t *pred,	/* branch predictor instance */
+	   md_addr_t baddr,		/* branch address */
+	   md_addr_t btb_target,	/* BTB target, if any */
+	   struct bpred_update_t *dir_update_ptr)/* pred state pointer */
+{
+  struct bpred_ind_t *ind = pred->ind;
+  int i, provider = -1, altprov = -1;
+
+  for (i = ind->hist.ntables - 1; i >= 0; i--)
+    {
+      dir_update_ptr->ind.index[i] = TAGE_INDEX(&ind->hist, baddr, i);
+      dir_update_ptr->ind.tag[i] = TAGE_TAG(&ind->hist, baddr, i);
+
+      /* the two longest history matches provide the prediction */
+      if (altprov < 0
+	  && (ind->table[i][dir_update_ptr->ind.index[i]].tag
+	      == dir_update_ptr->ind.tag[i]))
+	{
+	  if (provider < 0)
+	    provider = i;
+	  else
+	    altprov = i;
+	}
+    }
+  dir_update_ptr->ind.provider = provider;
+  dir_update_ptr->ind.altprov = altprov;
+  dir_update_ptr->dir.ind = TRUE;
+
+  /* the BTB is the alternate without a second match */
+  if (altprov >= 0)
+    dir_update_ptr->ind.alt_target =
+      ind->table[altprov][dir_update_ptr->ind.index[altprov]].target;
+  else
+    dir_update_ptr->ind.alt_target = btb_target;
+
+  if (provider >= 0)
+    dir_update_ptr->ind.target =
+      ind->table[provider][dir_update_ptr->ind.index[provider]].target;
+  else
+    dir_update_ptr->ind.target = dir_update_ptr->ind.alt_target;
+
+  return dir_update_ptr->ind.target;
+}
+
+/* train the ITTAGE tables of PRED with the resolved target BTARGET of the
+   indirect jump looked up into *DIR_UPDATE_PTR */
+static void
+ind_update(struct bpred_t *pred,	/* branch predictor instance */
+	   md_addr_t btarget,		/* resolved branch target */
+	   struct bpred_update_t *dir_update_ptr)/* pred state pointer */
+{
+  struct bpred_ind_t *ind = pred->ind;
+  struct bpred_ind_ent_t *ent;
+  int i, start, provider = dir_update_ptr->ind.provider;
+
+  /* on a misprediction, allocate an entry in a longer history table */
+  if (dir_update_ptr->ind.target != btarget
+      && provider < ind->hist.ntables - 1)
+    {
+      /* randomly skip the first candidate table, to spread allocations */
+      start = provider + 1;
+      ind->seed = ind->seed * 1103515245 + 12345;
+      if (start < ind->hist.ntables - 1 && ((ind->seed >> 16) & 1))
+	start++;
+
+      for (i = start; i < ind->hist.ntables; i++)
+	{
+	  ent = &ind->table[i][dir_update_ptr->ind.index[i]];
+	  if (ent->u == 0)
+	    {
+	      ent->tag = dir_update_ptr->ind.tag[i];
+	      ent->target = btarget;
+	      ent->ctr = 0;
+	      pred->ind_allocs++;
+	      break;
+	    }
+	}
+
+      /* no entry available, age the candidates */
+      if (i == ind->hist.ntables)
+	{
+	  for (i = provider + 1; i < ind->hist.ntables; i++)
+	    {
+	      ent = &ind->table[i][dir_update_ptr->ind.index[i]];
+	      if (ent->u > 0)
+		ent->u--;
+	    }
+	}
+    }
+
+  /* train the provider, unless it was replaced since the lookup */
+  if (provider >= 0)
+    {
+      ent = &ind->table[provider][dir_update_ptr->ind.index[provider]];
+      if (ent->tag == dir_update_ptr->ind.tag[provider])
+	{
+	  /* the provider is useful if it differs from a wrong alternate */
+	  if (dir_update_ptr->ind.target != dir_update_ptr->ind.alt_target)
+	    {
+	      if (dir_update_ptr->ind.target == btarget)
+		{
+		  if (ent->u < 3)
+		    ent->u++;
+		}
+	      else if (ent->u > 0)
+		ent->u--;
+	    }
+
+	  /* a target is only replaced once its confidence is exhausted */
+	  if (ent->target == btarget)
+	    {
+	      if (ent->ctr < 3)
+		ent->ctr++;
+	    }
+	  else if (ent->ctr > 0)
+	    ent->ctr--;
+	  else
+	    ent->target = btarget;
+	}
+    }
+
+  /* periodically decay usefulness, so stale entries can be replaced */
+  if (++ind->tick >= BPRED_TAGE_U_PERIOD)
+    {
+      int j;
+
+      ind->tick = 0;
+      for (i=0; i < ind->hist.ntables; i++)
+	for (j=0; j < ind->size; j++)
+	  ind->table[i][j].u >>= 1;
+    }
+}
+
 /* probe a predictor for a next fetch address, the predictor is probed
    with branch address BADDR, the branch target is BTARGET (used for
    static predictors), and OP is the instruction opcode (used to simulate
@@ -562,7 +1208,7 @@ bpred_lookup(struct bpred_t *pred,	/* branch predictor instance */
 					 * used on mispredict recovery */
 {
   struct bpred_btb_ent_t *pbtb = NULL;
-  int index, i;
+  int index, i, pred_taken = FALSE;
 
   if (!dir_update_ptr)
     panic("no bpred update record");
@@ -577,6 +1223,10 @@ bpred_lookup(struct bpred_t *pred,	/* branch predictor instance */
   dir_update_ptr->pdir1 = NULL;
   dir_update_ptr->pdir2 = NULL;
   dir_update_ptr->pmeta = NULL;
+  dir_update_ptr->pbtb = NULL;
+  dir_update_ptr->dir.pushed = FALSE;
+  dir_update_ptr->dir.ind = FALSE;
+  dir_update_ptr->dir.ipushed = FALSE;
   /* Except for jumps, get a pointer to direction-prediction bits */
   switch (pred->class) {
     case BPredComb:
@@ -616,6 +1266,14 @@ bpred_lookup(struct bpred_t *pred,	/* branch predictor instance */
 	    bpred_dir_lookup (pred->dirpred.bimod, baddr);
 	}
       break;
+    case BPredTAGE:
+      /* all control insts checkpoint the speculative global history,
+	 only conditional branches update it */
+      hist_save(&pred->dirpred.tage->config.tage.hist,
+		&dir_update_ptr->tage.ckpt);
+      if ((MD_OP_FLAGS(op) & (F_CTRL|F_UNCOND)) != (F_CTRL|F_UNCOND))
+	pred_taken = tage_lookup(pred, baddr, dir_update_ptr);
+      break;
     case BPredTaken:
       return btarget;
     case BPredNotTaken:
@@ -635,6 +1293,28 @@ bpred_lookup(struct bpred_t *pred,	/* branch predictor instance */
    * We have a stateful predictor, and have gotten a pointer into the
    * direction predictor (except for jumps, for which the ptr is null)
    */
+  if (pred->class != BPredTAGE && dir_update_ptr->pdir1)
+    pred_taken = (*(dir_update_ptr->pdir1) >= 2);
+
+  /* the ITTAGE path history records the direction of each conditional
+     branch and an address bit of each jump, indirect jumps predicted by
+     ITTAGE push their bit after the target lookup below */
+  if (pred->ind)
+    {
+      hist_save(&pred->ind->hist, &dir_update_ptr->ind.ckpt);
+      dir_update_ptr->dir.ipushed = TRUE;
+      if ((MD_OP_FLAGS(op) & (F_CTRL|F_UNCOND)) != (F_CTRL|F_UNCOND))
+	{
+	  dir_update_ptr->dir.icond = TRUE;
+	  hist_push(&pred->ind->hist, pred_taken);
+	}
+      else
+	{
+	  dir_update_ptr->dir.icond = FALSE;
+	  if (!MD_IS_INDIR(op) || (is_return && pred->retstack.size))
+	    hist_push(&pred->ind->hist, IND_PATH_BIT(baddr));
+	}
+    }
 
   /* record pre-pop TOS; if this branch is executed speculatively
    * and is squashed, we'll restore the TOS and hope the data
@@ -667,50 +1347,52 @@ bpred_lookup(struct bpred_t *pred,	/* branch predictor instance */
 #endif /* !RAS_BUG_COMPATIBLE */
   
   /* not a return. Get a pointer into the BTB */
-  index = (baddr >> MD_BR_SHIFT) & (pred->btb.sets - 1);
-
-  if (pred->btb.assoc > 1)
-    {
-      index *= pred->btb.assoc;
+  index = BTB_HASH(pred, baddr) * pred->btb.assoc;
 
-      /* Now we know the set; look for a PC match */
-      for (i = index; i < (index+pred->btb.assoc) ; i++)
-	if (pred->btb.btb_data[i].addr == baddr)
-	  {
-	    /* match */
-	    pbtb = &pred->btb.btb_data[i];
-	    break;
-	  }
-    }	
-  else
-    {
-      pbtb = &pred->btb.btb_data[index];
-      if (pbtb->addr != baddr)
-	pbtb = NULL;
-    }
+  /* Now we know the set; look for a PC match */
+  for (i = index; i < (index+pred->btb.assoc) ; i++)
+    if (pred->btb.btb_data[i].addr == baddr)
+      {
+	/* match */
+	pbtb = &pred->btb.btb_data[i];
+	break;
+      }
 
   /*
-   * We now also have a pointer into the BTB for a hit, or NULL otherwise
+   * We now also have a pointer into the BTB for a hit, or NULL otherwise,
+   * it is remembered so the update can skip the search
    */
+  dir_update_ptr->pbtb = pbtb;
 
   /* if this is a jump, ignore predicted direction; we know it's taken. */
   if ((MD_OP_FLAGS(op) & (F_CTRL|F_UNCOND)) == (F_CTRL|F_UNCOND))
     {
+      /* indirect jumps which did not use the RAS may be predicted by
+	 ITTAGE, which falls back to the BTB target */
+      if (pred->ind && MD_IS_INDIR(op))
+	{
+	  md_addr_t target =
+	    ind_lookup(pred, baddr, pbtb ? pbtb->target : 0, dir_update_ptr);
+
+	  hist_push(&pred->ind->hist, IND_PATH_BIT(baddr));
+	  return (target ? target : 1);
+	}
       return (pbtb ? pbtb->target : 1);
     }
 
   /* otherwise we have a conditional branch */
+
   if (pbtb == NULL)
     {
       /* BTB miss -- just return a predicted direction */
-      return ((*(dir_update_ptr->pdir1) >= 2)
+      return (pred_taken
 	      ? /* taken */ 1
 	      : /* not taken */ 0);
     }
   else
     {
       /* BTB hit, so return target if it's a predicted-taken branch */
-      return ((*(dir_update_ptr->pdir1) >= 2)
+      return (pred_taken
 	      ? /* taken */ pbtb->target
 	      : /* not taken */ 0);
     }
@@ -723,6 +1405,8 @@ bpred_lookup(struct bpred_t *pred,	/* branch predictor instance */
 void
 bpred_recover(struct bpred_t *pred,	/* branch predictor instance */
 	      md_addr_t baddr,		/* branch address */
+	      int taken,		/* non-zero if branch was taken */
+	      struct bpred_update_t *dir_update_ptr, /* pred state pointer */
 	      int stack_recover_idx)	/* Non-speculative top-of-stack;
 					 * used on mispredict recovery */
 {
@@ -730,6 +1414,23 @@ bpred_recover(struct bpred_t *pred,	/* branch predictor instance */
     return;
 
   pred->retstack.tos = stack_recover_idx;
+
+  /* restore the global histories to their state before the branch, and
+     append the resolved direction */
+  if (pred->class == BPredTAGE)
+    {
+      struct bpred_hist_t *hist = &pred->dirpred.tage->config.tage.hist;
+
+      hist_restore(hist, &dir_update_ptr->tage.ckpt);
+      if (dir_update_ptr->dir.pushed)
+	hist_push(hist, taken);
+    }
+  if (pred->ind && dir_update_ptr->dir.ipushed)
+    {
+      hist_restore(&pred->ind->hist, &dir_update_ptr->ind.ckpt);
+      hist_push(&pred->ind->hist,
+		dir_update_ptr->dir.icond ? taken : IND_PATH_BIT(baddr));
+    }
 }
 
 /* update the branch predictor, only useful for stateful predictors; updates
@@ -751,7 +1452,7 @@ bpred_update(struct bpred_t *pred,	/* branch predictor instance */
 	     struct bpred_update_t *dir_update_ptr)/* pred state pointer */
 {
   struct bpred_btb_ent_t *pbtb = NULL;
-  struct bpred_btb_ent_t *lruhead = NULL, *lruitem = NULL;
+  struct bpred_btb_ent_t *lruitem = NULL;
   int index, i;
 
   /* don't change bpred state for non-branch instructions or if this
@@ -777,7 +1478,14 @@ bpred_update(struct bpred_t *pred,	/* branch predictor instance */
     }
   else if ((MD_OP_FLAGS(op) & (F_CTRL|F_COND)) == (F_CTRL|F_COND))
     {
-      if (dir_update_ptr->dir.meta)
+      if (pred->class == BPredTAGE)
+	{
+	  if (dir_update_ptr->tage.provider >= 0)
+	    pred->used_tagged++;
+	  if (dir_update_ptr->dir.usealt)
+	    pred->used_alt++;
+	}
+      else if (dir_update_ptr->dir.meta)
 	pred->used_2lev++;
       else
 	pred->used_bimod++;
@@ -796,6 +1504,19 @@ bpred_update(struct bpred_t *pred,	/* branch predictor instance */
 	  pred->jr_non_ras_seen++;
 	  if (correct)
 	    pred->jr_non_ras_hits++;
+	  else
+	    pred->indir_misses++;
+
+	  if (dir_update_ptr->dir.ind)
+	    {
+	      if (dir_update_ptr->ind.provider >= 0)
+		{
+		  pred->ind_used++;
+		  if (dir_update_ptr->ind.target == btarget)
+		    pred->ind_hits++;
+		}
+	      ind_update(pred, btarget, dir_update_ptr);
+	    }
 	}
       else
 	{
@@ -840,69 +1561,44 @@ bpred_update(struct bpred_t *pred,	/* branch predictor instance */
 	shift_reg & ((1 << pred->dirpred.twolev->config.two.shift_width) - 1);
     }
 
+  /* train the TAGE tagged tables */
+  if (pred->class == BPredTAGE
+      && (MD_OP_FLAGS(op) & (F_CTRL|F_UNCOND)) != (F_CTRL|F_UNCOND))
+    tage_update(pred, taken, dir_update_ptr);
+
   /* find BTB entry if it's a taken branch (don't allocate for non-taken) */
   if (taken)
     {
-      index = (baddr >> MD_BR_SHIFT) & (pred->btb.sets - 1);
-      
-      if (pred->btb.assoc > 1)
+      index = BTB_HASH(pred, baddr) * pred->btb.assoc;
+
+      /* the entry found at lookup is still valid if it was not replaced */
+      pbtb = dir_update_ptr->pbtb;
+      if (pbtb && pbtb->addr != baddr)
+	pbtb = NULL;
+
+      /* Now we know the set; look for a PC match; also identify the LRU
+       * item */
+      for (i = index; i < (index+pred->btb.assoc) ; i++)
 	{
-	  index *= pred->btb.assoc;
-	  
-	  /* Now we know the set; look for a PC match; also identify
-	   * MRU and LRU items */
-	  for (i = index; i < (index+pred->btb.assoc) ; i++)
-	    {
-	      if (pred->btb.btb_data[i].addr == baddr)
-		{
-		  /* match */
-		  assert(!pbtb);
-		  pbtb = &pred->btb.btb_data[i];
-		}
-	      
-	      dassert(pred->btb.btb_data[i].prev 
-		      != pred->btb.btb_data[i].next);
-	      if (pred->btb.btb_data[i].prev == NULL)
-		{
-		  /* this is the head of the lru list, ie current MRU item */
-		  dassert(lruhead == NULL);
-		  lruhead = &pred->btb.btb_data[i];
-		}
-	      if (pred->btb.btb_data[i].next == NULL)
-		{
-		  /* this is the tail of the lru list, ie the LRU item */
-		  dassert(lruitem == NULL);
-		  lruitem = &pred->btb.btb_data[i];
-		}
-	    }
-	  dassert(lruhead && lruitem);
-	  
-	  if (!pbtb)
-	    /* missed in BTB; choose the LRU item in this set as the victim */
-	    pbtb = lruitem;	
-	  /* else hit, and pbtb points to matching BTB entry */
-	  
-	  /* Update LRU state: selected item, whether selected because it
-	   * matched or because it was LRU and selected as a victim, becomes 
-	   * MRU */
-	  if (pbtb != lruhead)
-	    {
-	      /* this splices out the matched entry... */
-	      if (pbtb->prev)
-		pbtb->prev->next = pbtb->next;
-	      if (pbtb->next)
-		pbtb->next->prev = pbtb->prev;
-	      /* ...and this puts the matched entry at the head of the list */
-	      pbtb->next = lruhead;
-	      pbtb->prev = NULL;
-	      lruhead->prev = pbtb;
-	      dassert(pbtb->prev || pbtb->next);
-	      dassert(pbtb->prev != pbtb->next);
-	    }
-	  /* else pbtb is already MRU item; do nothing */
+	  if (!pbtb && pred->btb.btb_data[i].addr == baddr)
+	    pbtb = &pred->btb.btb_data[i];
+	  if (pred->btb.btb_data[i].lru == (unsigned int)pred->btb.assoc - 1)
+	    lruitem = &pred->btb.btb_data[i];
 	}
-      else
-	pbtb = &pred->btb.btb_data[index];
+      dassert(lruitem);
+
+      if (!pbtb)
+	/* missed in BTB; choose the LRU item in this set as the victim */
+	pbtb = lruitem;	
+      /* else hit, and pbtb points to matching BTB entry */
+
+      /* Update LRU state: selected item, whether selected because it
+       * matched or because it was LRU and selected as a victim, becomes 
+       * MRU */
+      for (i = index; i < (index+pred->btb.assoc) ; i++)
+	if (pred->btb.btb_data[i].lru < pbtb->lru)
+	  pred->btb.btb_data[i].lru++;
+      pbtb->lru = 0;
     }
       
   /* 
@@ -978,7 +1674,6 @@ bpred_update(struct bpred_t *pred,	/* branch predictor instance */
 	{
 	  /* enter a new branch in the table */
 	  pbtb->addr = baddr;
-	  pbtb->op = op;
 	  pbtb->target = btarget;
 	}
     }
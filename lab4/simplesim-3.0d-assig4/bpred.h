@@ -91,10 +91,32 @@
  *		are incremented on taken branches and decremented on
  *		no taken branches.  One BTB entry per counter.
  *
+ *	BPredTAGE:  tagged geometric history length predictor (Seznec)
+ *
+ *		A bimodal base predictor backed by N partially tagged tables
+ *		indexed with global histories of geometrically increasing
+ *		lengths.  The longest history table with a matching tag
+ *		provides the prediction.  The global history is updated
+ *		speculatively at lookup, each lookup records a checkpoint of
+ *		the history which bpred_recover() restores.  Parameters are:
+ *		     B   # entries in the bimodal base predictor
+ *		     N   # tagged tables (at most BPRED_TAGE_MAX_TABLES)
+ *		     M   # entries per tagged table
+ *		     T   tag width in bits
+ *		     L1  shortest history length
+ *		     LN  longest history length
+ *
  *	BPredTaken:  static predict branch taken
  *
  *	BPredNotTaken:  static predict branch not taken
  *
+ * Any of the stateful predictors can be extended with an ITTAGE indirect
+ * target predictor (see bpred_ind_create()), which predicts the targets of
+ * indirect jumps that do not use the return-address stack.  It is built
+ * like BPredTAGE, but its tagged tables hold targets and are indexed with
+ * a path history that records the direction of each conditional branch and
+ * an address bit of each jump.  The BTB target is used when no tag matches.
+ *
  */
 
 /* branch predictor types */
@@ -104,15 +126,69 @@ enum bpred_class {
   BPred2bit,			/* 2-bit saturating cntr pred (dir mapped) */
   BPredTaken,			/* static predict taken */
   BPredNotTaken,		/* static predict not taken */
+  BPredTAGE,			/* tagged geometric history length pred */
   BPred_NUM
 };
 
-/* an entry in a BTB */
+/* an entry in a BTB, the BTB is set-associative, and the sets are indexed
+   with a hash of the branch address */
 struct bpred_btb_ent_t {
   md_addr_t addr;		/* address of branch being tracked */
-  enum md_opcode op;		/* opcode of branch corresp. to addr */
   md_addr_t target;		/* last destination of branch when taken */
-  struct bpred_btb_ent_t *prev, *next; /* lru chaining pointers */
+  unsigned int lru;		/* LRU position in set, 0 is the MRU entry */
+};
+
+/* TAGE predictor limits */
+#define BPRED_TAGE_MAX_TABLES	8	/* max tagged tables */
+#define BPRED_TAGE_HIST_SIZE	4096	/* global history buffer, power of 2 */
+
+/* speculative global history of the tagged (TAGE and ITTAGE) predictors,
+   with the history folded down to index and tag widths for each table */
+struct bpred_hist_t {
+  int ntables;			/* number of tagged tables */
+  int idx_width;		/* table index width in bits */
+  int tag_width;		/* tag width in bits */
+  int hist_len[BPRED_TAGE_MAX_TABLES]; /* history length per table */
+  unsigned char *ghist;		/* global history buffer */
+  int ghist_ptr;		/* most recent history bit in ghist[] */
+  unsigned int fidx[BPRED_TAGE_MAX_TABLES];	/* folded index history */
+  unsigned int ftag0[BPRED_TAGE_MAX_TABLES];	/* folded tag histories */
+  unsigned int ftag1[BPRED_TAGE_MAX_TABLES];
+};
+
+/* checkpoint of a speculative global history */
+struct bpred_hist_ckpt_t {
+  int ghist_ptr;		/* history pointer */
+  unsigned short fidx[BPRED_TAGE_MAX_TABLES];	/* folded histories */
+  unsigned short ftag0[BPRED_TAGE_MAX_TABLES];
+  unsigned short ftag1[BPRED_TAGE_MAX_TABLES];
+};
+
+/* an entry in a TAGE tagged table */
+struct bpred_tage_ent_t {
+  signed char ctr;		/* 3-bit signed prediction counter */
+  unsigned char u;		/* 2-bit usefulness counter */
+  unsigned short tag;		/* partial tag */
+};
+
+/* an entry in an ITTAGE tagged table */
+struct bpred_ind_ent_t {
+  md_addr_t target;		/* predicted target */
+  unsigned short tag;		/* partial tag */
+  unsigned char ctr;		/* 2-bit target confidence counter */
+  unsigned char u;		/* 2-bit usefulness counter */
+};
+
+/* ITTAGE indirect target predictor, predicts the targets of indirect
+   jumps which do not use the return-address stack from tagged tables
+   indexed with a path history of geometrically increasing lengths, the
+   BTB target is used when no table matches */
+struct bpred_ind_t {
+  int size;			/* entries per tagged table */
+  struct bpred_ind_ent_t *table[BPRED_TAGE_MAX_TABLES]; /* tables */
+  struct bpred_hist_t hist;	/* speculative path history */
+  unsigned int tick;		/* updates since last usefulness decay */
+  unsigned int seed;		/* allocation randomizer state */
 };
 
 /* direction predictor def */
@@ -131,6 +207,14 @@ struct bpred_dir_t {
       int *shiftregs;		/* level-1 history table */
       unsigned char *l2table;	/* level-2 prediction state table */
     } two;
+    struct {
+      int size;			/* entries per tagged table */
+      struct bpred_tage_ent_t *table[BPRED_TAGE_MAX_TABLES]; /* tables */
+      struct bpred_hist_t hist;	/* speculative global history */
+      int use_alt;		/* use alt pred for new entries? (4 bits) */
+      unsigned int tick;	/* updates since last usefulness decay */
+      unsigned int seed;	/* allocation randomizer state */
+    } tage;
   } config;
 };
 
@@ -141,10 +225,12 @@ struct bpred_t {
     struct bpred_dir_t *bimod;	  /* first direction predictor */
     struct bpred_dir_t *twolev;	  /* second direction predictor */
     struct bpred_dir_t *meta;	  /* meta predictor */
+    struct bpred_dir_t *tage;	  /* TAGE tagged tables */
   } dirpred;
 
   struct {
     int sets;			/* num BTB sets */
+    int log_sets;		/* log2 of num BTB sets */
     int assoc;			/* BTB associativity */
     struct bpred_btb_ent_t *btb_data; /* BTB addr-prediction table */
   } btb;
@@ -155,16 +241,26 @@ struct bpred_t {
     struct bpred_btb_ent_t *stack; /* return-address stack */
   } retstack;
 
+  struct bpred_ind_t *ind;	/* indirect target predictor, if any */
+  char *prefix;			/* stat name prefix, NULL for none */
+
   /* stats */
   counter_t addr_hits;		/* num correct addr-predictions */
   counter_t dir_hits;		/* num correct dir-predictions (incl addr) */
   counter_t used_ras;		/* num RAS predictions used */
   counter_t used_bimod;		/* num bimodal predictions used (BPredComb) */
   counter_t used_2lev;		/* num 2-level predictions used (BPredComb) */
+  counter_t used_tagged;	/* num tagged predictions used (BPredTAGE) */
+  counter_t used_alt;		/* num alternate predictions used (BPredTAGE) */
+  counter_t tage_allocs;	/* num tagged entries allocated (BPredTAGE) */
   counter_t jr_hits;		/* num correct addr-predictions for JR's */
   counter_t jr_seen;		/* num JR's seen */
   counter_t jr_non_ras_hits;	/* num correct addr-preds for non-RAS JR's */
   counter_t jr_non_ras_seen;	/* num non-RAS JR's seen */
+  counter_t indir_misses;	/* num non-RAS JR target mispredictions */
+  counter_t ind_used;		/* num ITTAGE target predictions used */
+  counter_t ind_hits;		/* num correct ITTAGE target predictions */
+  counter_t ind_allocs;		/* num ITTAGE entries allocated */
   counter_t misses;		/* num incorrect predictions */
 
   counter_t lookups;		/* num lookups */
@@ -178,12 +274,38 @@ struct bpred_update_t {
   char *pdir1;		/* direction-1 predictor counter */
   char *pdir2;		/* direction-2 predictor counter */
   char *pmeta;		/* meta predictor counter */
+  struct bpred_btb_ent_t *pbtb;	/* BTB entry hit at lookup, if any */
   struct {		/* predicted directions */
     unsigned int ras    : 1;	/* RAS used */
     unsigned int bimod  : 1;    /* bimodal predictor */
     unsigned int twolev : 1;    /* 2-level predictor */
     unsigned int meta   : 1;    /* meta predictor (0..bimod / 1..2lev) */
+    unsigned int tage   : 1;	/* TAGE final prediction */
+    unsigned int prov   : 1;	/* TAGE provider prediction */
+    unsigned int alt    : 1;	/* TAGE alternate prediction */
+    unsigned int newent : 1;	/* TAGE provider is newly allocated */
+    unsigned int usealt : 1;	/* TAGE used the alternate prediction */
+    unsigned int pushed : 1;	/* TAGE pushed a history bit */
+    unsigned int ind    : 1;	/* ITTAGE looked up this jump's target */
+    unsigned int ipushed: 1;	/* ITTAGE pushed a path history bit */
+    unsigned int icond  : 1;	/* ... and it was a branch direction */
   } dir;
+  struct {		/* TAGE lookup state and history checkpoint */
+    signed char provider;	/* providing table, -1 for base predictor */
+    signed char altprov;	/* alternate table, -1 for base predictor */
+    unsigned short index[BPRED_TAGE_MAX_TABLES]; /* table indices */
+    unsigned short tag[BPRED_TAGE_MAX_TABLES];	/* computed tags */
+    struct bpred_hist_ckpt_t ckpt;	/* history before the lookup */
+  } tage;
+  struct {		/* ITTAGE lookup state and history checkpoint */
+    signed char provider;	/* providing table, -1 for BTB */
+    signed char altprov;	/* alternate table, -1 for BTB */
+    unsigned short index[BPRED_TAGE_MAX_TABLES]; /* table indices */
+    unsigned short tag[BPRED_TAGE_MAX_TABLES];	/* computed tags */
+    md_addr_t target;		/* ITTAGE predicted target */
+    md_addr_t alt_target;	/* alternate predicted target */
+    struct bpred_hist_ckpt_t ckpt;	/* history before the lookup */
+  } ind;
 };
 
 /* create a branch predictor */
@@ -199,6 +321,27 @@ bpred_create(enum bpred_class class,	/* type of predictor to create */
 	     unsigned int btb_assoc,	/* BTB associativity */
 	     unsigned int retstack_size);/* num entries in ret-addr stack */
 
+/* create a TAGE branch predictor */
+struct bpred_t *			/* branch predictory instance */
+bpred_tage_create(unsigned int bimod_size,/* base predictor table size */
+		  unsigned int ntables,	/* number of tagged tables */
+		  unsigned int table_size,/* entries per tagged table */
+		  unsigned int tag_width,/* tag width in bits */
+		  unsigned int min_hist,/* shortest history length */
+		  unsigned int max_hist,/* longest history length */
+		  unsigned int btb_sets,/* number of sets in BTB */
+		  unsigned int btb_assoc,/* BTB associativity */
+		  unsigned int retstack_size);/* num entries in ret-addr stack */
+
+/* attach an ITTAGE indirect target predictor to branch predictor PRED */
+void
+bpred_ind_create(struct bpred_t *pred,	/* branch predictor instance */
+		 unsigned int ntables,	/* number of tagged tables */
+		 unsigned int table_size,/* entries per tagged table */
+		 unsigned int tag_width,/* tag width in bits */
+		 unsigned int min_hist,	/* shortest history length */
+		 unsigned int max_hist);/* longest history length */
+
 /* create a branch direction predictor */
 struct bpred_dir_t *		/* branch direction predictor instance */
 bpred_dir_create (
@@ -247,10 +390,14 @@ bpred_lookup(struct bpred_t *pred,	/* branch predictor instance */
 /* Speculative execution can corrupt the ret-addr stack.  So for each
  * lookup we return the top-of-stack (TOS) at that point; a mispredicted
  * branch, as part of its recovery, restores the TOS using this value --
- * hopefully this uncorrupts the stack. */
+ * hopefully this uncorrupts the stack.  Predictors with speculatively
+ * updated global history (BPredTAGE) restore the history checkpointed in
+ * *DIR_UPDATE_PTR, and append the resolved direction TAKEN. */
 void
 bpred_recover(struct bpred_t *pred,	/* branch predictor instance */
 	      md_addr_t baddr,		/* branch address */
+	      int taken,		/* non-zero if branch was taken */
+	      struct bpred_update_t *dir_update_ptr, /* pred state pointer */
 	      int stack_recover_idx);	/* Non-speculative top-of-stack;
 					 * used on mispredict recovery */
 
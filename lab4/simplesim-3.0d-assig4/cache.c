@@ -256,6 +256,115 @@ update_way_list(struct cache_set_t *set,	/* set contained way chain */
     panic("bogus WHERE designator");
 }
 
+/* account the MSHR occupancy of cache CP from the last update up to NOW */
+static void
+mshr_account(struct cache_t *cp,	/* cache instance */
+	     tick_t now)		/* account up to this time */
+{
+  tick_t n;
+
+  if (now <= cp->mshr_time)
+    return;
+
+  n = now - cp->mshr_time;
+  if (cp->mshr_num)
+    {
+      cp->mshr_busy_cycles += n;
+      cp->mshr_occ_cycles += n * cp->mshr_num;
+      if (cp->mshr_mlp_dist)
+	stat_add_samples(cp->mshr_mlp_dist, cp->mshr_num, (int)n);
+    }
+  cp->mshr_time = now;
+}
+
+/* return the busy MSHR of cache CP whose fill completes first */
+static struct cache_mshr_t *
+mshr_earliest(struct cache_t *cp)	/* cache instance */
+{
+  struct cache_mshr_t *first = &cp->mshrs[0];
+  int i;
+
+  for (i=1; i < cp->mshr_num; i++)
+    {
+      if (cp->mshrs[i].ready < first->ready)
+	first = &cp->mshrs[i];
+    }
+  return first;
+}
+
+/* free the MSHRs of cache CP whose fills complete by NOW, in completion
+   order so that the occupancy of the cycles in between is accounted */
+static void
+mshr_advance(struct cache_t *cp,	/* cache instance */
+	     tick_t now)		/* current time */
+{
+  struct cache_mshr_t *mshr;
+
+  /* MSHRs completing by the last update have already been freed */
+  if (now <= cp->mshr_time)
+    return;
+
+  while (cp->mshr_num > 0)
+    {
+      mshr = mshr_earliest(cp);
+      if (mshr->ready > now)
+	break;
+
+      mshr_account(cp, mshr->ready);
+      *mshr = cp->mshrs[--cp->mshr_num];
+    }
+  mshr_account(cp, now);
+}
+
+/* return the busy MSHR of cache CP filling block BADDR, or NULL if none */
+static struct cache_mshr_t *
+mshr_lookup(struct cache_t *cp,		/* cache instance */
+	    md_addr_t baddr)		/* block address */
+{
+  int i;
+
+  for (i=0; i < cp->mshr_num; i++)
+    {
+      if (cp->mshrs[i].baddr == baddr)
+	return &cp->mshrs[i];
+    }
+  return NULL;
+}
+
+/* return the latency of a hit at NOW to block BLK holding ADDR, a hit to a
+   block whose fill is still in flight is a secondary miss, it merges into
+   the MSHR of the fill or, if that MSHR has no free target, is replayed
+   once the fill completes */
+static INLINE unsigned int
+hit_lat(struct cache_t *cp,		/* cache instance */
+	struct cache_blk_t *blk,	/* block hit */
+	md_addr_t addr,			/* address of access */
+	tick_t now,			/* time of access */
+	int prefetch)		/* 1 if the access is a prefetch */
+{
+  struct cache_mshr_t *mshr;
+
+  if (!cp->mshrs || prefetch || blk->ready <= now)
+    return (int) MAX(cp->hit_latency, (blk->ready - now));
+
+  mshr_advance(cp, now);
+  mshr = mshr_lookup(cp, CACHE_BADDR(cp, addr));
+
+  /* fills initiated by prefetches do not hold an MSHR */
+  if (!mshr || mshr->ntargets < cp->mshr_ntargets)
+    {
+      if (mshr)
+	{
+	  mshr->ntargets++;
+	  cp->mshr_merges++;
+	}
+      return (int) MAX(cp->hit_latency, (blk->ready - now));
+    }
+
+  cp->mshr_target_stalls++;
+  return (int) (blk->ready - now) + cp->hit_latency;
+}
+
 /* create and initialize a general cache structure */
 struct cache_t *			/* pointer to cache created */
 cache_create(char *name,		/* name of the cache */
@@ -314,6 +423,9 @@ cache_create(char *name,		/* name of the cache */
   cp->policy = policy;
   cp->hit_latency = hit_latency;
   cp->prefetch_type = prefetch_type;
+  cp->stride_rpt = NULL;
+  cp->prefetch_schedule = NULL;
+  cp->prefetch_clock = 0;
 
   /* miss/replacement functions */
   cp->blk_access_fn = blk_access_fn;
@@ -348,6 +460,14 @@ cache_create(char *name,		/* name of the cache */
   cp->prefetch_hits = 0;
   cp->prefetch_misses = 0;
 
+  /* no MSHR file until one is set with cache_set_mshrs() */
+  cp->mshr_nentries = 0;
+  cp->mshr_ntargets = 0;
+  cp->mshrs = NULL;
+  cp->mshr_num = 0;
+  cp->mshr_time = 0;
+  cp->mshr_mlp_dist = NULL;
+
   /* blow away the last block accessed */
   cp->last_tagset = 0;
   cp->last_blk = NULL;
@@ -411,6 +531,50 @@ cache_create(char *name,		/* name of the cache */
   return cp;
 }
 
+/* give cache CP a file of NENTRIES MSHRs with up to NTARGETS merged accesses
+   each, zero NENTRIES removes the MSHR file, must be called before the
+   cache stats are registered */
+void
+cache_set_mshrs(struct cache_t *cp,	/* cache instance */
+		int nentries,		/* number of MSHRs, 0 for none */
+		int ntargets)		/* accesses merged into one MSHR */
+{
+  if (nentries < 0)
+    fatal("cache `%s': number of MSHRs `%d' must be non-negative",
+	  cp->name, nentries);
+  if (nentries > 0 && ntargets < 1)
+    fatal("cache `%s': MSHR targets `%d' must be positive non-zero",
+	  cp->name, ntargets);
+
+  if (cp->mshrs)
+    free(cp->mshrs);
+  cp->mshrs = NULL;
+  cp->mshr_nentries = nentries;
+  cp->mshr_ntargets = ntargets;
+  cp->mshr_num = 0;
+
+  if (nentries > 0)
+    {
+      cp->mshrs = (struct cache_mshr_t *)
+	calloc(nentries, sizeof(struct cache_mshr_t));
+      if (!cp->mshrs)
+	fatal("out of virtual memory");
+    }
+}
+
+/* return non-zero if all MSHRs of cache CP are busy at NOW, i.e., a primary
+   miss initiated at NOW would have to wait for an MSHR */
+int					/* non-zero if MSHR file full */
+cache_mshr_full(struct cache_t *cp,	/* cache instance */
+		tick_t now)		/* time of access */
+{
+  if (!cp->mshrs)
+    return FALSE;
+
+  mshr_advance(cp, now);
+  return cp->mshr_num == cp->mshr_nentries;
+}
+
 /* parse policy */
 enum cache_policy			/* replacement policy enum */
 cache_char2policy(char c)		/* replacement policy as a char */
@@ -439,6 +603,10 @@ cache_config(struct cache_t *cp,	/* cache instance */
 	  : cp->policy == FIFO ? "FIFO"
 	  : (abort(), ""),
 	  cp->prefetch_type);
+  if (cp->mshrs)
+    fprintf(stream,
+	    "cache: %s: %d MSHRs, %d targets/MSHR\n",
+	    cp->name, cp->mshr_nentries, cp->mshr_ntargets);
 }
 
 /* register cache stats */
@@ -502,7 +670,36 @@ cache_reg_stats(struct cache_t *cp,	/* cache instance */
   sprintf(buf, "%s.prefetch_misses", name);
   stat_reg_counter(sdb, buf, "total number of prefetch misses", &cp->prefetch_misses, 0, NULL);
 
-
+  if (cp->mshrs)
+    {
+      sprintf(buf, "%s.mshr_merges", name);
+      stat_reg_counter(sdb, buf, "secondary misses merged into an MSHR",
+		       &cp->mshr_merges, 0, NULL);
+      sprintf(buf, "%s.mshr_full_stalls", name);
+      stat_reg_counter(sdb, buf, "primary misses delayed by full MSHR file",
+		       &cp->mshr_full_stalls, 0, NULL);
+      sprintf(buf, "%s.mshr_target_stalls", name);
+      stat_reg_counter(sdb, buf, "secondary misses delayed by full targets",
+		       &cp->mshr_target_stalls, 0, NULL);
+      sprintf(buf, "%s.mshr_busy_cycles", name);
+      stat_reg_counter(sdb, buf, "cycles with at least one miss outstanding",
+		       &cp->mshr_busy_cycles, 0, NULL);
+      sprintf(buf, "%s.mshr_occ_cycles", name);
+      stat_reg_counter(sdb, buf, "cumulative outstanding misses per cycle",
+		       &cp->mshr_occ_cycles, 0, NULL);
+      sprintf(buf, "%s.mlp", name);
+      sprintf(buf1, "%s.mshr_occ_cycles / %s.mshr_busy_cycles", name, name);
+      stat_reg_formula(sdb, buf,
+		       "memory level parallelism (avg misses outstanding)",
+		       buf1, NULL);
+      sprintf(buf, "%s.mlp_dist", name);
+      cp->mshr_mlp_dist =
+	stat_reg_dist(sdb, buf, "cycles with N misses outstanding",
+		      /* init */0, /* arr sz */cp->mshr_nentries + 1,
+		      /* bucket sz */1, /* print */PF_ALL,
+		      /* format */NULL, /* index map */NULL,
+		      /* print fn */NULL);
+    }
 }
 
 md_addr_t get_PC();
@@ -538,10 +735,6 @@ struct stride_rpt_entry_t {
   int last_access;
 };
 
-// Table of RPT entries (yes, that name is redundant.)
-// Used by the stride-prefetcher to store required metadata.
-struct stride_rpt_entry_t* stride_rpt = NULL;
-
 // Defines the transition graph of how an entry progresses through RPT states.
 enum stride_rpt_state_t stride_rpt_transitions_mismatch[] = {
   [RPT_NO_PRED] = RPT_NO_PRED,
@@ -566,9 +759,9 @@ void stride_prefetcher(struct cache_t *cp, md_addr_t addr) {
   // So, we handle initialization here if needed.
   // This usage of the variable is based on conventions in configuration.
   md_addr_t num_rpt_entries = cp->prefetch_type;
-  if (stride_rpt == NULL) {
+  if (cp->stride_rpt == NULL) {
     // This will memory leak...but we don't particularly care.
-    stride_rpt = (struct stride_rpt_entry_t*) calloc(num_rpt_entries, sizeof(struct stride_rpt_entry_t));
+    cp->stride_rpt = (struct stride_rpt_entry_t*) calloc(num_rpt_entries, sizeof(struct stride_rpt_entry_t));
   }
 
   // Discard the three bottom bits from the PC, since they are useless.
@@ -584,7 +777,7 @@ void stride_prefetcher(struct cache_t *cp, md_addr_t addr) {
   md_addr_t rpt_index = pc & rpt_index_mask;
   md_addr_t rpt_tag = pc & ~rpt_index_mask;
 
-  struct stride_rpt_entry_t* rpt_entry = &stride_rpt[rpt_index];
+  struct stride_rpt_entry_t* rpt_entry = &cp->stride_rpt[rpt_index];
 
   if (rpt_entry->tag == rpt_tag) {
     // Hit, we should process the current entry compared to the old one.
@@ -622,9 +815,7 @@ void stride_prefetcher(struct cache_t *cp, md_addr_t addr) {
 }
 
 /* ECE552 Assignment 4 - BEGIN CODE*/
-int i = 0;
 #define prefetch_schedule_size (1000)
-md_addr_t prefetch_schedule[prefetch_schedule_size];
 /* ECE552 Assignment 4 - END CODE*/
 
 /* Open Ended Prefetcher: a non-trivial modification to stride. */
@@ -635,9 +826,10 @@ void open_ended_prefetcher(struct cache_t *cp, md_addr_t addr) {
   // So, we handle initialization here if needed.
   // This usage of the variable is based on conventions in configuration.
   md_addr_t num_rpt_entries = 16;
-  if (stride_rpt == NULL) {
+  if (cp->stride_rpt == NULL) {
     // This will memory leak...but we don't particularly care.
-    stride_rpt = (struct stride_rpt_entry_t*) calloc(num_rpt_entries, sizeof(struct stride_rpt_entry_t));
+    cp->stride_rpt = (struct stride_rpt_entry_t*) calloc(num_rpt_entries, sizeof(struct stride_rpt_entry_t));
+    cp->prefetch_schedule = (md_addr_t*) calloc(prefetch_schedule_size, sizeof(md_addr_t));
   }
 
   // Discard the three bottom bits from the PC, since they are useless.
@@ -653,7 +845,7 @@ void open_ended_prefetcher(struct cache_t *cp, md_addr_t addr) {
   md_addr_t rpt_index = pc & rpt_index_mask;
   md_addr_t rpt_tag = pc & ~rpt_index_mask;
 
-  struct stride_rpt_entry_t* rpt_entry = &stride_rpt[rpt_index];
+  struct stride_rpt_entry_t* rpt_entry = &cp->stride_rpt[rpt_index];
 
   if (rpt_entry->tag == rpt_tag) {
     // Hit, we should process the current entry compared to the old one.
@@ -678,33 +870,33 @@ void open_ended_prefetcher(struct cache_t *cp, md_addr_t addr) {
     if (
       (rpt_entry->state != RPT_NO_PRED && new_stride != addr)
       // If the instruction hasn't been used recently, don't prefetch it, because it may cause an evict.
-      && (i - rpt_entry->last_access < 32)
+      && (cp->prefetch_clock - rpt_entry->last_access < 32)
     ) {
       md_addr_t prefetch_addr = CACHE_BADDR(cp, addr + rpt_entry->stride);
 
       // Based on the last time the instruction was called, predict the next time it'll be used.
-      int delay = i - rpt_entry->last_access;
+      int delay = cp->prefetch_clock - rpt_entry->last_access;
       // If the instruction will be used soon, prefetch it now.
       // Otherwise, schedule it for later prefetch.
       if (delay > 100) {
         // When scheduling, we prefetch a bit before projected usage.
-        prefetch_schedule[(i + delay - 2) % prefetch_schedule_size] = prefetch_addr;
+        cp->prefetch_schedule[(cp->prefetch_clock + delay - 2) % prefetch_schedule_size] = prefetch_addr;
       } else {
         cache_access(cp, Read, prefetch_addr, NULL, cp->bsize, 0, NULL, NULL, 1);
       }
     }
 
     // If there are any prefetches schedules, perform them.
-    if (prefetch_schedule[i % prefetch_schedule_size] != 0) {
-      cache_access(cp, Read, prefetch_schedule[i % prefetch_schedule_size], NULL, cp->bsize, 0, NULL, NULL, 1);
-      prefetch_schedule[i % prefetch_schedule_size] = 0;
+    if (cp->prefetch_schedule[cp->prefetch_clock % prefetch_schedule_size] != 0) {
+      cache_access(cp, Read, cp->prefetch_schedule[cp->prefetch_clock % prefetch_schedule_size], NULL, cp->bsize, 0, NULL, NULL, 1);
+      cp->prefetch_schedule[cp->prefetch_clock % prefetch_schedule_size] = 0;
     }
 
     if (rpt_entry->probation > 0) {
       rpt_entry->probation -= 1;
     }
 
-    rpt_entry->last_access = i;
+    rpt_entry->last_access = cp->prefetch_clock;
   } else {
     if (rpt_entry->tag == 0 || rpt_entry->probation == 64 || rpt_entry->state == RPT_NO_PRED) {
       // Miss, make a new RPT entry.
@@ -713,13 +905,13 @@ void open_ended_prefetcher(struct cache_t *cp, md_addr_t addr) {
       rpt_entry->stride = 0;
       rpt_entry->state = RPT_INIT;
       rpt_entry->probation = 0;
-      rpt_entry->last_access = i;
+      rpt_entry->last_access = cp->prefetch_clock;
     } else {
       rpt_entry->probation++;
     }
   }
 
-  i++;
+  cp->prefetch_clock++;
 
   /* ECE552 Assignment 4 - END CODE*/
 }
@@ -765,6 +957,29 @@ cache_stats(struct cache_t *cp,		/* cache instance */
 	  (double)cp->invalidations/sum);
 }
 
+/* reset stats after priming, e.g., after functional cache warm-up */
+void
+cache_after_priming(struct cache_t *cp)	/* cache instance */
+{
+  if (cp == NULL)
+    return;
+
+  cp->hits = 0;
+  cp->misses = 0;
+  cp->replacements = 0;
+  cp->writebacks = 0;
+  cp->invalidations = 0;
+  cp->read_hits = 0;
+  cp->read_misses = 0;
+  cp->prefetch_hits = 0;
+  cp->prefetch_misses = 0;
+  cp->mshr_merges = 0;
+  cp->mshr_full_stalls = 0;
+  cp->mshr_target_stalls = 0;
+  cp->mshr_busy_cycles = 0;
+  cp->mshr_occ_cycles = 0;
+}
+
 /* access a cache, perform a CMD operation on cache CP at address ADDR,
    places NBYTES of data at *P, returns latency of operation if initiated
    at NOW, places pointer to block user data in *UDATA, *P is untouched if
@@ -786,6 +1001,7 @@ cache_access(struct cache_t *cp,	/* cache to access */
   md_addr_t set = CACHE_SET(cp, addr);
   md_addr_t bofs = CACHE_BLK(cp, addr);
   struct cache_blk_t *blk, *repl;
+  struct cache_mshr_t *mshr = NULL;
   int lat = 0;
 
   /* default replacement address */
@@ -852,6 +1068,21 @@ cache_access(struct cache_t *cp,	/* cache to access */
      cp->prefetch_misses++;
   }
 
+  /* a primary miss holds an MSHR until its fill completes, if all are busy
+     it takes over the first to free; fills initiated by prefetches do not
+     hold an MSHR */
+  if (cp->mshrs && prefetch == 0)
+    {
+      mshr_advance(cp, now);
+      if (cp->mshr_num == cp->mshr_nentries)
+	{
+	  cp->mshr_full_stalls++;
+	  mshr = mshr_earliest(cp);
+	  lat += BOUND_POS(mshr->ready - now);
+	}
+      else
+	mshr = &cp->mshrs[cp->mshr_num++];
+    }
 
   /* select the appropriate block to replace, and re-link this entry to
      the appropriate place in the way list */
@@ -931,6 +1162,14 @@ cache_access(struct cache_t *cp,	/* cache to access */
   /* update block status */
   repl->ready = now+lat;
 
+  /* the MSHR is held until the block is filled */
+  if (mshr)
+    {
+      mshr->baddr = CACHE_BADDR(cp, addr);
+      mshr->ready = repl->ready;
+      mshr->ntargets = 1;
+    }
+
   /* link this entry back into the hash table */
   if (cp->hsize)
     link_htab_ent(cp, &cp->sets[set], repl);
@@ -992,7 +1231,7 @@ cache_access(struct cache_t *cp,	/* cache to access */
 
 
   /* return first cycle data is available to access */
-  return (int) MAX(cp->hit_latency, (blk->ready - now));
+  return hit_lat(cp, blk, addr, now, prefetch);
 
  cache_fast_hit: /* fast hit handler */
   
@@ -1037,7 +1276,7 @@ cache_access(struct cache_t *cp,	/* cache to access */
   }
 
   /* return first cycle data is available to access */
-  return (int) MAX(cp->hit_latency, (blk->ready - now));
+  return hit_lat(cp, blk, addr, now, prefetch);
 }
 
 /* return non-zero if block containing address ADDR is contained in cache
@@ -92,8 +92,18 @@
  * Due to the organization of this cache implementation, the latency of a
  * request cannot be affected by a later request to this module.  As a result,
  * reordering of requests in the memory hierarchy is not possible.
+ *
+ * Optionally, a cache may be given a file of miss status holding registers
+ * (MSHRs) with cache_set_mshrs().  Each primary miss then holds an MSHR until
+ * its block fill completes, secondary misses to an in-flight block merge into
+ * its MSHR up to the per-MSHR target limit, and a primary miss that finds
+ * all MSHRs busy is delayed until the earliest one frees.  The calling
+ * simulator can use cache_mshr_full() to hold back accesses instead.
  */
 
+/* prefetcher reference prediction table entry, see cache.c */
+struct stride_rpt_entry_t;
+
 /* highly associative caches are implemented using a hash table lookup to
    speed block access, this macro decides if a cache is "highly associative" */
 #define CACHE_HIGHLY_ASSOC(cp)	((cp)->assoc > 4)
@@ -133,6 +143,14 @@ struct cache_blk_t
 				   should probably be a multiple of 8 */
 };
 
+/* miss status holding register, tracks one in-flight block fill */
+struct cache_mshr_t
+{
+  md_addr_t baddr;		/* address of the block being filled */
+  tick_t ready;			/* time when the fill completes */
+  int ntargets;			/* number of accesses waiting on the fill */
+};
+
 /* cache set definition (one or more blocks sharing the same set index) */
 struct cache_set_t
 {
@@ -160,6 +178,12 @@ struct cache_t
   unsigned int hit_latency;	/* cache hit latency */
   int prefetch_type;		/* prefetcher type */
 
+  /* prefetcher state, allocated on first use, kept per-cache so that caches
+     never share prefetch history and can be simulated concurrently */
+  struct stride_rpt_entry_t *stride_rpt;/* reference prediction table */
+  md_addr_t *prefetch_schedule;	/* open-ended prefetcher deferred prefetches */
+  int prefetch_clock;		/* open-ended prefetcher access count */
+
   /* miss/replacement handler, read/write BSIZE bytes starting at BADDR
      from/into cache block BLK, returns the latency of the operation
      if initiated at NOW, returned latencies indicate how long it takes
@@ -196,6 +220,13 @@ struct cache_t
  				   may be more than one cycle, as specified
  				   by the miss handler */
 
+  /* MSHR file, NULL if the cache can service any number of misses */
+  int mshr_nentries;		/* number of MSHRs */
+  int mshr_ntargets;		/* max accesses merged into one MSHR */
+  struct cache_mshr_t *mshrs;	/* MSHRs, busy ones first */
+  int mshr_num;			/* number of busy MSHRs */
+  tick_t mshr_time;		/* MSHR occupancy is accounted up to here */
+
   /* per-cache stats */
   counter_t hits;		/* total number of hits */
   counter_t misses;		/* total number of misses */
@@ -210,6 +241,13 @@ struct cache_t
   counter_t prefetch_hits;	/* total number of prefetch accesses that are hits */ 
   counter_t prefetch_misses;	/* total number of prefetch accesses that miss in this cache */
 
+  counter_t mshr_merges;	/* secondary misses merged into an MSHR */
+  counter_t mshr_full_stalls;	/* primary misses delayed by a full MSHR file */
+  counter_t mshr_target_stalls;	/* secondary misses delayed by full targets */
+  counter_t mshr_busy_cycles;	/* cycles with at least one busy MSHR */
+  counter_t mshr_occ_cycles;	/* sum over cycles of busy MSHRs */
+  struct stat_stat_t *mshr_mlp_dist;/* cycles with N busy MSHRs */
+
 
 
   /* last block to hit, used to optimize cache hit processing */
@@ -241,6 +279,20 @@ cache_create(char *name,		/* name of the cache */
 	     unsigned int hit_latency,/* latency in cycles for a hit */
 	     int prefetch_type);      /* the type of the prefetcher for this cache */	
 
+/* give cache CP a file of NENTRIES MSHRs with up to NTARGETS merged accesses
+   each, zero NENTRIES removes the MSHR file, must be called before the
+   cache stats are registered */
+void
+cache_set_mshrs(struct cache_t *cp,	/* cache instance */
+		int nentries,		/* number of MSHRs, 0 for none */
+		int ntargets);		/* accesses merged into one MSHR */
+
+/* return non-zero if all MSHRs of cache CP are busy at NOW, i.e., a primary
+   miss initiated at NOW would have to wait for an MSHR */
+int					/* non-zero if MSHR file full */
+cache_mshr_full(struct cache_t *cp,	/* cache instance */
+		tick_t now);		/* time of access */
+
 /* parse policy */
 enum cache_policy			/* replacement policy enum */
 cache_char2policy(char c);		/* replacement policy as a char */
@@ -263,6 +315,10 @@ cache_stats(struct cache_t *cp,		/* cache instance */
 /* print cache stats */
 void cache_stats(struct cache_t *cp, FILE *stream);
 
+/* reset stats after priming, e.g., after functional cache warm-up */
+void
+cache_after_priming(struct cache_t *cp);/* cache instance */
+
 /* figure out what type of prefetcher is used by this cache and
    call the appropriate function to generate the prefetch (e.g., next_line_prefetcher) */
 
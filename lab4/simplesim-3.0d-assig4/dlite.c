@@ -260,6 +260,10 @@ ident_evaluator(struct eval_state_t *es)	/* expression evaluator */
 	  eval_error = ERR_BADEXPR;
 	  val = err_value;
 	  break;
+	case sc_mean:
+	  val.type = et_double;
+	  val.value.as_double = stat->variant.for_mean.mean;
+	  break;
 	case sc_formula:
 	  {
 	    /* instantiate a new evaluator to avoid recursion problems */
@@ -0,0 +1,411 @@
+/* dram.c - banked DRAM timing model routines */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "stats.h"
+#include "dram.h"
+
+/* create and initialize a DRAM */
+struct dram_t *				/* pointer to DRAM created */
+dram_create(char *name,			/* name of the DRAM */
+	    int nchans,			/* number of channels */
+	    int nbanks,			/* number of banks per channel */
+	    int row_size,		/* row size in bytes */
+	    enum dram_policy policy,	/* page policy */
+	    int rq_size,		/* read queue size, per channel */
+	    int wq_size,		/* write queue size, per channel */
+	    int t_rcd,			/* activate (RAS to CAS) time */
+	    int t_cas,			/* column access time */
+	    int t_rp,			/* precharge time */
+	    int t_burst,		/* bus cycles per bus width transferred */
+	    int bus_width)		/* data bus width in bytes */
+{
+  struct dram_t *dp;
+  struct dram_chan_t *ch;
+  int i, j;
+
+  /* check all DRAM parameters */
+  if (nchans <= 0 || (nchans & (nchans-1)) != 0)
+    fatal("DRAM channels `%d' must be a positive power of two", nchans);
+  if (nbanks <= 0 || (nbanks & (nbanks-1)) != 0)
+    fatal("DRAM banks `%d' must be a positive power of two", nbanks);
+  if (row_size < 8 || (row_size & (row_size-1)) != 0)
+    fatal("DRAM row size `%d' must be a power of two, 8 or greater",
+	  row_size);
+  if (rq_size < 1 || wq_size < 1)
+    fatal("DRAM read and write queues must have at least one entry");
+  if (t_rcd < 0 || t_cas < 1 || t_rp < 0)
+    fatal("DRAM tRCD and tRP must be non-negative, and tCAS positive");
+  if (t_burst < 1 || bus_width < 1)
+    fatal("DRAM burst time and bus width must be positive");
+
+  /* allocate the DRAM structure */
+  dp = (struct dram_t *)
+    calloc(1, sizeof(struct dram_t) + (nchans-1)*sizeof(struct dram_chan_t));
+  if (!dp)
+    fatal("out of virtual memory");
+
+  /* initialize user parameters */
+  dp->name = mystrdup(name);
+  dp->nchans = nchans;
+  dp->nbanks = nbanks;
+  dp->row_size = row_size;
+  dp->policy = policy;
+  dp->rq_size = rq_size;
+  dp->wq_size = wq_size;
+  dp->t_rcd = t_rcd;
+  dp->t_cas = t_cas;
+  dp->t_rp = t_rp;
+  dp->t_burst = t_burst;
+  dp->bus_width = bus_width;
+
+  /* compute derived parameters, addresses are row:bank:channel:column */
+  dp->col_shift = log_base2(row_size);
+  dp->chan_shift = dp->col_shift;
+  dp->chan_mask = nchans - 1;
+  dp->bank_shift = dp->chan_shift + log_base2(nchans);
+  dp->bank_mask = nbanks - 1;
+  dp->row_shift = dp->bank_shift + log_base2(nbanks);
+
+  /* allocate the channels, all banks start precharged */
+  for (i=0; i < nchans; i++)
+    {
+      ch = &dp->chans[i];
+      ch->bus_free = 0;
+      ch->rq_done = (tick_t *)calloc(rq_size, sizeof(tick_t));
+      ch->rq_head = 0;
+      ch->wq = (struct dram_write_t *)
+	calloc(wq_size, sizeof(struct dram_write_t));
+      ch->wq_num = 0;
+      ch->banks = (struct dram_bank_t *)
+	calloc(nbanks, sizeof(struct dram_bank_t));
+      if (!ch->rq_done || !ch->wq || !ch->banks)
+	fatal("out of virtual memory");
+      for (j=0; j < nbanks; j++)
+	{
+	  ch->banks[j].row_open = FALSE;
+	  ch->banks[j].ready = 0;
+	}
+    }
+
+  return dp;
+}
+
+/* parse page policy character C, i.e., {o|c} */
+enum dram_policy			/* page policy */
+dram_char2policy(char c)		/* policy as a character */
+{
+  switch (c) {
+  case 'o': return dram_open_page;
+  case 'c': return dram_closed_page;
+  default: fatal("bad DRAM page policy `%c', must be {o|c}", c);
+  }
+  return dram_open_page;
+}
+
+/* print DRAM configuration */
+void
+dram_config(struct dram_t *dp,		/* DRAM instance */
+	    FILE *stream)		/* output stream */
+{
+  fprintf(stream,
+	  "%s: %d channels, %d banks/channel, %d byte rows, "
+	  "%s page policy\n",
+	  dp->name, dp->nchans, dp->nbanks, dp->row_size,
+	  dp->policy == dram_open_page ? "open" : "closed");
+  fprintf(stream,
+	  "%s: tRCD %d, tCAS %d, tRP %d, %d cycles per %d byte burst, "
+	  "%d entry read queues, %d entry write queues\n",
+	  dp->name, dp->t_rcd, dp->t_cas, dp->t_rp, dp->t_burst,
+	  dp->bus_width, dp->rq_size, dp->wq_size);
+}
+
+/* register DRAM stats, SIM_CYCLE names the stat holding the simulation time,
+   used to compute the data bus utilization */
+void
+dram_reg_stats(struct dram_t *dp,	/* DRAM instance */
+	       struct stat_sdb_t *sdb,	/* stats database */
+	       char *sim_cycle)		/* name of the simulation time stat */
+{
+  char buf[512], buf1[512], *name;
+
+  /* get a name for this DRAM */
+  if (!dp->name || !dp->name[0])
+    name = "<unknown>";
+  else
+    name = dp->name;
+
+  sprintf(buf, "%s.reads", name);
+  stat_reg_counter(sdb, buf, "total number of reads", &dp->reads, 0, NULL);
+  sprintf(buf, "%s.writes", name);
+  stat_reg_counter(sdb, buf, "total number of writes", &dp->writes, 0, NULL);
+  sprintf(buf, "%s.row_hits", name);
+  stat_reg_counter(sdb, buf, "total number of accesses to an open row",
+		   &dp->row_hits, 0, NULL);
+  sprintf(buf, "%s.row_empty", name);
+  stat_reg_counter(sdb, buf, "total number of accesses to a closed bank",
+		   &dp->row_empty, 0, NULL);
+  sprintf(buf, "%s.row_conflicts", name);
+  stat_reg_counter(sdb, buf,
+		   "total number of accesses to a bank with another row open",
+		   &dp->row_conflicts, 0, NULL);
+  sprintf(buf, "%s.row_hit_rate", name);
+  sprintf(buf1, "%s.row_hits / (%s.row_hits + %s.row_empty + %s.row_conflicts)",
+	  name, name, name, name);
+  stat_reg_formula(sdb, buf, "row buffer hit rate (i.e., row hits/access)",
+		   buf1, NULL);
+  sprintf(buf, "%s.read_lat", name);
+  stat_reg_counter(sdb, buf, "cumulative read latency (cycle's)",
+		   &dp->read_lat, 0, NULL);
+  sprintf(buf, "%s.avg_read_lat", name);
+  sprintf(buf1, "%s.read_lat / %s.reads", name, name);
+  stat_reg_formula(sdb, buf, "avg read latency (cycle's)", buf1, NULL);
+  sprintf(buf, "%s.rq_stalls", name);
+  stat_reg_counter(sdb, buf, "total number of reads delayed by a full "
+		   "read queue", &dp->rq_stalls, 0, NULL);
+  sprintf(buf, "%s.wq_drains", name);
+  stat_reg_counter(sdb, buf, "total number of write queue drains forced "
+		   "by a full write queue", &dp->wq_drains, 0, NULL);
+  sprintf(buf, "%s.bytes", name);
+  stat_reg_counter(sdb, buf, "total number of bytes transferred",
+		   &dp->bytes, 0, NULL);
+  sprintf(buf, "%s.bus_busy", name);
+  stat_reg_counter(sdb, buf, "cumulative busy cycles of the data buses",
+		   &dp->bus_busy, 0, NULL);
+  sprintf(buf, "%s.bandwidth", name);
+  sprintf(buf1, "%s.bytes / %s", name, sim_cycle);
+  stat_reg_formula(sdb, buf, "avg bandwidth used (bytes/cycle)", buf1, NULL);
+  sprintf(buf, "%s.bus_util", name);
+  sprintf(buf1, "%s.bus_busy / (%s * %d)", name, sim_cycle, dp->nchans);
+  stat_reg_formula(sdb, buf, "fraction of time (cycle's) the data buses "
+		   "were busy", buf1, NULL);
+}
+
+/* schedule an access of BSIZE bytes to ROW of BANK on channel CH, starting
+   no earlier than time START, returns the time its data transfer ends; the
+   bank, bus and stats are only updated if COMMIT is non-zero, else the
+   access is only timed */
+static tick_t				/* time access completes */
+dram_schedule(struct dram_t *dp,	/* DRAM */
+	      struct dram_chan_t *ch,	/* channel accessed */
+	      int bank,			/* bank accessed */
+	      md_addr_t row,		/* row accessed */
+	      int bsize,		/* size of access in bytes */
+	      tick_t start,		/* earliest start time */
+	      int commit)		/* update DRAM state? */
+{
+  struct dram_bank_t *bp = &ch->banks[bank];
+  tick_t data, end;
+  int lat, burst;
+
+  /* wait for the bank */
+  start = MAX(start, bp->ready);
+
+  /* row buffer access */
+  if (bp->row_open && bp->open_row == row)
+    {
+      lat = dp->t_cas;
+      if (commit)
+	dp->row_hits++;
+    }
+  else if (bp->row_open)
+    {
+      lat = dp->t_rp + dp->t_rcd + dp->t_cas;
+      if (commit)
+	dp->row_conflicts++;
+    }
+  else
+    {
+      lat = dp->t_rcd + dp->t_cas;
+      if (commit)
+	dp->row_empty++;
+    }
+
+  /* data transfer, waits for the bus */
+  burst = dp->t_burst * ((bsize + dp->bus_width - 1) / dp->bus_width);
+  data = MAX(start + lat, ch->bus_free);
+  end = data + burst;
+
+  if (commit)
+    {
+      ch->bus_free = end;
+      dp->bus_busy += burst;
+      dp->bytes += bsize;
+
+      if (dp->policy == dram_open_page)
+	{
+	  /* the next access may follow as soon as the data is out */
+	  bp->row_open = TRUE;
+	  bp->open_row = row;
+	  bp->ready = data;
+	}
+      else
+	{
+	  /* precharge right after the column access */
+	  bp->row_open = FALSE;
+	  bp->ready = data + dp->t_rp;
+	}
+    }
+
+  return end;
+}
+
+/* return the index of the write queue entry of channel CH to drain next,
+   FR-FCFS: the oldest write to an open row, else the oldest write */
+static int				/* write queue index */
+dram_pick_write(struct dram_chan_t *ch)	/* channel */
+{
+  int i;
+  struct dram_write_t *w;
+
+  for (i=0; i < ch->wq_num; i++)
+    {
+      w = &ch->wq[i];
+      if (ch->banks[w->bank].row_open
+	  && ch->banks[w->bank].open_row == w->row)
+	return i;
+    }
+  return 0;
+}
+
+/* drain writes from the write queue of channel CH, if FORCE is non-zero,
+   drain at time NOW until the queue is half empty, else drain the writes
+   that complete by time NOW */
+static void
+dram_drain(struct dram_t *dp,		/* DRAM */
+	   struct dram_chan_t *ch,	/* channel to drain */
+	   tick_t now,			/* current time */
+	   int force)			/* drain to half full? */
+{
+  int i;
+  struct dram_write_t *w;
+  tick_t start;
+
+  while (ch->wq_num > (force ? dp->wq_size / 2 : 0))
+    {
+      i = dram_pick_write(ch);
+      w = &ch->wq[i];
+      start = force ? MAX(now, w->when) : w->when;
+
+      /* idle time drains stop at the first write that would delay now */
+      if (!force
+	  && dram_schedule(dp, ch, w->bank, w->row, w->bsize, start,
+			   /* commit */FALSE) > now)
+	break;
+
+      dram_schedule(dp, ch, w->bank, w->row, w->bsize, start,
+		    /* commit */TRUE);
+
+      /* remove the write, keeping the queue in arrival order */
+      for (; i < ch->wq_num - 1; i++)
+	ch->wq[i] = ch->wq[i+1];
+      ch->wq_num--;
+    }
+}
+
+/* access BSIZE bytes at address ADDR of DRAM DP at time NOW, returns the
+   latency of a read, writes are posted and return zero */
+unsigned int				/* latency of access in cycles */
+dram_access(struct dram_t *dp,		/* DRAM to access */
+	    enum mem_cmd cmd,		/* access cmd, Read or Write */
+	    md_addr_t addr,		/* address of access */
+	    int bsize,			/* size of access in bytes */
+	    tick_t now)			/* time of access */
+{
+  struct dram_chan_t *ch = &dp->chans[(addr >> dp->chan_shift)
+				      & dp->chan_mask];
+  int bank = (addr >> dp->bank_shift) & dp->bank_mask;
+  md_addr_t row = addr >> dp->row_shift;
+  struct dram_write_t *w;
+  tick_t start, end;
+
+  if (cmd == Write)
+    {
+      /* post the write, drain the queue if it is full */
+      dp->writes++;
+      w = &ch->wq[ch->wq_num++];
+      w->bank = bank;
+      w->row = row;
+      w->bsize = bsize;
+      w->when = now;
+      if (ch->wq_num == dp->wq_size)
+	{
+	  dp->wq_drains++;
+	  dram_drain(dp, ch, now, /* force */TRUE);
+	}
+      return 0;
+    }
+
+  /* writes go out while the channel would otherwise be idle */
+  dram_drain(dp, ch, now, /* force */FALSE);
+
+  /* with a full read queue, wait for the oldest outstanding read */
+  start = now;
+  if (ch->rq_done[ch->rq_head] > now)
+    {
+      start = ch->rq_done[ch->rq_head];
+      dp->rq_stalls++;
+    }
+
+  end = dram_schedule(dp, ch, bank, row, bsize, start, /* commit */TRUE);
+  ch->rq_done[ch->rq_head] = end;
+  ch->rq_head = (ch->rq_head + 1) % dp->rq_size;
+
+  dp->reads++;
+  dp->read_lat += end - now;
+  return (unsigned int)(end - now);
+}
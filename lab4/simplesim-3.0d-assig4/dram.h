@@ -0,0 +1,201 @@
+/* dram.h - banked DRAM timing model interfaces */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#ifndef DRAM_H
+#define DRAM_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "stats.h"
+
+/*
+ * This module models the timing of a main memory built from DRAM channels,
+ * each with its own data bus and a number of independent banks.  Each bank
+ * holds at most one open row in its row buffer: an access to the open row
+ * (row hit) only needs a column access (tCAS), an access to a closed bank
+ * first activates the row (tRCD), and an access to a bank with another row
+ * open (row conflict) must first precharge it (tRP).  With the open page
+ * policy rows are left open after an access, with the closed page policy
+ * every access precharges its bank when done.  Blocks then occupy the data
+ * bus of their channel for one burst cycle per bus width transferred.
+ *
+ * Addresses are mapped row:bank:channel:column, so consecutive blocks fall
+ * in the same row, and consecutive rows in different channels and banks.
+ *
+ * Like the rest of the memory hierarchy, the model returns the latency of
+ * each access as it is made, so reads are scheduled first-come first-served
+ * in the order the caches miss, queueing behind earlier accesses to their
+ * bank and bus, and behind the oldest outstanding read once the channel's
+ * read queue is full.  Writes (i.e., writebacks) are posted to a per channel
+ * write queue and drained later: when the queue fills, it is drained to half
+ * full, and before a read, any writes that can complete in the idle time up
+ * to the read are drained; drains pick writes FR-FCFS, i.e., the oldest
+ * write to an open row first, else the oldest write.
+ */
+
+/* DRAM page (row buffer) policies */
+enum dram_policy {
+  dram_open_page,		/* leave rows open after an access */
+  dram_closed_page		/* precharge the bank after each access */
+};
+
+/* DRAM bank state */
+struct dram_bank_t
+{
+  md_addr_t open_row;		/* row held in the row buffer, if row_open */
+  int row_open;			/* non-zero if the row buffer holds a row */
+  tick_t ready;			/* time the bank can start its next access */
+};
+
+/* posted write, waiting in a write queue */
+struct dram_write_t
+{
+  int bank;			/* bank written */
+  md_addr_t row;		/* row written */
+  int bsize;			/* size of write in bytes */
+  tick_t when;			/* time the write was posted */
+};
+
+/* DRAM channel state */
+struct dram_chan_t
+{
+  tick_t bus_free;		/* time the data bus is next free */
+  tick_t *rq_done;		/* completion times of the last RQ_SIZE reads,
+				   a circular queue of RQ_SIZE entries */
+  int rq_head;			/* oldest entry of RQ_DONE */
+  struct dram_write_t *wq;	/* write queue, in arrival order */
+  int wq_num;			/* number of writes in the write queue */
+  struct dram_bank_t *banks;	/* banks of this channel */
+};
+
+/* DRAM definition */
+struct dram_t
+{
+  /* parameters */
+  char *name;			/* DRAM name */
+  int nchans;			/* number of channels */
+  int nbanks;			/* number of banks per channel */
+  int row_size;			/* row size in bytes */
+  enum dram_policy policy;	/* page policy */
+  int rq_size;			/* read queue size, per channel */
+  int wq_size;			/* write queue size, per channel */
+  int t_rcd, t_cas, t_rp;	/* activate, column access, precharge times */
+  int t_burst;			/* bus cycles per bus width transferred */
+  int bus_width;		/* data bus width in bytes */
+
+  /* derived data, for fast decoding */
+  int col_shift;		/* log2(ROW_SIZE) */
+  int chan_shift, chan_mask;
+  int bank_shift, bank_mask;
+  int row_shift;
+
+  /* per-DRAM stats */
+  counter_t reads;		/* total number of reads */
+  counter_t writes;		/* total number of writes */
+  counter_t row_hits;		/* accesses to an open row */
+  counter_t row_empty;		/* accesses to a closed bank */
+  counter_t row_conflicts;	/* accesses to a bank with another row open */
+  counter_t read_lat;		/* cumulative read latency */
+  counter_t rq_stalls;		/* reads delayed by a full read queue */
+  counter_t wq_drains;		/* write queue drains forced by a full queue */
+  counter_t bus_busy;		/* cumulative busy cycles of all data buses */
+  counter_t bytes;		/* total bytes transferred */
+
+  /* NOTE: this is a variable-size tail array, this must be the LAST field
+     defined in this structure! */
+  struct dram_chan_t chans[1];	/* each entry is a channel */
+};
+
+/* create and initialize a DRAM */
+struct dram_t *				/* pointer to DRAM created */
+dram_create(char *name,			/* name of the DRAM */
+	    int nchans,			/* number of channels */
+	    int nbanks,			/* number of banks per channel */
+	    int row_size,		/* row size in bytes */
+	    enum dram_policy policy,	/* page policy */
+	    int rq_size,		/* read queue size, per channel */
+	    int wq_size,		/* write queue size, per channel */
+	    int t_rcd,			/* activate (RAS to CAS) time */
+	    int t_cas,			/* column access time */
+	    int t_rp,			/* precharge time */
+	    int t_burst,		/* bus cycles per bus width transferred */
+	    int bus_width);		/* data bus width in bytes */
+
+/* parse page policy character C, i.e., {o|c} */
+enum dram_policy			/* page policy */
+dram_char2policy(char c);		/* policy as a character */
+
+/* print DRAM configuration */
+void
+dram_config(struct dram_t *dp,		/* DRAM instance */
+	    FILE *stream);		/* output stream */
+
+/* register DRAM stats, SIM_CYCLE names the stat holding the simulation time,
+   used to compute the data bus utilization */
+void
+dram_reg_stats(struct dram_t *dp,	/* DRAM instance */
+	       struct stat_sdb_t *sdb,	/* stats database */
+	       char *sim_cycle);	/* name of the simulation time stat */
+
+/* access BSIZE bytes at address ADDR of DRAM DP at time NOW, returns the
+   latency of a read, writes are posted and return zero */
+unsigned int				/* latency of access in cycles */
+dram_access(struct dram_t *dp,		/* DRAM to access */
+	    enum mem_cmd cmd,		/* access cmd, Read or Write */
+	    md_addr_t addr,		/* address of access */
+	    int bsize,			/* size of access in bytes */
+	    tick_t now);		/* time of access */
+
+#endif /* DRAM_H */
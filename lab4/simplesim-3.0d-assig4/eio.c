@@ -90,14 +90,363 @@
    )
 */
 
+/*
+   Binary EIO files (EIO_BINARY_VERSION) start with the same header line,
+   followed by EIO_BINARY_HEADER.  Everything after that is binary: EXO
+   terms are written as a class byte followed by the value, integers and
+   addresses as zig-zag varints, and lists and blobs as a varint length
+   followed by the elements or bytes.  The checkpoint is the same sequence
+   of terms as the text format.  Each transaction is framed as:
+
+     EIO_REC_TRANS, varint icnt, varint payload size, transaction term
+
+   so it can be skipped without decoding it.  When the trace is written
+   to a seekable file, eio_close() appends an index record:
+
+     EIO_REC_INDEX, varint count, count x (varint icnt delta,
+                                            varint offset delta)
+
+   and a trailer holding the 8-byte little-endian offset of the index
+   record and EIO_TRAILER_MAGIC, eio_fast_forward() seeks with it.
+*/
+
+#define EIO_BINARY_HEADER						\
+  "/* binary EIO trace - DO NOT EDIT, transaction records follow */\n"
+
+/* binary EIO record kinds */
+#define EIO_REC_TRANS		'T'	/* syscall transaction */
+#define EIO_REC_INDEX		'I'	/* transaction index, ends the trace */
+
+/* binary EIO trailer: index record offset and magic */
+#define EIO_TRAILER_MAGIC	"EIOX"
+#define EIO_TRAILER_SIZE	12
+
 /* EIO transaction count, i.e., number of last transaction completed */
 static counter_t eio_trans_icnt = -1;
 
+/* EIO transaction index entry */
+struct eio_idx_t {
+  counter_t icnt;			/* transaction instruction count */
+  long offset;				/* file offset of transaction record */
+};
+
+/* the EIO interfaces pass bare streams, the encoding and index of each
+   open EIO stream is kept here */
+#define EIO_MAX_STREAMS		8
+
+static struct eio_stream_t {
+  FILE *fd;				/* stream, NULL if slot is free */
+  int binary;				/* binary encoding? */
+  int writing;				/* created by eio_create()? */
+  int seekable;				/* transactions can be seeked to? */
+  struct eio_idx_t *idx;		/* transaction index */
+  int nidx, maxidx;			/* index entries used/allocated */
+} eio_streams[EIO_MAX_STREAMS];
+
+/* binary term encoding buffer */
+static byte_t *enc_buf = NULL;
+static unsigned enc_len = 0, enc_max = 0;
+
+/* get the state of EIO stream FD, returns NULL if FD is not an EIO stream */
+static struct eio_stream_t *
+eio_stream(FILE *fd)			/* EIO stream */
+{
+  int i;
+
+  for (i=0; i < EIO_MAX_STREAMS; i++)
+    {
+      if (eio_streams[i].fd == fd)
+	return &eio_streams[i];
+    }
+  return NULL;
+}
+
+/* allocate state for new EIO stream FD */
+static struct eio_stream_t *
+eio_stream_new(FILE *fd,		/* EIO stream */
+	       int binary,		/* binary encoding? */
+	       int writing)		/* created by eio_create()? */
+{
+  struct eio_stream_t *st;
+
+  st = eio_stream(NULL);
+  if (!st)
+    fatal("too many open EIO files");
+
+  st->fd = fd;
+  st->binary = binary;
+  st->writing = writing;
+  st->seekable = FALSE;
+  st->idx = NULL;
+  st->nidx = st->maxidx = 0;
+
+  return st;
+}
+
+/* add a transaction at file offset OFFSET to the index of stream ST */
+static void
+index_add(struct eio_stream_t *st,	/* EIO stream */
+	  counter_t icnt,		/* transaction instruction count */
+	  long offset)			/* file offset of transaction record */
+{
+  if (st->nidx == st->maxidx)
+    {
+      st->maxidx = st->maxidx ? 2*st->maxidx : 1024;
+      st->idx = (struct eio_idx_t *)
+	realloc(st->idx, st->maxidx * sizeof(struct eio_idx_t));
+      if (!st->idx)
+	fatal("out of virtual memory");
+    }
+  st->idx[st->nidx].icnt = icnt;
+  st->idx[st->nidx].offset = offset;
+  st->nidx++;
+}
+
+/* append byte VAL to the encoding buffer */
+static INLINE void
+enc_byte(int val)			/* byte to append */
+{
+  if (enc_len == enc_max)
+    {
+      enc_max = enc_max ? 2*enc_max : 4096;
+      enc_buf = (byte_t *)realloc(enc_buf, enc_max);
+      if (!enc_buf)
+	fatal("out of virtual memory");
+    }
+  enc_buf[enc_len++] = (byte_t)val;
+}
+
+/* append varint VAL to the encoding buffer */
+static void
+enc_varint(qword_t val)			/* value to encode */
+{
+  while (val >= 0x80)
+    {
+      enc_byte((int)(val | 0x80));
+      val >>= 7;
+    }
+  enc_byte((int)val);
+}
+
+/* append the binary encoding of EXO term EXO to the encoding buffer */
+static void
+enc_term(struct exo_term_t *exo)	/* term to encode */
+{
+  struct exo_term_t *elt;
+  sqword_t sval;
+  unsigned i, n;
+
+  enc_byte(exo->ec);
+  switch (exo->ec)
+    {
+    case ec_integer:
+    case ec_address:
+      /* zig-zag, registers holding small negative values stay short */
+      sval = (sqword_t)exo->as_integer.val;
+      enc_varint(((qword_t)sval << 1) ^ (qword_t)(sval >> 63));
+      break;
+
+    case ec_list:
+      for (n=0, elt=exo->as_list.head; elt != NULL; elt=elt->next)
+	n++;
+      enc_varint(n);
+      for (elt=exo->as_list.head; elt != NULL; elt=elt->next)
+	enc_term(elt);
+      break;
+
+    case ec_blob:
+      enc_varint(exo->as_blob.size);
+      for (i=0; i < exo->as_blob.size; i++)
+	enc_byte(exo->as_blob.data[i]);
+      break;
+
+    default:
+      panic("EXO class `%s' cannot be written to a binary EIO file",
+	    exo_class_str[exo->ec]);
+    }
+}
+
+/* write varint VAL to stream FD */
+static void
+put_varint(FILE *fd,			/* output stream */
+	   qword_t val)			/* value to write */
+{
+  while (val >= 0x80)
+    {
+      putc((int)((val & 0x7f) | 0x80), fd);
+      val >>= 7;
+    }
+  putc((int)val, fd);
+}
+
+/* read the next byte of binary EIO stream FD */
+static INLINE int
+get_byte(FILE *fd)			/* input stream */
+{
+  int c;
+
+  if ((c = getc(fd)) == EOF)
+    fatal("EIO file is truncated");
+  return c;
+}
+
+/* read a varint from binary EIO stream FD */
+static qword_t
+get_varint(FILE *fd)			/* input stream */
+{
+  qword_t val = 0;
+  int c, shift = 0;
+
+  do {
+    c = get_byte(fd);
+    val |= (qword_t)(c & 0x7f) << shift;
+    shift += 7;
+  } while (c & 0x80);
+
+  return val;
+}
+
+/* read a binary EXO term from FD, returns NULL at the end of the file */
+static struct exo_term_t *
+get_term(FILE *fd)			/* input stream */
+{
+  struct exo_term_t *exo, *elt, *tail;
+  qword_t zval;
+  unsigned n;
+  int ec;
+
+  if ((ec = getc(fd)) == EOF)
+    return NULL;
+
+  switch (ec)
+    {
+    case ec_integer:
+    case ec_address:
+      zval = get_varint(fd);
+      exo = exo_new((enum exo_class_t)ec,
+		    (exo_integer_t)((zval >> 1) ^ (~(zval & 1) + 1)));
+      break;
+
+    case ec_list:
+      exo = exo_new(ec_list, NULL);
+      for (n = (unsigned)get_varint(fd), tail = NULL; n > 0; n--)
+	{
+	  if (!(elt = get_term(fd)))
+	    fatal("EIO file is truncated");
+	  if (tail)
+	    tail->next = elt;
+	  else
+	    exo->as_list.head = elt;
+	  tail = elt;
+	}
+      break;
+
+    case ec_blob:
+      n = (unsigned)get_varint(fd);
+      exo = exo_new(ec_blob, n, NULL);
+      if (fread(exo->as_blob.data, 1, n, fd) != n)
+	fatal("EIO file is truncated");
+      break;
+
+    default:
+      fatal("bad term class in binary EIO file");
+    }
+
+  return exo;
+}
+
+/* read the next EXO term from EIO stream FD */
+static struct exo_term_t *
+read_term(FILE *fd)			/* EIO stream */
+{
+  struct eio_stream_t *st = eio_stream(fd);
+
+  if (st && st->binary)
+    return get_term(fd);
+  else
+    return exo_read(fd);
+}
+
+/* write EXO term EXO to EIO stream FD */
+static void
+write_term(struct exo_term_t *exo,	/* term to write */
+	   FILE *fd)			/* EIO stream */
+{
+  struct eio_stream_t *st = eio_stream(fd);
+
+  if (st && st->binary)
+    {
+      enc_len = 0;
+      enc_term(exo);
+      if (fwrite(enc_buf, 1, enc_len, fd) != enc_len)
+	fatal("could not write EIO file");
+    }
+  else
+    {
+      exo_print(exo, fd);
+      fprintf(fd, "\n\n");
+    }
+}
+
+/* skip NBYTES bytes of EIO stream ST */
+static void
+skip_bytes(struct eio_stream_t *st,	/* EIO stream */
+	   qword_t nbytes)		/* bytes to skip */
+{
+  if (st->seekable && fseek(st->fd, (long)nbytes, SEEK_CUR) == 0)
+    return;
+
+  /* not seekable (e.g., a compressed trace), read through it */
+  for (; nbytes > 0; nbytes--)
+    get_byte(st->fd);
+}
+
+/* load the transaction index of binary EIO stream ST, ST is left without
+   an index if the stream cannot seek or no index was written */
+static void
+index_load(struct eio_stream_t *st)	/* EIO stream */
+{
+  byte_t trailer[EIO_TRAILER_SIZE];
+  counter_t icnt = 0;
+  long start, offset = 0;
+  int i, n;
+
+  start = ftell(st->fd);
+  if (start == -1 || fseek(st->fd, -EIO_TRAILER_SIZE, SEEK_END) != 0)
+    return;
+  st->seekable = TRUE;
+
+  if (fread(trailer, 1, EIO_TRAILER_SIZE, st->fd) == EIO_TRAILER_SIZE
+      && !memcmp(trailer + 8, EIO_TRAILER_MAGIC, 4))
+    {
+      for (i=7; i >= 0; i--)
+	offset = (offset << 8) | trailer[i];
+
+      if (fseek(st->fd, offset, SEEK_SET) == 0
+	  && getc(st->fd) == EIO_REC_INDEX)
+	{
+	  n = (int)get_varint(st->fd);
+	  for (i=0, offset=0; i < n; i++)
+	    {
+	      icnt += (counter_t)get_varint(st->fd);
+	      offset += (long)get_varint(st->fd);
+	      index_add(st, icnt, offset);
+	    }
+	}
+    }
+
+  if (fseek(st->fd, start, SEEK_SET) != 0)
+    fatal("could not seek EIO file");
+}
+
+/* create EIO file FNAME, BINARY selects the binary encoding */
 FILE *
-eio_create(char *fname)
+eio_create(char *fname,			/* EIO file name */
+	   int binary)			/* write binary EIO file? */
 {
   FILE *fd;
   struct exo_term_t *exo;
+  struct eio_stream_t *st;
   int target_big_endian;
 
   target_big_endian = (endian_host_byte_order() == endian_big);
@@ -106,28 +455,48 @@ eio_create(char *fname)
   if (!fd)
     fatal("unable to create EIO file `%s'", fname);
 
-  /* emit EIO file header */
-  fprintf(fd, "%s\n", EIO_FILE_HEADER);
-  fprintf(fd, "/* file_format: %d, file_version: %d, big_endian: %d */\n", 
-	  MD_EIO_FILE_FORMAT, EIO_FILE_VERSION, ld_target_big_endian);
-  exo = exo_new(ec_list,
-		exo_new(ec_integer, (exo_integer_t)MD_EIO_FILE_FORMAT),
-		exo_new(ec_integer, (exo_integer_t)EIO_FILE_VERSION),
-		exo_new(ec_integer, (exo_integer_t)target_big_endian),
-		NULL);
-  exo_print(exo, fd);
+  st = eio_stream_new(fd, binary, /* writing */TRUE);
+
+  /* emit EIO file header, binary files replace the blank line after it */
+  if (binary)
+    {
+      fprintf(fd, "%s%s", EIO_FILE_HEADER, EIO_BINARY_HEADER);
+      exo = exo_new(ec_list,
+		    exo_new(ec_integer, (exo_integer_t)MD_EIO_FILE_FORMAT),
+		    exo_new(ec_integer, (exo_integer_t)EIO_FILE_VERSION),
+		    exo_new(ec_integer, (exo_integer_t)target_big_endian),
+		    exo_new(ec_integer, (exo_integer_t)EIO_BINARY_VERSION),
+		    NULL);
+
+      /* index transactions if the file can be seeked on replay */
+      st->seekable = (ftell(fd) != -1);
+    }
+  else
+    {
+      fprintf(fd, "%s\n", EIO_FILE_HEADER);
+      fprintf(fd, "/* file_format: %d, file_version: %d, big_endian: %d */\n",
+	      MD_EIO_FILE_FORMAT, EIO_FILE_VERSION, ld_target_big_endian);
+      exo = exo_new(ec_list,
+		    exo_new(ec_integer, (exo_integer_t)MD_EIO_FILE_FORMAT),
+		    exo_new(ec_integer, (exo_integer_t)EIO_FILE_VERSION),
+		    exo_new(ec_integer, (exo_integer_t)target_big_endian),
+		    NULL);
+    }
+  write_term(exo, fd);
   exo_delete(exo);
-  fprintf(fd, "\n\n");
 
   return fd;
 }
 
+/* open EIO file FNAME, text and binary EIO files are both accepted */
 FILE *
-eio_open(char *fname)
+eio_open(char *fname)			/* EIO file name */
 {
   FILE *fd;
-  struct exo_term_t *exo;
+  struct exo_term_t *exo, *elt;
+  struct eio_stream_t *st;
   int file_format, file_version, big_endian, target_big_endian;
+  char buf[512];
 
   target_big_endian = (endian_host_byte_order() == endian_big);
 
@@ -135,17 +504,31 @@ eio_open(char *fname)
   if (!fd)
     fatal("unable to open EIO file `%s'", fname);
 
+  /* check the EIO file header, the next line selects the encoding (it is
+     blank in text EIO files) */
+  if (!fgets(buf, sizeof(buf), fd) || strcmp(buf, EIO_FILE_HEADER))
+    fatal("`%s' is not an EIO file", fname);
+  if (!fgets(buf, sizeof(buf), fd))
+    fatal("could not read EIO file header");
+  st = eio_stream_new(fd, /* binary */!strcmp(buf, EIO_BINARY_HEADER),
+		      /* !writing */FALSE);
+
   /* read and check EIO file header */
-  exo = exo_read(fd);
+  exo = read_term(fd);
   if (!exo
       || exo->ec != ec_list
-      || !exo->as_list.head
-      || exo->as_list.head->ec != ec_integer
-      || !exo->as_list.head->next
-      || exo->as_list.head->next->ec != ec_integer
-      || !exo->as_list.head->next->next
-      || exo->as_list.head->next->next->ec != ec_integer
-      || exo->as_list.head->next->next->next != NULL)
+      || !(elt = exo->as_list.head)
+      || elt->ec != ec_integer
+      || !(elt = elt->next)
+      || elt->ec != ec_integer
+      || !(elt = elt->next)
+      || elt->ec != ec_integer
+      || (st->binary
+	  ? (!(elt = elt->next)
+	     || elt->ec != ec_integer
+	     || elt->as_integer.val != EIO_BINARY_VERSION)
+	  : FALSE)
+      || elt->next != NULL)
     fatal("could not read EIO file header");
 
   file_format = exo->as_list.head->as_integer.val;
@@ -159,6 +542,9 @@ eio_open(char *fname)
   if (file_version != EIO_FILE_VERSION)
     fatal("EIO file `%s' has incompatible version", fname);
 
+  if (st->binary)
+    index_load(st);
+
   if (!!big_endian != !!target_big_endian)
     {
       warn("endian of `%s' does not match host", fname);
@@ -197,9 +583,44 @@ eio_valid(char *fname)
   return TRUE;
 }
 
+/* close EIO stream FD, the transaction index is appended to binary EIO
+   traces written to a seekable file */
 void
-eio_close(FILE *fd)
+eio_close(FILE *fd)			/* EIO stream */
 {
+  struct eio_stream_t *st = eio_stream(fd);
+  counter_t icnt = 0;
+  long offset, last = 0;
+  int i;
+
+  if (st && st->binary && st->writing)
+    {
+      offset = st->seekable ? ftell(fd) : -1;
+
+      /* the index record also marks the end of the trace */
+      putc(EIO_REC_INDEX, fd);
+      put_varint(fd, offset != -1 ? st->nidx : 0);
+      if (offset != -1)
+	{
+	  for (i=0; i < st->nidx; i++)
+	    {
+	      put_varint(fd, (qword_t)(st->idx[i].icnt - icnt));
+	      put_varint(fd, (qword_t)(st->idx[i].offset - last));
+	      icnt = st->idx[i].icnt;
+	      last = st->idx[i].offset;
+	    }
+	  for (i=0; i < 8; i++)
+	    putc((int)((offset >> (8*i)) & 0xff), fd);
+	  fwrite(EIO_TRAILER_MAGIC, 1, 4, fd);
+	}
+    }
+
+  if (st)
+    {
+      if (st->idx)
+	free(st->idx);
+      st->fd = NULL;
+    }
   gzclose(fd);
 }
 
@@ -210,78 +631,84 @@ eio_write_chkpt(struct regs_t *regs,		/* regs to dump */
 		struct mem_t *mem,		/* memory to dump */
 		FILE *fd)			/* stream to write to */
 {
-  int i;
+  int i, text;
   struct exo_term_t *exo;
   struct mem_pte_t *pte;
+  struct eio_stream_t *st = eio_stream(fd);
+
+  /* comments are only written to text EIO files */
+  text = !st || !st->binary;
 
-  myfprintf(fd, "/* ** start checkpoint @ %n... */\n\n", eio_trans_icnt);
+  if (text)
+    myfprintf(fd, "/* ** start checkpoint @ %n... */\n\n", eio_trans_icnt);
 
-  myfprintf(fd, "/* EIO file pointer: %n... */\n", eio_trans_icnt);
+  if (text)
+    myfprintf(fd, "/* EIO file pointer: %n... */\n", eio_trans_icnt);
   exo = exo_new(ec_integer, (exo_integer_t)eio_trans_icnt);
-  exo_print(exo, fd);
-  fprintf(fd, "\n\n");
+  write_term(exo, fd);
   exo_delete(exo);
 
   /* dump misc regs: icnt, PC, NPC, etc... */
-  fprintf(fd, "/* misc regs icnt, PC, NPC, etc... */\n");
+  if (text)
+    fprintf(fd, "/* misc regs icnt, PC, NPC, etc... */\n");
   exo = MD_MISC_REGS_TO_EXO(regs);
-  exo_print(exo, fd);
-  fprintf(fd, "\n\n");
+  write_term(exo, fd);
   exo_delete(exo);
 
   /* dump integer registers */
-  fprintf(fd, "/* integer regs */\n");
+  if (text)
+    fprintf(fd, "/* integer regs */\n");
   exo = exo_new(ec_list, NULL);
   for (i=0; i < MD_NUM_IREGS; i++)
     exo->as_list.head = exo_chain(exo->as_list.head, MD_IREG_TO_EXO(regs, i));
-  exo_print(exo, fd);
-  fprintf(fd, "\n\n");
+  write_term(exo, fd);
   exo_delete(exo);
 
   /* dump FP registers */
-  fprintf(fd, "/* FP regs (integer format) */\n");
+  if (text)
+    fprintf(fd, "/* FP regs (integer format) */\n");
   exo = exo_new(ec_list, NULL);
   for (i=0; i < MD_NUM_FREGS; i++)
     exo->as_list.head = exo_chain(exo->as_list.head, MD_FREG_TO_EXO(regs, i));
-  exo_print(exo, fd);
-  fprintf(fd, "\n\n");
+  write_term(exo, fd);
   exo_delete(exo);
 
-  fprintf(fd, "/* writing `%d' memory pages... */\n", (int)mem->page_count);
+  if (text)
+    fprintf(fd, "/* writing `%d' memory pages... */\n",
+	    (int)mem->page_count);
   exo = exo_new(ec_list,
 		exo_new(ec_integer, (exo_integer_t)mem->page_count),
 		exo_new(ec_address, (exo_integer_t)ld_brk_point),
 		exo_new(ec_address, (exo_integer_t)ld_stack_min),
 		NULL);
-  exo_print(exo, fd);
-  fprintf(fd, "\n\n");
+  write_term(exo, fd);
   exo_delete(exo);
 
-  fprintf(fd, "/* text segment specifiers (base & size) */\n");
+  if (text)
+    fprintf(fd, "/* text segment specifiers (base & size) */\n");
   exo = exo_new(ec_list,
 		exo_new(ec_address, (exo_integer_t)ld_text_base),
 		exo_new(ec_integer, (exo_integer_t)ld_text_size),
 		NULL);
-  exo_print(exo, fd);
-  fprintf(fd, "\n\n");
+  write_term(exo, fd);
   exo_delete(exo);
 
-  fprintf(fd, "/* data segment specifiers (base & size) */\n");
+  if (text)
+    fprintf(fd, "/* data segment specifiers (base & size) */\n");
   exo = exo_new(ec_list,
 		exo_new(ec_address, (exo_integer_t)ld_data_base),
 		exo_new(ec_integer, (exo_integer_t)ld_data_size),
 		NULL);
-  exo_print(exo, fd);
-  fprintf(fd, "\n\n");
+  write_term(exo, fd);
   exo_delete(exo);
 
-  fprintf(fd, "/* stack segment specifiers (base & size) */\n");
+  if (text)
+    fprintf(fd, "/* stack segment specifiers (base & size) */\n");
   exo = exo_new(ec_list,
 		exo_new(ec_address, (exo_integer_t)ld_stack_base),
 		exo_new(ec_integer, (exo_integer_t)ld_stack_size),
 		NULL);
-  exo_print(exo, fd);
-  fprintf(fd, "\n\n");
+  write_term(exo, fd);
   exo_delete(exo);
 
   /* visit all active memory pages, and dump them to the checkpoint file */
@@ -292,12 +719,12 @@ eio_write_chkpt(struct regs_t *regs,		/* regs to dump */
 		    exo_new(ec_address, (exo_integer_t)MEM_PTE_ADDR(pte, i)),
 		    exo_new(ec_blob, MD_PAGE_SIZE, pte->page),
 		    NULL);
-      exo_print(exo, fd);
-      fprintf(fd, "\n\n");
+      write_term(exo, fd);
       exo_delete(exo);
     }
 
-  myfprintf(fd, "/* ** end checkpoint @ %n... */\n\n", eio_trans_icnt);
+  if (text)
+    myfprintf(fd, "/* ** end checkpoint @ %n... */\n\n", eio_trans_icnt);
 
   return eio_trans_icnt;
 }
@@ -314,7 +741,7 @@ eio_read_chkpt(struct regs_t *regs,		/* regs to dump */
   struct exo_term_t *exo, *elt;
 
   /* read the EIO file pointer */
-  exo = exo_read(fd);
+  exo = read_term(fd);
   if (!exo
       || exo->ec != ec_integer)
     fatal("could not read EIO file pointer");
@@ -322,12 +749,12 @@ eio_read_chkpt(struct regs_t *regs,		/* regs to dump */
   exo_delete(exo);
 
   /* read misc regs: icnt, PC, NPC, HI, LO, FCC */
-  exo = exo_read(fd);
+  exo = read_term(fd);
   MD_EXO_TO_MISC_REGS(exo, sim_num_insn, regs);
   exo_delete(exo);
 
   /* read integer registers */
-  exo = exo_read(fd);
+  exo = read_term(fd);
   if (!exo
       || exo->ec != ec_list)
     fatal("could not read EIO integer regs");
@@ -348,7 +775,7 @@ eio_read_chkpt(struct regs_t *regs,		/* regs to dump */
   exo_delete(exo);
 
   /* read FP registers */
-  exo = exo_read(fd);
+  exo = read_term(fd);
   if (!exo
       || exo->ec != ec_list)
     fatal("could not read EIO FP regs");
@@ -369,7 +796,7 @@ eio_read_chkpt(struct regs_t *regs,		/* regs to dump */
   exo_delete(exo);
 
   /* read the number of page defs, and memory config */
-  exo = exo_read(fd);
+  exo = read_term(fd);
   if (!exo
       || exo->ec != ec_list
       || !exo->as_list.head
@@ -386,7 +813,7 @@ eio_read_chkpt(struct regs_t *regs,		/* regs to dump */
   exo_delete(exo);
 
   /* read text segment specifiers */
-  exo = exo_read(fd);
+  exo = read_term(fd);
   if (!exo
       || exo->ec != ec_list
       || !exo->as_list.head
@@ -400,7 +827,7 @@ eio_read_chkpt(struct regs_t *regs,		/* regs to dump */
   exo_delete(exo);
 
   /* read data segment specifiers */
-  exo = exo_read(fd);
+  exo = read_term(fd);
   if (!exo
       || exo->ec != ec_list
       || !exo->as_list.head
@@ -414,7 +841,7 @@ eio_read_chkpt(struct regs_t *regs,		/* regs to dump */
   exo_delete(exo);
 
   /* read stack segment specifiers */
-  exo = exo_read(fd);
+  exo = read_term(fd);
   if (!exo
       || exo->ec != ec_list
       || !exo->as_list.head
@@ -434,7 +861,7 @@ eio_read_chkpt(struct regs_t *regs,		/* regs to dump */
       struct exo_term_t *blob;
 
       /* read the page */
-      exo = exo_read(fd);
+      exo = read_term(fd);
       if (!exo
 	  || exo->ec != ec_list
 	  || !exo->as_list.head
@@ -577,6 +1004,7 @@ eio_write_trace(FILE *eio_fd,			/* EIO stream file desc */
 {
   int i;
   struct exo_term_t *exo;
+  struct eio_stream_t *st = eio_stream(eio_fd);
 
   /* write syscall register inputs ($r2..$r7) */
   input_regs = exo_new(ec_list, NULL);
@@ -619,8 +1047,21 @@ eio_write_trace(FILE *eio_fd,			/* EIO stream file desc */
 		input_regs, input_mem,
 		output_regs, output_mem,
 		NULL);
-  exo_print(exo, eio_fd);
-  fprintf(eio_fd, "\n\n");
+  if (st && st->binary)
+    {
+      /* frame the transaction, so replay can skip it without decoding */
+      if (st->seekable)
+	index_add(st, icnt, ftell(eio_fd));
+      enc_len = 0;
+      enc_term(exo);
+      putc(EIO_REC_TRANS, eio_fd);
+      put_varint(eio_fd, (qword_t)icnt);
+      put_varint(eio_fd, enc_len);
+      if (fwrite(enc_buf, 1, enc_len, eio_fd) != enc_len)
+	fatal("could not write EIO trace");
+    }
+  else
+    write_term(exo, eio_fd);
 
   /* release input storage */
   exo_delete(exo);
@@ -644,6 +1085,7 @@ eio_read_trace(FILE *eio_fd,			/* EIO stream file desc */
   struct exo_term_t *exo, *exo_icnt, *exo_pc;
   struct exo_term_t *exo_inregs, *exo_inmem, *exo_outregs, *exo_outmem;
   struct exo_term_t *brkrec, *regrec, *memrec;
+  struct eio_stream_t *st = eio_stream(eio_fd);
 
   /* exit() system calls get executed for real... */
   if (MD_EXIT_SYSCALL(regs))
@@ -653,7 +1095,17 @@ eio_read_trace(FILE *eio_fd,			/* EIO stream file desc */
     }
 
   /* else, read the external I/O (EIO) transaction */
-  exo = exo_read(eio_fd);
+  if (st && st->binary)
+    {
+      if (getc(eio_fd) != EIO_REC_TRANS)
+	fatal("cannot read EIO transaction");
+      /* the frame's icnt and size are only needed to skip it */
+      get_varint(eio_fd);
+      get_varint(eio_fd);
+      exo = get_term(eio_fd);
+    }
+  else
+    exo = exo_read(eio_fd);
 
   /* one more transaction processed */
   eio_trans_icnt = icnt;
@@ -815,6 +1267,42 @@ void
 eio_fast_forward(FILE *eio_fd, counter_t icnt)
 {
   struct exo_term_t *exo, *exo_icnt;
+  struct eio_stream_t *st = eio_stream(eio_fd);
+  counter_t rec_icnt;
+  int lo, hi, mid;
+
+  if (st && st->binary)
+    {
+      /* seek to the transaction with the index, if there is one */
+      if (st->nidx > 0)
+	{
+	  for (lo=0, hi=st->nidx-1; lo < hi; )
+	    {
+	      mid = (lo + hi) / 2;
+	      if (st->idx[mid].icnt < icnt)
+		lo = mid + 1;
+	      else
+		hi = mid;
+	    }
+	  if (st->idx[lo].icnt != icnt)
+	    fatal("could not fast forward to EIO checkpoint");
+	  if (fseek(eio_fd, st->idx[lo].offset, SEEK_SET) != 0)
+	    fatal("could not seek EIO file");
+	}
+
+      /* skip transaction records, up to and including ICNT's */
+      do
+	{
+	  if (getc(eio_fd) != EIO_REC_TRANS)
+	    fatal("could not fast forward to EIO checkpoint");
+	  rec_icnt = (counter_t)get_varint(eio_fd);
+	  skip_bytes(st, get_varint(eio_fd));
+	}
+      while (rec_icnt != icnt);
+
+      eio_trans_icnt = icnt;
+      return;
+    }
 
   do
     {
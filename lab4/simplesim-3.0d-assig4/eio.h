@@ -61,13 +61,21 @@
 /* EIO file version */
 #define EIO_FILE_VERSION		3
 
-FILE *eio_create(char *fname);
+/* binary EIO encoding version, binary files hold the same terms as text
+   EIO files of version EIO_FILE_VERSION */
+#define EIO_BINARY_VERSION		2
 
+/* create EIO file FNAME, BINARY selects the binary encoding */
+FILE *eio_create(char *fname, int binary);
+
+/* open EIO file FNAME, text and binary EIO files are both accepted */
 FILE *eio_open(char *fname);
 
 /* returns non-zero if file FNAME has a valid EIO header */
 int eio_valid(char *fname);
 
+/* close EIO stream FD, the transaction index is appended to binary EIO
+   traces written to a seekable file */
 void eio_close(FILE *fd);
 
 /* check point current architected state to stream FD, returns
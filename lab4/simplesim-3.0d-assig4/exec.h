@@ -0,0 +1,335 @@
+/* exec.h - shared functional execution engine */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+/*
+ * This file is the functional execution loop shared by the simulators,
+ * it is included (once) by a simulator after its state is declared, and
+ * it defines:
+ *
+ *   static void exec_insts(counter_t count);
+ *
+ * which executes COUNT insts (or until EXEC_STOP() if COUNT is zero) from
+ * the precise architected state in `regs', `mem' and the predecoded text
+ * `pd'.  The register and memory accessors used by machine.def are
+ * defined here, replacing any the simulator has defined.
+ *
+ * A simulator observes execution by defining any of these hooks before
+ * including this file, hooks that are not defined are compiled away:
+ *
+ *   EXEC_ON_FETCH(PC)		statement, before the inst at PC is fetched
+ *   EXEC_ON_MEM(CMD, ADDR, NBYTES)
+ *				expression, before each load (CMD == Read)
+ *				or store (CMD == Write) of NBYTES at ADDR
+ *   EXEC_ON_BRANCH(DEC, TPC)	statement, after a control inst DEC executes,
+ *				TPC is its target address (regs_NPC is the
+ *				next PC)
+ *   EXEC_ON_SYSCALL(INST)	expression, executes system call INST,
+ *				sys_syscall() on precise state by default
+ *   EXEC_ON_INST(DEC, ADDR, IS_WRITE)
+ *				statement, after each inst DEC executes,
+ *				ADDR is its effective address, if any
+ *   EXEC_STOP()		expression, non-zero to return after the
+ *				current inst
+ *
+ * EXEC_INSN_CNT names the counter incremented for each inst executed, it
+ * is sim_num_insn by default.
+ */
+
+#ifndef EXEC_H
+#define EXEC_H
+
+#ifndef EXEC_ON_FETCH
+#define EXEC_ON_FETCH(PC)
+#endif
+#ifndef EXEC_ON_MEM
+#define EXEC_ON_MEM(CMD, ADDR, NBYTES)	0
+#endif
+#ifndef EXEC_ON_SYSCALL
+#define EXEC_ON_SYSCALL(INST)						\
+  sys_syscall(&regs, mem_access, mem, (INST), TRUE)
+#endif
+#ifndef EXEC_ON_INST
+#define EXEC_ON_INST(DEC, ADDR, IS_WRITE)
+#endif
+#ifndef EXEC_STOP
+#define EXEC_STOP()			FALSE
+#endif
+#ifndef EXEC_INSN_CNT
+#define EXEC_INSN_CNT			sim_num_insn
+#endif
+
+/*
+ * precise architected register accessors
+ */
+
+#undef SET_NPC
+#undef SET_TPC
+#undef CPC
+#undef GPR
+#undef SET_GPR
+
+/* next program counter */
+#define SET_NPC(EXPR)		(regs.regs_NPC = (EXPR))
+
+/* target program counter, only computed if branches are hooked */
+#ifdef EXEC_ON_BRANCH
+#define SET_TPC(EXPR)		(target_PC = (EXPR))
+#else
+#define SET_TPC(EXPR)		((void)0)
+#endif
+
+/* current program counter */
+#define CPC			(regs.regs_PC)
+
+/* general purpose registers */
+#define GPR(N)			(regs.regs_R[N])
+#define SET_GPR(N,EXPR)		(regs.regs_R[N] = (EXPR))
+
+#if defined(TARGET_PISA)
+
+#undef FPR_L
+#undef SET_FPR_L
+#undef FPR_F
+#undef SET_FPR_F
+#undef FPR_D
+#undef SET_FPR_D
+#undef SET_HI
+#undef HI
+#undef SET_LO
+#undef LO
+#undef FCC
+#undef SET_FCC
+
+/* floating point registers, L->word, F->single-prec, D->double-prec */
+#define FPR_L(N)		(regs.regs_F.l[(N)])
+#define SET_FPR_L(N,EXPR)	(regs.regs_F.l[(N)] = (EXPR))
+#define FPR_F(N)		(regs.regs_F.f[(N)])
+#define SET_FPR_F(N,EXPR)	(regs.regs_F.f[(N)] = (EXPR))
+#define FPR_D(N)		(regs.regs_F.d[(N) >> 1])
+#define SET_FPR_D(N,EXPR)	(regs.regs_F.d[(N) >> 1] = (EXPR))
+
+/* miscellaneous register accessors */
+#define SET_HI(EXPR)		(regs.regs_C.hi = (EXPR))
+#define HI			(regs.regs_C.hi)
+#define SET_LO(EXPR)		(regs.regs_C.lo = (EXPR))
+#define LO			(regs.regs_C.lo)
+#define FCC			(regs.regs_C.fcc)
+#define SET_FCC(EXPR)		(regs.regs_C.fcc = (EXPR))
+
+#elif defined(TARGET_ALPHA)
+
+#undef FPR_Q
+#undef SET_FPR_Q
+#undef FPR
+#undef SET_FPR
+#undef FPCR
+#undef SET_FPCR
+#undef UNIQ
+#undef SET_UNIQ
+
+/* floating point registers, L->word, F->single-prec, D->double-prec */
+#define FPR_Q(N)		(regs.regs_F.q[N])
+#define SET_FPR_Q(N,EXPR)	(regs.regs_F.q[N] = (EXPR))
+#define FPR(N)			(regs.regs_F.d[(N)])
+#define SET_FPR(N,EXPR)		(regs.regs_F.d[(N)] = (EXPR))
+
+/* miscellaneous register accessors */
+#define FPCR			(regs.regs_C.fpcr)
+#define SET_FPCR(EXPR)		(regs.regs_C.fpcr = (EXPR))
+#define UNIQ			(regs.regs_C.uniq)
+#define SET_UNIQ(EXPR)		(regs.regs_C.uniq = (EXPR))
+
+#else
+#error No ISA target defined...
+#endif
+
+/*
+ * precise architected memory state accessors
+ */
+
+#undef READ_BYTE
+#undef READ_HALF
+#undef READ_WORD
+#undef READ_QWORD
+#undef WRITE_BYTE
+#undef WRITE_HALF
+#undef WRITE_WORD
+#undef WRITE_QWORD
+#undef SYSCALL
+
+#define READ_BYTE(SRC, FAULT)						\
+  ((FAULT) = md_fault_none, addr = (SRC),				\
+   (void)EXEC_ON_MEM(Read, addr, sizeof(byte_t)), MEM_READ_BYTE(mem, addr))
+#define READ_HALF(SRC, FAULT)						\
+  ((FAULT) = md_fault_none, addr = (SRC),				\
+   (void)EXEC_ON_MEM(Read, addr, sizeof(half_t)), MEM_READ_HALF(mem, addr))
+#define READ_WORD(SRC, FAULT)						\
+  ((FAULT) = md_fault_none, addr = (SRC),				\
+   (void)EXEC_ON_MEM(Read, addr, sizeof(word_t)), MEM_READ_WORD(mem, addr))
+#ifdef HOST_HAS_QWORD
+#define READ_QWORD(SRC, FAULT)						\
+  ((FAULT) = md_fault_none, addr = (SRC),				\
+   (void)EXEC_ON_MEM(Read, addr, sizeof(qword_t)),			\
+   MEM_READ_QWORD(mem, addr))
+#endif /* HOST_HAS_QWORD */
+
+#define WRITE_BYTE(SRC, DST, FAULT)					\
+  ((FAULT) = md_fault_none, addr = (DST),				\
+   (void)EXEC_ON_MEM(Write, addr, sizeof(byte_t)),			\
+   MEM_WRITE_BYTE(mem, addr, (SRC)))
+#define WRITE_HALF(SRC, DST, FAULT)					\
+  ((FAULT) = md_fault_none, addr = (DST),				\
+   (void)EXEC_ON_MEM(Write, addr, sizeof(half_t)),			\
+   MEM_WRITE_HALF(mem, addr, (SRC)))
+#define WRITE_WORD(SRC, DST, FAULT)					\
+  ((FAULT) = md_fault_none, addr = (DST),				\
+   (void)EXEC_ON_MEM(Write, addr, sizeof(word_t)),			\
+   MEM_WRITE_WORD(mem, addr, (SRC)))
+#ifdef HOST_HAS_QWORD
+#define WRITE_QWORD(SRC, DST, FAULT)					\
+  ((FAULT) = md_fault_none, addr = (DST),				\
+   (void)EXEC_ON_MEM(Write, addr, sizeof(qword_t)),			\
+   MEM_WRITE_QWORD(mem, addr, (SRC)))
+#endif /* HOST_HAS_QWORD */
+
+/* system call handler macro */
+#define SYSCALL(INST)		EXEC_ON_SYSCALL(INST)
+
+/* execute COUNT insts, or until EXEC_STOP() if COUNT is zero, from the
+   precise architected state */
+static void
+exec_insts(counter_t count)		/* insts to execute, 0 for no limit */
+{
+  counter_t icount;
+  md_inst_t inst;			/* actual instruction bits */
+  struct predec_inst_t *dec;		/* predecoded inst */
+  enum md_opcode op;			/* decoded opcode enum */
+  register md_addr_t addr;		/* effective address, if load/store */
+  register int is_write;		/* store? */
+#ifdef EXEC_ON_BRANCH
+  md_addr_t target_PC = 0;		/* branch target address */
+#endif /* EXEC_ON_BRANCH */
+  enum md_fault_type fault;
+
+  for (icount=0; !count || icount < count; icount++)
+    {
+      /* maintain $r0 semantics */
+      regs.regs_R[MD_REG_ZERO] = 0;
+#ifdef TARGET_ALPHA
+      regs.regs_F.d[MD_REG_ZERO] = 0.0;
+#endif /* TARGET_ALPHA */
+
+      /* get the next instruction to execute */
+      EXEC_ON_FETCH(regs.regs_PC);
+      dec = PREDEC_LOOKUP(pd, regs.regs_PC);
+      inst = dec->inst;
+
+      /* keep an instruction count */
+      EXEC_INSN_CNT++;
+
+      /* set default reference address and access mode */
+      addr = 0; is_write = FALSE;
+
+      /* set default fault - none */
+      fault = md_fault_none;
+
+      /* the instruction is predecoded */
+      op = dec->op;
+
+      /* execute the instruction */
+      switch (op)
+	{
+#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
+	case OP:							\
+	  SYMCAT(OP,_IMPL);						\
+	  break;
+#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
+	case OP:							\
+	  panic("attempted to execute a linking opcode");
+#define CONNECT(OP)
+#undef DECLARE_FAULT
+#define DECLARE_FAULT(FAULT)						\
+	  { fault = (FAULT); break; }
+#include "machine.def"
+	default:
+	  panic("attempted to execute a bogus opcode");
+	}
+
+      if (fault != md_fault_none)
+	fatal("fault (%d) detected @ 0x%08p", fault, regs.regs_PC);
+
+      if ((dec->flags & (F_MEM|F_STORE)) == (F_MEM|F_STORE))
+	is_write = TRUE;
+
+#ifdef EXEC_ON_BRANCH
+      if (dec->flags & F_CTRL)
+	EXEC_ON_BRANCH(dec, target_PC);
+#endif /* EXEC_ON_BRANCH */
+
+      EXEC_ON_INST(dec, addr, is_write);
+
+      /* check for DLite debugger entry condition */
+      if (dlite_check_break(regs.regs_NPC,
+			    is_write ? ACCESS_WRITE : ACCESS_READ,
+			    addr, sim_num_insn, sim_num_insn))
+	dlite_main(regs.regs_PC, regs.regs_NPC, sim_num_insn, &regs, mem);
+
+      /* go to the next instruction */
+      regs.regs_PC = regs.regs_NPC;
+      regs.regs_NPC += sizeof(md_inst_t);
+
+      /* finish early? */
+      if (EXEC_STOP())
+	return;
+    }
+}
+
+#endif /* EXEC_H */
@@ -0,0 +1,307 @@
+/* hier.c - cache hierarchy routines */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "cache.h"
+#include "memtrace.h"
+#include "stats.h"
+#include "hier.h"
+
+/* PC of the reference being sent to a hierarchy and the hierarchy being
+   accessed, private to each thread, the cache miss handlers and the
+   prefetchers (via get_PC()) have no other way to find them */
+THREAD_LOCAL md_addr_t hier_pc = 0;
+THREAD_LOCAL struct hier_t *hier_cur = NULL;
+
+/* l1 data cache l1 block miss handler function */
+static unsigned int			/* latency of block access */
+dl1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
+	      md_addr_t baddr,		/* block address to access */
+	      int bsize,		/* size of block to access */
+	      struct cache_blk_t *blk,	/* ptr to block in upper level */
+	      tick_t now,		/* time of access */
+	      int prefetch)		/* if 1 the access is a prefetch */
+{
+  if (hier_cur->dl2)
+    {
+      /* access next level of data cache hierarchy */
+      return cache_access(hier_cur->dl2, cmd, baddr, NULL, bsize,
+			  /* now */now, /* pudata */NULL, /* repl addr */NULL,
+			  prefetch);
+    }
+  else
+    {
+      /* access main memory */
+      return /* access latency, ignored */1;
+    }
+}
+
+/* l1 inst cache l1 block miss handler function */
+static unsigned int			/* latency of block access */
+il1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
+	      md_addr_t baddr,		/* block address to access */
+	      int bsize,		/* size of block to access */
+	      struct cache_blk_t *blk,	/* ptr to block in upper level */
+	      tick_t now,		/* time of access */
+	      int prefetch)		/* if 1 the access is a prefetch */
+{
+  if (hier_cur->il2)
+    {
+      /* access next level of inst cache hierarchy */
+      return cache_access(hier_cur->il2, cmd, baddr, NULL, bsize,
+			  /* now */now, /* pudata */NULL, /* repl addr */NULL,
+			  prefetch);
+    }
+  else
+    {
+      /* access main memory */
+      return /* access latency, ignored */1;
+    }
+}
+
+/* l2 cache block miss handler function */
+static unsigned int			/* latency of block access */
+l2_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
+	     md_addr_t baddr,		/* block address to access */
+	     int bsize,			/* size of block to access */
+	     struct cache_blk_t *blk,	/* ptr to block in upper level */
+	     tick_t now,		/* time of access */
+	     int prefetch)		/* if 1 the access is a prefetch */
+{
+  /* this is a miss to the lowest level, so access main memory */
+  return /* access latency, ignored */1;
+}
+
+/* TLB block miss handler function */
+static unsigned int			/* latency of block access */
+tlb_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
+	      md_addr_t baddr,		/* block address to access */
+	      int bsize,		/* size of block to access */
+	      struct cache_blk_t *blk,	/* ptr to block in upper level */
+	      tick_t now,		/* time of access */
+	      int prefetch)		/* if 1 the access is a prefetch */
+{
+  md_addr_t *phy_page_ptr = (md_addr_t *)blk->user_data;
+
+  /* no real memory access, however, should have user data space attached */
+  assert(phy_page_ptr);
+
+  /* fake translation, for now... */
+  *phy_page_ptr = 0;
+
+  return /* access latency, ignored */1;
+}
+
+/* create the cache described by cache config CONFIG as cache level LEVEL,
+   named <prefix><name>, using miss handler ACCESS_FN */
+static struct cache_t *
+hier_cache(char *prefix,		/* cache name prefix */
+	   char *level,			/* cache level name */
+	   char *config,		/* cache config */
+	   int usize,			/* size of user data to alloc w/blks */
+	   unsigned int (*access_fn)(enum mem_cmd cmd,
+				     md_addr_t baddr, int bsize,
+				     struct cache_blk_t *blk,
+				     tick_t now, int prefetch))
+{
+  char name[128], hname[256], c;
+  int nsets, bsize, assoc, prefetch_type;
+
+  if (sscanf(config, "%[^:]:%d:%d:%d:%c:%d",
+	     name, &nsets, &bsize, &assoc, &c, &prefetch_type) != 6)
+    fatal("bad %s parms: <name>:<nsets>:<bsize>:<assoc>:<repl>:<pref>",
+	  level);
+  sprintf(hname, "%s%s", prefix, name);
+  return cache_create(hname, nsets, bsize, /* balloc */FALSE,
+		      usize, assoc, cache_char2policy(c),
+		      access_fn, /* hit latency */1, prefetch_type);
+}
+
+/* create cache hierarchy H as described by SPEC, the caches are named
+   <prefix><name>, e.g., h0.dl1 */
+void
+hier_create(struct hier_t *h,		/* hierarchy to initialize */
+	    char *prefix,		/* cache name prefix */
+	    char *spec)			/* hierarchy description */
+{
+  char *tok, *config;
+  char *il1_opt = NULL, *il2_opt = NULL;
+
+  memset(h, 0, sizeof(*h));
+
+  /* create the data side first, the inst side may refer to it */
+  spec = mystrdup(spec);
+  for (tok=strtok(spec, ","); tok; tok=strtok(NULL, ","))
+    {
+      if (!(config = strchr(tok, '=')))
+	fatal("bad cache hierarchy level `%s', use <level>=<config>", tok);
+      *config++ = '\0';
+
+      if (!mystricmp(tok, "dl1"))
+	h->dl1 = hier_cache(prefix, tok, config, 0, dl1_access_fn);
+      else if (!mystricmp(tok, "dl2"))
+	h->dl2 = hier_cache(prefix, tok, config, 0, l2_access_fn);
+      else if (!mystricmp(tok, "itlb"))
+	h->itlb = hier_cache(prefix, tok, config, sizeof(md_addr_t),
+			     tlb_access_fn);
+      else if (!mystricmp(tok, "dtlb"))
+	h->dtlb = hier_cache(prefix, tok, config, sizeof(md_addr_t),
+			     tlb_access_fn);
+      else if (!mystricmp(tok, "il1"))
+	il1_opt = config;
+      else if (!mystricmp(tok, "il2"))
+	il2_opt = config;
+      else
+	fatal("unknown cache hierarchy level `%s'", tok);
+    }
+
+  if (h->dl2 && !h->dl1)
+    fatal("the l1 data cache must defined if the l2 cache is defined");
+
+  if (!il1_opt)
+    {
+      if (il2_opt)
+	fatal("the l1 inst cache must defined if the l2 cache is defined");
+    }
+  else if (!mystricmp(il1_opt, "dl1") || !mystricmp(il1_opt, "dl2"))
+    {
+      h->il1 = !mystricmp(il1_opt, "dl1") ? h->dl1 : h->dl2;
+      if (!h->il1)
+	fatal("I-cache l1 cannot access D-cache `%s' as it's undefined",
+	      il1_opt);
+      if (il2_opt)
+	fatal("the l1 inst cache must defined if the l2 cache is defined");
+    }
+  else
+    {
+      h->il1 = hier_cache(prefix, "il1", il1_opt, 0, il1_access_fn);
+      if (!il2_opt)
+	h->il2 = NULL;
+      else if (!mystricmp(il2_opt, "dl2"))
+	{
+	  if (!h->dl2)
+	    fatal("I-cache l2 cannot access D-cache l2 as it's undefined");
+	  h->il2 = h->dl2;
+	}
+      else
+	h->il2 = hier_cache(prefix, "il2", il2_opt, 0, l2_access_fn);
+    }
+  free(spec);
+}
+
+/* register the cache statistics of hierarchy H */
+void
+hier_reg_stats(struct hier_t *h,	/* cache hierarchy */
+	       struct stat_sdb_t *sdb)	/* stats database */
+{
+  if (h->il1 && (h->il1 != h->dl1 && h->il1 != h->dl2))
+    cache_reg_stats(h->il1, sdb);
+  if (h->il2 && (h->il2 != h->dl1 && h->il2 != h->dl2))
+    cache_reg_stats(h->il2, sdb);
+  if (h->dl1)
+    cache_reg_stats(h->dl1, sdb);
+  if (h->dl2)
+    cache_reg_stats(h->dl2, sdb);
+  if (h->itlb)
+    cache_reg_stats(h->itlb, sdb);
+  if (h->dtlb)
+    cache_reg_stats(h->dtlb, sdb);
+}
+
+/* send reference KIND of NBYTES at ADDR by the inst at PC to hierarchy H */
+void
+hier_access(struct hier_t *h,		/* cache hierarchy */
+	    enum mtrace_kind_t kind,	/* reference kind */
+	    md_addr_t pc,		/* PC of referencing inst */
+	    md_addr_t addr,		/* address referenced */
+	    int nbytes)			/* size of reference in bytes */
+{
+  enum mem_cmd cmd;
+
+  hier_cur = h;
+  hier_pc = pc;
+  if (kind == mt_ifetch)
+    {
+      if (h->itlb)
+	cache_access(h->itlb, Read, addr, NULL, nbytes, 0, NULL, NULL, 0);
+      if (h->il1)
+	cache_access(h->il1, Read, addr, NULL, nbytes, 0, NULL, NULL, 0);
+    }
+  else
+    {
+      cmd = (kind == mt_write) ? Write : Read;
+      if (h->dtlb)
+	cache_access(h->dtlb, cmd, addr, NULL, nbytes, 0, NULL, NULL, 0);
+      if (h->dl1)
+	cache_access(h->dl1, cmd, addr, NULL, nbytes, 0, NULL, NULL, 0);
+    }
+}
+
+/* flush the data caches and data TLB of hierarchy H */
+void
+hier_flush(struct hier_t *h)		/* cache hierarchy */
+{
+  hier_cur = h;
+  if (h->dtlb)
+    cache_flush(h->dtlb, 0);
+  if (h->dl1)
+    cache_flush(h->dl1, 0);
+  if (h->dl2)
+    cache_flush(h->dl2, 0);
+}
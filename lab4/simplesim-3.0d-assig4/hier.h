@@ -0,0 +1,121 @@
+/* hier.h - cache hierarchy interfaces */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#ifndef HIER_H
+#define HIER_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "cache.h"
+#include "memtrace.h"
+#include "stats.h"
+
+/*
+ * This module implements the cache hierarchies simulated by sim-replay and
+ * by sim-cache's configuration sweeps.  A hierarchy has the same form as the
+ * one simulated by sim-cache, i.e., up to two levels of instruction and data
+ * cache (with any levels unified) and one level of instruction and data
+ * TLBs.  A hierarchy is described by a comma separated list of
+ * <level>=<config> pairs, where <level> is one of il1, il2, dl1, dl2, itlb
+ * or dtlb, and <config> is a cache config in the same format as sim-cache's
+ * `-cache:dl1' option.  As in sim-cache, il1 may be given as `dl1' or `dl2',
+ * and il2 as `dl2', to unify levels.  Levels not listed are not simulated.
+ *
+ * Independent hierarchies may be accessed from different threads, but each
+ * hierarchy must only be accessed by one thread at a time.
+ */
+
+/* cache hierarchy, each level may be NULL */
+struct hier_t
+{
+  struct cache_t *il1;		/* level 1 instruction cache */
+  struct cache_t *il2;		/* level 2 instruction cache */
+  struct cache_t *dl1;		/* level 1 data cache */
+  struct cache_t *dl2;		/* level 2 data cache */
+  struct cache_t *itlb;		/* instruction TLB */
+  struct cache_t *dtlb;		/* data TLB */
+};
+
+/* PC of the reference the calling thread is sending to a hierarchy, used by
+   the prefetchers (via get_PC()), and the hierarchy, NULL if the calling
+   thread has not accessed any */
+extern THREAD_LOCAL md_addr_t hier_pc;
+extern THREAD_LOCAL struct hier_t *hier_cur;
+
+/* create cache hierarchy H as described by SPEC, the caches are named
+   <prefix><name>, e.g., h0.dl1 */
+void
+hier_create(struct hier_t *h,		/* hierarchy to initialize */
+	    char *prefix,		/* cache name prefix */
+	    char *spec);		/* hierarchy description */
+
+/* register the cache statistics of hierarchy H */
+void
+hier_reg_stats(struct hier_t *h,	/* cache hierarchy */
+	       struct stat_sdb_t *sdb);	/* stats database */
+
+/* send reference KIND of NBYTES at ADDR by the inst at PC to hierarchy H */
+void
+hier_access(struct hier_t *h,		/* cache hierarchy */
+	    enum mtrace_kind_t kind,	/* reference kind */
+	    md_addr_t pc,		/* PC of referencing inst */
+	    md_addr_t addr,		/* address referenced */
+	    int nbytes);		/* size of reference in bytes */
+
+/* flush the data caches and data TLB of hierarchy H */
+void
+hier_flush(struct hier_t *h);		/* cache hierarchy */
+
+#endif /* HIER_H */
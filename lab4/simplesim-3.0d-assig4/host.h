@@ -79,6 +79,16 @@
 #endif /* OLD_SYMCAT */
 #endif /* __GNUC__ */
 
+/* thread-private storage for simulators with worker threads, only supported
+   with GNU GCC, elsewhere such simulators do all their work on the main
+   thread */
+#ifdef __GNUC__
+#define HOST_HAS_THREADS
+#define THREAD_LOCAL	__thread
+#else /* !__GNUC__ */
+#define THREAD_LOCAL
+#endif /* __GNUC__ */
+
 /* host-dependent canonical type definitions */
 typedef int bool_t;			/* generic boolean type */
 typedef unsigned char byte_t;		/* byte - 8 bits */
@@ -121,11 +121,22 @@ struct opt_odb_t *sim_odb;
 /* stats database */
 struct stat_sdb_t *sim_sdb;
 
+/* counter stat the stats interval is counted in, NULL for no interval stats,
+   and its value at the next interval stats dump */
+counter_t *sim_stats_var = NULL;
+counter_t sim_stats_next = 0;
+
+/* called before any stats are printed, if set */
+void (*sim_stats_hook)(void) = NULL;
+
 /* EIO interfaces */
 char *sim_eio_fname = NULL;
 char *sim_chkpt_fname = NULL;
 FILE *sim_eio_fd = NULL;
 
+/* cached post-load program image file name, NULL if none */
+char *sim_image_fname = NULL;
+
 /* redirected program/simulator output file names */
 static char *sim_simout = NULL;
 static char *sim_progout = NULL;
@@ -140,6 +151,20 @@ static int help_me;
 /* random number generator seed */
 static int rand_seed;
 
+/* statistics output format, see enum stat_fmt_t */
+static int stats_format;
+static char *stats_format_names[sf_NUM] = { "text", "json", "csv" };
+
+/* interval statistics: dump interval, the stat it is counted in, and the
+   interval stats output file */
+static unsigned int stats_interval;
+static char *stats_var_name;
+static char *stats_fname;
+static FILE *stats_fd = NULL;
+
+/* number of interval stats dumps so far */
+static int stats_sample = 0;
+
 /* initialize and quit immediately */
 static int init_quit;
 
@@ -195,6 +220,9 @@ sim_print_stats(FILE *fd)		/* output stream */
   if (!running)
     return;
 
+  if (sim_stats_hook)
+    (*sim_stats_hook)();
+
   /* get stats time */
   sim_end_time = time((time_t *)NULL);
   sim_elapsed_time = MAX(sim_end_time - sim_start_time, 1);
@@ -206,11 +234,85 @@ sim_print_stats(FILE *fd)		/* output stream */
 
   /* print simulation stats */
   fprintf(fd, "\nsim: ** simulation statistics **\n");
-  stat_print_stats(sim_sdb, fd);
+  stat_print_fmt(sim_sdb, fd, (enum stat_fmt_t)stats_format);
   sim_aux_stats(fd);
   fprintf(fd, "\n");
 }
 
+/* print stats record SAMPLE (-1 for the final record) to FD, both the
+   cumulative stats and their change since the last record */
+static void
+print_stats_record(FILE *fd,		/* output stream */
+		   int sample)		/* record number, -1 for final */
+{
+  char name[32], prefix[64];
+
+  if (sim_stats_hook)
+    (*sim_stats_hook)();
+
+  /* get stats time */
+  sim_end_time = time((time_t *)NULL);
+  sim_elapsed_time = MAX(sim_end_time - sim_start_time, 1);
+
+  if (sample < 0)
+    strcpy(name, "final");
+  else
+    snprintf(name, sizeof(name), "%d", sample);
+
+  switch (stats_format)
+    {
+    case sf_text:
+      fprintf(fd, "\nsim: ** %s%s statistics **\n",
+	      sample < 0 ? "" : "interval ", name);
+      stat_print_stats(sim_sdb, fd);
+      fprintf(fd, "\nsim: ** %s%s statistics, change since last dump **\n",
+	      sample < 0 ? "" : "interval ", name);
+      sim_sdb->delta = TRUE;
+      stat_print_stats(sim_sdb, fd);
+      sim_sdb->delta = FALSE;
+      break;
+    case sf_json:
+      fprintf(fd, sample < 0 ? "{\"sample\":\"%s\"" : "{\"sample\":%s", name);
+      fprintf(fd, ",\"cumulative\":");
+      stat_print_json(sim_sdb, fd);
+      fprintf(fd, ",\"delta\":");
+      sim_sdb->delta = TRUE;
+      stat_print_json(sim_sdb, fd);
+      sim_sdb->delta = FALSE;
+      fprintf(fd, "}\n");
+      break;
+    case sf_csv:
+      snprintf(prefix, sizeof(prefix), "%s,cumulative", name);
+      stat_print_csv(sim_sdb, fd, prefix);
+      snprintf(prefix, sizeof(prefix), "%s,delta", name);
+      sim_sdb->delta = TRUE;
+      stat_print_csv(sim_sdb, fd, prefix);
+      sim_sdb->delta = FALSE;
+      break;
+    default:
+      panic("bogus stat output format");
+    }
+  fflush(fd);
+}
+
+/* dump interval stats, called through SIM_STATS_CHECK() once the interval
+   counter reaches the next dump, or after a SIGUSR1 */
+void
+sim_stats_interval(void)
+{
+  sim_dump_stats = FALSE;
+  if (sim_stats_var)
+    {
+      while (sim_stats_next <= *sim_stats_var)
+	sim_stats_next += stats_interval;
+    }
+
+  print_stats_record(stats_fd ? stats_fd : stderr, ++stats_sample);
+
+  /* the next dump prints the change from here */
+  stat_snapshot(sim_sdb);
+}
+
 /* print stats, uninitialize simulator components, and exit w/ exitcode */
 static void
 exit_now(int exit_code)
@@ -218,6 +320,14 @@ exit_now(int exit_code)
   /* print simulation stats */
   sim_print_stats(stderr);
 
+  /* close the interval stats with a final record */
+  if (running && stats_fd)
+    {
+      print_stats_record(stats_fd, -1);
+      fclose(stats_fd);
+      stats_fd = NULL;
+    }
+
   /* un-initialize the simulator */
   sim_uninit();
 
@@ -268,6 +378,10 @@ main(int argc, char **argv, char **envp)
 	       &init_quit, /* default */FALSE, /* !print */FALSE, NULL);
   opt_reg_string(sim_odb, "-chkpt", "restore EIO trace execution from <fname>",
 		 &sim_chkpt_fname, /* default */NULL, /* !print */FALSE, NULL);
+  opt_reg_string(sim_odb, "-image",
+		 "map program text and data from cached post-load image <fname>,"
+		 " created if missing or stale",
+		 &sim_image_fname, /* default */NULL, /* !print */FALSE, NULL);
 
   /* stdio redirection options */
   opt_reg_string(sim_odb, "-redir:sim",
@@ -285,7 +399,32 @@ main(int argc, char **argv, char **envp)
 	      /* default */NICE_DEFAULT_VALUE, /* print */TRUE, NULL);
 #endif
 
-  /* FIXME: add stats intervals and max insts... */
+  /* statistics output options */
+  opt_reg_enum(sim_odb, "-stats:format",
+	       "statistics output format {text|json|csv}",
+	       &stats_format, /* default */"text",
+	       stats_format_names, /* index map */NULL, sf_NUM,
+	       /* print */TRUE, NULL);
+  opt_reg_uint(sim_odb, "-stats:interval",
+	       "dump stats every <n> counts of -stats:var, 0 for never",
+	       &stats_interval, /* default */0, /* print */TRUE, NULL);
+  opt_reg_string(sim_odb, "-stats:var",
+		 "counter stat the stats interval is counted in",
+		 &stats_var_name, /* default */"sim_num_insn",
+		 /* print */TRUE, NULL);
+  opt_reg_string(sim_odb, "-stats:file",
+		 "interval stats output file (simulator output if none)",
+		 &stats_fname, /* default */NULL, /* print */TRUE, NULL);
+  opt_reg_note(sim_odb,
+"  Interval stats dumps hold all stats and their change since the previous\n"
+"  dump, formulas are evaluated on the changes, e.g., the IPC of the\n"
+"  interval.  Sampled means and sparse distributions are not differenced.\n"
+"  SIGUSR1 also forces a dump.  With json each dump is one JSON object per\n"
+"  line, with csv each value is a `<dump>,{cumulative|delta},<stat>,<value>'\n"
+"  row.  An interval stats file ends with a `final' dump.\n"
+	       );
+
+  /* FIXME: add max insts... */
 
   /* register all simulator-specific options */
   sim_reg_options(sim_odb);
@@ -389,6 +528,29 @@ main(int argc, char **argv, char **envp)
 		&sim_mem_usage, sim_mem_usage, "%11dk");
 #endif
 
+  /* locate the interval stats counter */
+  if (stats_interval > 0)
+    {
+      struct stat_stat_t *stat = stat_find_stat(sim_sdb, stats_var_name);
+
+      if (!stat)
+	fatal("interval stat `%s' is not defined", stats_var_name);
+      if (stat->sc != sc_counter)
+	fatal("interval stat `%s' is not a counter", stats_var_name);
+      sim_stats_var = stat->variant.for_counter.var;
+      sim_stats_next = *sim_stats_var + stats_interval;
+    }
+
+  /* open the interval stats file */
+  if (stats_fname)
+    {
+      stats_fd = fopen(stats_fname, "w");
+      if (!stats_fd)
+	fatal("unable to open interval stats file `%s'", stats_fname);
+      if (stats_format == sf_csv)
+	fprintf(stats_fd, "sample,type,stat,value\n");
+    }
+
   /* record start of execution time, used in rate stats */
   sim_start_time = time((time_t *)NULL);
 
@@ -413,6 +575,9 @@ main(int argc, char **argv, char **envp)
   if (init_quit)
     exit_now(0);
 
+  /* interval stats print changes from here */
+  stat_snapshot(sim_sdb);
+
   running = TRUE;
   sim_main();
 
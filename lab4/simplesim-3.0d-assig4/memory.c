@@ -59,6 +59,13 @@
 #include "stats.h"
 #include "memory.h"
 
+#ifdef MEM_FLAT_PTAB
+/* second level page table shared by all unmapped first level entries */
+struct mem_pte_t mem_ptab_null[MEM_PTAB_L2_SIZE];
+#endif /* MEM_FLAT_PTAB */
+
+/* zero value read from pages not yet allocated (see MEM_READ()) */
+const union mem_zero_t mem_zero;
 
 /* create a flat memory space */
 struct mem_t *
@@ -71,14 +78,35 @@ mem_create(char *name)			/* name of the memory space */
     fatal("out of virtual memory");
 
   mem->name = mystrdup(name);
+  mem_xlat_flush(mem);
   return mem;
 }
 
+/* invalidate the host translation caches of memory space MEM, required if
+   any page mapping changes */
+void
+mem_xlat_flush(struct mem_t *mem)	/* memory space to flush */
+{
+  int i;
+
+  for (i=0; i < MEM_XLAT_SIZE; i++)
+    {
+      mem->ixlat[i].tag = ~(md_addr_t)0;
+      mem->ixlat[i].page = NULL;
+      mem->dxlat[i].tag = ~(md_addr_t)0;
+      mem->dxlat[i].page = NULL;
+    }
+}
+
 /* translate address ADDR in memory space MEM, returns pointer to host page */
 byte_t *
 mem_translate(struct mem_t *mem,	/* memory space to access */
 	      md_addr_t addr)		/* virtual address to translate */
 {
+#ifdef MEM_FLAT_PTAB
+  /* flat page tables always translate in the MEM_PTAB_PAGE() fast path */
+  return MEM_PTAB_PAGE(mem, addr);
+#else /* !MEM_FLAT_PTAB */
   struct mem_pte_t *pte, *prev;
 
   /* got here via a first level miss in the page tables */
@@ -104,6 +132,50 @@ mem_translate(struct mem_t *mem,	/* memory space to access */
 
   /* no translation found, return NULL */
   return NULL;
+#endif /* MEM_FLAT_PTAB */
+}
+
+/* translate address ADDR in memory space MEM after a miss in host translation
+   cache XLAT, fills XLAT if the page is allocated, returns pointer to host
+   page or NULL if unallocated */
+byte_t *
+mem_xlat_fill(struct mem_t *mem,	/* memory space to access */
+	      struct mem_xlat_t *xlat,	/* translation cache that missed */
+	      md_addr_t addr)		/* virtual address to translate */
+{
+  byte_t *page;
+
+  page = MEM_PTAB_PAGE(mem, addr);
+
+  /* unallocated pages are not cached, so that page allocation need not
+     update the translation caches */
+  if (page)
+    {
+      xlat[MEM_XLAT_SET(addr)].tag = MEM_XLAT_TAG(addr);
+      xlat[MEM_XLAT_SET(addr)].page = page;
+    }
+  return page;
+}
+
+/* watch writes to the SIZE bytes of memory space MEM starting at BASE,
+   FN is called with DATA before each write to the range, a memory space
+   has a single watch, a SIZE of zero removes it */
+void
+mem_watch(struct mem_t *mem,		/* memory space to watch */
+	  md_addr_t base,		/* base of range to watch */
+	  md_addr_t size,		/* size of range to watch */
+	  void (*fn)(void *data,	/* watch function */
+		     md_addr_t addr,	/* address written */
+		     int nbytes),	/* number of bytes written */
+	  void *data)			/* watch function client data */
+{
+  if (size != 0 && mem->watch_size != 0)
+    panic("memory space `%s' is already watched", mem->name);
+
+  mem->watch_base = base;
+  mem->watch_size = size;
+  mem->watch_fn = fn;
+  mem->watch_data = data;
 }
 
 /* allocate a memory page */
@@ -112,26 +184,69 @@ mem_newpage(struct mem_t *mem,		/* memory space to allocate in */
 	    md_addr_t addr)		/* virtual address to allocate */
 {
   byte_t *page;
-  struct mem_pte_t *pte;
 
   /* see misc.c for details on the getcore() function */
   page = getcore(MD_PAGE_SIZE);
   if (!page)
     fatal("out of virtual memory");
 
-  /* generate a new PTE */
-  pte = calloc(1, sizeof(struct mem_pte_t));
-  if (!pte)
-    fatal("out of virtual memory");
-  pte->tag = MEM_PTAB_TAG(addr);
-  pte->page = page;
+  mem_map_page(mem, addr, page);
+}
+
+/* map the MD_PAGE_SIZE bytes of host memory at PAGE as the page holding
+   virtual address ADDR, replacing any existing mapping, the page is never
+   released and writes go directly to it, so a page mapped from a file with
+   MAP_PRIVATE is copied by the host on the first write */
+void
+mem_map_page(struct mem_t *mem,		/* memory space to map into */
+	     md_addr_t addr,		/* virtual address to map */
+	     byte_t *page)		/* host page */
+{
+  struct mem_pte_t *pte;
+
+#ifdef MEM_FLAT_PTAB
+  /* allocate the second level page table on first use */
+  if (mem->ptab[MEM_PTAB_L1(addr)] == mem_ptab_null)
+    {
+      mem->ptab[MEM_PTAB_L1(addr)] =
+	calloc(MEM_PTAB_L2_SIZE, sizeof(struct mem_pte_t));
+      if (!mem->ptab[MEM_PTAB_L1(addr)])
+	fatal("out of virtual memory");
+    }
+  pte = &mem->ptab[MEM_PTAB_L1(addr)][MEM_PTAB_L2(addr)];
+#else /* !MEM_FLAT_PTAB */
+  /* look for an existing PTE */
+  for (pte=mem->ptab[MEM_PTAB_SET(addr)]; pte != NULL; pte=pte->next)
+    {
+      if (pte->tag == MEM_PTAB_TAG(addr))
+	break;
+    }
 
-  /* insert PTE into inverted hash table */
-  pte->next = mem->ptab[MEM_PTAB_SET(addr)];
-  mem->ptab[MEM_PTAB_SET(addr)] = pte;
+  if (!pte)
+    {
+      /* generate a new PTE */
+      pte = calloc(1, sizeof(struct mem_pte_t));
+      if (!pte)
+	fatal("out of virtual memory");
+      pte->tag = MEM_PTAB_TAG(addr);
+
+      /* insert PTE into inverted hash table */
+      pte->next = mem->ptab[MEM_PTAB_SET(addr)];
+      mem->ptab[MEM_PTAB_SET(addr)] = pte;
+    }
+#endif /* MEM_FLAT_PTAB */
 
-  /* one more page allocated */
-  mem->page_count++;
+  if (pte->page)
+    {
+      /* remapped page, the translation caches may hold the old page */
+      mem_xlat_flush(mem);
+    }
+  else
+    {
+      /* one more page allocated */
+      mem->page_count++;
+    }
+  pte->page = page;
 }
 
 /* generic memory access function, it's safe because alignments and permissions
@@ -234,17 +349,50 @@ mem_reg_stats(struct mem_t *mem,	/* memory space to declare */
   stat_reg_formula(sdb, buf, "total size of memory pages allocated",
 		   buf1, "%11.0fk");
 
+  /* flat page tables never miss */
+#ifndef MEM_FLAT_PTAB
   sprintf(buf, "%s.ptab_misses", mem->name);
   stat_reg_counter(sdb, buf, "total first level page table misses",
 		   &mem->ptab_misses, mem->ptab_misses, NULL);
+#endif /* !MEM_FLAT_PTAB */
 
   sprintf(buf, "%s.ptab_accesses", mem->name);
   stat_reg_counter(sdb, buf, "total page table accesses",
 		   &mem->ptab_accesses, mem->ptab_accesses, NULL);
 
+  sprintf(buf, "%s.ixlat_hits", mem->name);
+  stat_reg_counter(sdb, buf, "total inst fetch translation cache hits",
+		   &mem->ixlat_hits, mem->ixlat_hits, NULL);
+
+  sprintf(buf, "%s.ixlat_misses", mem->name);
+  stat_reg_counter(sdb, buf, "total inst fetch translation cache misses",
+		   &mem->ixlat_misses, mem->ixlat_misses, NULL);
+
+  sprintf(buf, "%s.ixlat_hit_rate", mem->name);
+  sprintf(buf1, "%s.ixlat_hits / (%s.ixlat_hits + %s.ixlat_misses)",
+	  mem->name, mem->name, mem->name);
+  stat_reg_formula(sdb, buf, "inst fetch translation cache hit rate",
+		   buf1, NULL);
+
+  sprintf(buf, "%s.dxlat_hits", mem->name);
+  stat_reg_counter(sdb, buf, "total data translation cache hits",
+		   &mem->dxlat_hits, mem->dxlat_hits, NULL);
+
+  sprintf(buf, "%s.dxlat_misses", mem->name);
+  stat_reg_counter(sdb, buf, "total data translation cache misses",
+		   &mem->dxlat_misses, mem->dxlat_misses, NULL);
+
+  sprintf(buf, "%s.dxlat_hit_rate", mem->name);
+  sprintf(buf1, "%s.dxlat_hits / (%s.dxlat_hits + %s.dxlat_misses)",
+	  mem->name, mem->name, mem->name);
+  stat_reg_formula(sdb, buf, "data translation cache hit rate",
+		   buf1, NULL);
+
+#ifndef MEM_FLAT_PTAB
   sprintf(buf, "%s.ptab_miss_rate", mem->name);
   sprintf(buf1, "%s.ptab_misses / %s.ptab_accesses", mem->name, mem->name);
   stat_reg_formula(sdb, buf, "first level page table miss rate", buf1, NULL);
+#endif /* !MEM_FLAT_PTAB */
 }
 
 /* initialize memory system, call before loader.c */
@@ -253,13 +401,28 @@ mem_init(struct mem_t *mem)	/* memory space to initialize */
 {
   int i;
 
+#ifdef MEM_FLAT_PTAB
+  /* initialize the first level page table to all unmapped */
+  for (i=0; i < MEM_PTAB_L1_SIZE; i++)
+    mem->ptab[i] = mem_ptab_null;
+#else /* !MEM_FLAT_PTAB */
   /* initialize the first level page table to all empty */
   for (i=0; i < MEM_PTAB_SIZE; i++)
     mem->ptab[i] = NULL;
+#endif /* MEM_FLAT_PTAB */
+
+  mem_xlat_flush(mem);
+
+  /* no write watch */
+  mem->watch_size = 0;
 
   mem->page_count = 0;
   mem->ptab_misses = 0;
   mem->ptab_accesses = 0;
+  mem->ixlat_hits = 0;
+  mem->ixlat_misses = 0;
+  mem->dxlat_hits = 0;
+  mem->dxlat_misses = 0;
 }
 
 /* dump a block of memory, returns any faults encountered */
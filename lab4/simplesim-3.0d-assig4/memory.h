@@ -60,6 +60,34 @@
 #include "options.h"
 #include "stats.h"
 
+/* targets with 32-bit addresses map the simulated address space through a
+   flat two-level page table, unless MEM_HASH_PTAB is defined, 64-bit address
+   spaces always use an inverted page table */
+#if !defined(MD_QWORD_ADDRS) && !defined(MEM_HASH_PTAB)
+#define MEM_FLAT_PTAB
+#endif
+
+#ifdef MEM_FLAT_PTAB
+
+/* number of entries in the second level page tables, the remaining virtual
+   page number bits index the first level page table */
+#define MEM_LOG_PTAB_L2_SIZE	10
+#define MEM_PTAB_L2_SIZE	(1 << MEM_LOG_PTAB_L2_SIZE)
+#define MEM_LOG_PTAB_L1_SIZE	(32 - MD_LOG_PAGE_SIZE - MEM_LOG_PTAB_L2_SIZE)
+#define MEM_PTAB_L1_SIZE	(1 << MEM_LOG_PTAB_L1_SIZE)
+
+/* page table entry */
+struct mem_pte_t {
+  byte_t *page;			/* page pointer, NULL if unallocated */
+};
+
+/* second level page table shared by all unmapped first level entries, all
+   of its pages are unallocated, so translation never needs to check the
+   first level entry */
+extern struct mem_pte_t mem_ptab_null[MEM_PTAB_L2_SIZE];
+
+#else /* !MEM_FLAT_PTAB */
+
 /* number of entries in page translation hash table (must be power-of-two) */
 #define MEM_PTAB_SIZE		(32*1024)
 #define MEM_LOG_PTAB_SIZE	15
@@ -71,16 +99,49 @@ struct mem_pte_t {
   byte_t *page;			/* page pointer */
 };
 
+#endif /* MEM_FLAT_PTAB */
+
+/* number of entries in each host translation cache (must be power-of-two) */
+#define MEM_XLAT_SIZE		64
+
+/* host translation cache entry, direct-mapped on the virtual page number */
+struct mem_xlat_t {
+  md_addr_t tag;		/* virtual page number, all ones if invalid */
+  byte_t *page;			/* page pointer */
+};
+
 /* memory object */
 struct mem_t {
   /* memory object state */
   char *name;				/* name of this memory space */
+#ifdef MEM_FLAT_PTAB
+  struct mem_pte_t *ptab[MEM_PTAB_L1_SIZE];/* first level page table */
+#else /* !MEM_FLAT_PTAB */
   struct mem_pte_t *ptab[MEM_PTAB_SIZE];/* inverted page table */
+#endif /* MEM_FLAT_PTAB */
+
+  /* host translation caches for inst fetches and data accesses, checked
+     before the page table, only allocated pages are cached */
+  struct mem_xlat_t ixlat[MEM_XLAT_SIZE];
+  struct mem_xlat_t dxlat[MEM_XLAT_SIZE];
+
+  /* write watch, WATCH_FN is called before any write to the range of
+     WATCH_SIZE bytes starting at WATCH_BASE (see mem_watch()) */
+  md_addr_t watch_base;			/* base of watched range */
+  md_addr_t watch_size;			/* size of watched range, 0 if none */
+  void (*watch_fn)(void *data,		/* watch client data */
+		   md_addr_t addr,	/* address written */
+		   int nbytes);		/* number of bytes written */
+  void *watch_data;			/* watch client data */
 
   /* memory object stats */
   counter_t page_count;			/* total number of pages allocated */
   counter_t ptab_misses;		/* total first level page tbl misses */
   counter_t ptab_accesses;		/* total page table accesses */
+  counter_t ixlat_hits;			/* total inst xlat cache hits */
+  counter_t ixlat_misses;		/* total inst xlat cache misses */
+  counter_t dxlat_hits;			/* total data xlat cache hits */
+  counter_t dxlat_misses;		/* total data xlat cache misses */
 };
 
 /* memory access command */
@@ -102,6 +163,25 @@ typedef enum md_fault_type
  * virtual to host page translation macros
  */
 
+#ifdef MEM_FLAT_PTAB
+
+/* compute first and second level page table indices */
+#define MEM_PTAB_L1(ADDR)						\
+  ((ADDR) >> (MD_LOG_PAGE_SIZE + MEM_LOG_PTAB_L2_SIZE))
+#define MEM_PTAB_L2(ADDR)						\
+  (((ADDR) >> MD_LOG_PAGE_SIZE) & (MEM_PTAB_L2_SIZE - 1))
+
+/* convert a pte entry at virtual page number idx to a block address */
+#define MEM_PTE_ADDR(PTE, IDX)	((md_addr_t)(IDX) << MD_LOG_PAGE_SIZE)
+
+/* walk the page table for virtual address ADDR, returns NULL if
+   unallocated */
+#define MEM_PTAB_PAGE(MEM, ADDR)					\
+  ((MEM)->ptab_accesses++,						\
+   (MEM)->ptab[MEM_PTAB_L1(ADDR)][MEM_PTAB_L2(ADDR)].page)
+
+#else /* !MEM_FLAT_PTAB */
+
 /* compute page table set */
 #define MEM_PTAB_SET(ADDR)						\
   (((ADDR) >> MD_LOG_PAGE_SIZE) & (MEM_PTAB_SIZE - 1))
@@ -115,8 +195,9 @@ typedef enum md_fault_type
   (((PTE)->tag << (MD_LOG_PAGE_SIZE + MEM_LOG_PTAB_SIZE))		\
    | ((IDX) << MD_LOG_PAGE_SIZE))
 
-/* locate host page for virtual address ADDR, returns NULL if unallocated */
-#define MEM_PAGE(MEM, ADDR)						\
+/* walk the page table for virtual address ADDR, returns NULL if
+   unallocated */
+#define MEM_PTAB_PAGE(MEM, ADDR)					\
   (/* first attempt to hit in first entry, otherwise call xlation fn */	\
    ((MEM)->ptab[MEM_PTAB_SET(ADDR)]					\
     && (MEM)->ptab[MEM_PTAB_SET(ADDR)]->tag == MEM_PTAB_TAG(ADDR))	\
@@ -126,9 +207,32 @@ typedef enum md_fault_type
    : (/* first level miss - call the translation helper function */	\
       mem_translate((MEM), (ADDR))))
 
+#endif /* MEM_FLAT_PTAB */
+
+/* compute host translation cache tag and set */
+#define MEM_XLAT_TAG(ADDR)	((ADDR) >> MD_LOG_PAGE_SIZE)
+#define MEM_XLAT_SET(ADDR)	(MEM_XLAT_TAG(ADDR) & (MEM_XLAT_SIZE - 1))
+
+/* locate host page for virtual address ADDR, returns NULL if unallocated */
+#define MEM_PAGE(MEM, ADDR)						\
+  mem_xlat_page((MEM), (MEM)->dxlat,					\
+		&(MEM)->dxlat_hits, &(MEM)->dxlat_misses, (ADDR))
+
+/* locate host page for inst fetch address ADDR, returns NULL if
+   unallocated */
+#define MEM_IPAGE(MEM, ADDR)						\
+  mem_xlat_page((MEM), (MEM)->ixlat,					\
+		&(MEM)->ixlat_hits, &(MEM)->ixlat_misses, (ADDR))
+
 /* compute address of access within a host page */
 #define MEM_OFFSET(ADDR)	((ADDR) & (MD_PAGE_SIZE - 1))
 
+/* call the write watch function if ADDR is in the watched range */
+#define MEM_WATCH(MEM, ADDR, NBYTES)					\
+  ((md_addr_t)((ADDR) - (MEM)->watch_base) < (MEM)->watch_size		\
+   ? (*(MEM)->watch_fn)((MEM)->watch_data, (ADDR), (NBYTES))		\
+   : (void)0)
+
 /* memory tickle function, allocates pages when they are first written */
 #define MEM_TICKLE(MEM, ADDR)						\
   (!MEM_PAGE(MEM, ADDR)							\
@@ -137,35 +241,47 @@ typedef enum md_fault_type
    : (/* nada... */ (void)0))
 
 /* memory page iterator */
+#ifdef MEM_FLAT_PTAB
+#define MEM_FORALL(MEM, ITER, PTE)					\
+  for ((ITER)=0; (ITER) < MEM_PTAB_L1_SIZE * MEM_PTAB_L2_SIZE; (ITER)++)	\
+    if (((PTE) = &(MEM)->ptab[(ITER) >> MEM_LOG_PTAB_L2_SIZE]		\
+			     [(ITER) & (MEM_PTAB_L2_SIZE - 1)])->page == NULL) \
+      /* unallocated page */;						\
+    else
+#else /* !MEM_FLAT_PTAB */
 #define MEM_FORALL(MEM, ITER, PTE)					\
   for ((ITER)=0; (ITER) < MEM_PTAB_SIZE; (ITER)++)			\
     for ((PTE)=(MEM)->ptab[i]; (PTE) != NULL; (PTE)=(PTE)->next)
+#endif /* MEM_FLAT_PTAB */
 
 
 /*
  * memory accessors macros, fast but difficult to debug...
  */
 
-/* safe version, works only with scalar types */
-/* FIXME: write a more efficient GNU C expression for this... */
+/* safe version, works only with scalar types, reads of pages not yet
+   allocated return zero value */
 #define MEM_READ(MEM, ADDR, TYPE)					\
-  (MEM_PAGE(MEM, (md_addr_t)(ADDR))					\
-   ? *((TYPE *)(MEM_PAGE(MEM, (md_addr_t)(ADDR)) + MEM_OFFSET(ADDR)))	\
-   : /* page not yet allocated, return zero value */ 0)
+  (*((TYPE *)mem_read_addr((MEM), (md_addr_t)(ADDR))))
 
 /* unsafe version, works with any type */
 #define __UNCHK_MEM_READ(MEM, ADDR, TYPE)				\
   (*((TYPE *)(MEM_PAGE(MEM, (md_addr_t)(ADDR)) + MEM_OFFSET(ADDR))))
 
-/* safe version, works only with scalar types */
-/* FIXME: write a more efficient GNU C expression for this... */
+/* inst fetch version, works only with scalar types */
+#define MEM_IREAD(MEM, ADDR, TYPE)					\
+  (*((TYPE *)mem_iread_addr((MEM), (md_addr_t)(ADDR))))
+
+/* safe version, works only with scalar types, pages are allocated when
+   they are first written */
 #define MEM_WRITE(MEM, ADDR, TYPE, VAL)					\
-  (MEM_TICKLE(MEM, (md_addr_t)(ADDR)),					\
-   *((TYPE *)(MEM_PAGE(MEM, (md_addr_t)(ADDR)) + MEM_OFFSET(ADDR))) = (VAL))
+  (MEM_WATCH(MEM, (md_addr_t)(ADDR), sizeof(TYPE)),			\
+   *((TYPE *)mem_write_addr((MEM), (md_addr_t)(ADDR))) = (VAL))
       
 /* unsafe version, works with any type */
 #define __UNCHK_MEM_WRITE(MEM, ADDR, TYPE, VAL)				\
-  (*((TYPE *)(MEM_PAGE(MEM, (md_addr_t)(ADDR)) + MEM_OFFSET(ADDR))) = (VAL))
+  (MEM_WATCH(MEM, (md_addr_t)(ADDR), sizeof(TYPE)),			\
+   *((TYPE *)(MEM_PAGE(MEM, (md_addr_t)(ADDR)) + MEM_OFFSET(ADDR))) = (VAL))
 
 
 /* fast memory accessor macros, typed versions */
@@ -175,6 +291,7 @@ typedef enum md_fault_type
 #define MEM_READ_SHALF(MEM, ADDR)	MD_SWAPH(MEM_READ(MEM, ADDR, shalf_t))
 #define MEM_READ_WORD(MEM, ADDR)	MD_SWAPW(MEM_READ(MEM, ADDR, word_t))
 #define MEM_READ_SWORD(MEM, ADDR)	MD_SWAPW(MEM_READ(MEM, ADDR, sword_t))
+#define MEM_IREAD_WORD(MEM, ADDR)	MD_SWAPW(MEM_IREAD(MEM, ADDR, word_t))
 
 #ifdef HOST_HAS_QWORD
 #define MEM_READ_QWORD(MEM, ADDR)	MD_SWAPQ(MEM_READ(MEM, ADDR, qword_t))
@@ -213,11 +330,44 @@ byte_t *
 mem_translate(struct mem_t *mem,	/* memory space to access */
 	      md_addr_t addr);		/* virtual address to translate */
 
+/* invalidate the host translation caches of memory space MEM, required if
+   any page mapping changes */
+void
+mem_xlat_flush(struct mem_t *mem);	/* memory space to flush */
+
+/* translate address ADDR in memory space MEM after a miss in host translation
+   cache XLAT, fills XLAT if the page is allocated, returns pointer to host
+   page or NULL if unallocated */
+byte_t *
+mem_xlat_fill(struct mem_t *mem,	/* memory space to access */
+	      struct mem_xlat_t *xlat,	/* translation cache that missed */
+	      md_addr_t addr);		/* virtual address to translate */
+
+/* watch writes to the SIZE bytes of memory space MEM starting at BASE,
+   FN is called with DATA before each write to the range, a memory space
+   has a single watch, a SIZE of zero removes it */
+void
+mem_watch(struct mem_t *mem,		/* memory space to watch */
+	  md_addr_t base,		/* base of range to watch */
+	  md_addr_t size,		/* size of range to watch */
+	  void (*fn)(void *data,	/* watch function */
+		     md_addr_t addr,	/* address written */
+		     int nbytes),	/* number of bytes written */
+	  void *data);			/* watch function client data */
+
 /* allocate a memory page */
 void
 mem_newpage(struct mem_t *mem,		/* memory space to allocate in */
 	    md_addr_t addr);		/* virtual address to allocate */
 
+/* map the MD_PAGE_SIZE bytes of host memory at PAGE as the page holding
+   virtual address ADDR, replacing any existing mapping, the page is never
+   released */
+void
+mem_map_page(struct mem_t *mem,		/* memory space to map into */
+	     md_addr_t addr,		/* virtual address to map */
+	     byte_t *page);		/* host page */
+
 /* generic memory access function, it's safe because alignments and permissions
    are checked, handles any natural transfer sizes; note, faults out if nbytes
    is not a power-of-two or larger then MD_PAGE_SIZE */
@@ -289,4 +439,79 @@ mem_bzero(mem_access_fn mem_fn,		/* user-specified memory accessor */
 	  md_addr_t addr,		/* target address to access */
 	  int nbytes);			/* number of bytes to clear */
 
+
+/*
+ * host translation cache lookups used by the accessor macros, each access
+ * looks up its page once, so it counts as a single hit or miss
+ */
+
+/* zero value of any scalar type, read from pages not yet allocated */
+extern const union mem_zero_t {
+  word_t w[2];
+  dfloat_t d;
+#ifdef HOST_HAS_QWORD
+  qword_t q;
+#endif /* HOST_HAS_QWORD */
+} mem_zero;
+
+/* locate host page for address ADDR in memory space MEM through host
+   translation cache XLAT, counting the lookup in *HITS or *MISSES, returns
+   NULL if unallocated */
+static INLINE byte_t *
+mem_xlat_page(struct mem_t *mem,	/* memory space to access */
+	      struct mem_xlat_t *xlat,	/* translation cache to look in */
+	      counter_t *hits,		/* translation cache hit count */
+	      counter_t *misses,	/* translation cache miss count */
+	      md_addr_t addr)		/* virtual address to translate */
+{
+  struct mem_xlat_t *ent = &xlat[MEM_XLAT_SET(addr)];
+
+  if (ent->tag == MEM_XLAT_TAG(addr))
+    {
+      (*hits)++;
+      return ent->page;
+    }
+  (*misses)++;
+  return mem_xlat_fill(mem, xlat, addr);
+}
+
+/* return host address of data read at ADDR in memory space MEM, or the
+   address of a zero value if its page is not yet allocated */
+static INLINE byte_t *
+mem_read_addr(struct mem_t *mem,	/* memory space to access */
+	      md_addr_t addr)		/* virtual address to read */
+{
+  byte_t *page = MEM_PAGE(mem, addr);
+
+  return page ? page + MEM_OFFSET(addr) : (byte_t *)&mem_zero;
+}
+
+/* return host address of inst fetch at ADDR in memory space MEM, or the
+   address of a zero value if its page is not yet allocated */
+static INLINE byte_t *
+mem_iread_addr(struct mem_t *mem,	/* memory space to access */
+	       md_addr_t addr)		/* virtual address to fetch */
+{
+  byte_t *page = MEM_IPAGE(mem, addr);
+
+  return page ? page + MEM_OFFSET(addr) : (byte_t *)&mem_zero;
+}
+
+/* return host address of data write at ADDR in memory space MEM,
+   allocating its page on first write */
+static INLINE byte_t *
+mem_write_addr(struct mem_t *mem,	/* memory space to access */
+	       md_addr_t addr)		/* virtual address to write */
+{
+  byte_t *page = MEM_PAGE(mem, addr);
+
+  if (!page)
+    {
+      /* allocate page at address ADDR */
+      mem_newpage(mem, addr);
+      page = mem_xlat_fill(mem, mem->dxlat, addr);
+    }
+  return page + MEM_OFFSET(addr);
+}
+
 #endif /* MEMORY_H */
@@ -0,0 +1,264 @@
+/* memtrace.c - memory reference trace routines */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memtrace.h"
+
+/* record tag byte fields */
+#define MT_KIND_MASK		0x03	/* reference kind */
+#define MT_SIZE_SHIFT		2	/* log2 of the reference size */
+#define MT_SIZE_MASK		0x07
+#define MT_PC_IMPLIED		0x20	/* no PC delta follows: fetches are
+					   sequential, loads/stores reuse the
+					   PC of the previous record */
+
+/* largest encoded record: tag plus two maximum length varints */
+#define MT_MAX_RECSZ		(1 + 2*((sizeof(md_addr_t)*8 + 6) / 7))
+
+/* zig-zag encode/decode an address difference, small negative and positive
+   differences both map to small unsigned values */
+#define ZIGZAG(D)							\
+  (((D) << 1) ^ (((D) >> (sizeof(md_addr_t)*8 - 1)) ? ~(md_addr_t)0 : 0))
+#define UNZIGZAG(Z)		(((Z) >> 1) ^ (((Z) & 1) ? ~(md_addr_t)0 : 0))
+
+/* write out the trace buffer */
+static void
+flush_buf(struct mtrace_t *mt)		/* memory reference trace */
+{
+  if (mt->pos && fwrite(mt->buf, 1, mt->pos, mt->fd) != (size_t)mt->pos)
+    fatal("could not write memory reference trace");
+  mt->pos = 0;
+}
+
+/* get the next byte of the trace, returns -1 at the end of the trace */
+static INLINE int
+get_byte(struct mtrace_t *mt)		/* memory reference trace */
+{
+  if (mt->pos == mt->len)
+    {
+      mt->len = fread(mt->buf, 1, MTRACE_BUFSZ, mt->fd);
+      mt->pos = 0;
+      if (mt->len <= 0)
+	{
+	  mt->len = 0;
+	  return -1;
+	}
+    }
+  return mt->buf[mt->pos++];
+}
+
+/* append varint VAL to the trace buffer */
+static INLINE void
+put_varint(struct mtrace_t *mt,		/* memory reference trace */
+	   md_addr_t val)		/* value to encode */
+{
+  while (val >= 0x80)
+    {
+      mt->buf[mt->pos++] = (byte_t)(val | 0x80);
+      val >>= 7;
+    }
+  mt->buf[mt->pos++] = (byte_t)val;
+}
+
+/* get the next varint from the trace */
+static INLINE md_addr_t
+get_varint(struct mtrace_t *mt)		/* memory reference trace */
+{
+  md_addr_t val = 0;
+  int c, shift = 0;
+
+  do {
+    if ((c = get_byte(mt)) < 0)
+      fatal("memory reference trace is truncated");
+    val |= (md_addr_t)(c & 0x7f) << shift;
+    shift += 7;
+  } while (c & 0x80);
+
+  return val;
+}
+
+/* open memory reference trace FNAME for reading or writing (MODE is "r" or
+   "w"), fatal errors are reported if the trace cannot be opened */
+struct mtrace_t *			/* memory reference trace */
+mtrace_open(char *fname,		/* trace file name */
+	    char *mode)			/* "r" for reading, "w" for writing */
+{
+  struct mtrace_t *mt;
+  byte_t hdr[8];
+
+  mt = (struct mtrace_t *)calloc(1, sizeof(struct mtrace_t));
+  if (!mt)
+    fatal("out of virtual memory");
+
+  mt->writing = (*mode == 'w');
+  mt->fd = gzopen(fname, mt->writing ? "w" : "r");
+  if (!mt->fd)
+    fatal("cannot open memory reference trace `%s'", fname);
+
+  mt->last_pc = 0;
+  mt->last_addr = 0;
+  mt->nrecs = 0;
+  mt->pos = mt->len = 0;
+
+  if (mt->writing)
+    {
+      memcpy(hdr, MTRACE_MAGIC, 4);
+      hdr[4] = MTRACE_VERSION;
+      hdr[5] = sizeof(md_addr_t);
+      hdr[6] = sizeof(md_inst_t);
+      hdr[7] = 0;
+      if (fwrite(hdr, 1, sizeof(hdr), mt->fd) != sizeof(hdr))
+	fatal("could not write memory reference trace header");
+    }
+  else
+    {
+      if (fread(hdr, 1, sizeof(hdr), mt->fd) != sizeof(hdr)
+	  || memcmp(hdr, MTRACE_MAGIC, 4) != 0)
+	fatal("`%s' is not a memory reference trace", fname);
+      if (hdr[4] != MTRACE_VERSION)
+	fatal("memory reference trace `%s' is version %d, expected %d",
+	      fname, hdr[4], MTRACE_VERSION);
+      if (hdr[5] != sizeof(md_addr_t) || hdr[6] != sizeof(md_inst_t))
+	fatal("memory reference trace `%s' was written for another target",
+	      fname);
+    }
+
+  return mt;
+}
+
+/* flush and close memory reference trace MT */
+void
+mtrace_close(struct mtrace_t *mt)	/* memory reference trace */
+{
+  if (mt->writing)
+    flush_buf(mt);
+  gzclose(mt->fd);
+  free(mt);
+}
+
+/* append one reference to memory reference trace MT */
+void
+mtrace_write(struct mtrace_t *mt,	/* memory reference trace */
+	     enum mtrace_kind_t kind,	/* reference kind */
+	     md_addr_t pc,		/* PC of referencing instruction */
+	     md_addr_t addr,		/* address referenced */
+	     int nbytes)		/* size of reference in bytes */
+{
+  int tag = kind | ((log_base2(nbytes) & MT_SIZE_MASK) << MT_SIZE_SHIFT);
+  int pc_implied;
+
+  if (mt->pos > MTRACE_BUFSZ - (int)MT_MAX_RECSZ)
+    flush_buf(mt);
+
+  if (kind == mt_ifetch)
+    pc_implied = (pc == mt->last_pc + sizeof(md_inst_t));
+  else
+    pc_implied = (pc == mt->last_pc);
+
+  mt->buf[mt->pos++] = tag | (pc_implied ? MT_PC_IMPLIED : 0);
+  if (!pc_implied)
+    put_varint(mt, ZIGZAG(pc - mt->last_pc));
+  mt->last_pc = pc;
+
+  if (kind != mt_ifetch)
+    {
+      put_varint(mt, ZIGZAG(addr - mt->last_addr));
+      mt->last_addr = addr;
+    }
+
+  mt->nrecs++;
+}
+
+/* read the next reference from memory reference trace MT into *REC, returns
+   zero at the end of the trace */
+int					/* non-zero if a record was read */
+mtrace_read(struct mtrace_t *mt,	/* memory reference trace */
+	    struct mtrace_rec_t *rec)	/* decoded record */
+{
+  int tag;
+  md_addr_t delta;
+
+  if ((tag = get_byte(mt)) < 0)
+    return FALSE;
+
+  rec->kind = (enum mtrace_kind_t)(tag & MT_KIND_MASK);
+  rec->nbytes = 1 << ((tag >> MT_SIZE_SHIFT) & MT_SIZE_MASK);
+
+  if (tag & MT_PC_IMPLIED)
+    {
+      if (rec->kind == mt_ifetch)
+	mt->last_pc += sizeof(md_inst_t);
+    }
+  else
+    {
+      delta = get_varint(mt);
+      mt->last_pc += UNZIGZAG(delta);
+    }
+  rec->pc = mt->last_pc;
+
+  if (rec->kind == mt_ifetch)
+    rec->addr = rec->pc;
+  else
+    {
+      delta = get_varint(mt);
+      mt->last_addr += UNZIGZAG(delta);
+      rec->addr = mt->last_addr;
+    }
+
+  mt->nrecs++;
+  return TRUE;
+}
@@ -0,0 +1,141 @@
+/* memtrace.h - memory reference trace interfaces */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#ifndef MEMTRACE_H
+#define MEMTRACE_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+
+/*
+ * This module reads and writes compact binary memory reference traces.  A
+ * trace records every instruction fetch, load and store made by a functional
+ * simulation (e.g., sim-cache -trace:mem), so that cache experiments can be
+ * replayed (e.g., with sim-replay) without re-executing the program.
+ *
+ * Each record starts with a tag byte that holds the reference kind, the
+ * log2 of the access size and two PC compression flags.  Fields that cannot
+ * be inferred from the tag follow as zig-zag encoded LEB128 varints of the
+ * difference from the previous value of the same field:
+ *
+ *   instruction fetch:  [PC delta, unless sequential]
+ *   load or store:      [PC delta, unless same as last PC] address delta
+ *
+ * A sequential fetch thus takes one byte, and a load or store typically two
+ * to four bytes.  The trace begins with an 8 byte header, see MTRACE_MAGIC.
+ * Traces whose names end in ".gz" are compressed through gzip.
+ */
+
+/* trace file magic, followed by a version, sizeof(md_addr_t) and
+   sizeof(md_inst_t) byte each, and a pad byte */
+#define MTRACE_MAGIC		"SSMT"
+#define MTRACE_VERSION		1
+
+/* trace record kinds */
+enum mtrace_kind_t {
+  mt_ifetch = 0,		/* instruction fetch */
+  mt_read,			/* data read (load) */
+  mt_write			/* data write (store) */
+};
+
+/* decoded trace record */
+struct mtrace_rec_t
+{
+  enum mtrace_kind_t kind;	/* reference kind */
+  md_addr_t pc;			/* PC of referencing instruction */
+  md_addr_t addr;		/* address referenced */
+  int nbytes;			/* size of reference in bytes */
+};
+
+/* trace buffer size in bytes */
+#define MTRACE_BUFSZ		(64*1024)
+
+/* memory reference trace file */
+struct mtrace_t
+{
+  FILE *fd;			/* trace stream */
+  int writing;			/* non-zero if trace is open for writing */
+  md_addr_t last_pc;		/* PC of previous record */
+  md_addr_t last_addr;		/* address of previous load or store */
+  counter_t nrecs;		/* records read or written so far */
+  int pos;			/* next buffer byte to read or write */
+  int len;			/* number of valid buffer bytes (reading) */
+  byte_t buf[MTRACE_BUFSZ];	/* I/O buffer */
+};
+
+/* open memory reference trace FNAME for reading or writing (MODE is "r" or
+   "w"), fatal errors are reported if the trace cannot be opened */
+struct mtrace_t *			/* memory reference trace */
+mtrace_open(char *fname,		/* trace file name */
+	    char *mode);		/* "r" for reading, "w" for writing */
+
+/* flush and close memory reference trace MT */
+void
+mtrace_close(struct mtrace_t *mt);	/* memory reference trace */
+
+/* append one reference to memory reference trace MT */
+void
+mtrace_write(struct mtrace_t *mt,	/* memory reference trace */
+	     enum mtrace_kind_t kind,	/* reference kind */
+	     md_addr_t pc,		/* PC of referencing instruction */
+	     md_addr_t addr,		/* address referenced */
+	     int nbytes);		/* size of reference in bytes */
+
+/* read the next reference from memory reference trace MT into *REC, returns
+   zero at the end of the trace */
+int					/* non-zero if a record was read */
+mtrace_read(struct mtrace_t *mt,	/* memory reference trace */
+	    struct mtrace_rec_t *rec);	/* decoded record */
+
+#endif /* MEMTRACE_H */
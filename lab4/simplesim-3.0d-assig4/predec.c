@@ -0,0 +1,184 @@
+/* predec.c - instruction predecode routines */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "stats.h"
+#include "predec.h"
+
+/* decode instruction INST into predecoded inst PI */
+static void
+decode_inst(struct predec_inst_t *pi,	/* predecoded inst to fill */
+	    md_inst_t inst)		/* instruction bits */
+{
+  enum md_opcode op;
+
+  MD_SET_OPCODE(op, inst);
+
+  pi->inst = inst;
+  switch (op)
+    {
+#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
+    case OP:								\
+      pi->out1 = O1; pi->out2 = O2;					\
+      pi->in1 = I1; pi->in2 = I2; pi->in3 = I3;				\
+      break;
+#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
+    case OP:								\
+      /* not an executable opcode, leave it undecoded */		\
+      op = OP_NA;							\
+      pi->out1 = DNA; pi->out2 = DNA;					\
+      pi->in1 = DNA; pi->in2 = DNA; pi->in3 = DNA;			\
+      break;
+#define CONNECT(OP)
+#include "machine.def"
+    default:
+      /* bogus inst, left undecoded */
+      op = OP_NA;
+      pi->out1 = DNA; pi->out2 = DNA;
+      pi->in1 = DNA; pi->in2 = DNA; pi->in3 = DNA;
+    }
+  pi->op = op;
+  pi->flags = MD_OP_FLAGS(op);
+}
+
+/* text segment write watch, invalidates the insts written */
+static void
+text_written(void *data,		/* predecoded text */
+	     md_addr_t addr,		/* address written */
+	     int nbytes)		/* number of bytes written */
+{
+  struct predec_t *pd = data;
+  md_addr_t idx, last;
+
+  last = (addr + nbytes - 1 - pd->base) / sizeof(md_inst_t);
+  for (idx = (addr - pd->base) / sizeof(md_inst_t); idx <= last; idx++)
+    {
+      if (idx < pd->size / sizeof(md_inst_t) && pd->insts[idx].op != OP_NA)
+	{
+	  pd->insts[idx].op = OP_NA;
+	  pd->invalidations++;
+	}
+    }
+}
+
+/* create a predecoder for the SIZE bytes of text at BASE in memory space
+   MEM, writes to the text are watched to invalidate decoded insts */
+struct predec_t *			/* predecoded text */
+predec_create(struct mem_t *mem,	/* memory space holding the text */
+	      md_addr_t base,		/* base address of text */
+	      md_addr_t size)		/* size of text in bytes */
+{
+  struct predec_t *pd;
+
+  pd = (struct predec_t *)calloc(1, sizeof(struct predec_t));
+  if (!pd)
+    fatal("out of virtual memory");
+
+  pd->mem = mem;
+  pd->base = base;
+  pd->size = size & ~(sizeof(md_inst_t) - 1);
+
+  /* all insts start out undecoded, i.e., OP_NA */
+  pd->insts = (struct predec_inst_t *)
+    calloc(pd->size / sizeof(md_inst_t) + 1, sizeof(struct predec_inst_t));
+  if (!pd->insts)
+    fatal("out of virtual memory");
+
+  decode_inst(&pd->nop, MD_NOP_INST);
+
+  if (pd->size != 0)
+    mem_watch(mem, pd->base, pd->size, text_written, pd);
+
+  return pd;
+}
+
+/* decode the inst at PC into predecoded text PD, this is the slow path of
+   PREDEC_LOOKUP() */
+struct predec_inst_t *			/* predecoded inst */
+predec_decode(struct predec_t *pd,	/* predecoded text */
+	      md_addr_t PC)		/* address of inst to decode */
+{
+  struct predec_inst_t *pi;
+  md_inst_t inst;
+
+  if ((md_addr_t)(PC - pd->base) < pd->size
+      && !(PC & (sizeof(md_inst_t) - 1)))
+    pi = &pd->insts[(PC - pd->base) / sizeof(md_inst_t)];
+  else
+    pi = &pd->scratch;
+
+  MD_FETCH_INST(inst, pd->mem, PC);
+  decode_inst(pi, inst);
+  pd->decodes++;
+
+  return pi;
+}
+
+/* register predecoder stats */
+void
+predec_reg_stats(struct predec_t *pd,	/* predecoded text */
+		 struct stat_sdb_t *sdb)/* stats database */
+{
+  stat_reg_counter(sdb, "predec.decodes",
+		   "total number of insts decoded",
+		   &pd->decodes, pd->decodes, NULL);
+  stat_reg_counter(sdb, "predec.invalidations",
+		   "total number of decoded insts invalidated by writes",
+		   &pd->invalidations, pd->invalidations, NULL);
+}
@@ -0,0 +1,171 @@
+/* predec.h - instruction predecode interfaces */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+
+
+#ifndef PREDEC_H
+#define PREDEC_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "memory.h"
+#include "stats.h"
+
+/*
+ * This module caches decoded instructions, shared by the simulators so
+ * that the text segment is decoded once rather than on every execution of
+ * an instruction.  Each text segment inst has an entry, indexed by its PC,
+ * holding the inst bits, opcode, opcode flags and the register dependence
+ * names of its outputs and inputs (as used by sim-outorder's scheduler).
+ * Entries are decoded on first use, and are invalidated through a write
+ * watch on the text segment (see mem_watch()), so self-modifying code is
+ * decoded again.  Insts outside of the text segment are decoded on every
+ * lookup.
+ */
+
+/*
+ * register dependence decoders, see the DEFINST() O1..I3 fields of
+ * machine.def
+ */
+
+#define DNA			(0)
+
+#if defined(TARGET_PISA)
+
+/* general register dependence decoders */
+#define DGPR(N)			(N)
+#define DGPR_D(N)		((N) &~1)
+
+/* floating point register dependence decoders */
+#define DFPR_L(N)		(((N)+32)&~1)
+#define DFPR_F(N)		(((N)+32)&~1)
+#define DFPR_D(N)		(((N)+32)&~1)
+
+/* miscellaneous register dependence decoders */
+#define DHI			(0+32+32)
+#define DLO			(1+32+32)
+#define DFCC			(2+32+32)
+#define DTMP			(3+32+32)
+
+#elif defined(TARGET_ALPHA)
+
+/* general register dependence decoders, $r31 maps to DNA (0) */
+#define DGPR(N)			(31 - (N)) /* was: (((N) == 31) ? DNA : (N)) */
+
+/* floating point register dependence decoders */
+#define DFPR(N)			(((N) == 31) ? DNA : ((N)+32))
+
+/* miscellaneous register dependence decoders */
+#define DFPCR			(0+32+32)
+#define DUNIQ			(1+32+32)
+#define DTMP			(2+32+32)
+
+#else
+#error No ISA target defined...
+#endif
+
+/* predecoded instruction */
+struct predec_inst_t
+{
+  md_inst_t inst;			/* instruction bits */
+  enum md_opcode op;			/* decoded opcode, OP_NA if invalid */
+  unsigned int flags;			/* opcode flags, see MD_OP_FLAGS() */
+  int out1, out2;			/* output register dependence names */
+  int in1, in2, in3;			/* input register dependence names */
+};
+
+/* predecoded text segment */
+struct predec_t
+{
+  struct mem_t *mem;			/* memory space decoded from */
+  md_addr_t base;			/* base of the predecoded text */
+  md_addr_t size;			/* size of the predecoded text in bytes */
+  struct predec_inst_t *insts;		/* predecoded insts, by PC */
+  struct predec_inst_t scratch;		/* last inst decoded outside text */
+  struct predec_inst_t nop;		/* predecoded NOP inst */
+
+  /* predecoder stats */
+  counter_t decodes;			/* total insts decoded */
+  counter_t invalidations;		/* total insts invalidated by writes */
+};
+
+/* locate the predecoded inst at PC in predecoded text PD, decoding it if
+   required, NOTE: an inst decoded outside of the text segment is only
+   valid until the next lookup */
+#define PREDEC_LOOKUP(PD, PC)						\
+  ((md_addr_t)((PC) - (PD)->base) < (PD)->size				\
+   && !((PC) & (sizeof(md_inst_t) - 1))					\
+   && (PD)->insts[((PC) - (PD)->base) / sizeof(md_inst_t)].op != OP_NA	\
+   ? &(PD)->insts[((PC) - (PD)->base) / sizeof(md_inst_t)]		\
+   : predec_decode((PD), (PC)))
+
+/* create a predecoder for the SIZE bytes of text at BASE in memory space
+   MEM, writes to the text are watched to invalidate decoded insts */
+struct predec_t *			/* predecoded text */
+predec_create(struct mem_t *mem,	/* memory space holding the text */
+	      md_addr_t base,		/* base address of text */
+	      md_addr_t size);		/* size of text in bytes */
+
+/* decode the inst at PC into predecoded text PD, this is the slow path of
+   PREDEC_LOOKUP() */
+struct predec_inst_t *			/* predecoded inst */
+predec_decode(struct predec_t *pd,	/* predecoded text */
+	      md_addr_t PC);		/* address of inst to decode */
+
+/* register predecoder stats */
+void
+predec_reg_stats(struct predec_t *pd,	/* predecoded text */
+		 struct stat_sdb_t *sdb);/* stats database */
+
+#endif /* PREDEC_H */
@@ -51,6 +51,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "host.h"
 #include "misc.h"
@@ -58,6 +59,10 @@
 #include "range.h"
 #include "ptrace.h"
 
+#ifdef HOST_HAS_THREADS
+#include <pthread.h>
+#endif /* HOST_HAS_THREADS */
+
 /* pipetrace file */
 FILE *ptrace_outfd = NULL;
 
@@ -70,12 +75,154 @@ struct range_range_t ptrace_range;
 /* one-shot switch for pipetracing */
 int ptrace_oneshot = FALSE;
 
+/* non-zero if writing a binary pipetrace */
+static int pt_binary = FALSE;
+
+/* pipeline stages with their own binary stage index */
+static char *ptrace_stages[] = PTRACE_STAGES;
+
+/* binary pipetrace encoder state */
+static struct ptrace_state_t *pt_enc = NULL;
+
+/* block being filled, and the other block, which may be being written */
+static byte_t *pt_buf = NULL;
+static byte_t *pt_spare = NULL;
+static int pt_pos = 0;
+
+/* binary pipetrace blocks are written by a background thread on hosts
+   with threads (see host.h), elsewhere they are written synchronously */
+#ifdef HOST_HAS_THREADS
+/* block writer thread, PT_WR_LEN is non-zero while a block is pending */
+static pthread_t pt_writer_tid;
+static pthread_mutex_t pt_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pt_cond = PTHREAD_COND_INITIALIZER;
+static byte_t *pt_wr_buf = NULL;
+static int pt_wr_len = 0;
+static int pt_wr_exit = FALSE;
+
+/* background block writer */
+static void *
+pt_writer(void *arg)			/* unused */
+{
+  byte_t *buf;
+  int len;
+
+  pthread_mutex_lock(&pt_lock);
+  for (;;)
+    {
+      while (!pt_wr_len && !pt_wr_exit)
+	pthread_cond_wait(&pt_cond, &pt_lock);
+      if (!pt_wr_len)
+	break;
+
+      buf = pt_wr_buf;
+      len = pt_wr_len;
+      pthread_mutex_unlock(&pt_lock);
+
+      if (fwrite(buf, 1, len, ptrace_outfd) != (size_t)len)
+	fatal("could not write pipetrace");
+
+      pthread_mutex_lock(&pt_lock);
+      pt_wr_len = 0;
+      pthread_cond_broadcast(&pt_cond);
+    }
+  pthread_mutex_unlock(&pt_lock);
+
+  return NULL;
+}
+#endif /* HOST_HAS_THREADS */
+
+/* hand the filled binary pipetrace block to the writer, and start
+   filling the other block */
+static void
+pt_flush(void)
+{
+  byte_t *tmp;
+
+  if (!pt_pos)
+    return;
+
+#ifdef HOST_HAS_THREADS
+  pthread_mutex_lock(&pt_lock);
+  while (pt_wr_len)
+    pthread_cond_wait(&pt_cond, &pt_lock);
+  pt_wr_buf = pt_buf;
+  pt_wr_len = pt_pos;
+  pthread_cond_broadcast(&pt_cond);
+  pthread_mutex_unlock(&pt_lock);
+#else /* !HOST_HAS_THREADS */
+  if (fwrite(pt_buf, 1, pt_pos, ptrace_outfd) != (size_t)pt_pos)
+    fatal("could not write pipetrace");
+#endif /* HOST_HAS_THREADS */
+
+  tmp = pt_buf;
+  pt_buf = pt_spare;
+  pt_spare = tmp;
+  pt_pos = 0;
+}
+
+/* make room for an event of up to NBYTES bytes in the current block */
+#define PT_RESERVE(NBYTES)						\
+  do {									\
+    if (pt_pos > PTRACE_BUFSZ - (int)(NBYTES))				\
+      pt_flush();							\
+  } while (0)
+
+/* append varint VAL to the current block */
+static INLINE void
+pt_put_varint(md_addr_t val)		/* value to encode */
+{
+  while (val >= 0x80)
+    {
+      pt_buf[pt_pos++] = (byte_t)(val | 0x80);
+      val >>= 7;
+    }
+  pt_buf[pt_pos++] = (byte_t)val;
+}
+
+/* append the zig-zag encoded difference of iseq ISEQ to the current block */
+static INLINE void
+pt_put_iseq(unsigned int iseq)		/* instruction sequence number */
+{
+  md_addr_t delta = (md_addr_t)(int)(iseq - pt_enc->last_iseq);
+
+  pt_put_varint(PT_ZIGZAG(delta));
+  pt_enc->last_iseq = iseq;
+}
+
+/* append the PC and address fields of a new inst or uop */
+static INLINE void
+pt_put_pcaddr(md_addr_t pc,		/* program counter of instruction */
+	      md_addr_t addr)		/* address referenced */
+{
+  pt_put_varint(PT_ZIGZAG(pc - pt_enc->last_pc));
+  pt_put_varint(PT_ZIGZAG(addr - pt_enc->last_addr));
+  pt_enc->last_pc = pc;
+  pt_enc->last_addr = addr;
+}
+
+/* append string STR to the current block, preceded by its length */
+static void
+pt_put_string(char *str)		/* string to append */
+{
+  int len = strlen(str);
+
+  if (len + PT_MAX_RECSZ > PTRACE_BUFSZ)
+    fatal("pipetrace string is too long");
+  PT_RESERVE(len + PT_MAX_RECSZ);
+  pt_put_varint(len);
+  memcpy(&pt_buf[pt_pos], str, len);
+  pt_pos += len;
+}
+
 /* open pipeline trace */
 void
 ptrace_open(char *fname,		/* output filename */
 	    char *range)		/* trace range */
 {
   char *errstr;
+  int len;
+  byte_t hdr[8];
 
   /* parse the output range */
   if (!range)
@@ -104,9 +251,41 @@ ptrace_open(char *fname,		/* output filename */
     ptrace_outfd = stdout;
   else
     {
-      ptrace_outfd = fopen(fname, "w");
+      ptrace_outfd = gzopen(fname, "w");
       if (!ptrace_outfd)
 	fatal("cannot open pipetrace output file `%s'", fname);
+
+      len = strlen(fname);
+      pt_binary = ((len > 4 && !strcmp(fname + len - 4, ".ptb"))
+		   || (len > 7 && !strcmp(fname + len - 7, ".ptb.gz")));
+    }
+
+  if (pt_binary)
+    {
+      pt_enc =
+	(struct ptrace_state_t *)calloc(1, sizeof(struct ptrace_state_t));
+      pt_buf = (byte_t *)malloc(PTRACE_BUFSZ);
+      pt_spare = (byte_t *)malloc(PTRACE_BUFSZ);
+      if (!pt_enc || !pt_buf || !pt_spare)
+	fatal("out of virtual memory");
+      pt_pos = 0;
+
+      memcpy(hdr, PTRACE_MAGIC, 4);
+      hdr[4] = PTRACE_VERSION;
+      hdr[5] = sizeof(md_addr_t);
+      hdr[6] = sizeof(md_inst_t);
+#ifdef BYTES_BIG_ENDIAN
+      hdr[7] = 1;
+#else /* !BYTES_BIG_ENDIAN */
+      hdr[7] = 0;
+#endif /* BYTES_BIG_ENDIAN */
+      if (fwrite(hdr, 1, sizeof(hdr), ptrace_outfd) != sizeof(hdr))
+	fatal("could not write pipetrace header");
+
+#ifdef HOST_HAS_THREADS
+      if (pthread_create(&pt_writer_tid, NULL, pt_writer, NULL) != 0)
+	fatal("could not create pipetrace writer thread");
+#endif /* HOST_HAS_THREADS */
     }
 }
 
@@ -114,8 +293,21 @@ ptrace_open(char *fname,		/* output filename */
 void
 ptrace_close(void)
 {
+  if (pt_binary)
+    {
+      pt_flush();
+#ifdef HOST_HAS_THREADS
+      pthread_mutex_lock(&pt_lock);
+      pt_wr_exit = TRUE;
+      pthread_cond_broadcast(&pt_cond);
+      pthread_mutex_unlock(&pt_lock);
+      pthread_join(pt_writer_tid, NULL);
+#endif /* HOST_HAS_THREADS */
+      pt_binary = FALSE;
+    }
+
   if (ptrace_outfd != NULL && ptrace_outfd != stderr && ptrace_outfd != stdout)
-    fclose(ptrace_outfd);
+    gzclose(ptrace_outfd);
 }
 
 /* declare a new instruction */
@@ -125,6 +317,33 @@ __ptrace_newinst(unsigned int iseq,	/* instruction sequence number */
 		 md_addr_t pc,		/* program counter of instruction */
 		 md_addr_t addr)	/* address referenced, if load/store */
 {
+  if (pt_binary)
+    {
+      int tag = PT_NEWINST, ci = PT_ICACHE_HASH(pc);
+
+      PT_RESERVE(PT_MAX_RECSZ);
+      if (iseq == pt_enc->last_iseq + 1)
+	tag |= PT_NEXT;
+      if (pt_enc->icache[ci].pc == pc
+	  && !memcmp(&pt_enc->icache[ci].inst, &inst, sizeof(md_inst_t)))
+	tag |= PT_INST_CACHED;
+
+      pt_buf[pt_pos++] = tag;
+      if (tag & PT_NEXT)
+	pt_enc->last_iseq = iseq;
+      else
+	pt_put_iseq(iseq);
+      pt_put_pcaddr(pc, addr);
+      if (!(tag & PT_INST_CACHED))
+	{
+	  memcpy(&pt_buf[pt_pos], &inst, sizeof(md_inst_t));
+	  pt_pos += sizeof(md_inst_t);
+	  pt_enc->icache[ci].pc = pc;
+	  pt_enc->icache[ci].inst = inst;
+	}
+      return;
+    }
+
   myfprintf(ptrace_outfd, "+ %u 0x%08p 0x%08p ", iseq, pc, addr);
   md_print_insn(inst, addr, ptrace_outfd);
   fprintf(ptrace_outfd, "\n");
@@ -140,6 +359,16 @@ __ptrace_newuop(unsigned int iseq,	/* instruction sequence number */
 		md_addr_t pc,		/* program counter of instruction */
 		md_addr_t addr)		/* address referenced, if load/store */
 {
+  if (pt_binary)
+    {
+      PT_RESERVE(PT_MAX_RECSZ);
+      pt_buf[pt_pos++] = PT_NEWUOP;
+      pt_put_iseq(iseq);
+      pt_put_pcaddr(pc, addr);
+      pt_put_string(uop_desc);
+      return;
+    }
+
   myfprintf(ptrace_outfd,
 	    "+ %u 0x%08p 0x%08p [%s]\n", iseq, pc, addr, uop_desc);
 
@@ -151,6 +380,14 @@ __ptrace_newuop(unsigned int iseq,	/* instruction sequence number */
 void
 __ptrace_endinst(unsigned int iseq)	/* instruction sequence number */
 {
+  if (pt_binary)
+    {
+      PT_RESERVE(PT_MAX_RECSZ);
+      pt_buf[pt_pos++] = PT_ENDINST;
+      pt_put_iseq(iseq);
+      return;
+    }
+
   fprintf(ptrace_outfd, "- %u\n", iseq);
 
   if (ptrace_outfd == stderr || ptrace_outfd == stdout)
@@ -161,6 +398,20 @@ __ptrace_endinst(unsigned int iseq)	/* instruction sequence number */
 void
 __ptrace_newcycle(tick_t cycle)		/* new cycle */
 {
+  if (pt_binary)
+    {
+      PT_RESERVE(PT_MAX_RECSZ);
+      if (cycle == pt_enc->last_cycle + 1)
+	pt_buf[pt_pos++] = PT_NEWCYCLE | PT_NEXT;
+      else
+	{
+	  pt_buf[pt_pos++] = PT_NEWCYCLE;
+	  pt_put_varint((md_addr_t)(cycle - pt_enc->last_cycle));
+	}
+      pt_enc->last_cycle = cycle;
+      return;
+    }
+
   fprintf(ptrace_outfd, "@ %.0f\n", (double)cycle);
 
   if (ptrace_outfd == stderr || ptrace_outfd == stdout)
@@ -173,6 +424,28 @@ __ptrace_newstage(unsigned int iseq,	/* instruction sequence number */
 		  char *pstage,		/* pipeline stage entered */
 		  unsigned int pevents)/* pipeline events while in stage */
 {
+  if (pt_binary)
+    {
+      int i;
+
+      /* the PST_* names are usually passed as the same literals */
+      for (i=0; i < N_ELT(ptrace_stages); i++)
+	if (pstage == ptrace_stages[i] || !strcmp(pstage, ptrace_stages[i]))
+	  break;
+      if (i == N_ELT(ptrace_stages))
+	i = PT_STAGE_OTHER;
+
+      PT_RESERVE(PT_MAX_RECSZ);
+      pt_buf[pt_pos++] = (PT_NEWSTAGE | (i << PT_STAGE_SHIFT)
+			  | (pevents ? PT_EVENTS : 0));
+      pt_put_iseq(iseq);
+      if (pevents)
+	pt_put_varint(pevents);
+      if (i == PT_STAGE_OTHER)
+	pt_put_string(pstage);
+      return;
+    }
+
   fprintf(ptrace_outfd, "* %u %s 0x%08x\n", iseq, pstage, pevents);
 
   if (ptrace_outfd == stderr || ptrace_outfd == stdout)
@@ -65,6 +65,25 @@
  *	@ <cycle>			- new cycle def
  *	* <iseq> <stage> <events>	- instruction stage transition
  *
+ * Pipetraces whose file names end in ".ptb" (or ".ptb.gz") are written in
+ * a binary format instead, which is many times smaller and faster to write.
+ * ptrace2txt converts them back into the text format above, for use with
+ * pipeview.pl.  Each event is a tag byte, holding the event kind and flags,
+ * followed by the fields that cannot be inferred from the tag as zig-zag
+ * encoded LEB128 varints of the difference from the previous value of the
+ * same field:
+ *
+ *	new inst:	[iseq, unless +1] pc addr [inst, unless cached]
+ *	new uop:	iseq pc addr <desc length> <desc bytes>
+ *	end inst:	iseq
+ *	new cycle:	[cycle, unless +1]
+ *	new stage:	iseq [events, unless zero] [<length> <stage>, unless
+ *			one of the PST_* stages]
+ *
+ * Instructions are cached by PC on both ends, so that an instruction is
+ * only written the first time it is seen at its PC.  Events are buffered
+ * in large blocks, which are written by a background thread (when built
+ * with GNU GCC), file names ending in ".gz" are compressed through gzip.
  */
 
 /*
@@ -91,6 +110,64 @@
 /* pipetrace file */
 extern FILE *ptrace_outfd;
 
+/* binary pipetrace file magic, followed by a version, sizeof(md_addr_t)
+   and sizeof(md_inst_t) byte each, and a byte that is non-zero if the
+   instructions were written by a big-endian host */
+#define PTRACE_MAGIC		"SSPT"
+#define PTRACE_VERSION		1
+
+/* binary pipetrace block size in bytes */
+#define PTRACE_BUFSZ		(256*1024)
+
+/* binary pipetrace event kinds, in the low bits of the tag byte */
+#define PT_KIND_MASK		0x07
+#define PT_NEWINST		0
+#define PT_NEWUOP		1
+#define PT_ENDINST		2
+#define PT_NEWCYCLE		3
+#define PT_NEWSTAGE		4
+
+/* new stage tag fields, the stage index is PT_STAGE_OTHER for stages that
+   are not one of the PST_* stages, whose name then follows */
+#define PT_STAGE_SHIFT		3
+#define PT_STAGE_MASK		0x07
+#define PT_STAGE_OTHER		7
+#define PT_EVENTS		0x40	/* non-zero events follow */
+
+/* new inst and new cycle tag flags */
+#define PT_INST_CACHED		0x40	/* inst is in the instruction cache */
+#define PT_NEXT			0x80	/* iseq or cycle is the previous +1 */
+
+/* largest encoded event, excluding uop descriptions and stage names */
+#define PT_MAX_RECSZ							\
+  (1 + 4*((sizeof(md_addr_t)*8 + 6) / 7) + sizeof(md_inst_t))
+
+/* instruction cache size, a power of two */
+#define PT_ICACHE_SIZE		4096
+#define PT_ICACHE_HASH(PC)	(((PC) >> 3) & (PT_ICACHE_SIZE - 1))
+
+/* zig-zag encode/decode a difference, small negative and positive
+   differences both map to small unsigned values */
+#define PT_ZIGZAG(D)							\
+  (((D) << 1) ^ (((D) >> (sizeof(md_addr_t)*8 - 1)) ? ~(md_addr_t)0 : 0))
+#define PT_UNZIGZAG(Z)		(((Z) >> 1) ^ (((Z) & 1) ? ~(md_addr_t)0 : 0))
+
+/* binary stage indices of the PST_* pipeline stages */
+#define PTRACE_STAGES							\
+  { PST_IFETCH, PST_DISPATCH, PST_EXECUTE, PST_WRITEBACK, PST_COMMIT }
+
+/* binary pipetrace encoder and decoder state */
+struct ptrace_state_t {
+  unsigned int last_iseq;	/* iseq of the previous event */
+  md_addr_t last_pc;		/* PC of the previous new inst or uop */
+  md_addr_t last_addr;		/* address of the previous new inst or uop */
+  tick_t last_cycle;		/* previous cycle */
+  struct {
+    md_addr_t pc;		/* PC of cached inst, 0 if invalid */
+    md_inst_t inst;		/* cached inst */
+  } icache[PT_ICACHE_SIZE];
+};
+
 /* pipetracing is active */
 extern int ptrace_active;
 
@@ -0,0 +1,294 @@
+/* ptrace2txt.c - binary pipetrace to text pipetrace converter */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "ptrace.h"
+
+/*
+ * This program converts a binary pipetrace, written by sim-outorder when
+ * the -ptrace file name ends in ".ptb" (or ".ptb.gz"), into the text
+ * pipetrace format read by pipeview.pl, e.g.,
+ *
+ *	sim-outorder -ptrace foo.ptb.gz : test-math
+ *	ptrace2txt foo.ptb.gz | pipeview.pl -
+ */
+
+/* pipeline stages with their own binary stage index */
+static char *ptrace_stages[] = PTRACE_STAGES;
+
+/* binary pipetrace reader */
+struct pt_reader_t {
+  FILE *fd;			/* trace stream */
+  int pos;			/* next buffer byte to read */
+  int len;			/* number of valid buffer bytes */
+  byte_t buf[PTRACE_BUFSZ];	/* read buffer */
+};
+
+/* get the next byte of the trace, returns -1 at the end of the trace */
+static INLINE int
+pt_get_byte(struct pt_reader_t *rd)	/* binary pipetrace reader */
+{
+  if (rd->pos == rd->len)
+    {
+      rd->len = fread(rd->buf, 1, PTRACE_BUFSZ, rd->fd);
+      rd->pos = 0;
+      if (rd->len <= 0)
+	{
+	  rd->len = 0;
+	  return -1;
+	}
+    }
+  return rd->buf[rd->pos++];
+}
+
+/* get the next byte of an event, which must be present */
+static INLINE int
+pt_get_byte_chk(struct pt_reader_t *rd)	/* binary pipetrace reader */
+{
+  int c;
+
+  if ((c = pt_get_byte(rd)) < 0)
+    fatal("pipetrace is truncated");
+  return c;
+}
+
+/* get the next varint from the trace */
+static md_addr_t
+pt_get_varint(struct pt_reader_t *rd)	/* binary pipetrace reader */
+{
+  md_addr_t val = 0;
+  int c, shift = 0;
+
+  do {
+    c = pt_get_byte_chk(rd);
+    val |= (md_addr_t)(c & 0x7f) << shift;
+    shift += 7;
+  } while (c & 0x80);
+
+  return val;
+}
+
+/* get a length-prefixed string from the trace into BUF of size BUFSZ */
+static void
+pt_get_string(struct pt_reader_t *rd,	/* binary pipetrace reader */
+	      char *buf,		/* string buffer */
+	      int bufsz)		/* string buffer size */
+{
+  int i, len = (int)pt_get_varint(rd);
+
+  if (len >= bufsz)
+    fatal("pipetrace string is too long");
+  for (i=0; i < len; i++)
+    buf[i] = pt_get_byte_chk(rd);
+  buf[len] = '\0';
+}
+
+/* convert binary pipetrace FNAME to the text format, written to STREAM */
+static void
+ptrace_convert(char *fname,		/* binary pipetrace file name */
+	       FILE *stream)		/* text output stream */
+{
+  struct pt_reader_t *rd;
+  struct ptrace_state_t *dec;
+  md_inst_t inst;
+  md_addr_t delta;
+  byte_t hdr[8];
+  char str[1024];
+  unsigned int pevents;
+  int i, tag, stage, ci;
+
+  rd = (struct pt_reader_t *)calloc(1, sizeof(struct pt_reader_t));
+  dec = (struct ptrace_state_t *)calloc(1, sizeof(struct ptrace_state_t));
+  if (!rd || !dec)
+    fatal("out of virtual memory");
+
+  rd->fd = gzopen(fname, "r");
+  if (!rd->fd)
+    fatal("cannot open pipetrace `%s'", fname);
+
+  if (fread(hdr, 1, sizeof(hdr), rd->fd) != sizeof(hdr)
+      || memcmp(hdr, PTRACE_MAGIC, 4) != 0)
+    fatal("`%s' is not a binary pipetrace", fname);
+  if (hdr[4] != PTRACE_VERSION)
+    fatal("pipetrace `%s' is version %d, expected %d",
+	  fname, hdr[4], PTRACE_VERSION);
+#ifdef BYTES_BIG_ENDIAN
+  if (hdr[7] != 1)
+#else /* !BYTES_BIG_ENDIAN */
+  if (hdr[7] != 0)
+#endif /* BYTES_BIG_ENDIAN */
+    fatal("pipetrace `%s' was written on a host of another byte order",
+	  fname);
+  if (hdr[5] != sizeof(md_addr_t) || hdr[6] != sizeof(md_inst_t))
+    fatal("pipetrace `%s' was written for another target", fname);
+
+  while ((tag = pt_get_byte(rd)) >= 0)
+    {
+      switch (tag & PT_KIND_MASK)
+	{
+	case PT_NEWINST:
+	  if (tag & PT_NEXT)
+	    dec->last_iseq++;
+	  else
+	    {
+	      delta = pt_get_varint(rd);
+	      dec->last_iseq += (int)PT_UNZIGZAG(delta);
+	    }
+	  delta = pt_get_varint(rd);
+	  dec->last_pc += PT_UNZIGZAG(delta);
+	  delta = pt_get_varint(rd);
+	  dec->last_addr += PT_UNZIGZAG(delta);
+
+	  ci = PT_ICACHE_HASH(dec->last_pc);
+	  if (tag & PT_INST_CACHED)
+	    {
+	      if (dec->icache[ci].pc != dec->last_pc)
+		fatal("pipetrace is corrupted");
+	      inst = dec->icache[ci].inst;
+	    }
+	  else
+	    {
+	      for (i=0; i < (int)sizeof(md_inst_t); i++)
+		((byte_t *)&inst)[i] = pt_get_byte_chk(rd);
+	      dec->icache[ci].pc = dec->last_pc;
+	      dec->icache[ci].inst = inst;
+	    }
+
+	  myfprintf(stream, "+ %u 0x%08p 0x%08p ",
+		    dec->last_iseq, dec->last_pc, dec->last_addr);
+	  md_print_insn(inst, dec->last_addr, stream);
+	  fprintf(stream, "\n");
+	  break;
+
+	case PT_NEWUOP:
+	  delta = pt_get_varint(rd);
+	  dec->last_iseq += (int)PT_UNZIGZAG(delta);
+	  delta = pt_get_varint(rd);
+	  dec->last_pc += PT_UNZIGZAG(delta);
+	  delta = pt_get_varint(rd);
+	  dec->last_addr += PT_UNZIGZAG(delta);
+	  pt_get_string(rd, str, sizeof(str));
+	  myfprintf(stream, "+ %u 0x%08p 0x%08p [%s]\n",
+		    dec->last_iseq, dec->last_pc, dec->last_addr, str);
+	  break;
+
+	case PT_ENDINST:
+	  delta = pt_get_varint(rd);
+	  dec->last_iseq += (int)PT_UNZIGZAG(delta);
+	  fprintf(stream, "- %u\n", dec->last_iseq);
+	  break;
+
+	case PT_NEWCYCLE:
+	  if (tag & PT_NEXT)
+	    dec->last_cycle += 1;
+	  else
+	    dec->last_cycle += (tick_t)pt_get_varint(rd);
+	  fprintf(stream, "@ %.0f\n", (double)dec->last_cycle);
+	  break;
+
+	case PT_NEWSTAGE:
+	  delta = pt_get_varint(rd);
+	  dec->last_iseq += (int)PT_UNZIGZAG(delta);
+	  pevents = (tag & PT_EVENTS) ? (unsigned int)pt_get_varint(rd) : 0;
+	  stage = (tag >> PT_STAGE_SHIFT) & PT_STAGE_MASK;
+	  if (stage == PT_STAGE_OTHER)
+	    pt_get_string(rd, str, sizeof(str));
+	  else if (stage < N_ELT(ptrace_stages))
+	    strcpy(str, ptrace_stages[stage]);
+	  else
+	    fatal("pipetrace is corrupted");
+	  fprintf(stream, "* %u %s 0x%08x\n", dec->last_iseq, str, pevents);
+	  break;
+
+	default:
+	  fatal("pipetrace is corrupted");
+	}
+    }
+
+  gzclose(rd->fd);
+  free(dec);
+  free(rd);
+}
+
+int
+main(int argc, char **argv)
+{
+  FILE *stream;
+
+  if (argc < 2 || argc > 3)
+    {
+      fprintf(stderr, "usage: %s <binary pipetrace> [<text pipetrace>]\n",
+	      argv[0]);
+      exit(1);
+    }
+
+  if (argc == 3)
+    {
+      stream = gzopen(argv[2], "w");
+      if (!stream)
+	fatal("cannot open text pipetrace `%s'", argv[2]);
+    }
+  else
+    stream = stdout;
+
+  ptrace_convert(argv[1], stream);
+
+  if (stream != stdout)
+    gzclose(stream);
+
+  return 0;
+}
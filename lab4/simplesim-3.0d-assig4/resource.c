@@ -57,6 +57,21 @@
 #include "misc.h"
 #include "resource.h"
 
+/* index of the least significant set bit of non-zero MASK */
+#ifdef __GNUC__
+#define RES_FFS(MASK)		__builtin_ctz(MASK)
+#else /* !__GNUC__ */
+static int
+RES_FFS(unsigned int mask)
+{
+  int i;
+
+  for (i=0; !(mask & 1); i++)
+    mask >>= 1;
+  return i;
+}
+#endif /* __GNUC__ */
+
 /* create a resource pool */
 struct res_pool *
 res_create_pool(char *name, struct res_desc *pool, int ndesc)
@@ -86,6 +101,7 @@ res_create_pool(char *name, struct res_desc *pool, int ndesc)
 	  inst_pool[index] = pool[i];
 	  inst_pool[index].quantity = 1;
 	  inst_pool[index].busy = FALSE;
+	  inst_pool[index].next_release = NULL;
 	  for (k=0; k<MAX_RES_CLASSES && inst_pool[index].x[k].class; k++)
 	    inst_pool[index].x[k].master = &inst_pool[index];
 	  index++;
@@ -111,6 +127,15 @@ res_create_pool(char *name, struct res_desc *pool, int ndesc)
 	  if (plate->class)
 	    {
 	      assert(plate->class < MAX_RES_CLASSES);
+	      if (res->nents[plate->class] == MAX_INSTS_PER_CLASS)
+		fatal("too many functional units, increase MAX_INSTS_PER_CLASS");
+	      if (plate->issuelat >= RES_WHEEL_SIZE)
+		fatal("issue latency of `%s' must be less than %d",
+		      plate->master->name, RES_WHEEL_SIZE);
+
+	      /* all units start out free */
+	      plate->slot = res->nents[plate->class];
+	      res->free_mask[plate->class] |= 1U << plate->slot;
 	      res->table[plate->class][res->nents[plate->class]++] = plate;
 	    }
 	  else
@@ -126,31 +151,110 @@ res_create_pool(char *name, struct res_desc *pool, int ndesc)
    operation of class CLASS, returns a pointer to the resource template,
    returns NULL, if there are currently no free resources available,
    follow the MASTER link to the master resource descriptor;
-   NOTE: caller is responsible for reseting the busy flag in the beginning
-   of the cycle when the resource can once again accept a new operation */
+   the resource stays free until it is reserved with res_reserve() */
 struct res_template *
 res_get(struct res_pool *pool, int class)
 {
-  int i;
-
   /* must be a valid class */
   assert(class < MAX_RES_CLASSES);
 
   /* must be at least one resource in this class */
   assert(pool->table[class][0]);
 
-  for (i=0; i<MAX_INSTS_PER_CLASS; i++)
+  /* the first free instance, as found by a scan of the table */
+  if (!pool->free_mask[class])
+    return NULL;
+  return pool->table[class][RES_FFS(pool->free_mask[class])];
+}
+
+/* mark resource RES busy (BUSY is non-zero) or free in all of its classes */
+static void
+res_set_busy(struct res_pool *pool, struct res_desc *res, int busy)
+{
+  int k;
+
+  res->busy = busy;
+  for (k=0; k<MAX_RES_CLASSES && res->x[k].class; k++)
+    {
+      if (busy)
+	pool->free_mask[res->x[k].class] &= ~(1U << res->x[k].slot);
+      else
+	pool->free_mask[res->x[k].class] |= 1U << res->x[k].slot;
+    }
+}
+
+/* reserve the resource of template FU in resource pool POOL for its issue
+   latency, it is released by the res_release() of that many cycles later */
+void
+res_reserve(struct res_pool *pool, struct res_template *fu)
+{
+  struct res_desc *res = fu->master;
+  int slot;
+
+  if (fu->issuelat <= 0)
+    return;
+
+  res_set_busy(pool, res, fu->issuelat);
+  res->release = pool->now + fu->issuelat;
+  slot = res->release & (RES_WHEEL_SIZE - 1);
+  res->next_release = pool->wheel[slot];
+  pool->wheel[slot] = res;
+}
+
+/* advance resource pool POOL one cycle, releasing the resources whose
+   issue latency has elapsed, call once at the beginning of each cycle */
+void
+res_release(struct res_pool *pool)
+{
+  struct res_desc *res, *next;
+  int slot;
+
+  pool->now++;
+  slot = pool->now & (RES_WHEEL_SIZE - 1);
+  for (res = pool->wheel[slot]; res != NULL; res = next)
+    {
+      next = res->next_release;
+      res->next_release = NULL;
+      res_set_busy(pool, res, FALSE);
+    }
+  pool->wheel[slot] = NULL;
+}
+
+/* advance resource pool POOL NCYCLES cycles, as NCYCLES calls of
+   res_release() would */
+void
+res_advance(struct res_pool *pool, tick_t ncycles)
+{
+  if (ncycles < RES_WHEEL_SIZE)
     {
-      if (pool->table[class][i])
+      while (ncycles-- > 0)
+	res_release(pool);
+    }
+  else
+    {
+      /* every busy resource is released within a wheel revolution */
+      res_release_all(pool);
+      pool->now += ncycles;
+    }
+}
+
+/* release all resources of resource pool POOL */
+void
+res_release_all(struct res_pool *pool)
+{
+  struct res_desc *res, *next;
+  int slot;
+
+  for (slot=0; slot<RES_WHEEL_SIZE; slot++)
+    {
+      for (res = pool->wheel[slot]; res != NULL; res = next)
 	{
-	  if (!pool->table[class][i]->master->busy)
-	    return pool->table[class][i];
+	  next = res->next_release;
+	  res->next_release = NULL;
+	  res_set_busy(pool, res, FALSE);
 	}
-      else
-	break;
+      pool->wheel[slot] = NULL;
     }
-  /* none found */
-  return NULL;
 }
 
 /* dump the resource pool POOL to stream STREAM */
@@ -175,7 +279,9 @@ res_dump(struct res_pool *pool, FILE *stream)
 	    break;
 	  fprintf(stream, "\t%s (busy for %d cycles) ",
 		  pool->table[i][j]->master->name,
-		  pool->table[i][j]->master->busy);
+		  (pool->table[i][j]->master->busy
+		   ? (int)(pool->table[i][j]->master->release - pool->now)
+		   : 0));
 	}
       assert(j == pool->nents[i]);
       fprintf(stream, "\n");
@@ -54,11 +54,18 @@
 
 #include <stdio.h>
 
+#include "host.h"
+
 /* maximum number of resource classes supported */
 #define MAX_RES_CLASSES		16
 
-/* maximum number of resource instances for a class supported */
-#define MAX_INSTS_PER_CLASS	8
+/* maximum number of resource instances for a class supported, each class
+   keeps a bitmask of its free instances in an unsigned int */
+#define MAX_INSTS_PER_CLASS	32
+
+/* number of cycles covered by the release timing wheel, a power of two,
+   issue latencies must be less than this */
+#define RES_WHEEL_SIZE		64
 
 /* resource descriptor */
 struct res_desc {
@@ -75,7 +82,10 @@ struct res_desc {
 					   before another operation can be
 					   issued on this resource */
     struct res_desc *master;		/* master resource record */
+    int slot;				/* index in the class's table */
   } x[MAX_RES_CLASSES];
+  unsigned int release;			/* pool cycle the unit is released */
+  struct res_desc *next_release;	/* next unit released that cycle */
 };
 
 /* resource pool: one entry per resource instance */
@@ -86,6 +96,11 @@ struct res_pool {
   /* res class -> res template mapping table, lists are NULL terminated */
   int nents[MAX_RES_CLASSES];
   struct res_template *table[MAX_RES_CLASSES][MAX_INSTS_PER_CLASS];
+  /* free instances of each class, bit I is set if TABLE[class][I] is free */
+  unsigned int free_mask[MAX_RES_CLASSES];
+  /* busy units, listed in the slot of the cycle they are released */
+  unsigned int now;			/* current pool cycle */
+  struct res_desc *wheel[RES_WHEEL_SIZE];
 };
 
 /* create a resource pool */
@@ -95,10 +110,24 @@ struct res_pool *res_create_pool(char *name, struct res_desc *pool, int ndesc);
    operation of class CLASS, returns a pointer to the resource template,
    returns NULL, if there are currently no free resources available,
    follow the MASTER link to the master resource descriptor;
-   NOTE: caller is responsible for reseting the busy flag in the beginning
-   of the cycle when the resource can once again accept a new operation */
+   the resource stays free until it is reserved with res_reserve() */
 struct res_template *res_get(struct res_pool *pool, int class);
 
+/* reserve the resource of template FU in resource pool POOL for its issue
+   latency, it is released by the res_release() of that many cycles later */
+void res_reserve(struct res_pool *pool, struct res_template *fu);
+
+/* advance resource pool POOL one cycle, releasing the resources whose
+   issue latency has elapsed, call once at the beginning of each cycle */
+void res_release(struct res_pool *pool);
+
+/* advance resource pool POOL NCYCLES cycles, as NCYCLES calls of
+   res_release() would */
+void res_advance(struct res_pool *pool, tick_t ncycles);
+
+/* release all resources of resource pool POOL */
+void res_release_all(struct res_pool *pool);
+
 /* dump the resource pool POOL to stream STREAM */
 void res_dump(struct res_pool *pool, FILE *stream);
 
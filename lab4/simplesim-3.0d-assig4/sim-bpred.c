@@ -51,6 +51,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include "host.h"
@@ -58,16 +59,20 @@
 #include "machine.h"
 #include "regs.h"
 #include "memory.h"
+#include "predec.h"
 #include "loader.h"
 #include "syscall.h"
 #include "dlite.h"
 #include "options.h"
 #include "stats.h"
 #include "bpred.h"
+#include "sweep.h"
 #include "sim.h"
 
 /*
- * This file implements a branch predictor analyzer.
+ * This file implements a branch predictor analyzer.  Any number of further
+ * predictor configurations can be swept in the same run, they are trained
+ * by worker threads from batches of the branches of the simulated program.
  */
 
 /* simulated registers */
@@ -76,10 +81,13 @@ static struct regs_t regs;
 /* simulated memory */
 static struct mem_t *mem = NULL;
 
+/* predecoded program text */
+static struct predec_t *pd = NULL;
+
 /* maximum number of inst's to execute */
 static unsigned int max_insts;
 
-/* branch predictor type {nottaken|taken|perfect|bimod|2lev} */
+/* branch predictor type {nottaken|taken|perfect|bimod|2lev|comb|tage} */
 static char *pred_type;
 
 /* bimodal predictor config (<table_size>) */
@@ -97,6 +105,20 @@ static int comb_nelt = 1;
 static int comb_config[1] =
   { /* meta_table_size */1024 };
 
+/* TAGE predictor config
+   (<num_tables> <table_size> <tag_width> <min_hist> <max_hist>) */
+static int tage_nelt = 5;
+static int tage_config[5] =
+  { /* tables */7, /* table size */1024, /* tag */10, /* min hist */4,
+    /* max hist */160 };
+
+/* ITTAGE indirect target predictor config, zero tables disables ITTAGE
+   (<num_tables> <table_size> <tag_width> <min_hist> <max_hist>) */
+static int ittage_nelt = 5;
+static int ittage_config[5] =
+  { /* tables */0, /* table size */512, /* tag */12, /* min hist */4,
+    /* max hist */64 };
+
 /* return address stack (RAS) size */
 static int ras_size = 8;
 
@@ -108,6 +130,44 @@ static int btb_config[2] =
 /* branch predictor */
 static struct bpred_t *pred;
 
+/* branch predictor configuration, as given by the -bpred options */
+struct pred_config_t
+{
+  char *type;			/* predictor type */
+  int bimod[1];			/* bimodal predictor config */
+  int twolev[4];		/* 2-level predictor config */
+  int comb[1];			/* combining predictor config */
+  int tage[5];			/* TAGE predictor config */
+  int ittage[5];		/* ITTAGE predictor config */
+  int ras;			/* return address stack size */
+  int btb[2];			/* BTB config */
+};
+
+/* swept branch predictors, trained from SWEEP */
+#define MAX_SWEEPS 64
+static struct bpred_t *sweep_preds[MAX_SWEEPS];
+static struct sweep_t *sweep = NULL;
+
+/* swept predictor options */
+static int sweep_nelt = 0;
+static char *sweep_opts[MAX_SWEEPS];
+static int sweep_threads;
+
+/* sweep event, an executed control inst */
+struct sweep_branch_t
+{
+  md_addr_t pc;			/* address of the control inst */
+  md_addr_t npc;		/* address of the next inst executed */
+  md_addr_t target;		/* branch target address */
+  int op;			/* an enum md_opcode */
+  int flags;			/* SWEEP_* flags */
+};
+
+/* sweep event flags */
+#define SWEEP_COND		0x01	/* conditional branch */
+#define SWEEP_CALL		0x02	/* function call */
+#define SWEEP_RETURN		0x04	/* function return */
+
 /* track number of insn and refs */
 static counter_t sim_num_refs = 0;
 
@@ -138,6 +198,10 @@ sim_reg_options(struct opt_odb_t *odb)
 "      PAp     : N, W, M (M == 2^(N+W)), 0\n"
 "      gshare  : 1, W, 2^W, 1\n"
 "  Predictor `comb' combines a bimodal and a 2-level predictor.\n"
+"  Predictor `tage' backs a bimodal predictor (configured by -bpred:bimod)\n"
+"  with tagged tables indexed by geometrically longer global histories.\n"
+"  Any stateful predictor can predict the targets of indirect jumps with\n"
+"  ITTAGE (-bpred:ittage), falling back to the BTB on a tag miss.\n"
                );
 
   /* instruction limit */
@@ -146,7 +210,7 @@ sim_reg_options(struct opt_odb_t *odb)
 	       /* print */TRUE, /* format */NULL);
 
   opt_reg_string(odb, "-bpred",
-		 "branch predictor type {nottaken|taken|bimod|2lev|comb}",
+		 "branch predictor type {nottaken|taken|bimod|2lev|comb|tage}",
                  &pred_type, /* default */"bimod",
                  /* print */TRUE, /* format */NULL);
 
@@ -169,6 +233,22 @@ sim_reg_options(struct opt_odb_t *odb)
 		   /* default */comb_config,
 		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
 
+  opt_reg_int_list(odb, "-bpred:tage",
+		   "TAGE predictor config "
+		   "(<num_tables> <table_size> <tag_width> <min_hist> "
+		   "<max_hist>)",
+		   tage_config, tage_nelt, &tage_nelt,
+		   /* default */tage_config,
+		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
+
+  opt_reg_int_list(odb, "-bpred:ittage",
+		   "ITTAGE indirect target predictor config, 0 tables for "
+		   "none (<num_tables> <table_size> <tag_width> <min_hist> "
+		   "<max_hist>)",
+		   ittage_config, ittage_nelt, &ittage_nelt,
+		   /* default */ittage_config,
+		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
+
   opt_reg_int(odb, "-bpred:ras",
               "return address stack size (0 for no return stack)",
               &ras_size, /* default */ras_size,
@@ -179,91 +259,261 @@ sim_reg_options(struct opt_odb_t *odb)
 		   btb_config, btb_nelt, &btb_nelt,
 		   /* default */btb_config,
 		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
+
+  opt_reg_string_list(odb, "-sweep",
+		      "swept predictor config(s), i.e., "
+		      "<type>[,<param>=<n>[:<n>...]...]",
+		      sweep_opts, MAX_SWEEPS, &sweep_nelt, /* default */NULL,
+		      /* print */TRUE, /* format */NULL, /* accrue */TRUE);
+  opt_reg_note(odb,
+"  Each use of `-sweep' trains one more predictor in the same run, given as\n"
+"  a predictor type, as for `-bpred', followed by any of the parameters\n"
+"  bimod, 2lev, comb, tage, ittage, ras and btb, whose values are those of\n"
+"  the -bpred:<param> option separated by colons.  Parameters not given\n"
+"  take the values of the -bpred options.  The stats of swept predictor <n>\n"
+"  are reported with the prefix `s<n>.', e.g., s0.bpred_2lev.misses.  Swept\n"
+"  predictors are trained in batches by worker threads.\n"
+"\n"
+"    Example:   -sweep 2lev,2lev=1:4096:12:1 -sweep tage,btb=1024:4\n"
+	       );
+  opt_reg_int(odb, "-sweep:threads",
+	      "number of sweep worker threads (0 for one per predictor)",
+	      &sweep_threads, /* default */0, /* print */TRUE, /* format */NULL);
 }
 
-/* check simulator-specific option values */
-void
-sim_check_options(struct opt_odb_t *odb, int argc, char **argv)
+/* create a branch predictor as configured by CFG */
+static struct bpred_t *			/* branch predictor */
+pred_create(struct pred_config_t *cfg)	/* predictor configuration */
 {
-  if (!mystricmp(pred_type, "taken"))
+  struct bpred_t *bp = NULL;
+
+  if (!mystricmp(cfg->type, "taken"))
     {
       /* static predictor, not taken */
-      pred = bpred_create(BPredTaken, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+      bp = bpred_create(BPredTaken, 0, 0, 0, 0, 0, 0, 0, 0, 0);
     }
-  else if (!mystricmp(pred_type, "nottaken"))
+  else if (!mystricmp(cfg->type, "nottaken"))
     {
       /* static predictor, taken */
-      pred = bpred_create(BPredNotTaken, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+      bp = bpred_create(BPredNotTaken, 0, 0, 0, 0, 0, 0, 0, 0, 0);
     }
-  else if (!mystricmp(pred_type, "bimod"))
+  else if (!mystricmp(cfg->type, "bimod"))
     {
-      if (bimod_nelt != 1)
-	fatal("bad bimod predictor config (<table_size>)");
-      if (btb_nelt != 2)
-	fatal("bad btb config (<num_sets> <associativity>)");
-
       /* bimodal predictor, bpred_create() checks BTB_SIZE */
-      pred = bpred_create(BPred2bit,
-			  /* bimod table size */bimod_config[0],
-			  /* 2lev l1 size */0,
-			  /* 2lev l2 size */0,
-			  /* meta table size */0,
-			  /* history reg size */0,
-			  /* history xor address */0,
-			  /* btb sets */btb_config[0],
-			  /* btb assoc */btb_config[1],
-			  /* ret-addr stack size */ras_size);
+      bp = bpred_create(BPred2bit,
+			/* bimod table size */cfg->bimod[0],
+			/* 2lev l1 size */0,
+			/* 2lev l2 size */0,
+			/* meta table size */0,
+			/* history reg size */0,
+			/* history xor address */0,
+			/* btb sets */cfg->btb[0],
+			/* btb assoc */cfg->btb[1],
+			/* ret-addr stack size */cfg->ras);
     }
-  else if (!mystricmp(pred_type, "2lev"))
+  else if (!mystricmp(cfg->type, "2lev"))
     {
       /* 2-level adaptive predictor, bpred_create() checks args */
-      if (twolev_nelt != 4)
-	fatal("bad 2-level pred config (<l1size> <l2size> <hist_size> <xor>)");
-      if (btb_nelt != 2)
-	fatal("bad btb config (<num_sets> <associativity>)");
-
-      pred = bpred_create(BPred2Level,
-			  /* bimod table size */0,
-			  /* 2lev l1 size */twolev_config[0],
-			  /* 2lev l2 size */twolev_config[1],
-			  /* meta table size */0,
-			  /* history reg size */twolev_config[2],
-			  /* history xor address */twolev_config[3],
-			  /* btb sets */btb_config[0],
-			  /* btb assoc */btb_config[1],
-			  /* ret-addr stack size */ras_size);
+      bp = bpred_create(BPred2Level,
+			/* bimod table size */0,
+			/* 2lev l1 size */cfg->twolev[0],
+			/* 2lev l2 size */cfg->twolev[1],
+			/* meta table size */0,
+			/* history reg size */cfg->twolev[2],
+			/* history xor address */cfg->twolev[3],
+			/* btb sets */cfg->btb[0],
+			/* btb assoc */cfg->btb[1],
+			/* ret-addr stack size */cfg->ras);
     }
-  else if (!mystricmp(pred_type, "comb"))
+  else if (!mystricmp(cfg->type, "comb"))
     {
       /* combining predictor, bpred_create() checks args */
-      if (twolev_nelt != 4)
-	fatal("bad 2-level pred config (<l1size> <l2size> <hist_size> <xor>)");
+      bp = bpred_create(BPredComb,
+			/* bimod table size */cfg->bimod[0],
+			/* l1 size */cfg->twolev[0],
+			/* l2 size */cfg->twolev[1],
+			/* meta table size */cfg->comb[0],
+			/* history reg size */cfg->twolev[2],
+			/* history xor address */cfg->twolev[3],
+			/* btb sets */cfg->btb[0],
+			/* btb assoc */cfg->btb[1],
+			/* ret-addr stack size */cfg->ras);
+    }
+  else if (!mystricmp(cfg->type, "tage"))
+    {
+      /* TAGE predictor, bpred_tage_create() checks args */
+      bp = bpred_tage_create(/* bimod table size */cfg->bimod[0],
+			     /* tagged tables */cfg->tage[0],
+			     /* table size */cfg->tage[1],
+			     /* tag width */cfg->tage[2],
+			     /* shortest history */cfg->tage[3],
+			     /* longest history */cfg->tage[4],
+			     /* btb sets */cfg->btb[0],
+			     /* btb assoc */cfg->btb[1],
+			     /* ret-addr stack size */cfg->ras);
+    }
+  else
+    fatal("cannot parse predictor type `%s'", cfg->type);
+
+  if (cfg->ittage[0] != 0)
+    {
+      /* bpred_ind_create() checks args */
+      bpred_ind_create(bp,
+		       /* tagged tables */cfg->ittage[0],
+		       /* table size */cfg->ittage[1],
+		       /* tag width */cfg->ittage[2],
+		       /* shortest history */cfg->ittage[3],
+		       /* longest history */cfg->ittage[4]);
+    }
+
+  return bp;
+}
+
+/* parse the colon separated values of sweep parameter PARAM from STR into
+   the NVALS elements of VALS */
+static void
+sweep_param(char *param,		/* parameter name */
+	    char *str,			/* value string */
+	    int *vals,			/* parsed values */
+	    int nvals)			/* number of values expected */
+{
+  int i;
+  char *end;
+
+  for (i=0; i < nvals; i++)
+    {
+      vals[i] = (int)strtol(str, &end, 0);
+      if (end == str || (*end != (i == nvals-1 ? '\0' : ':')))
+	fatal("sweep parameter `%s' needs %d colon separated values",
+	      param, nvals);
+      str = end + 1;
+    }
+}
+
+/* parse swept predictor SPEC, `<type>[,<param>=<n>[:<n>...]...]', into CFG,
+   the parameters not given are left as they are */
+static void
+sweep_parse(char *spec,			/* swept predictor spec */
+	    struct pred_config_t *cfg)	/* parsed predictor config */
+{
+  char *p, *val;
+
+  /* the spec is kept, for printing, the type and values point into a copy */
+  if (!(spec = mystrdup(spec)))
+    fatal("out of virtual memory");
+
+  cfg->type = strtok(spec, ",");
+  if (!cfg->type)
+    fatal("empty -sweep predictor config");
+  while ((p = strtok(NULL, ",")) != NULL)
+    {
+      if (!(val = strchr(p, '=')))
+	fatal("bad sweep parameter `%s', expected <param>=<values>", p);
+      *val++ = '\0';
+
+      if (!mystricmp(p, "bimod"))
+	sweep_param(p, val, cfg->bimod, 1);
+      else if (!mystricmp(p, "2lev"))
+	sweep_param(p, val, cfg->twolev, 4);
+      else if (!mystricmp(p, "comb"))
+	sweep_param(p, val, cfg->comb, 1);
+      else if (!mystricmp(p, "tage"))
+	sweep_param(p, val, cfg->tage, 5);
+      else if (!mystricmp(p, "ittage"))
+	sweep_param(p, val, cfg->ittage, 5);
+      else if (!mystricmp(p, "ras"))
+	sweep_param(p, val, &cfg->ras, 1);
+      else if (!mystricmp(p, "btb"))
+	sweep_param(p, val, cfg->btb, 2);
+      else
+	fatal("unknown sweep parameter `%s'", p);
+    }
+}
+
+static void sweep_apply(int config, void *evs, int nevs);
+
+/* make the swept predictor stats current before they are printed */
+static void
+sweep_stats_sync(void)
+{
+  sweep_sync(sweep);
+}
+
+/* check simulator-specific option values */
+void
+sim_check_options(struct opt_odb_t *odb, int argc, char **argv)
+{
+  struct pred_config_t cfg, scfg;
+  char prefix[32];
+  int i;
+
+  if (!mystricmp(pred_type, "bimod") || !mystricmp(pred_type, "comb")
+      || !mystricmp(pred_type, "tage"))
+    {
       if (bimod_nelt != 1)
 	fatal("bad bimod predictor config (<table_size>)");
+    }
+  if (!mystricmp(pred_type, "2lev") || !mystricmp(pred_type, "comb"))
+    {
+      if (twolev_nelt != 4)
+	fatal("bad 2-level pred config (<l1size> <l2size> <hist_size> <xor>)");
+    }
+  if (!mystricmp(pred_type, "comb"))
+    {
       if (comb_nelt != 1)
 	fatal("bad combining predictor config (<meta_table_size>)");
+    }
+  if (!mystricmp(pred_type, "tage"))
+    {
+      if (tage_nelt != 5)
+	fatal("bad TAGE pred config (<num_tables> <table_size> <tag_width> "
+	      "<min_hist> <max_hist>)");
+    }
+  if (mystricmp(pred_type, "taken") && mystricmp(pred_type, "nottaken"))
+    {
       if (btb_nelt != 2)
 	fatal("bad btb config (<num_sets> <associativity>)");
-
-      pred = bpred_create(BPredComb,
-			  /* bimod table size */bimod_config[0],
-			  /* l1 size */twolev_config[0],
-			  /* l2 size */twolev_config[1],
-			  /* meta table size */comb_config[0],
-			  /* history reg size */twolev_config[2],
-			  /* history xor address */twolev_config[3],
-			  /* btb sets */btb_config[0],
-			  /* btb assoc */btb_config[1],
-			  /* ret-addr stack size */ras_size);
     }
-  else
-    fatal("cannot parse predictor type `%s'", pred_type);
+  if (ittage_nelt != 5)
+    fatal("bad ITTAGE pred config (<num_tables> <table_size> <tag_width> "
+	  "<min_hist> <max_hist>)");
+
+  cfg.type = pred_type;
+  memcpy(cfg.bimod, bimod_config, sizeof(cfg.bimod));
+  memcpy(cfg.twolev, twolev_config, sizeof(cfg.twolev));
+  memcpy(cfg.comb, comb_config, sizeof(cfg.comb));
+  memcpy(cfg.tage, tage_config, sizeof(cfg.tage));
+  memcpy(cfg.ittage, ittage_config, sizeof(cfg.ittage));
+  cfg.ras = ras_size;
+  memcpy(cfg.btb, btb_config, sizeof(cfg.btb));
+
+  pred = pred_create(&cfg);
+
+  /* swept predictors default to the -bpred options */
+  if (sweep_threads < 0)
+    fatal("number of sweep worker threads must be non-negative");
+  for (i=0; i < sweep_nelt; i++)
+    {
+      scfg = cfg;
+      sweep_parse(sweep_opts[i], &scfg);
+      sweep_preds[i] = pred_create(&scfg);
+      sprintf(prefix, "s%d.", i);
+      sweep_preds[i]->prefix = mystrdup(prefix);
+    }
+  if (sweep_nelt)
+    {
+      sweep = sweep_create(sweep_nelt, sizeof(struct sweep_branch_t),
+			   sweep_apply, sweep_threads);
+      sim_stats_hook = sweep_stats_sync;
+    }
 }
 
 /* register simulator-specific statistics */
 void
 sim_reg_stats(struct stat_sdb_t *sdb)
 {
+  int i;
+
   stat_reg_counter(sdb, "sim_num_insn",
 		   "total number of instructions executed",
 		   &sim_num_insn, sim_num_insn, NULL);
@@ -287,6 +537,13 @@ sim_reg_stats(struct stat_sdb_t *sdb)
   /* register predictor stats */
   if (pred)
     bpred_reg_stats(pred, sdb);
+  for (i=0; i < sweep_nelt; i++)
+    bpred_reg_stats(sweep_preds[i], sdb);
+  if (sweep)
+    sweep_reg_stats(sweep, sdb);
+
+  /* register predecoder stats */
+  predec_reg_stats(pd, sdb);
 }
 
 /* initialize the simulator */
@@ -326,6 +583,9 @@ sim_load_prog(char *fname,		/* program to load */
   /* load program text and data, set up environment, memory, and regs */
   ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
 
+  /* predecode the program text as it is executed */
+  pd = predec_create(mem, ld_text_base, ld_text_size);
+
   /* initialize the DLite debugger */
   dlite_init(md_reg_obj, dlite_mem_obj, bpred_mstate_obj);
 }
@@ -334,7 +594,10 @@ sim_load_prog(char *fname,		/* program to load */
 void
 sim_aux_config(FILE *stream)		/* output stream */
 {
-  /* nothing currently */
+  int i;
+
+  for (i=0; i < sweep_nelt; i++)
+    fprintf(stream, "sweep: s%d: %s\n", i, sweep_opts[i]);
 }
 
 /* dump simulator-specific auxiliary simulator statistics */
@@ -348,7 +611,8 @@ sim_aux_stats(FILE *stream)		/* output stream */
 void
 sim_uninit(void)
 {
-  /* nada */
+  if (sweep)
+    sweep_destroy(sweep);
 }
 
 
@@ -356,97 +620,125 @@ sim_uninit(void)
  * configure the execution engine
  */
 
-/*
- * precise architected register accessors
- */
+/* look up and train branch predictor BP with the control inst at PC, which
+   continued at NPC, TARGET is its target address */
+static INLINE void
+pred_train(struct bpred_t *bp,		/* branch predictor */
+	   md_addr_t pc,		/* address of the control inst */
+	   md_addr_t npc,		/* address of the next inst executed */
+	   md_addr_t target,		/* branch target address */
+	   enum md_opcode op,		/* opcode of the control inst */
+	   int is_cond,			/* conditional branch? */
+	   int is_call,			/* function call? */
+	   int is_return)		/* function return? */
+{
+  md_addr_t pred_PC;
+  struct bpred_update_t update_rec;
+  int stack_idx;
+
+  /* get the next predicted fetch address */
+  pred_PC = bpred_lookup(bp,
+			 /* branch addr */pc,
+			 /* target */target,
+			 /* inst opcode */op,
+			 /* call? */is_call,
+			 /* return? */is_return,
+			 /* stash an update ptr */&update_rec,
+			 /* stash return stack ptr */&stack_idx);
+
+  /* valid address returned from branch predictor? */
+  if (!pred_PC)
+    {
+      /* no predicted taken target, attempt not taken target */
+      pred_PC = pc + sizeof(md_inst_t);
+    }
+
+  /* repair speculative predictor history on a mis-predicted
+     direction, the ret-addr stack is left unchanged */
+  if (is_cond
+      && ((pred_PC != pc + sizeof(md_inst_t))
+	  != (npc != pc + sizeof(md_inst_t))))
+    bpred_recover(bp, pc,
+		  /* taken? */npc != (pc + sizeof(md_inst_t)),
+		  &update_rec, stack_idx);
+
+  bpred_update(bp,
+	       /* branch addr */pc,
+	       /* resolved branch target */npc,
+	       /* taken? */npc != (pc + sizeof(md_inst_t)),
+	       /* pred taken? */pred_PC != (pc + sizeof(md_inst_t)),
+	       /* correct pred? */pred_PC == npc,
+	       /* opcode */op,
+	       /* predictor update pointer */&update_rec);
+}
+
+/* train swept predictor CONFIG with the NEVS control insts at EVS, called
+   by the sweep workers */
+static void
+sweep_apply(int config,			/* swept predictor */
+	    void *evs,			/* batch of control insts */
+	    int nevs)			/* number of control insts */
+{
+  struct bpred_t *bp = sweep_preds[config];
+  struct sweep_branch_t *ev = (struct sweep_branch_t *)evs;
+  int i;
+
+  for (i=0; i < nevs; i++, ev++)
+    pred_train(bp, ev->pc, ev->npc, ev->target, (enum md_opcode)ev->op,
+	       ev->flags & SWEEP_COND, ev->flags & SWEEP_CALL,
+	       ev->flags & SWEEP_RETURN);
+}
+
+/* look up and train the branch predictors with executed control inst DEC,
+   TARGET_PC is its target address */
+static INLINE void
+bpred_branch(struct predec_inst_t *dec,	/* executed control inst */
+	     md_addr_t target_PC)	/* branch target address */
+{
+  md_inst_t inst = dec->inst;		/* for MD_IS_RETURN() */
+  struct sweep_branch_t *ev;
+
+  sim_num_branches++;
+
+  if (pred)
+    pred_train(pred, regs.regs_PC, regs.regs_NPC, target_PC, dec->op,
+	       dec->flags & F_COND, MD_IS_CALL(dec->op),
+	       MD_IS_RETURN(dec->op));
+
+  if (sweep)
+    {
+      ev = SWEEP_EVENT(sweep, struct sweep_branch_t);
+      ev->pc = regs.regs_PC;
+      ev->npc = regs.regs_NPC;
+      ev->target = target_PC;
+      ev->op = dec->op;
+      ev->flags = (((dec->flags & F_COND) ? SWEEP_COND : 0)
+		   | (MD_IS_CALL(dec->op) ? SWEEP_CALL : 0)
+		   | (MD_IS_RETURN(dec->op) ? SWEEP_RETURN : 0));
+    }
+}
+
+/* count each executed inst */
+static INLINE void
+bpred_inst(struct predec_inst_t *dec)	/* executed inst */
+{
+  if (dec->flags & F_MEM)
+    sim_num_refs++;
 
-/* next program counter */
-#define SET_NPC(EXPR)		(regs.regs_NPC = (EXPR))
-
-/* target program counter */
-#undef  SET_TPC
-#define SET_TPC(EXPR)		(target_PC = (EXPR))
-
-/* current program counter */
-#define CPC			(regs.regs_PC)
-
-/* general purpose registers */
-#define GPR(N)			(regs.regs_R[N])
-#define SET_GPR(N,EXPR)		(regs.regs_R[N] = (EXPR))
-
-#if defined(TARGET_PISA)
-
-/* floating point registers, L->word, F->single-prec, D->double-prec */
-#define FPR_L(N)		(regs.regs_F.l[(N)])
-#define SET_FPR_L(N,EXPR)	(regs.regs_F.l[(N)] = (EXPR))
-#define FPR_F(N)		(regs.regs_F.f[(N)])
-#define SET_FPR_F(N,EXPR)	(regs.regs_F.f[(N)] = (EXPR))
-#define FPR_D(N)		(regs.regs_F.d[(N) >> 1])
-#define SET_FPR_D(N,EXPR)	(regs.regs_F.d[(N) >> 1] = (EXPR))
-
-/* miscellaneous register accessors */
-#define SET_HI(EXPR)		(regs.regs_C.hi = (EXPR))
-#define HI			(regs.regs_C.hi)
-#define SET_LO(EXPR)		(regs.regs_C.lo = (EXPR))
-#define LO			(regs.regs_C.lo)
-#define FCC			(regs.regs_C.fcc)
-#define SET_FCC(EXPR)		(regs.regs_C.fcc = (EXPR))
-
-#elif defined(TARGET_ALPHA)
-
-/* floating point registers, L->word, F->single-prec, D->double-prec */
-#define FPR_Q(N)		(regs.regs_F.q[N])
-#define SET_FPR_Q(N,EXPR)	(regs.regs_F.q[N] = (EXPR))
-#define FPR(N)			(regs.regs_F.d[N])
-#define SET_FPR(N,EXPR)		(regs.regs_F.d[N] = (EXPR))
-
-/* miscellaneous register accessors */
-#define FPCR			(regs.regs_C.fpcr)
-#define SET_FPCR(EXPR)		(regs.regs_C.fpcr = (EXPR))
-#define UNIQ			(regs.regs_C.uniq)
-#define SET_UNIQ(EXPR)		(regs.regs_C.uniq = (EXPR))
-
-#else
-#error No ISA target defined...
-#endif
-
-/* precise architected memory state help functions */
-#define READ_BYTE(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_BYTE(mem, addr))
-#define READ_HALF(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_HALF(mem, addr))
-#define READ_WORD(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_WORD(mem, addr))
-#ifdef HOST_HAS_QWORD
-#define READ_QWORD(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_QWORD(mem, addr))
-#endif /* HOST_HAS_QWORD */
-
-#define WRITE_BYTE(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_BYTE(mem, addr, (SRC)))
-#define WRITE_HALF(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_HALF(mem, addr, (SRC)))
-#define WRITE_WORD(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_WORD(mem, addr, (SRC)))
-#ifdef HOST_HAS_QWORD
-#define WRITE_QWORD(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_QWORD(mem, addr, (SRC)))
-#endif /* HOST_HAS_QWORD */
-
-/* system call handler macro */
-#define SYSCALL(INST)	sys_syscall(&regs, mem_access, mem, INST, TRUE)
+  /* dump interval stats? */
+  SIM_STATS_CHECK();
+}
+
+#define EXEC_ON_BRANCH(DEC, TPC)	bpred_branch((DEC), (TPC))
+#define EXEC_ON_INST(DEC, ADDR, IS_WRITE)	bpred_inst(DEC)
+#define EXEC_STOP()		(max_insts && sim_num_insn >= max_insts)
+
+#include "exec.h"
 
 /* start simulation, program loaded, processor precise state initialized */
 void
 sim_main(void)
 {
-  md_inst_t inst;
-  register md_addr_t addr, target_PC = 0;
-  enum md_opcode op;
-  register int is_write;
-  int stack_idx;
-  enum md_fault_type fault;
-
   fprintf(stderr, "sim: ** starting functional simulation w/ predictors **\n");
 
   /* set up initial default next PC */
@@ -457,108 +749,6 @@ sim_main(void)
     dlite_main(regs.regs_PC - sizeof(md_inst_t), regs.regs_PC,
 	       sim_num_insn, &regs, mem);
 
-  while (TRUE)
-    {
-      /* maintain $r0 semantics */
-      regs.regs_R[MD_REG_ZERO] = 0;
-#ifdef TARGET_ALPHA
-      regs.regs_F.d[MD_REG_ZERO] = 0.0;
-#endif /* TARGET_ALPHA */
-
-      /* get the next instruction to execute */
-      MD_FETCH_INST(inst, mem, regs.regs_PC);
-
-      /* keep an instruction count */
-      sim_num_insn++;
-
-      /* set default reference address and access mode */
-      addr = 0; is_write = FALSE;
-
-      /* set default fault - none */
-      fault = md_fault_none;
-
-      /* decode the instruction */
-      MD_SET_OPCODE(op, inst);
-
-      /* execute the instruction */
-      switch (op)
-	{
-#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
-	case OP:							\
-          SYMCAT(OP,_IMPL);						\
-          break;
-#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
-        case OP:							\
-          panic("attempted to execute a linking opcode");
-#define CONNECT(OP)
-#define DECLARE_FAULT(FAULT)						\
-	  { fault = (FAULT); break; }
-#include "machine.def"
-	default:
-	  panic("attempted to execute a bogus opcode");
-      }
-
-      if (fault != md_fault_none)
-	fatal("fault (%d) detected @ 0x%08p", fault, regs.regs_PC);
-
-      if (MD_OP_FLAGS(op) & F_MEM)
-	{
-	  sim_num_refs++;
-	  if (MD_OP_FLAGS(op) & F_STORE)
-	    is_write = TRUE;
-	}
-
-      if (MD_OP_FLAGS(op) & F_CTRL)
-	{
-	  md_addr_t pred_PC;
-	  struct bpred_update_t update_rec;
-
-	  sim_num_branches++;
-
-	  if (pred)
-	    {
-	      /* get the next predicted fetch address */
-	      pred_PC = bpred_lookup(pred,
-				     /* branch addr */regs.regs_PC,
-				     /* target */target_PC,
-				     /* inst opcode */op,
-				     /* call? */MD_IS_CALL(op),
-				     /* return? */MD_IS_RETURN(op),
-				     /* stash an update ptr */&update_rec,
-				     /* stash return stack ptr */&stack_idx);
-
-	      /* valid address returned from branch predictor? */
-	      if (!pred_PC)
-		{
-		  /* no predicted taken target, attempt not taken target */
-		  pred_PC = regs.regs_PC + sizeof(md_inst_t);
-		}
-
-	      bpred_update(pred,
-			   /* branch addr */regs.regs_PC,
-			   /* resolved branch target */regs.regs_NPC,
-			   /* taken? */regs.regs_NPC != (regs.regs_PC +
-							 sizeof(md_inst_t)),
-			   /* pred taken? */pred_PC != (regs.regs_PC +
-							sizeof(md_inst_t)),
-			   /* correct pred? */pred_PC == regs.regs_NPC,
-			   /* opcode */op,
-			   /* predictor update pointer */&update_rec);
-	    }
-	}
-
-      /* check for DLite debugger entry condition */
-      if (dlite_check_break(regs.regs_NPC,
-			    is_write ? ACCESS_WRITE : ACCESS_READ,
-			    addr, sim_num_insn, sim_num_insn))
-	dlite_main(regs.regs_PC, regs.regs_NPC, sim_num_insn, &regs, mem);
-
-      /* go to the next instruction */
-      regs.regs_PC = regs.regs_NPC;
-      regs.regs_NPC += sizeof(md_inst_t);
-
-      /* finish early? */
-      if (max_insts && sim_num_insn >= max_insts)
-	return;
-    }
+  /* execute until the program exits, or the inst limit is reached */
+  exec_insts(0);
 }
@@ -60,7 +60,12 @@
 #include "machine.h"
 #include "regs.h"
 #include "memory.h"
+#include "predec.h"
 #include "cache.h"
+#include "stackdist.h"
+#include "memtrace.h"
+#include "hier.h"
+#include "sweep.h"
 #include "loader.h"
 #include "syscall.h"
 #include "dlite.h"
@@ -71,7 +76,9 @@
  * generated for a user-selected cache and TLB configuration, which may include
  * up to two levels of instruction and data cache (with any levels unified),
  * and one level of instruction and data TLBs.  No timing information is
- * generated (hence the distinction, "functional" simulator).
+ * generated (hence the distinction, "functional" simulator).  Any number of
+ * further cache hierarchies can be swept in the same run, they are fed by
+ * worker threads from batches of the references of the simulated program.
  */
 
 /* simulated registers */
@@ -80,6 +87,9 @@ static struct regs_t regs;
 /* simulated memory */
 static struct mem_t *mem = NULL;
 
+/* predecoded program text */
+static struct predec_t *pd = NULL;
+
 /* track number of insn and refs */
 static counter_t sim_num_refs = 0;
 
@@ -104,6 +114,31 @@ static struct cache_t *itlb = NULL;
 /* data TLB */
 static struct cache_t *dtlb = NULL;
 
+/* LRU stack distance families, each simulates all associativities of an
+   LRU cache geometry in a single pass */
+#define MAX_SDIST 8
+static struct sdist_t *sdist[MAX_SDIST];
+
+/* reference stream watched by each family, 'i'-inst, 'd'-data, 'u'-both */
+static char sdist_refs[MAX_SDIST];
+
+/* swept cache hierarchies, fed from SWEEP */
+#define MAX_SWEEPS 64
+static struct hier_t sweep_hiers[MAX_SWEEPS];
+static struct sweep_t *sweep = NULL;
+
+/* sweep event, a reference sent to every swept hierarchy */
+struct sweep_ref_t
+{
+  md_addr_t pc;			/* PC of referencing instruction */
+  md_addr_t addr;		/* address referenced */
+  int kind;			/* an enum mtrace_kind_t, or SWEEP_FLUSH */
+  int nbytes;			/* size of reference in bytes */
+};
+
+/* sweep event kind of a data cache flush on a system call */
+#define SWEEP_FLUSH		-1
+
 /* text-based stat profiles */
 #define MAX_PCSTAT_VARS 8
 static struct stat_stat_t *pcstat_stats[MAX_PCSTAT_VARS];
@@ -111,7 +146,8 @@ static counter_t pcstat_lastvals[MAX_PCSTAT_VARS];
 static struct stat_stat_t *pcstat_sdists[MAX_PCSTAT_VARS];
 
 md_addr_t get_PC() {	// return the current program counter (PC)
-   return regs.regs_PC;
+   /* swept hierarchies see the PC of the reference being applied */
+   return hier_cur ? hier_pc : regs.regs_PC;
 }
 
 /* wedge all stat values into a counter_t */
@@ -238,6 +274,45 @@ dtlb_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
   return /* access latency, ignored */1;
 }
 
+/* apply the NEVS references at EVS to swept hierarchy CONFIG */
+static void
+sweep_apply(int config,			/* swept hierarchy index */
+	    void *evs,			/* batch of sweep_ref_t events */
+	    int nevs)			/* number of events in batch */
+{
+  struct hier_t *h = &sweep_hiers[config];
+  struct sweep_ref_t *ev = (struct sweep_ref_t *)evs;
+  int i;
+
+  for (i=0; i<nevs; i++, ev++)
+    {
+      if (ev->kind == SWEEP_FLUSH)
+	hier_flush(h);
+      else
+	hier_access(h, (enum mtrace_kind_t)ev->kind,
+		    ev->pc, ev->addr, ev->nbytes);
+    }
+
+  /* without worker threads this runs on the simulator thread, whose
+     prefetchers must see the simulated PC again */
+  hier_cur = NULL;
+}
+
+/* bring the swept hierarchies up to date before stats are printed */
+static void
+sweep_stats_sync(void)
+{
+  sweep_sync(sweep);
+}
+
+/* queue reference KIND of NBYTES at ADDR for the swept hierarchies */
+#define SWEEP_REF(KIND, ADDR, NBYTES)					\
+  do {									\
+    struct sweep_ref_t *ev = SWEEP_EVENT(sweep, struct sweep_ref_t);	\
+    ev->pc = regs.regs_PC; ev->addr = (ADDR);				\
+    ev->kind = (KIND); ev->nbytes = (NBYTES);				\
+  } while (0)
+
 /* cache/TLB options */
 static char *cache_dl1_opt /* = "none" */;
 static char *cache_dl2_opt /* = "none" */;
@@ -248,6 +323,21 @@ static char *dtlb_opt /* = "none" */;
 static int flush_on_syscalls /* = FALSE */;
 static int compress_icache_addrs /* = FALSE */;
 
+/* memory reference trace output file name */
+static char *mtrace_fname /* = NULL */;
+
+/* memory reference trace, written when MTRACE_FNAME is given */
+static struct mtrace_t *mtrace = NULL;
+
+/* LRU stack distance family options */
+static int sdist_nelt = 0;
+static char *sdist_opts[MAX_SDIST];
+
+/* swept cache hierarchy options */
+static int sweep_nelt = 0;
+static char *sweep_opts[MAX_SWEEPS];
+static int sweep_threads;
+
 /* text-based stat profiles */
 static int pcstat_nelt = 0;
 static char *pcstat_vars[MAX_PCSTAT_VARS];
@@ -330,11 +420,60 @@ sim_reg_options(struct opt_odb_t *odb)	/* options database */
 		 &dtlb_opt, "dtlb:32:4096:4:l:0", /* print */TRUE, NULL);
   opt_reg_flag(odb, "-flush", "flush caches on system calls",
 	       &flush_on_syscalls, /* default */FALSE, /* print */TRUE, NULL);
+  opt_reg_string_list(odb, "-cache:sdist",
+		      "LRU stack distance family config(s), i.e., <config>",
+		      sdist_opts, MAX_SDIST, &sdist_nelt, NULL,
+		      /* print */TRUE, /* format */NULL, /* accrue */TRUE);
+  opt_reg_note(odb,
+"  The stack distance parameter <config> has the following format:\n"
+"\n"
+"    <name>:<nsets>:<bsize>:<max_assoc>:<refs>\n"
+"\n"
+"    <name>      - name of the cache family being defined\n"
+"    <nsets>     - number of sets in every cache of the family\n"
+"    <bsize>     - block size of every cache of the family\n"
+"    <max_assoc> - largest associativity simulated\n"
+"    <refs>      - references seen, 'd'-data, 'i'-inst, 'u'-unified\n"
+"\n"
+"  A stack distance family simulates every LRU cache with the given sets\n"
+"  and block size, from direct-mapped up to <max_assoc> ways, in one pass,\n"
+"  and reports hits and misses for each power-of-two associativity.  Use\n"
+"  one family per <nsets>:<bsize> pair to cover a grid of cache geometries.\n"
+"\n"
+"    Examples:   -cache:sdist dl1s:256:32:16:d\n"
+"                -cache:sdist ulfa:1:64:65536:u\n"
+	       );
   opt_reg_flag(odb, "-cache:icompress",
 	       "convert 64-bit inst addresses to 32-bit inst equivalents",
 	       &compress_icache_addrs, /* default */FALSE,
 	       /* print */TRUE, NULL);
 
+  opt_reg_string_list(odb, "-sweep",
+		      "swept cache hierarchy config(s), i.e., "
+		      "<level>=<config>,...",
+		      sweep_opts, MAX_SWEEPS, &sweep_nelt, /* default */NULL,
+		      /* print */TRUE, /* format */NULL, /* accrue */TRUE);
+  opt_reg_note(odb,
+"  Each use of `-sweep' simulates one more cache hierarchy in the same run,\n"
+"  given as for sim-replay's `-hier' option, i.e., a comma separated list\n"
+"  of <level>=<config> pairs, where <level> is one of il1, il2, dl1, dl2,\n"
+"  itlb or dtlb, il1 may be `dl1' or `dl2', and il2 `dl2', to unify\n"
+"  levels.  Levels not listed are not simulated.  The caches of swept\n"
+"  hierarchy <n> are reported with the prefix `s<n>.', e.g., s0.dl1.misses.\n"
+"  Swept hierarchies see the same references as the caches above, with\n"
+"  -flush and -cache:icompress applied, and are updated in batches by\n"
+"  worker threads.\n"
+"\n"
+"    Example:   -sweep dl1=dl1:512:32:2:l:0 -sweep dl1=dl1:1024:32:2:l:0\n"
+	       );
+  opt_reg_int(odb, "-sweep:threads",
+	      "number of sweep worker threads (0 for one per hierarchy)",
+	      &sweep_threads, /* default */0, /* print */TRUE, /* format */NULL);
+
+  opt_reg_string(odb, "-trace:mem",
+		 "write memory reference trace to file (for sim-replay)",
+		 &mtrace_fname, /* default */NULL, /* print */TRUE, NULL);
+
   opt_reg_string_list(odb, "-pcstat",
 		      "profile stat(s) against text addr's (mult uses ok)",
 		      pcstat_vars, MAX_PCSTAT_VARS, &pcstat_nelt, NULL,
@@ -348,7 +487,7 @@ sim_check_options(struct opt_odb_t *odb,	/* options database */
 		  int argc, char **argv)	/* command line arguments */
 {
   char name[128], c;
-  int nsets, bsize, assoc;
+  int i, nsets, bsize, assoc;
   int prefetch_type;			/* this specifies the type of the prefetcher */
 
   /* use a level 1 D-cache? */
@@ -447,6 +586,40 @@ sim_check_options(struct opt_odb_t *odb,	/* options database */
 	}
     }
 
+  /* LRU stack distance families */
+  for (i=0; i<sdist_nelt; i++)
+    {
+      if (sscanf(sdist_opts[i], "%[^:]:%d:%d:%d:%c",
+		 name, &nsets, &bsize, &assoc, &c) != 5)
+	fatal("bad stack distance parms: "
+	      "<name>:<nsets>:<bsize>:<max_assoc>:<refs>");
+      if (c != 'd' && c != 'i' && c != 'u')
+	fatal("bad stack distance reference stream `%c', use 'd', 'i' or 'u'",
+	      c);
+      sdist[i] = sdist_create(name, nsets, bsize, assoc);
+      sdist_refs[i] = c;
+    }
+
+  /* swept cache hierarchies */
+  if (sweep_threads < 0)
+    fatal("number of sweep worker threads must be non-negative");
+  for (i=0; i<sweep_nelt; i++)
+    {
+      sprintf(name, "s%d.", i);
+      hier_create(&sweep_hiers[i], name, sweep_opts[i]);
+    }
+
+  if (sweep_nelt)
+    {
+      sweep = sweep_create(sweep_nelt, sizeof(struct sweep_ref_t),
+			   sweep_apply, sweep_threads);
+      sim_stats_hook = sweep_stats_sync;
+    }
+
+  /* capture a memory reference trace? */
+  if (mtrace_fname)
+    mtrace = mtrace_open(mtrace_fname, "w");
+
   /* use an I-TLB? */
   if (!mystricmp(itlb_opt, "none"))
     itlb = NULL;
@@ -513,6 +686,9 @@ sim_load_prog(char *fname,		/* program to load */
   /* load program text and data, set up environment, memory, and regs */
   ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
 
+  /* predecode the program text as it is executed */
+  pd = predec_create(mem, ld_text_base, ld_text_size);
+
   /* initialize the DLite debugger */
   dlite_init(md_reg_obj, dlite_mem_obj, cache_mstate_obj);
 }
@@ -521,7 +697,12 @@ sim_load_prog(char *fname,		/* program to load */
 void
 sim_aux_config(FILE *stream)		/* output stream */
 {
-  /* nada */
+  int i;
+
+  for (i=0; i<sdist_nelt; i++)
+    sdist_config(sdist[i], stream);
+  for (i=0; i<sweep_nelt; i++)
+    fprintf(stream, "sweep: s%d: %s\n", i, sweep_opts[i]);
 }
 
 /* register simulator-specific statistics */
@@ -559,6 +740,12 @@ sim_reg_stats(struct stat_sdb_t *sdb)	/* stats database */
     cache_reg_stats(itlb, sdb);
   if (dtlb)
     cache_reg_stats(dtlb, sdb);
+  for (i=0; i<sdist_nelt; i++)
+    sdist_reg_stats(sdist[i], sdb);
+  for (i=0; i<sweep_nelt; i++)
+    hier_reg_stats(&sweep_hiers[i], sdb);
+  if (sweep)
+    sweep_reg_stats(sweep, sdb);
 
   for (i=0; i<pcstat_nelt; i++)
     {
@@ -592,6 +779,7 @@ sim_reg_stats(struct stat_sdb_t *sdb)	/* stats database */
     }
   ld_reg_stats(sdb);
   mem_reg_stats(mem, sdb);
+  predec_reg_stats(pd, sdb);
 }
 
 /* dump simulator-specific auxiliary simulator statistics */
@@ -605,113 +793,74 @@ sim_aux_stats(FILE *stream)		/* output stream */
 void
 sim_uninit(void)
 {
-  /* nada */
+  if (sweep)
+    {
+      sim_stats_hook = NULL;
+      sweep_destroy(sweep);
+      sweep = NULL;
+    }
+  if (mtrace)
+    {
+      mtrace_close(mtrace);
+      mtrace = NULL;
+    }
 }
 
 /*
  * configure the execution engine
  */
 
-/*
- * precise architected register accessors
- */
+/* feed a reference to every stack distance family watching reference
+   stream REFS, unified families see both streams, always returns zero */
+static int
+sdist_ref(int refs,			/* reference stream, 'i' or 'd' */
+	  md_addr_t addr)		/* address of access */
+{
+  int i;
+
+  for (i=0; i<sdist_nelt; i++)
+    {
+      if (sdist_refs[i] == refs || sdist_refs[i] == 'u')
+	sdist_access(sdist[i], addr);
+    }
+  return 0;
+}
+
+/* send data reference CMD of NBYTES at ADDR to the trace, stack
+   distance families and data caches, always returns zero */
+static INLINE int
+data_ref(enum mem_cmd cmd,		/* Read or Write */
+	 md_addr_t addr,		/* data address referenced */
+	 int nbytes)			/* size of reference in bytes */
+{
+  if (mtrace)
+    mtrace_write(mtrace, cmd == Write ? mt_write : mt_read,
+		 regs.regs_PC, addr, nbytes);
+  if (sdist_nelt)
+    sdist_ref('d', addr);
+  if (sweep)
+    SWEEP_REF(cmd == Write ? mt_write : mt_read, addr, nbytes);
+  if (dtlb)
+    cache_access(dtlb, cmd, addr, NULL, nbytes, 0, NULL, NULL, 0);
+  if (cache_dl1)
+    cache_access(cache_dl1, cmd, addr, NULL, nbytes, 0, NULL, NULL, 0);
+  return 0;
+}
 
-/* next program counter */
-#define SET_NPC(EXPR)		(regs.regs_NPC = (EXPR))
-
-/* current program counter */
-#define CPC			(regs.regs_PC)
-
-/* general purpose registers */
-#define GPR(N)			(regs.regs_R[N])
-#define SET_GPR(N,EXPR)		(regs.regs_R[N] = (EXPR))
-
-#if defined(TARGET_PISA)
-
-/* floating point registers, L->word, F->single-prec, D->double-prec */
-#define FPR_L(N)		(regs.regs_F.l[(N)])
-#define SET_FPR_L(N,EXPR)	(regs.regs_F.l[(N)] = (EXPR))
-#define FPR_F(N)		(regs.regs_F.f[(N)])
-#define SET_FPR_F(N,EXPR)	(regs.regs_F.f[(N)] = (EXPR))
-#define FPR_D(N)		(regs.regs_F.d[(N) >> 1])
-#define SET_FPR_D(N,EXPR)	(regs.regs_F.d[(N) >> 1] = (EXPR))
-
-/* miscellaneous register accessors */
-#define SET_HI(EXPR)		(regs.regs_C.hi = (EXPR))
-#define HI			(regs.regs_C.hi)
-#define SET_LO(EXPR)		(regs.regs_C.lo = (EXPR))
-#define LO			(regs.regs_C.lo)
-#define FCC			(regs.regs_C.fcc)
-#define SET_FCC(EXPR)		(regs.regs_C.fcc = (EXPR))
-
-#elif defined(TARGET_ALPHA)
-
-/* floating point registers, L->word, F->single-prec, D->double-prec */
-#define FPR_Q(N)		(regs.regs_F.q[N])
-#define SET_FPR_Q(N,EXPR)	(regs.regs_F.q[N] = (EXPR))
-#define FPR(N)			(regs.regs_F.d[N])
-#define SET_FPR(N,EXPR)		(regs.regs_F.d[N] = (EXPR))
-
-/* miscellaneous register accessors */
-#define FPCR			(regs.regs_C.fpcr)
-#define SET_FPCR(EXPR)		(regs.regs_C.fpcr = (EXPR))
-#define UNIQ			(regs.regs_C.uniq)
-#define SET_UNIQ(EXPR)		(regs.regs_C.uniq = (EXPR))
-
-#else
-#error No ISA target defined...
-#endif
-
-/* precise architected memory state accessor macros */
-#define __READ_CACHE(addr, SRC_T)					\
-  ((dtlb								\
-    ? cache_access(dtlb, Read, (addr), NULL,				\
-		   sizeof(SRC_T), 0, NULL, NULL, 0)			\
-    : 0),								\
-   (cache_dl1								\
-    ? cache_access(cache_dl1, Read, (addr), NULL,			\
-		   sizeof(SRC_T), 0, NULL, NULL, 0)			\
-    : 0))
-
-#define READ_BYTE(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, addr = (SRC),				\
-   __READ_CACHE(addr, byte_t), MEM_READ_BYTE(mem, addr))
-#define READ_HALF(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, addr = (SRC),				\
-   __READ_CACHE(addr, half_t), MEM_READ_HALF(mem, addr))
-#define READ_WORD(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, addr = (SRC),				\
-   __READ_CACHE(addr, word_t), MEM_READ_WORD(mem, addr))
-#ifdef HOST_HAS_QWORD
-#define READ_QWORD(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, addr = (SRC),				\
-   __READ_CACHE(addr, qword_t), MEM_READ_QWORD(mem, addr))
-#endif /* HOST_HAS_QWORD */
-
-#define __WRITE_CACHE(addr, DST_T)					\
-  ((dtlb								\
-    ? cache_access(dtlb, Write, (addr), NULL,				\
-		   sizeof(DST_T), 0, NULL, NULL, 0)			\
-    : 0),								\
-   (cache_dl1								\
-    ? cache_access(cache_dl1, Write, (addr), NULL,			\
-		   sizeof(DST_T), 0,  NULL, NULL, 0)			\
-    : 0))
-
-#define WRITE_BYTE(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, addr = (DST),				\
-   __WRITE_CACHE(addr, byte_t), MEM_WRITE_BYTE(mem, addr, (SRC)))
-#define WRITE_HALF(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, addr = (DST),				\
-   __WRITE_CACHE(addr, half_t), MEM_WRITE_HALF(mem, addr, (SRC)))
-#define WRITE_WORD(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, addr = (DST),				\
-   __WRITE_CACHE(addr, word_t), MEM_WRITE_WORD(mem, addr, (SRC)))
-#ifdef HOST_HAS_QWORD
-#define WRITE_QWORD(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, addr = (DST),				\
-   __WRITE_CACHE(addr, qword_t), MEM_WRITE_QWORD(mem, addr, (SRC)))
-#endif /* HOST_HAS_QWORD */
+/* flush the data caches and data TLB, and those of the swept
+   hierarchies */
+static void
+data_flush(void)
+{
+  if (dtlb)
+    cache_flush(dtlb, 0);
+  if (cache_dl1)
+    cache_flush(cache_dl1, 0);
+  if (cache_dl2)
+    cache_flush(cache_dl2, 0);
+  if (sweep)
+    SWEEP_REF(SWEEP_FLUSH, 0, 0);
+}
 
 /* system call memory access function */
 enum md_fault_type
@@ -721,33 +870,77 @@ dcache_access_fn(struct mem_t *mem,	/* memory space to access */
 		 void *p,		/* data input/output buffer */
 		 int nbytes)		/* number of bytes to access */
 {
-  if (dtlb)
-    cache_access(dtlb, cmd, addr, NULL, nbytes, 0, NULL, NULL, 0);
-  if (cache_dl1)
-    cache_access(cache_dl1, cmd, addr, NULL, nbytes, 0, NULL, NULL, 0);
+  data_ref(cmd, addr, nbytes);
   return mem_access(mem, cmd, addr, p, nbytes);
 }
 
-/* system call handler macro */
-#define SYSCALL(INST)							\
+/* send the fetch of the inst at PC to the trace, stack distance families
+   and instruction caches */
+static INLINE void
+inst_ref(md_addr_t PC)			/* address of fetched inst */
+{
+  if (mtrace)
+    mtrace_write(mtrace, mt_ifetch, PC, PC, sizeof(md_inst_t));
+  if (sdist_nelt)
+    sdist_ref('i', IACOMPRESS(PC));
+  if (sweep)
+    SWEEP_REF(mt_ifetch, IACOMPRESS(PC), ISCOMPRESS(sizeof(md_inst_t)));
+  if (itlb)
+    cache_access(itlb, Read, IACOMPRESS(PC),
+		 NULL, ISCOMPRESS(sizeof(md_inst_t)), 0, NULL, NULL, 0);
+  if (cache_il1)
+    cache_access(cache_il1, Read, IACOMPRESS(PC),
+		 NULL, ISCOMPRESS(sizeof(md_inst_t)), 0, NULL, NULL, 0);
+}
+
+/* count each executed inst and update any stats tracked by PC */
+static INLINE void
+cache_inst(struct predec_inst_t *dec)	/* executed inst */
+{
+  int i;
+
+  if (dec->flags & F_MEM)
+    sim_num_refs++;
+
+  /* update any stats tracked by PC */
+  for (i=0; i < pcstat_nelt; i++)
+    {
+      counter_t newval;
+      int delta;
+
+      /* check if any tracked stats changed */
+      newval = STATVAL(pcstat_stats[i]);
+      delta = newval - pcstat_lastvals[i];
+      if (delta != 0)
+	{
+	  stat_add_samples(pcstat_sdists[i], regs.regs_PC, delta);
+	  pcstat_lastvals[i] = newval;
+	}
+    }
+
+  /* dump interval stats? */
+  SIM_STATS_CHECK();
+}
+
+#define EXEC_ON_FETCH(PC)		inst_ref(PC)
+#define EXEC_ON_MEM(CMD, ADDR, NBYTES)	data_ref((CMD), (ADDR), (NBYTES))
+#define EXEC_ON_INST(DEC, ADDR, IS_WRITE)	cache_inst(DEC)
+#define EXEC_STOP()		(max_insts && sim_num_insn >= max_insts)
+
+/* system call handler, caches are flushed on system calls if requested,
+   otherwise the system call's data references are sent to the caches */
+#define EXEC_ON_SYSCALL(INST)						\
   (flush_on_syscalls							\
-   ? ((dtlb ? cache_flush(dtlb, 0) : 0),				\
-      (cache_dl1 ? cache_flush(cache_dl1, 0) : 0),			\
-      (cache_dl2 ? cache_flush(cache_dl2, 0) : 0),			\
+   ? (data_flush(),							\
       sys_syscall(&regs, mem_access, mem, INST, TRUE))			\
    : sys_syscall(&regs, dcache_access_fn, mem, INST, TRUE))
 
+#include "exec.h"
+
 /* start simulation, program loaded, processor precise state initialized */
 void
 sim_main(void)
 {
-  int i;
-  md_inst_t inst;
-  register md_addr_t addr;
-  enum md_opcode op;
-  register int is_write;
-  enum md_fault_type fault;
- 
   fprintf(stderr, "sim: ** starting functional simulation w/ caches **\n");
 
   /* set up initial default next PC */
@@ -758,92 +951,6 @@ sim_main(void)
     dlite_main(regs.regs_PC - sizeof(md_inst_t), regs.regs_PC,
 	       sim_num_insn, &regs, mem);
 
-  while (TRUE)
-    {
-      /* maintain $r0 semantics */
-      regs.regs_R[MD_REG_ZERO] = 0;
-#ifdef TARGET_ALPHA
-      regs.regs_F.d[MD_REG_ZERO] = 0.0;
-#endif /* TARGET_ALPHA */
-
-      /* get the next instruction to execute */
-      if (itlb)
-	cache_access(itlb, Read, IACOMPRESS(regs.regs_PC),
-		     NULL, ISCOMPRESS(sizeof(md_inst_t)), 0, NULL, NULL, 0);
-      if (cache_il1)
-	cache_access(cache_il1, Read, IACOMPRESS(regs.regs_PC),
-		     NULL, ISCOMPRESS(sizeof(md_inst_t)), 0, NULL, NULL, 0);
-      MD_FETCH_INST(inst, mem, regs.regs_PC);
-
-      /* keep an instruction count */
-      sim_num_insn++;
-
-      /* set default reference address and access mode */
-      addr = 0; is_write = FALSE;
-
-      /* set default fault - none */
-      fault = md_fault_none;
-
-      /* decode the instruction */
-      MD_SET_OPCODE(op, inst);
-
-      /* execute the instruction */
-      switch (op)
-	{
-#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
-	case OP:							\
-          SYMCAT(OP,_IMPL);						\
-          break;
-#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
-        case OP:							\
-          panic("attempted to execute a linking opcode");
-#define CONNECT(OP)
-#define DECLARE_FAULT(FAULT)						\
-	  { fault = (FAULT); break; }
-#include "machine.def"
-	default:
-          panic("attempted to execute a bogus opcode");
-	}
-
-      if (fault != md_fault_none)
-	fatal("fault (%d) detected @ 0x%08p", fault, regs.regs_PC);
-
-      if (MD_OP_FLAGS(op) & F_MEM)
-	{
-	  sim_num_refs++;
-	  if (MD_OP_FLAGS(op) & F_STORE)
-	    is_write = TRUE;
-	}
-
-      /* update any stats tracked by PC */
-      for (i=0; i < pcstat_nelt; i++)
-	{
-	  counter_t newval;
-	  int delta;
-
-	  /* check if any tracked stats changed */
-	  newval = STATVAL(pcstat_stats[i]);
-	  delta = newval - pcstat_lastvals[i];
-	  if (delta != 0)
-	    {
-	      stat_add_samples(pcstat_sdists[i], regs.regs_PC, delta);
-	      pcstat_lastvals[i] = newval;
-	    }
-
-	}
-
-      /* check for DLite debugger entry condition */
-      if (dlite_check_break(regs.regs_NPC,
-			    is_write ? ACCESS_WRITE : ACCESS_READ,
-			    addr, sim_num_insn, sim_num_insn))
-	dlite_main(regs.regs_PC, regs.regs_NPC, sim_num_insn, &regs, mem);
-
-      /* go to the next instruction */
-      regs.regs_PC = regs.regs_NPC;
-      regs.regs_NPC += sizeof(md_inst_t);
-
-      /* finish early? */
-      if (max_insts && sim_num_insn >= max_insts)
-	return;
-    }
+  /* execute until the program exits, or the inst limit is reached */
+  exec_insts(0);
 }
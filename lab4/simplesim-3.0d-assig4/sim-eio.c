@@ -96,6 +96,9 @@ static int fastfwding = FALSE;
 static char *trace_fname;
 static FILE *trace_fd = NULL;
 
+/* write EIO traces and checkpoints in the original text (EXO) format */
+static int eio_text;
+
 /* checkpoint filename and file descriptor */
 static enum { no_chkpt, one_shot_chkpt, periodic_chkpt } chkpt_kind = no_chkpt;
 static char *chkpt_fname;
@@ -115,6 +118,18 @@ static char *chkpt_opts[2];
 static int per_chkpt_nelt = 0;
 static char *per_chkpt_opts[2];
 
+/* periodic checkpoints are dumped this many insts before the start of
+   each interval, so the timing simulator can warm up into the interval */
+static int per_chkpt_warmup;
+
+/* SimPoint file, if specified only the listed intervals are dumped */
+static char *simpoints_fname;
+
+/* sorted interval numbers read from the SimPoint file */
+static int *simpoints = NULL;
+static int num_simpoints = 0;
+static int next_simpoint = 0;
+
 
 /* register simulator-specific options */
 void
@@ -145,6 +160,10 @@ sim_reg_options(struct opt_odb_t *odb)
 		 &trace_fname, /* default */NULL,
 		 /* print */TRUE, NULL);
 
+  opt_reg_flag(odb, "-trace:text",
+	       "write EIO traces and checkpoints as text instead of binary",
+	       &eio_text, /* default */FALSE, /* print */TRUE, NULL);
+
   opt_reg_string_list(odb, "-perdump",
 		      "periodic checkpoint every n instructions: "
 		      "<base fname> <interval>",
@@ -157,6 +176,16 @@ sim_reg_options(struct opt_odb_t *odb)
 		      chkpt_opts, /* sz */2, &chkpt_nelt, /* default */NULL,
 		      /* !print */FALSE, /* format */NULL, /* !accrue */FALSE);
 
+  opt_reg_int(odb, "-perdump:warmup",
+	      "periodic checkpoints are taken this many insts before intervals",
+	      &per_chkpt_warmup, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+
+  opt_reg_string(odb, "-simpoints",
+		 "SimPoint file selecting the periodic checkpoints to dump",
+		 &simpoints_fname, /* default */NULL,
+		 /* print */TRUE, NULL);
+
   opt_reg_note(odb,
 "  Checkpoint range triggers are formatted as follows:\n"
 "\n"
@@ -174,6 +203,87 @@ sim_reg_options(struct opt_odb_t *odb)
 "                -ptrace BLAH.trc :1500\n"
 "                -ptrace UXXE.trc :\n"
 	       );
+
+  opt_reg_note(odb,
+"  Periodic checkpoint <n> of the `-perdump' base file name (a printf-style\n"
+"  format) is taken `-perdump:warmup' insts before the start of interval\n"
+"  <n>, i.e., inst <n>*<interval>, so that `sim-outorder -chkpt <fname>\n"
+"  -warmup <warmup> -max:inst <interval>' simulates exactly interval <n>.\n"
+"  Interval 0 has no checkpoint, it starts at the program entry.  If a\n"
+"  SimPoint file is given with `-simpoints', only the intervals it lists\n"
+"  (one `<interval> <cluster>' pair per line) are checkpointed.\n"
+"\n"
+"    Example:   -perdump foo.%d.chk 10000000 -perdump:warmup 100000\n"
+"               -simpoints foo.simpts\n"
+	       );
+}
+
+/* SimPoint interval order */
+static int
+simpoint_cmp(const void *a, const void *b)
+{
+  return *(const int *)a - *(const int *)b;
+}
+
+/* read the interval numbers of SimPoint file FNAME, sorted */
+static void
+read_simpoints(char *fname)		/* SimPoint file name */
+{
+  FILE *fd;
+  int interval, cluster, size = 16;
+
+  fd = fopen(fname, "r");
+  if (!fd)
+    fatal("cannot open SimPoint file `%s'", fname);
+
+  simpoints = (int *)calloc(size, sizeof(int));
+  if (!simpoints)
+    fatal("out of virtual memory");
+
+  while (fscanf(fd, "%d %d", &interval, &cluster) == 2)
+    {
+      if (interval < 0)
+	fatal("bad interval `%d' in SimPoint file `%s'", interval, fname);
+
+      if (num_simpoints == size)
+	{
+	  size *= 2;
+	  simpoints = (int *)realloc(simpoints, size * sizeof(int));
+	  if (!simpoints)
+	    fatal("out of virtual memory");
+	}
+      simpoints[num_simpoints++] = interval;
+    }
+  if (!feof(fd))
+    fatal("cannot parse SimPoint file `%s', use: <interval> <cluster>", fname);
+  fclose(fd);
+
+  qsort(simpoints, num_simpoints, sizeof(int), simpoint_cmp);
+}
+
+/* set up the next periodic checkpoint after CHKPT_NUM, or turn periodic
+   checkpointing off if there are no more to dump */
+static void
+next_per_chkpt(void)
+{
+  if (simpoints_fname != NULL)
+    {
+      /* skip to the next interval selected by SimPoint, interval 0 starts at
+	 the program entry and needs no checkpoint */
+      while (next_simpoint < num_simpoints
+	     && simpoints[next_simpoint] <= (int)chkpt_num)
+	next_simpoint++;
+      if (next_simpoint == num_simpoints)
+	{
+	  chkpt_kind = no_chkpt;
+	  return;
+	}
+      chkpt_num = simpoints[next_simpoint];
+    }
+  else
+    chkpt_num++;
+
+  next_chkpt_cycle = chkpt_num * per_chkpt_interval - per_chkpt_warmup;
 }
 
 /* check simulator-specific option values */
@@ -182,6 +292,12 @@ sim_check_options(struct opt_odb_t *odb, int argc, char **argv)
 {
   if (fastfwd_count < 0 || fastfwd_count >= 2147483647)
     fatal("bad fast forward count: %d", fastfwd_count);
+
+  if (per_chkpt_warmup < 0)
+    fatal("bad periodic checkpoint warm-up: %d", per_chkpt_warmup);
+
+  if (simpoints_fname != NULL && per_chkpt_nelt != 2)
+    fatal("`-simpoints' selects `-perdump' checkpoints, specify both");
 }
 
 /* register simulator-specific statistics */
@@ -251,7 +367,7 @@ sim_load_prog(char *fname,		/* program to load */
 
       /* create the checkpoint file */
       chkpt_fname = chkpt_opts[0];
-      chkpt_fd = eio_create(chkpt_fname);
+      chkpt_fd = eio_create(chkpt_fname, !eio_text);
 
       /* indicate checkpointing is now active... */
       chkpt_kind = one_shot_chkpt;
@@ -267,10 +383,16 @@ sim_load_prog(char *fname,		/* program to load */
 	fatal("can't parse periodic checkpoint interval '%s'",
 	      per_chkpt_opts[1]);
 
+      if (per_chkpt_interval <= per_chkpt_warmup)
+	fatal("periodic checkpoint warm-up must be shorter than the interval");
+
+      if (simpoints_fname != NULL)
+	read_simpoints(simpoints_fname);
+
       /* indicate checkpointing is now active... */
       chkpt_kind = periodic_chkpt;
-      chkpt_num = 1;
-      next_chkpt_cycle = per_chkpt_interval;
+      chkpt_num = 0;
+      next_per_chkpt();
     }
 
   if (trace_fname != NULL)
@@ -279,7 +401,7 @@ sim_load_prog(char *fname,		/* program to load */
 	      trace_fname);
 
       /* create an EIO trace file */
-      trace_fd = eio_create(trace_fname);
+      trace_fd = eio_create(trace_fname, !eio_text);
     }
 
   /* initialize the DLite debugger */
@@ -527,7 +649,7 @@ sim_main(void)
 
 	  /* 'chkpt_fname' should be a printf format string */
 	  sprintf(this_chkpt_fname, chkpt_fname, chkpt_num);
-	  chkpt_fd = eio_create(this_chkpt_fname);
+	  chkpt_fd = eio_create(this_chkpt_fname, !eio_text);
 
 	  myfprintf(stderr, "sim: writing checkpoint file `%s' @ inst %n...\n",
 		  this_chkpt_fname, sim_num_insn);
@@ -538,8 +660,7 @@ sim_main(void)
 	  /* close the checkpoint file */
 	  eio_close(chkpt_fd);
 
-	  chkpt_num++;
-	  next_chkpt_cycle += per_chkpt_interval;
+	  next_per_chkpt();
 	}
 
       /* get the next instruction to execute */
@@ -595,6 +716,9 @@ sim_main(void)
       regs.regs_PC = regs.regs_NPC;
       regs.regs_NPC += sizeof(md_inst_t);
 
+      /* dump interval stats? */
+      SIM_STATS_CHECK();
+
       /* finish early? */
       if (max_insts && sim_num_insn >= max_insts)
 	return;
@@ -71,11 +71,24 @@
 
 #ifdef __GNUC__
 /* faster dispatch mechanism, requires GNU GCC C extensions, CAVEAT: some
-   versions of GNU GCC core dump when optimizing the jump table code with
-   optimization levels higher than -O1 */
-/* #define USE_JUMP_TABLE */
+   (old) versions of GNU GCC core dump when optimizing the jump table code
+   with optimization levels higher than -O1, define NO_JUMP_TABLE to use
+   the switch-based main loop */
+#ifndef NO_JUMP_TABLE
+#define USE_JUMP_TABLE
+#endif /* !NO_JUMP_TABLE */
 #endif /* __GNUC__ */
 
+/* the basic block translation cache: straight-line runs of instructions
+   (ending at a control or trap instruction) are fetched and decoded once
+   into an array of micro-ops, which are then executed back-to-back without
+   any per-instruction fetch or decode; blocks are chained to their most
+   recent successors, so most block transitions avoid the hash lookup */
+#define BB_MAX_INSTS		64	/* max insts in a translated block */
+#define BB_HASH_SIZE		8192	/* block hash table size, power of 2 */
+#define BB_MAX_BLOCKS		32768	/* max translated blocks */
+#define BB_MAX_UOPS		262144	/* max translated insts (and sentinels) */
+
 #include "host.h"
 #include "misc.h"
 #include "machine.h"
@@ -92,10 +105,44 @@ static struct regs_t regs;
 /* simulated memory */
 static struct mem_t *mem = NULL;
 
-#ifdef TARGET_ALPHA
-/* predecoded text memory */
-static struct mem_t *dec = NULL;
-#endif
+/* translated instruction, i.e., a basic block micro-op */
+struct bb_uop_t {
+#ifdef USE_JUMP_TABLE
+  void *impl;				/* instruction implementation */
+#endif /* USE_JUMP_TABLE */
+  enum md_opcode op;			/* decoded opcode */
+  md_inst_t inst;			/* instruction bits */
+};
+
+/* translated basic block */
+struct bb_t {
+  struct bb_t *next;			/* next block in hash bucket chain */
+  md_addr_t PC;				/* address of first inst */
+  int ninsts;				/* number of insts in block */
+  struct bb_uop_t *uops;		/* translated insts, plus a sentinel */
+  md_addr_t succ_PC[2];			/* fall-through, other successor */
+  struct bb_t *succ[2];			/* chained successor blocks */
+};
+
+/* basic block translation cache */
+static struct bb_t *bb_hash[BB_HASH_SIZE];	/* hashed by block PC */
+static struct bb_t *bb_blocks = NULL;		/* block storage */
+static int bb_nblocks = 0;			/* blocks allocated */
+static struct bb_uop_t *bb_uops = NULL;		/* micro-op storage */
+static int bb_nuops = 0;			/* micro-ops allocated */
+
+#ifdef USE_JUMP_TABLE
+/* instruction implementations, indexed by opcode, and the implementation of
+   the block sentinel micro-op, both are set up by sim_main() */
+static void **bb_jump = NULL;
+static void *bb_end = NULL;
+#endif /* USE_JUMP_TABLE */
+
+/* basic block translation cache stats */
+static counter_t bb_translations = 0;	/* total blocks translated */
+static counter_t bb_translated_insts = 0;/* total insts translated */
+static counter_t bb_flushes = 0;	/* total cache flushes */
+static counter_t bb_invalidations = 0;	/* total flushes due to text writes */
 
 /* register simulator-specific options */
 void
@@ -137,11 +184,23 @@ sim_reg_stats(struct stat_sdb_t *sdb)
 		   "simulation speed (in insts/sec)",
 		   "sim_num_insn / sim_elapsed_time", NULL);
 #endif /* !NO_INSN_COUNT */
+  stat_reg_counter(sdb, "bb.translations",
+		   "total number of basic blocks translated",
+		   &bb_translations, 0, NULL);
+  stat_reg_counter(sdb, "bb.translated_insts",
+		   "total number of instructions translated",
+		   &bb_translated_insts, 0, NULL);
+  stat_reg_formula(sdb, "bb.avg_size",
+		   "average translated basic block size (in insts)",
+		   "bb.translated_insts / bb.translations", NULL);
+  stat_reg_counter(sdb, "bb.flushes",
+		   "total number of translation cache flushes",
+		   &bb_flushes, 0, NULL);
+  stat_reg_counter(sdb, "bb.invalidations",
+		   "total number of translation invalidations by text writes",
+		   &bb_invalidations, 0, NULL);
   ld_reg_stats(sdb);
   mem_reg_stats(mem, sdb);
-#ifdef TARGET_ALPHA
-  mem_reg_stats(dec, sdb);
-#endif
 }
 
 /* initialize the simulator */
@@ -156,6 +215,143 @@ sim_init(void)
   mem_init(mem);
 }
 
+/* flush the basic block translation cache */
+static void
+bb_flush(void)
+{
+  int i;
+
+  for (i=0; i < BB_HASH_SIZE; i++)
+    bb_hash[i] = NULL;
+  bb_nblocks = 0;
+  bb_nuops = 0;
+  bb_flushes++;
+}
+
+/* program text write watch, unlinks all translated blocks so they are
+   translated again, NOTE: the storage of the unlinked blocks is not
+   reclaimed until the next flush, as the writing block is still executing */
+static void
+bb_text_written(void *data,		/* unused */
+		md_addr_t addr,		/* address written */
+		int nbytes)		/* number of bytes written */
+{
+  int i;
+
+  for (i=0; i < BB_HASH_SIZE; i++)
+    bb_hash[i] = NULL;
+  for (i=0; i < bb_nblocks; i++)
+    bb_blocks[i].succ[0] = bb_blocks[i].succ[1] = NULL;
+  bb_invalidations++;
+}
+
+/* translate the basic block at PC */
+static struct bb_t *			/* translated block */
+bb_translate(md_addr_t PC)		/* address of first inst */
+{
+  struct bb_t *bb;
+  struct bb_uop_t *uop;
+  int idx = (PC / sizeof(md_inst_t)) & (BB_HASH_SIZE - 1);
+
+  /* make room for the largest block, if needed */
+  if (bb_nblocks == BB_MAX_BLOCKS
+      || bb_nuops + BB_MAX_INSTS + 1 > BB_MAX_UOPS)
+    bb_flush();
+
+  bb = &bb_blocks[bb_nblocks++];
+  bb->PC = PC;
+  bb->uops = &bb_uops[bb_nuops];
+  bb->succ_PC[0] = bb->succ_PC[1] = 0;
+  bb->succ[0] = bb->succ[1] = NULL;
+
+  /* decode insts up to and including the first control or trap inst */
+  for (bb->ninsts=0; bb->ninsts < BB_MAX_INSTS; )
+    {
+      uop = &bb->uops[bb->ninsts++];
+      MD_FETCH_INST(uop->inst, mem, PC);
+      MD_SET_OPCODE(uop->op, uop->inst);
+#ifdef USE_JUMP_TABLE
+      uop->impl = bb_jump[uop->op];
+#endif /* USE_JUMP_TABLE */
+      PC += sizeof(md_inst_t);
+
+      if (uop->op == OP_NA
+	  || (MD_OP_FLAGS(uop->op) & (F_CTRL|F_TRAP)))
+	break;
+    }
+
+  /* terminate the block with a sentinel micro-op */
+  uop = &bb->uops[bb->ninsts];
+  uop->op = OP_NA;
+  uop->inst = MD_NOP_INST;
+#ifdef USE_JUMP_TABLE
+  uop->impl = bb_end;
+#endif /* USE_JUMP_TABLE */
+  bb_nuops += bb->ninsts + 1;
+
+  /* the fall-through successor is always the first chained successor */
+  bb->succ_PC[0] = PC;
+
+  bb->next = bb_hash[idx];
+  bb_hash[idx] = bb;
+
+  bb_translations++;
+  bb_translated_insts += bb->ninsts;
+
+  return bb;
+}
+
+/* locate the translated basic block at PC, translating it if needed */
+static struct bb_t *			/* translated block */
+bb_lookup(md_addr_t PC)			/* address of first inst */
+{
+  struct bb_t *bb;
+
+  for (bb = bb_hash[(PC / sizeof(md_inst_t)) & (BB_HASH_SIZE - 1)];
+       bb != NULL;
+       bb = bb->next)
+    {
+      if (bb->PC == PC)
+	return bb;
+    }
+  return bb_translate(PC);
+}
+
+/* locate the successor of basic block BB at PC, the slow path of
+   BB_SUCCESSOR(), chains the successor to BB */
+static struct bb_t *			/* translated successor block */
+bb_chain(struct bb_t *bb,		/* executed block */
+	 md_addr_t PC)			/* address of successor */
+{
+  struct bb_t *succ;
+  counter_t flushes = bb_flushes;
+
+  succ = bb_lookup(PC);
+
+  /* chain the successor, unless its translation flushed BB */
+  if (bb_flushes == flushes)
+    {
+      if (PC == bb->succ_PC[0])
+	bb->succ[0] = succ;
+      else
+	{
+	  /* other successor, the most recent one for indirect jumps */
+	  bb->succ_PC[1] = PC;
+	  bb->succ[1] = succ;
+	}
+    }
+  return succ;
+}
+
+/* locate the successor of basic block BB at PC, using the chained
+   successors if possible */
+#define BB_SUCCESSOR(BB, PC)						\
+  ((PC) == (BB)->succ_PC[0] && (BB)->succ[0]				\
+   ? (BB)->succ[0]							\
+   : ((PC) == (BB)->succ_PC[1] && (BB)->succ[1]				\
+      ? (BB)->succ[1]							\
+      : bb_chain((BB), (PC))))
+
 /* load program into simulated state */
 void
 sim_load_prog(char *fname,		/* program to load */
@@ -165,38 +361,14 @@ sim_load_prog(char *fname,		/* program to load */
   /* load program text and data, set up environment, memory, and regs */
   ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
 
-#ifdef TARGET_ALPHA
-  /* pre-decode text segment */
-  {
-    unsigned i, num_insn = (ld_text_size + 3) / 4;
-
-    fprintf(stderr, "** pre-decoding %u insts...", num_insn);
-
-    /* allocate decoded text space */
-    dec = mem_create("dec");
+  /* allocate the basic block translation cache */
+  bb_blocks = (struct bb_t *)calloc(BB_MAX_BLOCKS, sizeof(struct bb_t));
+  bb_uops = (struct bb_uop_t *)calloc(BB_MAX_UOPS, sizeof(struct bb_uop_t));
+  if (!bb_blocks || !bb_uops)
+    fatal("out of virtual memory");
 
-    for (i=0; i < num_insn; i++)
-      {
-	enum md_opcode op;
-	md_inst_t inst;
-	md_addr_t PC;
-
-	/* compute PC */
-	PC = ld_text_base + i * sizeof(md_inst_t);
-
-	/* get instruction from memory */
-	MD_FETCH_INST(inst, mem, PC);
-
-	/* decode the instruction */
-	MD_SET_OPCODE(op, inst);
-
-	/* insert into decoded opcode space */
-	MEM_WRITE_WORD(dec, PC << 1, (word_t)op);
-	MEM_WRITE_WORD(dec, (PC << 1)+sizeof(word_t), inst);
-      }
-    fprintf(stderr, "done\n");
-  }
-#endif /* TARGET_ALPHA */
+  /* translated text is flushed if the program text is written */
+  mem_watch(mem, ld_text_base, ld_text_size, bb_text_written, NULL);
 }
 
 /* print simulator-specific configuration information */
@@ -321,13 +493,14 @@ sim_main(void)
      a main simulator loop, which eliminates one branch from the simulator
      interpreter - crazy, no!?!? */
 
-  /* instruction jump table, this code is GNU GCC specific */
-  static void *op_jump[/* max opcodes */] = {
-    &&opcode_NA, /* NA */
+  /* instruction jump table, this code is GNU GCC specific, the table
+     covers all opcode field values so bogus opcodes reach opcode_NA */
+  static void *op_jump[/* max opcodes */MD_MAX_MASK+1] = {
+    [0 ... MD_MAX_MASK] = &&opcode_NA, /* NA */
 #define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
-    &&opcode_##OP,
+    [OP] = &&opcode_##OP,
 #define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
-    &&opcode_##OP,
+    [OP] = &&opcode_##OP,
 #define CONNECT(OP)
 #include "machine.def"
   };
@@ -336,8 +509,9 @@ sim_main(void)
   /* register allocate instruction buffer */
   register md_inst_t inst;
 
-  /* decoded opcode */
-  register enum md_opcode op;
+  /* executing block and micro-op */
+  register struct bb_t *bb;
+  register struct bb_uop_t *uop;
 
   fprintf(stderr, "sim: ** starting *fast* functional simulation **\n");
 
@@ -347,14 +521,16 @@ sim_main(void)
 
 #ifdef USE_JUMP_TABLE
 
-  regs.regs_NPC = regs.regs_PC;
+  /* translated blocks jump directly to inst implementations */
+  bb_jump = op_jump;
+  bb_end = &&opcode_bb_end;
 
-  /* load instruction */
-  MD_FETCH_INST(inst, mem, regs.regs_NPC);
+  regs.regs_NPC = regs.regs_PC;
 
-  /* jump to instruction implementation */
-  MD_SET_OPCODE(op, inst);
-  goto *op_jump[op];
+  /* jump to the first instruction implementation of the first block */
+  bb = bb_lookup(regs.regs_NPC);
+  uop = bb->uops;
+  goto *uop->impl;
 
 #define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
   opcode_##OP:								\
@@ -371,15 +547,13 @@ sim_main(void)
     /* set up default next PC */					\
     regs.regs_NPC += sizeof(md_inst_t);					\
 									\
-    /* execute the instruction */					\
-    SYMCAT(OP,_IMPL);							\
+    /* execute the instruction, faults break out of the implementation */\
+    inst = uop->inst;							\
+    do { SYMCAT(OP,_IMPL); } while (0);					\
 									\
-    /* get the next instruction */					\
-    MD_FETCH_INST(inst, mem, regs.regs_NPC);				\
-									\
-    /* jump to instruction implementation */				\
-    MD_SET_OPCODE(op, inst);						\
-    goto *op_jump[op];
+    /* jump to the next instruction implementation in the block */	\
+    uop++;								\
+    goto *uop->impl;
 
 #define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
   opcode_##OP:								\
@@ -392,61 +566,69 @@ sim_main(void)
   opcode_NA:
     panic("attempted to execute a bogus opcode");
 
+  opcode_bb_end:
+    /* dump interval stats? */
+    SIM_STATS_CHECK();
+
+    /* end of block, jump to the first inst implementation of the next */
+    bb = BB_SUCCESSOR(bb, regs.regs_NPC);
+    uop = bb->uops;
+    goto *uop->impl;
+
   /* should not get here... */
   panic("exited sim-fast main loop");
 
 #else /* !USE_JUMP_TABLE */
 
   /* set up initial default next PC */
-  regs.regs_NPC = regs.regs_PC + sizeof(md_inst_t);
+  regs.regs_NPC = regs.regs_PC;
 
+  bb = bb_lookup(regs.regs_NPC);
   while (TRUE)
     {
-      /* maintain $r0 semantics */
-      regs.regs_R[MD_REG_ZERO] = 0;
+      /* execute the block */
+      for (uop = bb->uops; uop < bb->uops + bb->ninsts; uop++)
+	{
+	  /* maintain $r0 semantics */
+	  regs.regs_R[MD_REG_ZERO] = 0;
 #ifdef TARGET_ALPHA
-      regs.regs_F.d[MD_REG_ZERO] = 0.0;
+	  regs.regs_F.d[MD_REG_ZERO] = 0.0;
 #endif /* TARGET_ALPHA */
 
-      /* keep an instruction count */
+	  /* keep an instruction count */
 #ifndef NO_INSN_COUNT
-      sim_num_insn++;
+	  sim_num_insn++;
 #endif /* !NO_INSN_COUNT */
 
-#ifdef TARGET_ALPHA
-      /* load predecoded instruction */
-      op = (enum md_opcode)__UNCHK_MEM_READ(dec, regs.regs_PC << 1, word_t);
-      inst =
-	__UNCHK_MEM_READ(dec, (regs.regs_PC << 1)+sizeof(word_t), md_inst_t);
-#else /* !TARGET_ALPHA */
-      /* load instruction */
-      MD_FETCH_INST(inst, mem, regs.regs_PC);
-
-      /* decode the instruction */
-      MD_SET_OPCODE(op, inst);
-#endif
+	  /* locate next instruction */
+	  regs.regs_PC = regs.regs_NPC;
+	  regs.regs_NPC += sizeof(md_inst_t);
 
-      /* execute the instruction */
-      switch (op)
-	{
+	  /* execute the instruction */
+	  inst = uop->inst;
+	  switch (uop->op)
+	    {
 #define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
-	case OP:							\
-	  SYMCAT(OP,_IMPL);						\
-	  break;
+	    case OP:							\
+	      SYMCAT(OP,_IMPL);						\
+	      break;
 #define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
-	case OP:							\
-	  panic("attempted to execute a linking opcode");
+	    case OP:							\
+	      panic("attempted to execute a linking opcode");
 #define CONNECT(OP)
 #define DECLARE_FAULT(FAULT)						\
-	  { /* uncaught... */break; }
+	      { /* uncaught... */break; }
 #include "machine.def"
-	default:
-	  panic("attempted to execute a bogus opcode");
+	    default:
+	      panic("attempted to execute a bogus opcode");
+	    }
 	}
 
-      /* execute next instruction */
-      regs.regs_PC = regs.regs_NPC;
-      regs.regs_NPC += sizeof(md_inst_t);
+      /* dump interval stats? */
+      SIM_STATS_CHECK();
+
+      /* execute the next block */
+      bb = BB_SUCCESSOR(bb, regs.regs_NPC);
     }
 
 #endif /* USE_JUMP_TABLE */
@@ -60,7 +60,9 @@
 #include "machine.h"
 #include "regs.h"
 #include "memory.h"
+#include "predec.h"
 #include "cache.h"
+#include "dram.h"
 #include "loader.h"
 #include "syscall.h"
 #include "bpred.h"
@@ -86,6 +88,9 @@ static struct regs_t regs;
 /* simulated memory */
 static struct mem_t *mem = NULL;
 
+/* predecoded program text */
+static struct predec_t *pd = NULL;
+
 
 /*
  * simulator options
@@ -97,6 +102,34 @@ static unsigned int max_insts;
 /* number of insts skipped before timing starts */
 static int fastfwd_count;
 
+/* number of insts functionally simulated with cache and predictor warming
+   after fast forwarding (or checkpoint restore), before timing starts */
+static int warmup_count;
+
+/* sampled simulation: sampling period, measured insts per sample and
+   detailed warm-up insts before each sample (see sim_main()) */
+static int sample_period;
+static int sample_size;
+static int sample_warmup;
+
+/* warm caches, TLBs and branch predictors during sampling fast forward */
+static int sample_fwarm;
+
+/* confidence interval of sampled CPI, in standard deviations */
+static double sample_z;
+
+/* command lines of the programs run on additional cores, `;' separated */
+static char *cores_progs;
+
+/* number of simulated cores, one per program */
+static int n_cores = 1;
+
+/* index of the core whose state is in the simulator globals */
+static int core_num = 0;
+
+/* longjmp here when the program of a core exits, with multiple cores */
+static jmp_buf core_exit_buf;
+
 /* pipeline trace range and output filename */
 static int ptrace_nelt = 0;
 static char *ptrace_opts[2];
@@ -110,7 +143,7 @@ static int ruu_branch_penalty;
 /* speed of front-end of machine relative to execution core */
 static int fetch_speed;
 
-/* branch predictor type {nottaken|taken|perfect|bimod|2lev} */
+/* branch predictor type {nottaken|taken|perfect|bimod|2lev|comb|tage} */
 static char *pred_type;
 
 /* bimodal predictor config (<table_size>) */
@@ -128,6 +161,20 @@ static int comb_nelt = 1;
 static int comb_config[1] =
   { /* meta_table_size */1024 };
 
+/* TAGE predictor config
+   (<num_tables> <table_size> <tag_width> <min_hist> <max_hist>) */
+static int tage_nelt = 5;
+static int tage_config[5] =
+  { /* tables */7, /* table size */1024, /* tag */10, /* min hist */4,
+    /* max hist */160 };
+
+/* ITTAGE indirect target predictor config, zero tables disables ITTAGE
+   (<num_tables> <table_size> <tag_width> <min_hist> <max_hist>) */
+static int ittage_nelt = 5;
+static int ittage_config[5] =
+  { /* tables */0, /* table size */512, /* tag */12, /* min hist */4,
+    /* max hist */64 };
+
 /* return address stack (RAS) size */
 static int ras_size = 8;
 
@@ -157,6 +204,12 @@ static int RUU_size = 8;
 /* load/store queue (LSQ) size */
 static int LSQ_size = 4;
 
+/* store set memory dependence predictor config, i.e., {<SSIT size> <LFST
+   size>}, loads wait for all earlier store addresses if the SSIT size is 0 */
+static int storeset_nelt = 2;
+static int storeset_config[2] =
+  { /* SSIT size */0, /* LFST size */128 };
+
 /* l1 data cache config, i.e., {<config>|none} */
 static char *cache_dl1_opt;
 
@@ -181,6 +234,17 @@ static char *cache_il2_opt;
 /* l2 instruction cache hit latency (in cycles) */
 static int cache_il2_lat;
 
+/* cache MSHR configs, i.e., {<MSHRs> <targets/MSHR>}, caches with 0 MSHRs
+   can service any number of misses */
+static int cache_dl1_mshr_nelt = 2;
+static int cache_dl1_mshr[2] = { /* MSHRs */0, /* targets */4 };
+static int cache_dl2_mshr_nelt = 2;
+static int cache_dl2_mshr[2] = { /* MSHRs */0, /* targets */4 };
+static int cache_il1_mshr_nelt = 2;
+static int cache_il1_mshr[2] = { /* MSHRs */0, /* targets */4 };
+static int cache_il2_mshr_nelt = 2;
+static int cache_il2_mshr[2] = { /* MSHRs */0, /* targets */4 };
+
 /* flush caches on system calls */
 static int flush_on_syscalls;
 
@@ -195,6 +259,14 @@ static int mem_lat[2] =
 /* memory access bus width (in bytes) */
 static int mem_bus_width;
 
+/* DRAM config, i.e., {<config>|none} */
+static char *dram_opt;
+
+/* DRAM timing (<tRCD> <tCAS> <tRP>) */
+static int dram_nelt = 3;
+static int dram_lat[3] =
+  { /* activate */9, /* column access */9, /* precharge */9 };
+
 /* instruction TLB config, i.e., {<config>|none} */
 static char *itlb_opt;
 
@@ -224,6 +296,10 @@ static int res_fpmult;
 static int pcstat_nelt = 0;
 static char *pcstat_vars[MAX_PCSTAT_VARS];
 
+/* profile the commit slots lost to each CPI stack component by text
+   address */
+static int cpi_pcstat;
+
 /* convert 64-bit inst text addresses to 32-bit inst equivalents */
 #ifdef TARGET_PISA
 #define IACOMPRESS(A)							\
@@ -238,6 +314,10 @@ static char *pcstat_vars[MAX_PCSTAT_VARS];
 /* operate in backward-compatible bugs mode (for testing only) */
 static int bugcompat_mode;
 
+/* jump over the cycles in which the pipeline is stalled waiting for an
+   event, stats are identical to simulating each cycle */
+static int skip_stalls;
+
 /*
  * functional unit resource configuration
  */
@@ -337,10 +417,68 @@ static counter_t RUU_count;		/* cumulative RUU occupancy */
 static counter_t RUU_fcount;		/* cumulative RUU full count */
 static counter_t LSQ_count;		/* cumulative LSQ occupancy */
 static counter_t LSQ_fcount;		/* cumulative LSQ full count */
+static counter_t lsq_forwards;		/* loads forwarded from the LSQ */
+static counter_t lsq_ss_deps;		/* loads given a store set dep */
+static counter_t lsq_violations;	/* memory order violations */
+static counter_t lsq_replays;		/* insts replayed after violations */
+static counter_t lsq_mshr_stalls;	/* load issues held by full MSHRs */
 
 /* total non-speculative bogus addresses seen (debug var) */
 static counter_t sim_invalid_addrs;
 
+/* total number of non-speculative insts executed outside of timing
+   simulation, i.e., restored from a checkpoint, fast forwarded or warming,
+   these are not counted in sim_num_insn */
+static counter_t sim_fwd_insn = 0;
+
+/* total number of stalled cycles skipped by the main loop */
+static counter_t sim_skip_cycle = 0;
+
+/* total number of insts fast forwarded in sampled simulation */
+static counter_t sample_fwd_insn = 0;
+
+/* CPI of each sample in sampled simulation */
+static struct stat_stat_t *sample_cpi = NULL;
+
+/* CPI stack components, each commit slot of each cycle is charged to the
+   one component that kept it from retiring an inst (see cpi_charge()) */
+enum cpi_comp_t {
+  cpi_base,			/* slot retired an inst */
+  cpi_icache,			/* RUU empty after an I-cache/I-TLB miss */
+  cpi_bpred,			/* RUU empty after a branch misprediction */
+  cpi_fetch,			/* RUU empty, any other front-end stall */
+  cpi_dl1,			/* head load missed in the L1 D-cache */
+  cpi_dl2,			/* head load missed in the L2 D-cache */
+  cpi_dtlb,			/* head load missed in the D-TLB */
+  cpi_fu,			/* head ready, but no FU, store port or MSHR */
+  cpi_dep,			/* head waits for operands or its execution */
+  cpi_ruu_full,			/* as cpi_dep, with the RUU full */
+  cpi_lsq_full,			/* as cpi_dep, with the LSQ full */
+  cpi_NUM
+};
+
+/* commit slots charged to each CPI stack component */
+static counter_t cpi_slots[cpi_NUM];
+
+/* component charged while the RUU is empty, i.e., the last front-end
+   stall, and the address of the inst that caused it */
+static enum cpi_comp_t cpi_front = cpi_fetch;
+static md_addr_t cpi_front_PC = 0;
+
+/* commit slots of the current cycle, found at commit and charged when the
+   cycle ends (see cpi_cycle_end()), so that the cycle cut short by the
+   program's exit, which sim_cycle does not count, is not charged */
+static int cpi_cycle_base = 0;
+static enum cpi_comp_t cpi_cycle_comp = cpi_fetch;
+static md_addr_t cpi_cycle_PC = 0;
+
+/* the component last charged for a lost commit slot */
+static enum cpi_comp_t cpi_last = cpi_fetch;
+
+/* non-speculative NOPs dispatched, but not yet charged their base slot,
+   NOPs never enter the RUU, they retire in commit slots left free */
+static counter_t cpi_nops = 0;
+
 /*
  * simulator state variables
  */
@@ -385,6 +523,10 @@ static struct cache_t *itlb;
 /* data TLB */
 static struct cache_t *dtlb;
 
+/* banked DRAM main memory, shared by all cores, NULL for the fixed
+   latency memory model */
+static struct dram_t *dram = NULL;
+
 /* branch predictor */
 static struct bpred_t *pred;
 
@@ -396,6 +538,9 @@ static struct stat_stat_t *pcstat_stats[MAX_PCSTAT_VARS];
 static counter_t pcstat_lastvals[MAX_PCSTAT_VARS];
 static struct stat_stat_t *pcstat_sdists[MAX_PCSTAT_VARS];
 
+/* commit slots lost to each CPI stack component, by text address */
+static struct stat_stat_t *cpi_pc_sdists[cpi_NUM];
+
 /* wedge all stat values into a counter_t */
 #define STATVAL(STAT)							\
   ((STAT)->sc == sc_int							\
@@ -419,26 +564,113 @@ mem_access_latency(int blk_sz)		/* block size accessed */
 	  (/* remainder chunk latency */mem_lat[1] * (chunks - 1)));
 }
 
+/* access main memory at physical block address BADDR, returns the latency
+   of reads */
+static unsigned int			/* latency of access */
+main_mem_access(enum mem_cmd cmd,	/* access cmd, Read or Write */
+		md_addr_t baddr,	/* block address to access */
+		int bsize,		/* size of block to access */
+		tick_t now)		/* time of access */
+{
+  if (dram)
+    return dram_access(dram, cmd, baddr, bsize, now);
+
+  if (cmd == Read)
+    return mem_access_latency(bsize);
+  else
+    {
+      /* FIXME: unlimited write buffers */
+      return 0;
+    }
+}
+
+
+/*
+ * physical page mapping, with multiple cores the programs share the L2
+ * caches, so their (virtual) addresses are mapped to physical addresses
+ * before the L2 caches are accessed; each core maps its pages to the next
+ * free physical page when they first reach the L2 caches
+ */
+
+/* a mapped page */
+struct core_page_t {
+  struct core_page_t *next;		/* next mapping in this bucket */
+  md_addr_t vpn;			/* virtual page number */
+  md_addr_t ppn;			/* physical page number */
+};
+
+/* number of buckets in a page mapping table, must be a power of two */
+#define CORE_PTAB_SIZE			1024
+
+/* page mapping table of the running core, NULL with a single core, whose
+   physical addresses are its virtual addresses */
+static struct core_page_t **core_ptab = NULL;
+
+/* next free physical page number, shared by all cores, page zero is never
+   mapped as the caches treat block address zero as their last block
+   accessed before any access */
+static md_addr_t core_next_ppn = 1;
+
+/* translate address ADDR of the running core to a physical address */
+static md_addr_t			/* physical address */
+core_paddr(md_addr_t addr)		/* virtual address */
+{
+  md_addr_t vpn = addr >> MD_LOG_PAGE_SIZE;
+  struct core_page_t *page, **bucket;
+
+  if (!core_ptab)
+    return addr;
+
+  bucket = &core_ptab[vpn & (CORE_PTAB_SIZE - 1)];
+  for (page = *bucket; page != NULL; page = page->next)
+    {
+      if (page->vpn == vpn)
+	break;
+    }
+  if (!page)
+    {
+      /* first access, map the page */
+      page = (struct core_page_t *)calloc(1, sizeof(struct core_page_t));
+      if (!page)
+	fatal("out of virtual memory");
+      page->vpn = vpn;
+      page->ppn = core_next_ppn++;
+      page->next = *bucket;
+      *bucket = page;
+    }
+  return (page->ppn << MD_LOG_PAGE_SIZE) | (addr & (MD_PAGE_SIZE - 1));
+}
+
 
 /*
  * cache miss handlers
  */
 
+/* return the current program counter, used by the cache prefetchers (see
+   cache.c), which this simulator does not configure */
+md_addr_t
+get_PC()
+{
+  return regs.regs_PC;
+}
+
 /* l1 data cache l1 block miss handler function */
 static unsigned int			/* latency of block access */
 dl1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
 	      md_addr_t baddr,		/* block address to access */
 	      int bsize,		/* size of block to access */
 	      struct cache_blk_t *blk,	/* ptr to block in upper level */
-	      tick_t now)		/* time of access */
+	      tick_t now,		/* time of access */
+	      int prefetch)		/* if 1 the access is a prefetch */
 {
   unsigned int lat;
 
   if (cache_dl2)
     {
       /* access next level of data cache hierarchy */
-      lat = cache_access(cache_dl2, cmd, baddr, NULL, bsize,
-			 /* now */now, /* pudata */NULL, /* repl addr */NULL);
+      lat = cache_access(cache_dl2, cmd, core_paddr(baddr), NULL, bsize,
+			 /* now */now, /* pudata */NULL, /* repl addr */NULL,
+			 prefetch);
       if (cmd == Read)
 	return lat;
       else
@@ -450,13 +682,7 @@ dl1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
   else
     {
       /* access main memory */
-      if (cmd == Read)
-	return mem_access_latency(bsize);
-      else
-	{
-	  /* FIXME: unlimited write buffers */
-	  return 0;
-	}
+      return main_mem_access(cmd, core_paddr(baddr), bsize, now);
     }
 }
 
@@ -466,16 +692,11 @@ dl2_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
 	      md_addr_t baddr,		/* block address to access */
 	      int bsize,		/* size of block to access */
 	      struct cache_blk_t *blk,	/* ptr to block in upper level */
-	      tick_t now)		/* time of access */
+	      tick_t now,		/* time of access */
+	      int prefetch)		/* if 1 the access is a prefetch */
 {
   /* this is a miss to the lowest level, so access main memory */
-  if (cmd == Read)
-    return mem_access_latency(bsize);
-  else
-    {
-      /* FIXME: unlimited write buffers */
-      return 0;
-    }
+  return main_mem_access(cmd, baddr, bsize, now);
 }
 
 /* l1 inst cache l1 block miss handler function */
@@ -484,15 +705,17 @@ il1_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
 	      md_addr_t baddr,		/* block address to access */
 	      int bsize,		/* size of block to access */
 	      struct cache_blk_t *blk,	/* ptr to block in upper level */
-	      tick_t now)		/* time of access */
+	      tick_t now,		/* time of access */
+	      int prefetch)		/* if 1 the access is a prefetch */
 {
   unsigned int lat;
 
 if (cache_il2)
     {
       /* access next level of inst cache hierarchy */
-      lat = cache_access(cache_il2, cmd, baddr, NULL, bsize,
-			 /* now */now, /* pudata */NULL, /* repl addr */NULL);
+      lat = cache_access(cache_il2, cmd, core_paddr(baddr), NULL, bsize,
+			 /* now */now, /* pudata */NULL, /* repl addr */NULL,
+			 prefetch);
       if (cmd == Read)
 	return lat;
       else
@@ -502,7 +725,7 @@ if (cache_il2)
     {
       /* access main memory */
       if (cmd == Read)
-	return mem_access_latency(bsize);
+	return main_mem_access(cmd, core_paddr(baddr), bsize, now);
       else
 	panic("writes to instruction memory not supported");
     }
@@ -514,11 +737,12 @@ il2_access_fn(enum mem_cmd cmd,		/* access cmd, Read or Write */
 	      md_addr_t baddr,		/* block address to access */
 	      int bsize,		/* size of block to access */
 	      struct cache_blk_t *blk,	/* ptr to block in upper level */
-	      tick_t now)		/* time of access */
+	      tick_t now,		/* time of access */
+	      int prefetch)		/* if 1 the access is a prefetch */
 {
   /* this is a miss to the lowest level, so access main memory */
   if (cmd == Read)
-    return mem_access_latency(bsize);
+    return main_mem_access(cmd, baddr, bsize, now);
   else
     panic("writes to instruction memory not supported");
 }
@@ -534,7 +758,8 @@ itlb_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
 	       md_addr_t baddr,		/* block address to access */
 	       int bsize,		/* size of block to access */
 	       struct cache_blk_t *blk,	/* ptr to block in upper level */
-	       tick_t now)		/* time of access */
+	       tick_t now,		/* time of access */
+	       int prefetch)		/* if 1 the access is a prefetch */
 {
   md_addr_t *phy_page_ptr = (md_addr_t *)blk->user_data;
 
@@ -554,7 +779,8 @@ dtlb_access_fn(enum mem_cmd cmd,	/* access cmd, Read or Write */
 	       md_addr_t baddr,	/* block address to access */
 	       int bsize,		/* size of block to access */
 	       struct cache_blk_t *blk,	/* ptr to block in upper level */
-	       tick_t now)		/* time of access */
+	       tick_t now,		/* time of access */
+	       int prefetch)		/* if 1 the access is a prefetch */
 {
   md_addr_t *phy_page_ptr = (md_addr_t *)blk->user_data;
 
@@ -591,6 +817,10 @@ sim_reg_options(struct opt_odb_t *odb)
   opt_reg_int(odb, "-fastfwd", "number of insts skipped before timing starts",
 	      &fastfwd_count, /* default */0,
 	      /* print */TRUE, /* format */NULL);
+  opt_reg_int(odb, "-warmup",
+	      "number of insts warming caches and predictors before timing",
+	      &warmup_count, /* default */0,
+	      /* print */TRUE, /* format */NULL);
   opt_reg_string_list(odb, "-ptrace",
 	      "generate pipetrace, i.e., <fname|stdout|stderr> <range>",
 	      ptrace_opts, /* arr_sz */2, &ptrace_nelt, /* default */NULL,
@@ -614,6 +844,66 @@ sim_reg_options(struct opt_odb_t *odb)
 "                -ptrace BLAH.trc :1500\n"
 "                -ptrace UXXE.trc :\n"
 "                -ptrace FOOBAR.trc @main:+278\n"
+"\n"
+"  Pipetraces named *.ptb (or *.ptb.gz) are written in a compact binary\n"
+"  format, use ptrace2txt to convert them for pipeview.pl.\n"
+	       );
+
+  /* sampling options */
+
+  opt_reg_int(odb, "-sample:period",
+	      "sampling period in insts (0 for no sampling)",
+	      &sample_period, /* default */0,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_int(odb, "-sample:size", "insts measured in each sample",
+	      &sample_size, /* default */1000,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_int(odb, "-sample:warmup",
+	      "insts of detailed warm-up before each sample",
+	      &sample_warmup, /* default */2000,
+	      /* print */TRUE, /* format */NULL);
+  opt_reg_flag(odb, "-sample:fwarm",
+	       "warm caches and predictors while fast forwarding",
+	       &sample_fwarm, /* default */TRUE,
+	       /* print */TRUE, /* format */NULL);
+  opt_reg_double(odb, "-sample:z",
+		 "sampled CPI confidence interval, in std deviations",
+		 &sample_z, /* default */3.0,
+		 /* print */TRUE, /* format */NULL);
+
+  opt_reg_note(odb,
+"  With a non-zero `-sample:period', the program is simulated in detail only\n"
+"  in short samples taken at fixed intervals.  Each period of P insts is\n"
+"  fast forwarded functionally for P-W-U insts (keeping the caches, TLBs\n"
+"  and branch predictors warm unless `-sample:fwarm' is false), simulated\n"
+"  in detail for W warm-up insts, and then in detail for U measured insts,\n"
+"  where W is `-sample:warmup' and U is `-sample:size'.  The CPI of the\n"
+"  measured insts of each sample is reported as sample.CPI, with its\n"
+"  confidence interval.  Sampling starts after any `-fastfwd' insts, and\n"
+"  `-max:inst' then counts fast forwarded insts as well.\n"
+"\n"
+"    Example:   -sample:period 1000000 -sample:warmup 2000 -sample:size 1000\n"
+	       );
+
+  /* multi-core options */
+
+  opt_reg_string(odb, "-cores:progs",
+		 "programs run on additional cores, `;' separated command lines",
+		 &cores_progs, /* default */NULL,
+		 /* print */TRUE, /* format */NULL);
+
+  opt_reg_note(odb,
+"  Each program named by `-cores:progs' runs on its own core, a copy of the\n"
+"  configured core with private L1 caches, TLBs, branch predictor and\n"
+"  functional units, and all cores share the L2 caches.  The programs have\n"
+"  separate address spaces, their pages are mapped to distinct physical\n"
+"  pages when first accessed in the L2 caches.  A core stops when its\n"
+"  program exits or after `-max:inst' committed insts, and simulation ends\n"
+"  when all cores have stopped.  The stats of the first core are reported\n"
+"  as usual, those of core N are prefixed with `cN.'.  The programs share\n"
+"  the simulator's standard input and output.\n"
+"\n"
+"    Example:   -cores:progs \"test-math; anagram words\"\n"
 	       );
 
   /* ifetch options */
@@ -647,10 +937,15 @@ sim_reg_options(struct opt_odb_t *odb)
 "      PAp     : N, W, M (M == 2^(N+W)), 0\n"
 "      gshare  : 1, W, 2^W, 1\n"
 "  Predictor `comb' combines a bimodal and a 2-level predictor.\n"
+"  Predictor `tage' backs a bimodal predictor (configured by -bpred:bimod)\n"
+"  with tagged tables indexed by geometrically longer global histories.\n"
+"  Any stateful predictor can predict the targets of indirect jumps with\n"
+"  ITTAGE (-bpred:ittage), falling back to the BTB on a tag miss.\n"
                );
 
   opt_reg_string(odb, "-bpred",
-		 "branch predictor type {nottaken|taken|perfect|bimod|2lev|comb}",
+		 "branch predictor type "
+		 "{nottaken|taken|perfect|bimod|2lev|comb|tage}",
                  &pred_type, /* default */"bimod",
                  /* print */TRUE, /* format */NULL);
 
@@ -673,6 +968,22 @@ sim_reg_options(struct opt_odb_t *odb)
 		   /* default */comb_config,
 		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
 
+  opt_reg_int_list(odb, "-bpred:tage",
+		   "TAGE predictor config "
+		   "(<num_tables> <table_size> <tag_width> <min_hist> "
+		   "<max_hist>)",
+		   tage_config, tage_nelt, &tage_nelt,
+		   /* default */tage_config,
+		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
+
+  opt_reg_int_list(odb, "-bpred:ittage",
+		   "ITTAGE indirect target predictor config, 0 tables for "
+		   "none (<num_tables> <table_size> <tag_width> <min_hist> "
+		   "<max_hist>)",
+		   ittage_config, ittage_nelt, &ittage_nelt,
+		   /* default */ittage_config,
+		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
+
   opt_reg_int(odb, "-bpred:ras",
               "return address stack size (0 for no return stack)",
               &ras_size, /* default */ras_size,
@@ -733,6 +1044,14 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &LSQ_size, /* default */8,
 	      /* print */TRUE, /* format */NULL);
 
+  opt_reg_int_list(odb, "-lsq:storeset",
+		   "store set memory dependence predictor config, 0 SSIT "
+		   "entries to wait for all earlier store addresses "
+		   "(<SSIT size> <LFST size>)",
+		   storeset_config, storeset_nelt, &storeset_nelt,
+		   /* default */storeset_config,
+		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
+
   /* cache options */
 
   opt_reg_string(odb, "-cache:dl1",
@@ -804,6 +1123,39 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &cache_il2_lat, /* default */6,
 	      /* print */TRUE, /* format */NULL);
 
+  opt_reg_int_list(odb, "-cache:dl1mshr",
+		   "l1 data cache MSHRs, 0 MSHRs for unlimited misses "
+		   "(<MSHRs> <targets/MSHR>)",
+		   cache_dl1_mshr, cache_dl1_mshr_nelt, &cache_dl1_mshr_nelt,
+		   /* default */cache_dl1_mshr,
+		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
+
+  opt_reg_int_list(odb, "-cache:dl2mshr",
+		   "l2 data cache MSHRs (<MSHRs> <targets/MSHR>)",
+		   cache_dl2_mshr, cache_dl2_mshr_nelt, &cache_dl2_mshr_nelt,
+		   /* default */cache_dl2_mshr,
+		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
+
+  opt_reg_int_list(odb, "-cache:il1mshr",
+		   "l1 inst cache MSHRs (<MSHRs> <targets/MSHR>)",
+		   cache_il1_mshr, cache_il1_mshr_nelt, &cache_il1_mshr_nelt,
+		   /* default */cache_il1_mshr,
+		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
+
+  opt_reg_int_list(odb, "-cache:il2mshr",
+		   "l2 inst cache MSHRs (<MSHRs> <targets/MSHR>)",
+		   cache_il2_mshr, cache_il2_mshr_nelt, &cache_il2_mshr_nelt,
+		   /* default */cache_il2_mshr,
+		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
+
+  opt_reg_note(odb,
+"  A cache with MSHRs holds one for each outstanding miss, secondary misses\n"
+"  to a block being filled merge into its MSHR, up to the target limit, and\n"
+"  a miss finding all MSHRs busy waits for the first to free.  Loads that\n"
+"  would miss in the l1 data cache are not issued while its MSHRs are full.\n"
+"  MSHRs of unified caches are set by the data cache options.\n"
+	       );
+
   opt_reg_flag(odb, "-cache:flush", "flush caches on system calls",
 	       &flush_on_syscalls, /* default */FALSE, /* print */TRUE, NULL);
 
@@ -822,6 +1174,16 @@ sim_reg_options(struct opt_odb_t *odb)
 	      &mem_bus_width, /* default */8,
 	      /* print */TRUE, /* format */NULL);
 
+  opt_reg_string(odb, "-mem:dram",
+		 "banked DRAM config, replaces -mem:lat's first chunk latency, "
+		 "i.e., {<config>|none}",
+		 &dram_opt, "none", /* print */TRUE, NULL);
+
+  opt_reg_int_list(odb, "-mem:dramlat",
+		   "DRAM timing (<tRCD> <tCAS> <tRP>)",
+		   dram_lat, dram_nelt, &dram_nelt, dram_lat,
+		   /* print */TRUE, /* format */NULL, /* !accrue */FALSE);
+
   /* TLB options */
 
   opt_reg_string(odb, "-tlb:itlb",
@@ -868,31 +1230,37 @@ sim_reg_options(struct opt_odb_t *odb)
 		      "profile stat(s) against text addr's (mult uses ok)",
 		      pcstat_vars, MAX_PCSTAT_VARS, &pcstat_nelt, NULL,
 		      /* !print */FALSE, /* format */NULL, /* accrue */TRUE);
+  opt_reg_flag(odb, "-cpi:pcstat",
+	       "profile the CPI stack components against text addr's",
+	       &cpi_pcstat, /* default */FALSE, /* print */TRUE, NULL);
+  opt_reg_note(odb,
+"  The CPI stack charges each commit slot of each cycle to one component:\n"
+"  cpi.base if it retired an inst, else the reason the RUU head could not\n"
+"  retire: a load missing in the L1 or L2 D-cache or the D-TLB\n"
+"  (cpi.memory.*), no FU, store port or MSHR (cpi.core.fu), or waiting on\n"
+"  operands or its own execution (cpi.core.dep, or cpi.window.* if the RUU\n"
+"  or LSQ is full meanwhile).  Slots of an empty RUU are charged to the\n"
+"  last front-end stall: an I-cache miss or a branch misprediction\n"
+"  (cpi.frontend.*).  The components sum to sim_CPI.  With `-cpi:pcstat',\n"
+"  the lost slots are also profiled by the address of the head inst, or of\n"
+"  the inst that stalled the front end.\n"
+	       );
 
   opt_reg_flag(odb, "-bugcompat",
 	       "operate in backward-compatible bugs mode (for testing only)",
 	       &bugcompat_mode, /* default */FALSE, /* print */TRUE, NULL);
+
+  opt_reg_flag(odb, "-skip:stalls",
+	       "skip cycles in which the stalled pipeline waits for an event",
+	       &skip_stalls, /* default */TRUE, /* print */TRUE, NULL);
 }
 
-/* check simulator-specific option values */
-void
-sim_check_options(struct opt_odb_t *odb,        /* options database */
-		  int argc, char **argv)        /* command line arguments */
+/* create the branch predictor configured by the predictor options, returns
+   NULL for a perfect predictor */
+static struct bpred_t *			/* branch predictor created */
+sim_pred_create(void)
 {
-  char name[128], c;
-  int nsets, bsize, assoc;
-
-  if (fastfwd_count < 0 || fastfwd_count >= 2147483647)
-    fatal("bad fast forward count: %d", fastfwd_count);
-
-  if (ruu_ifq_size < 1 || (ruu_ifq_size & (ruu_ifq_size - 1)) != 0)
-    fatal("inst fetch queue size must be positive > 0 and a power of two");
-
-  if (ruu_branch_penalty < 1)
-    fatal("mis-prediction penalty must be at least 1 cycle");
-
-  if (fetch_speed < 1)
-    fatal("front-end speed must be positive and non-zero");
+  struct bpred_t *pred = NULL;
 
   if (!mystricmp(pred_type, "perfect"))
     {
@@ -972,9 +1340,104 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
 			  /* btb assoc */btb_config[1],
 			  /* ret-addr stack size */ras_size);
     }
+  else if (!mystricmp(pred_type, "tage"))
+    {
+      /* TAGE predictor, bpred_tage_create() checks args */
+      if (bimod_nelt != 1)
+	fatal("bad bimod predictor config (<table_size>)");
+      if (tage_nelt != 5)
+	fatal("bad TAGE pred config (<num_tables> <table_size> <tag_width> "
+	      "<min_hist> <max_hist>)");
+      if (btb_nelt != 2)
+	fatal("bad btb config (<num_sets> <associativity>)");
+
+      pred = bpred_tage_create(/* bimod table size */bimod_config[0],
+			       /* tagged tables */tage_config[0],
+			       /* table size */tage_config[1],
+			       /* tag width */tage_config[2],
+			       /* shortest history */tage_config[3],
+			       /* longest history */tage_config[4],
+			       /* btb sets */btb_config[0],
+			       /* btb assoc */btb_config[1],
+			       /* ret-addr stack size */ras_size);
+    }
   else
     fatal("cannot parse predictor type `%s'", pred_type);
 
+  if (ittage_nelt != 5)
+    fatal("bad ITTAGE pred config (<num_tables> <table_size> <tag_width> "
+	  "<min_hist> <max_hist>)");
+  if (ittage_config[0] != 0 && pred)
+    {
+      /* bpred_ind_create() checks args */
+      bpred_ind_create(pred,
+		       /* tagged tables */ittage_config[0],
+		       /* table size */ittage_config[1],
+		       /* tag width */ittage_config[2],
+		       /* shortest history */ittage_config[3],
+		       /* longest history */ittage_config[4]);
+    }
+
+  return pred;
+}
+
+/* check simulator-specific option values */
+void
+sim_check_options(struct opt_odb_t *odb,        /* options database */
+		  int argc, char **argv)        /* command line arguments */
+{
+  char name[128], c;
+  int nsets, bsize, assoc;
+
+  if (fastfwd_count < 0 || fastfwd_count >= 2147483647)
+    fatal("bad fast forward count: %d", fastfwd_count);
+  if (warmup_count < 0 || warmup_count >= 2147483647)
+    fatal("bad warm-up count: %d", warmup_count);
+
+  if (sample_period < 0)
+    fatal("bad sampling period: %d", sample_period);
+  if (sample_period > 0)
+    {
+      if (sample_size < 1 || sample_warmup < 0)
+	fatal("sample size must be positive and warm-up non-negative");
+      if (sample_warmup + sample_size > sample_period)
+	fatal("sample warm-up and size must fit in the sampling period");
+      if (sample_z <= 0.0)
+	fatal("sample confidence interval must be positive");
+    }
+
+  if (cores_progs)
+    {
+      char *p;
+
+      /* one more core per program */
+      for (p = cores_progs; *p; p++)
+	{
+	  if (*p == ';')
+	    n_cores++;
+	}
+      n_cores++;
+
+      if (sample_period > 0)
+	fatal("sampled simulation is not supported with multiple cores");
+      if (pcstat_nelt > 0)
+	fatal("`-pcstat' is not supported with multiple cores");
+      if (cpi_pcstat)
+	fatal("`-cpi:pcstat' is not supported with multiple cores");
+    }
+
+  if (ruu_ifq_size < 1 || (ruu_ifq_size & (ruu_ifq_size - 1)) != 0)
+    fatal("inst fetch queue size must be positive > 0 and a power of two");
+
+  if (ruu_branch_penalty < 1)
+    fatal("mis-prediction penalty must be at least 1 cycle");
+
+  if (fetch_speed < 1)
+    fatal("front-end speed must be positive and non-zero");
+
+  /* create the branch predictor */
+  pred = sim_pred_create();
+
   if (!bpred_spec_opt)
     bpred_spec_update = spec_CT;
   else if (!mystricmp(bpred_spec_opt, "ID"))
@@ -999,6 +1462,15 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
   if (LSQ_size < 2 || (LSQ_size & (LSQ_size-1)) != 0)
     fatal("LSQ size must be a positive number > 1 and a power of two");
 
+  if (storeset_nelt != 2)
+    fatal("bad store set config (<SSIT size> <LFST size>)");
+  if (storeset_config[0] != 0
+      && (storeset_config[0] < 0
+	  || (storeset_config[0] & (storeset_config[0]-1)) != 0))
+    fatal("SSIT size must be zero or a positive power of two");
+  if (storeset_config[0] != 0 && storeset_config[1] < 1)
+    fatal("LFST size must be positive non-zero");
+
   /* use a level 1 D-cache? */
   if (!mystricmp(cache_dl1_opt, "none"))
     {
@@ -1016,7 +1488,9 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
 	fatal("bad l1 D-cache parms: <name>:<nsets>:<bsize>:<assoc>:<repl>");
       cache_dl1 = cache_create(name, nsets, bsize, /* balloc */FALSE,
 			       /* usize */0, assoc, cache_char2policy(c),
-			       dl1_access_fn, /* hit lat */cache_dl1_lat);
+			       dl1_access_fn, /* hit lat */cache_dl1_lat,
+			       /* prefetch */0);
+      cache_set_mshrs(cache_dl1, cache_dl1_mshr[0], cache_dl1_mshr[1]);
 
       /* is the level 2 D-cache defined? */
       if (!mystricmp(cache_dl2_opt, "none"))
@@ -1029,7 +1503,9 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
 		  "<name>:<nsets>:<bsize>:<assoc>:<repl>");
 	  cache_dl2 = cache_create(name, nsets, bsize, /* balloc */FALSE,
 				   /* usize */0, assoc, cache_char2policy(c),
-				   dl2_access_fn, /* hit lat */cache_dl2_lat);
+				   dl2_access_fn, /* hit lat */cache_dl2_lat,
+				   /* prefetch */0);
+	  cache_set_mshrs(cache_dl2, cache_dl2_mshr[0], cache_dl2_mshr[1]);
 	}
     }
 
@@ -1072,7 +1548,9 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
 	fatal("bad l1 I-cache parms: <name>:<nsets>:<bsize>:<assoc>:<repl>");
       cache_il1 = cache_create(name, nsets, bsize, /* balloc */FALSE,
 			       /* usize */0, assoc, cache_char2policy(c),
-			       il1_access_fn, /* hit lat */cache_il1_lat);
+			       il1_access_fn, /* hit lat */cache_il1_lat,
+			       /* prefetch */0);
+      cache_set_mshrs(cache_il1, cache_il1_mshr[0], cache_il1_mshr[1]);
 
       /* is the level 2 D-cache defined? */
       if (!mystricmp(cache_il2_opt, "none"))
@@ -1091,10 +1569,15 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
 		  "<name>:<nsets>:<bsize>:<assoc>:<repl>");
 	  cache_il2 = cache_create(name, nsets, bsize, /* balloc */FALSE,
 				   /* usize */0, assoc, cache_char2policy(c),
-				   il2_access_fn, /* hit lat */cache_il2_lat);
+				   il2_access_fn, /* hit lat */cache_il2_lat,
+				   /* prefetch */0);
+	  cache_set_mshrs(cache_il2, cache_il2_mshr[0], cache_il2_mshr[1]);
 	}
     }
 
+  if (n_cores > 1 && cache_il1 && cache_il1 == cache_dl2)
+    fatal("the shared l2 cache cannot be the l1 inst cache of multiple cores");
+
   /* use an I-TLB? */
   if (!mystricmp(itlb_opt, "none"))
     itlb = NULL;
@@ -1106,7 +1589,7 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
       itlb = cache_create(name, nsets, bsize, /* balloc */FALSE,
 			  /* usize */sizeof(md_addr_t), assoc,
 			  cache_char2policy(c), itlb_access_fn,
-			  /* hit latency */1);
+			  /* hit latency */1, /* prefetch */0);
     }
 
   /* use a D-TLB? */
@@ -1120,7 +1603,7 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
       dtlb = cache_create(name, nsets, bsize, /* balloc */FALSE,
 			  /* usize */sizeof(md_addr_t), assoc,
 			  cache_char2policy(c), dtlb_access_fn,
-			  /* hit latency */1);
+			  /* hit latency */1, /* prefetch */0);
     }
 
   if (cache_dl1_lat < 1)
@@ -1135,6 +1618,10 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
   if (cache_il2_lat < 1)
     fatal("l2 instruction cache latency must be greater than zero");
 
+  if (cache_dl1_mshr_nelt != 2 || cache_dl2_mshr_nelt != 2
+      || cache_il1_mshr_nelt != 2 || cache_il2_mshr_nelt != 2)
+    fatal("bad cache MSHR config (<MSHRs> <targets/MSHR>)");
+
   if (mem_nelt != 2)
     fatal("bad memory access latency (<first_chunk> <inter_chunk>)");
 
@@ -1144,6 +1631,26 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
   if (mem_bus_width < 1 || (mem_bus_width & (mem_bus_width-1)) != 0)
     fatal("memory bus width must be positive non-zero and a power of two");
 
+  /* use a banked DRAM? */
+  if (!mystricmp(dram_opt, "none"))
+    dram = NULL;
+  else
+    {
+      int nchans, nbanks, row_size, rq_size, wq_size;
+
+      if (dram_nelt != 3)
+	fatal("bad DRAM timing (<tRCD> <tCAS> <tRP>)");
+      if (sscanf(dram_opt, "%[^:]:%d:%d:%d:%c:%d:%d",
+		 name, &nchans, &nbanks, &row_size, &c,
+		 &rq_size, &wq_size) != 7)
+	fatal("bad DRAM parms: <name>:<channels>:<banks>:<row size>:"
+	      "<page policy>:<read queue size>:<write queue size>");
+      dram = dram_create(name, nchans, nbanks, row_size,
+			 dram_char2policy(c), rq_size, wq_size,
+			 dram_lat[0], dram_lat[1], dram_lat[2],
+			 /* burst */mem_lat[1], mem_bus_width);
+    }
+
   if (tlb_miss_lat < 1)
     fatal("TLB miss latency must be greater than zero");
 
@@ -1182,7 +1689,101 @@ sim_check_options(struct opt_odb_t *odb,        /* options database */
 void
 sim_aux_config(FILE *stream)            /* output stream */
 {
-  /* nada */
+  if (dram)
+    dram_config(dram, stream);
+}
+
+/* register the stats of the additional cores */
+static void cores_reg_stats(struct stat_sdb_t *sdb);
+
+/* CPI stack components, see enum cpi_comp_t, the stat names are below
+   cpi. (the CPI) and cpi_slots. (the commit slots) */
+static struct {
+  char *name;				/* component name */
+  char *desc;				/* component description */
+} cpi_comps[cpi_NUM] = {
+  { "base", "insts retired" },
+  { "frontend.icache", "I-cache and I-TLB misses" },
+  { "frontend.bpred", "branch mispredictions" },
+  { "frontend.other", "other front-end stalls" },
+  { "memory.dl1", "L1 D-cache load misses" },
+  { "memory.dl2", "L2 D-cache load misses" },
+  { "memory.dtlb", "D-TLB load misses" },
+  { "core.fu", "FU, store port and MSHR contention" },
+  { "core.dep", "operand and execution latency" },
+  { "window.ruu_full", "operand and execution latency, RUU full" },
+  { "window.lsq_full", "operand and execution latency, LSQ full" }
+};
+
+/* CPI stack component groups, the first part of the component names */
+static struct {
+  char *name;				/* group name */
+  char *desc;				/* group description */
+} cpi_groups[] = {
+  { "frontend", "front-end stalls" },
+  { "memory", "data memory stalls" },
+  { "core", "execution core stalls" },
+  { "window", "instruction window stalls" },
+  { NULL, NULL }
+};
+
+/* register the CPI stack of the commit slot counts SLOTS, the stat names
+   start with PREFIX */
+static void
+cpi_reg_stats(struct stat_sdb_t *sdb,	/* stats database */
+	      char *prefix,		/* stat name prefix */
+	      counter_t *slots)		/* commit slots, by component */
+{
+  char buf[512], buf1[512], sum[1024];
+  int i, g, len;
+
+  for (i=0; i < cpi_NUM; i++)
+    {
+      sprintf(buf, "%scpi_slots.%s", prefix, cpi_comps[i].name);
+      sprintf(buf1, "total commit slots charged to %s", cpi_comps[i].desc);
+      stat_reg_counter(sdb, buf, buf1, &slots[i], /* initial value */0,
+		       /* format */NULL);
+    }
+
+  /* the whole stack, then each group followed by its components */
+  sprintf(buf, "%scpi.total", prefix);
+  sprintf(buf1, "%scpi.base", prefix);
+  for (g=0; cpi_groups[g].name; g++)
+    sprintf(buf1 + strlen(buf1), " + %scpi.%s", prefix, cpi_groups[g].name);
+  stat_reg_formula(sdb, buf, "CPI stack total (equals sim_CPI)", buf1, NULL);
+
+  sprintf(buf, "%scpi.base", prefix);
+  sprintf(buf1, "%scpi_slots.base / (%d * %ssim_num_insn)",
+	  prefix, ruu_commit_width, prefix);
+  stat_reg_formula(sdb, buf, "CPI of insts retired", buf1, NULL);
+  for (g=0; cpi_groups[g].name; g++)
+    {
+      len = strlen(cpi_groups[g].name);
+      sum[0] = '\0';
+      for (i=0; i < cpi_NUM; i++)
+	{
+	  if (strncmp(cpi_comps[i].name, cpi_groups[g].name, len) != 0
+	      || cpi_comps[i].name[len] != '.')
+	    continue;
+	  sprintf(sum + strlen(sum), "%s%scpi.%s",
+		  sum[0] ? " + " : "", prefix, cpi_comps[i].name);
+	}
+      sprintf(buf, "%scpi.%s", prefix, cpi_groups[g].name);
+      sprintf(buf1, "CPI of %s", cpi_groups[g].desc);
+      stat_reg_formula(sdb, buf, buf1, sum, NULL);
+
+      for (i=0; i < cpi_NUM; i++)
+	{
+	  if (strncmp(cpi_comps[i].name, cpi_groups[g].name, len) != 0
+	      || cpi_comps[i].name[len] != '.')
+	    continue;
+	  sprintf(buf, "%scpi.%s", prefix, cpi_comps[i].name);
+	  sprintf(buf1, "CPI of %s", cpi_comps[i].desc);
+	  sprintf(sum, "%scpi_slots.%s / (%d * %ssim_num_insn)",
+		  prefix, cpi_comps[i].name, ruu_commit_width, prefix);
+	  stat_reg_formula(sdb, buf, buf1, sum, NULL);
+	}
+    }
 }
 
 /* register simulator-specific statistics */
@@ -1238,6 +1839,12 @@ sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
   stat_reg_formula(sdb, "sim_CPI",
 		   "cycles per instruction",
 		   "sim_cycle / sim_num_insn", /* format */NULL);
+  stat_reg_counter(sdb, "sim_fwd_insn",
+		   "total number of insts executed before timing simulation",
+		   &sim_fwd_insn, sim_fwd_insn, /* format */NULL);
+  stat_reg_counter(sdb, "sim_skip_cycle",
+		   "total number of stalled cycles skipped",
+		   &sim_skip_cycle, /* initial value */0, /* format */NULL);
   stat_reg_formula(sdb, "sim_exec_BW",
 		   "total instructions (mis-spec + committed) per cycle",
 		   "sim_total_insn / sim_cycle", /* format */NULL);
@@ -1245,6 +1852,23 @@ sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
 		   "instruction per branch",
 		   "sim_num_insn / sim_num_branches", /* format */NULL);
 
+  /* sampled simulation stats */
+  if (sample_period > 0)
+    {
+      stat_reg_counter(sdb, "sample.fwd_insn",
+		       "total number of insts fast forwarded",
+		       &sample_fwd_insn, /* initial value */0, /* format */NULL);
+      stat_reg_formula(sdb, "sample.total_insn",
+		       "total number of insts simulated (detailed + fast fwd)",
+		       "sim_num_insn + sample.fwd_insn", /* format */NULL);
+      sample_cpi = stat_reg_mean(sdb, "sample.CPI",
+				 "sampled cycles per instruction",
+				 sample_z, /* format */NULL);
+      stat_reg_formula(sdb, "sample.IPC",
+		       "sampled instructions per cycle",
+		       "1 / sample.CPI", /* format */NULL);
+    }
+
   /* occupancy stats */
   stat_reg_counter(sdb, "IFQ_count", "cumulative IFQ occupancy",
                    &IFQ_count, /* initial value */0, /* format */NULL);
@@ -1284,6 +1908,29 @@ sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
                    "lsq_occupancy / lsq_rate", /* format */NULL);
   stat_reg_formula(sdb, "lsq_full", "fraction of time (cycle's) LSQ was full",
                    "LSQ_fcount / sim_cycle", /* format */NULL);
+  stat_reg_counter(sdb, "lsq_forwards",
+		   "total number of loads forwarded from the LSQ",
+		   &lsq_forwards, /* initial value */0, /* format */NULL);
+  if (storeset_config[0])
+    {
+      stat_reg_counter(sdb, "lsq_ss_deps",
+		       "total number of loads made to wait on a store set",
+		       &lsq_ss_deps, /* initial value */0, /* format */NULL);
+      stat_reg_counter(sdb, "lsq_violations",
+		       "total number of memory order violations",
+		       &lsq_violations, /* initial value */0,
+		       /* format */NULL);
+      stat_reg_counter(sdb, "lsq_replays",
+		       "total number of insts replayed after violations",
+		       &lsq_replays, /* initial value */0, /* format */NULL);
+      stat_reg_formula(sdb, "lsq_violation_rate",
+		       "memory order violations per committed load",
+		       "lsq_violations / sim_num_loads", /* format */NULL);
+    }
+  if (cache_dl1 && cache_dl1->mshrs)
+    stat_reg_counter(sdb, "lsq_mshr_stalls",
+		     "total number of load issues held by full l1 MSHRs",
+		     &lsq_mshr_stalls, /* initial value */0, /* format */NULL);
 
   stat_reg_counter(sdb, "sim_slip",
                    "total number of slip cycles",
@@ -1293,10 +1940,16 @@ sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
                    "the average slip between issue and retirement",
                    "sim_slip / sim_num_insn", NULL);
 
+  /* register the CPI stack */
+  cpi_reg_stats(sdb, "", cpi_slots);
+
   /* register predictor stats */
   if (pred)
     bpred_reg_stats(pred, sdb);
 
+  /* register predecoder stats */
+  predec_reg_stats(pd, sdb);
+
   /* register cache stats */
   if (cache_il1
       && (cache_il1 != cache_dl1 && cache_il1 != cache_dl2))
@@ -1312,6 +1965,8 @@ sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
     cache_reg_stats(itlb, sdb);
   if (dtlb)
     cache_reg_stats(dtlb, sdb);
+  if (dram)
+    dram_reg_stats(dram, sdb, "sim_cycle");
 
   /* debug variable(s) */
   stat_reg_counter(sdb, "sim_invalid_addrs",
@@ -1348,8 +2003,29 @@ sim_reg_stats(struct stat_sdb_t *sdb)   /* stats database */
 					/* format */"0x%lx %lu %.2f",
 					/* print fn */NULL);
     }
+  if (cpi_pcstat)
+    {
+      for (i=0; i < cpi_NUM; i++)
+	{
+	  char buf[512], buf1[512];
+
+	  if (i == cpi_base)
+	    continue;
+	  sprintf(buf, "cpi_slots.%s_by_pc", cpi_comps[i].name);
+	  sprintf(buf1, "commit slots charged to %s (by text address)",
+		  cpi_comps[i].desc);
+	  cpi_pc_sdists[i] = stat_reg_sdist(sdb, buf, buf1,
+					    /* initial value */0,
+					    /* print format */(PF_COUNT|PF_PDF),
+					    /* format */"0x%lx %lu %.2f",
+					    /* print fn */NULL);
+	}
+    }
   ld_reg_stats(sdb);
   mem_reg_stats(mem, sdb);
+
+  if (n_cores > 1)
+    cores_reg_stats(sdb);
 }
 
 /* forward declarations */
@@ -1361,6 +2037,7 @@ static void readyq_init(void);
 static void cv_init(void);
 static void tracer_init(void);
 static void fetch_init(void);
+static void ss_init(void);
 
 /* initialize the simulator */
 void
@@ -1402,6 +2079,25 @@ simoo_mstate_obj(FILE *stream,			/* output stream */
 /* total RS links allocated at program start */
 #define MAX_RS_LINKS                    4096
 
+/* create the additional cores, and load their programs */
+static void cores_create(char **envp);
+
+/* initialize the simulation engine of the running core */
+static void
+engine_init(void)
+{
+  fu_pool = res_create_pool("fu-pool", fu_config, N_ELT(fu_config));
+  rslink_init(MAX_RS_LINKS);
+  tracer_init();
+  fetch_init();
+  cv_init();
+  eventq_init();
+  readyq_init();
+  ruu_init();
+  lsq_init();
+  ss_init();
+}
+
 /* load program into simulated state */
 void
 sim_load_prog(char *fname,		/* program to load */
@@ -1411,6 +2107,14 @@ sim_load_prog(char *fname,		/* program to load */
   /* load program text and data, set up environment, memory, and regs */
   ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
 
+  /* a restored checkpoint sets the inst count, these insts were not
+     simulated in detail */
+  sim_fwd_insn = sim_num_insn;
+  sim_num_insn = 0;
+
+  /* predecode the program text as it is executed */
+  pd = predec_create(mem, ld_text_base, ld_text_size);
+
   /* initialize here, so symbols can be loaded */
   if (ptrace_nelt == 2)
     {
@@ -1425,15 +2129,11 @@ sim_load_prog(char *fname,		/* program to load */
     fatal("bad pipetrace args, use: <fname|stdout|stderr> <range>");
 
   /* finish initialization of the simulation engine */
-  fu_pool = res_create_pool("fu-pool", fu_config, N_ELT(fu_config));
-  rslink_init(MAX_RS_LINKS);
-  tracer_init();
-  fetch_init();
-  cv_init();
-  eventq_init();
-  readyq_init();
-  ruu_init();
-  lsq_init();
+  engine_init();
+
+  /* load the programs of the other cores */
+  if (n_cores > 1)
+    cores_create(envp);
 
   /* initialize the DLite debugger */
   dlite_init(simoo_reg_obj, simoo_mem_obj, simoo_mstate_obj);
@@ -1509,6 +2209,8 @@ struct RUU_station {
   int queued;				/* operands ready and queued */
   int issued;				/* operation is/was executing */
   int completed;			/* operation has completed execution */
+  enum cpi_comp_t cpi_comp;		/* CPI stack component charged while
+					   executing at the RUU head */
   /* output operand dependency list, these lists are used to
      limit the number of associative searches into the RUU when
      instructions complete and need to wake up dependent insts */
@@ -1522,6 +2224,15 @@ struct RUU_station {
      operands are known to be read (see lsq_refresh() for details on
      enforcing memory dependencies) */
   int idep_ready[MAX_IDEPS];		/* input operand ready? */
+
+  /* memory dependence state of LSQ entries (see lsq_refresh()) */
+  struct RUU_station *addr_older;	/* next older load (store) in the
+					   LSQ with the same address hash */
+  struct RS_link *ld_waiters;		/* loads waiting for the store
+					   value of this store */
+  struct RUU_station *ss_dep;		/* store a load is predicted to
+					   depend on, see ss_dispatch() */
+  INST_TAG_TYPE ss_dep_tag;		/* tag of the SS_DEP instance */
 };
 
 /* non-zero if all register operands are ready, update with MAX_IDEPS */
@@ -1534,6 +2245,20 @@ static struct RUU_station *RUU;		/* register update unit */
 static int RUU_head, RUU_tail;		/* RUU head and tail pointers */
 static int RUU_num;			/* num entries currently in RUU */
 
+/* instructions squashed by a memory order violation, the functional
+   simulator has already executed them, so ruu_dispatch() re-dispatches
+   them from this circular queue before taking insts from the IFQ */
+struct replay_rec {
+  md_inst_t IR;				/* instruction bits */
+  md_addr_t PC, next_PC, pred_PC;	/* inst PC, next PC, predicted PC */
+  md_addr_t addr;			/* effective address of ld/st's */
+  struct bpred_update_t dir_update;	/* bpred direction update info */
+  int stack_recover_idx;		/* bpred retstack recovery idx */
+};
+static struct replay_rec *replay_data;	/* replay queue, RUU_size entries */
+static int replay_head, replay_num;	/* replay queue head and size */
+static tick_t replay_cycle;		/* cycle replay may start */
+
 /* allocate and initialize register update unit (RUU) */
 static void
 ruu_init(void)
@@ -1542,6 +2267,12 @@ ruu_init(void)
   if (!RUU)
     fatal("out of virtual memory");
 
+  replay_data = calloc(RUU_size, sizeof(struct replay_rec));
+  if (!replay_data)
+    fatal("out of virtual memory");
+  replay_head = replay_num = 0;
+  replay_cycle = 0;
+
   RUU_num = 0;
   RUU_head = RUU_tail = 0;
   RUU_count = 0;
@@ -1652,6 +2383,25 @@ static int LSQ_num;                     /* num entries currently in LSQ */
 #define STORE_OP_READY(RS)              ((RS)->idep_ready[STORE_OP_INDEX])
 #define STORE_ADDR_READY(RS)            ((RS)->idep_ready[STORE_ADDR_INDEX])
 
+/* number of LSQ entries, starting at the head, that have been checked by
+   lsq_refresh(), without a store set predictor this stops at the oldest
+   store with an unknown address, as later loads cannot issue */
+static int lsq_scanned;
+
+/* stores (and loads, with a store set predictor) in the LSQ indexed by
+   address, each bucket lists its entries from youngest to oldest through
+   their ADDR_OLDER links */
+static struct RUU_station **lsq_st_hash;
+static struct RUU_station **lsq_ld_hash;
+static int lsq_addr_hash_mask;
+
+/* LSQ address index bucket of address ADDR */
+#define LSQ_ADDR_HASH(ADDR)						\
+  ((((ADDR) >> 2) ^ ((ADDR) >> 12)) & lsq_addr_hash_mask)
+
+/* loads whose memory readiness must be checked by the next lsq_refresh() */
+static struct RS_link *lsq_wakeups;
+
 /* allocate and initialize the load/store queue (LSQ) */
 static void
 lsq_init(void)
@@ -1660,10 +2410,26 @@ lsq_init(void)
   if (!LSQ)
     fatal("out of virtual memory");
 
-  LSQ_num = 0;
-  LSQ_head = LSQ_tail = 0;
-  LSQ_count = 0;
-  LSQ_fcount = 0;
+  lsq_addr_hash_mask = 2*LSQ_size - 1;
+  lsq_st_hash = calloc(2*LSQ_size, sizeof(struct RUU_station *));
+  if (!lsq_st_hash)
+    fatal("out of virtual memory");
+  lsq_ld_hash = NULL;
+  if (storeset_config[0])
+    {
+      lsq_ld_hash = calloc(2*LSQ_size, sizeof(struct RUU_station *));
+      if (!lsq_ld_hash)
+	fatal("out of virtual memory");
+    }
+
+  LSQ_num = 0;
+  LSQ_head = LSQ_tail = 0;
+  lsq_scanned = 0;
+  lsq_wakeups = NULL;
+  lsq_forwards = 0;
+  lsq_mshr_stalls = 0;
+  LSQ_count = 0;
+  LSQ_fcount = 0;
 }
 
 /* dump the contents of the RUU */
@@ -1785,54 +2551,60 @@ rslink_init(int nlinks)			/* total number of RS_LINK available */
 }
 
 /* service all functional unit release events, this function is called
-   once per cycle, and it used to step the BUSY timers attached to each
-   functional unit in the function unit resource pool, as long as a functional
-   unit's BUSY count is > 0, it cannot be issued an operation */
+   once per cycle, it advances the release timing wheel of the functional
+   unit resource pool, a functional unit stays busy (and cannot be issued
+   an operation) until its issue latency has elapsed */
 static void
 ruu_release_fu(void)
 {
-  int i;
-
-  /* walk all resource units, decrement busy counts by one */
-  for (i=0; i<fu_pool->num_resources; i++)
-    {
-      /* resource is released when BUSY hits zero */
-      if (fu_pool->resources[i].busy > 0)
-	fu_pool->resources[i].busy--;
-    }
+  res_release(fu_pool);
 }
 
 
 /*
  * the execution unit event queue implementation follows, the event queue
  * indicates which instruction will complete next, the writeback handler
- * drains this queue
+ * drains this queue; events are kept on a timing wheel with one slot per
+ * cycle, so queueing an event and finding the events of a cycle take
+ * constant time, events too far in the future for the wheel wait on a
+ * sorted overflow list until the wheel reaches them
  */
 
-/* pending event queue, sorted from soonest to latest event (in time), NOTE:
-   RS_LINK nodes are used for the event queue list so that it need not be
-   updated during squash events */
-static struct RS_link *event_queue;
+/* number of cycles covered by the timing wheel, must be a power of two */
+#define EVENTQ_WHEEL_SIZE		512
+
+/* timing wheel slot holding the events of cycle WHEN */
+#define EVENTQ_SLOT(WHEN)		((WHEN) & (EVENTQ_WHEEL_SIZE-1))
+
+/* pending events, slot EVENTQ_SLOT(WHEN) lists the events of cycle WHEN for
+   cycles eventq_cycle to eventq_cycle+EVENTQ_WHEEL_SIZE-1, most recently
+   queued first; later events are on the overflow list, sorted from soonest
+   to latest event (in time), NOTE: RS_LINK nodes are used for the event
+   lists so that they need not be updated during squash events */
+static struct RS_link *event_wheel[EVENTQ_WHEEL_SIZE];
+static struct RS_link *event_overflow;
+
+/* earliest cycle with events that may not yet be serviced */
+static tick_t eventq_cycle;
 
 /* initialize the event queue structures */
 static void
 eventq_init(void)
 {
-  event_queue = NULL;
+  int i;
+
+  for (i=0; i<EVENTQ_WHEEL_SIZE; i++)
+    event_wheel[i] = NULL;
+  event_overflow = NULL;
+  eventq_cycle = 0;
 }
 
-/* dump the contents of the event queue */
+/* dump the event list EV */
 static void
-eventq_dump(FILE *stream)			/* output stream */
+eventq_dump_list(FILE *stream,			/* output stream */
+		 struct RS_link *ev)		/* event list */
 {
-  struct RS_link *ev;
-
-  if (!stream)
-    stream = stderr;
-
-  fprintf(stream, "** event queue state **\n");
-
-  for (ev = event_queue; ev != NULL; ev = ev->next)
+  for (; ev != NULL; ev = ev->next)
     {
       /* is event still valid? */
       if (RSLINK_VALID(ev))
@@ -1847,9 +2619,47 @@ eventq_dump(FILE *stream)			/* output stream */
     }
 }
 
-/* insert an event for RS into the event queue, event queue is sorted from
-   earliest to latest event, event and associated side-effects will be
-   apparent at the start of cycle WHEN */
+/* dump the contents of the event queue */
+static void
+eventq_dump(FILE *stream)			/* output stream */
+{
+  int i;
+
+  if (!stream)
+    stream = stderr;
+
+  fprintf(stream, "** event queue state **\n");
+
+  for (i=0; i<EVENTQ_WHEEL_SIZE; i++)
+    eventq_dump_list(stream, event_wheel[EVENTQ_SLOT(eventq_cycle + i)]);
+  eventq_dump_list(stream, event_overflow);
+}
+
+/* move events from the overflow list onto the timing wheel once their cycle
+   is covered by it, they are placed behind any events already in the slot,
+   as those (if any) were queued later */
+static void
+eventq_migrate(void)
+{
+  struct RS_link *ev, **tail;
+
+  while (event_overflow
+	 && event_overflow->x.when < eventq_cycle + EVENTQ_WHEEL_SIZE)
+    {
+      ev = event_overflow;
+      event_overflow = event_overflow->next;
+
+      for (tail = &event_wheel[EVENTQ_SLOT(ev->x.when)];
+	   *tail != NULL;
+	   tail = &(*tail)->next);
+      ev->next = NULL;
+      *tail = ev;
+    }
+}
+
+/* insert an event for RS into the event queue, events of the same cycle are
+   serviced most recently queued first, event and associated side-effects
+   will be apparent at the start of cycle WHEN */
 static void
 eventq_queue_event(struct RUU_station *rs, tick_t when)
 {
@@ -1865,8 +2675,16 @@ eventq_queue_event(struct RUU_station *rs, tick_t when)
   RSLINK_NEW(new_ev, rs);
   new_ev->x.when = when;
 
-  /* locate insertion point */
-  for (prev=NULL, ev=event_queue;
+  if (when < eventq_cycle + EVENTQ_WHEEL_SIZE)
+    {
+      /* insert at the beginning of the cycle's wheel slot */
+      new_ev->next = event_wheel[EVENTQ_SLOT(when)];
+      event_wheel[EVENTQ_SLOT(when)] = new_ev;
+      return;
+    }
+
+  /* beyond the wheel, locate insertion point in the overflow list */
+  for (prev=NULL, ev=event_overflow;
        ev && ev->x.when < when;
        prev=ev, ev=ev->next);
 
@@ -1879,8 +2697,8 @@ eventq_queue_event(struct RUU_station *rs, tick_t when)
   else
     {
       /* insert at beginning */
-      new_ev->next = event_queue;
-      event_queue = new_ev;
+      new_ev->next = event_overflow;
+      event_overflow = new_ev;
     }
 }
 
@@ -1891,37 +2709,67 @@ eventq_next_event(void)
 {
   struct RS_link *ev;
 
-  if (event_queue && event_queue->x.when <= sim_cycle)
+  while (eventq_cycle <= sim_cycle)
     {
-      /* unlink and return first event on priority list */
-      ev = event_queue;
-      event_queue = event_queue->next;
-
-      /* event still valid? */
-      if (RSLINK_VALID(ev))
+      while ((ev = event_wheel[EVENTQ_SLOT(eventq_cycle)]) != NULL)
 	{
-	  struct RUU_station *rs = RSLINK_RS(ev);
+	  /* unlink and return first event of the slot */
+	  event_wheel[EVENTQ_SLOT(eventq_cycle)] = ev->next;
 
-	  /* reclaim event record */
-	  RSLINK_FREE(ev);
+	  /* event still valid? */
+	  if (RSLINK_VALID(ev))
+	    {
+	      struct RUU_station *rs = RSLINK_RS(ev);
 
-	  /* event is valid, return resv station */
-	  return rs;
-	}
-      else
-	{
-	  /* reclaim event record */
-	  RSLINK_FREE(ev);
+	      /* reclaim event record */
+	      RSLINK_FREE(ev);
+
+	      /* event is valid, return resv station */
+	      return rs;
+	    }
 
-	  /* receiving inst was squashed, return next event */
-	  return eventq_next_event();
+	  /* receiving inst was squashed, reclaim event record and return
+	     next event */
+	  RSLINK_FREE(ev);
 	}
+
+      /* all events of this cycle have been serviced, advance the wheel */
+      eventq_cycle++;
+      eventq_migrate();
     }
-  else
+
+  /* no event or no event is ready */
+  return NULL;
+}
+
+/* return the cycle of the earliest pending event, squashed events included,
+   returns zero if the event queue is empty */
+static tick_t
+eventq_next_time(void)
+{
+  int i;
+
+  for (i=0; i<EVENTQ_WHEEL_SIZE; i++)
     {
-      /* no event or no event is ready */
-      return NULL;
+      if (event_wheel[EVENTQ_SLOT(eventq_cycle + i)] != NULL)
+	return eventq_cycle + i;
     }
+  return event_overflow ? event_overflow->x.when : 0;
+}
+
+/* discard all pending events, used when the pipeline is flushed */
+static void
+eventq_flush(void)
+{
+  int i;
+
+  for (i=0; i<EVENTQ_WHEEL_SIZE; i++)
+    {
+      RSLINK_FREE_LIST(event_wheel[i]);
+      event_wheel[i] = NULL;
+    }
+  RSLINK_FREE_LIST(event_overflow);
+  event_overflow = NULL;
 }
 
 
@@ -1930,27 +2778,53 @@ eventq_next_event(void)
  * queue indicates which instruction have all of there *register* dependencies
  * satisfied, instruction will issue when 1) all memory dependencies for
  * the instruction have been satisfied (see lsq_refresh() for details on how
- * this is accomplished) and 2) resources are available; ready queue is fully
- * constructed each cycle before any operation is issued from it -- this
- * ensures that instruction issue priorities are properly observed; NOTE:
- * RS_LINK nodes are used for the event queue list so that it need not be
- * updated during squash events
+ * this is accomplished) and 2) resources are available; the ready queue is
+ * kept in ready list order (see readyq_enqueue()) as a binary heap of runs:
+ * a run starts with an instruction younger than all of those ahead of it in
+ * the list, and runs are ordered by the sequence of that instruction, so
+ * instructions are enqueued and visited in logarithmic time; the ready queue
+ * is rebuilt as it is issued from (see ruu_issue()) -- this ensures that
+ * instruction issue priorities are properly observed; NOTE: RS_LINK nodes
+ * are used for the ready queue so that it need not be updated during squash
+ * events, squashed entries are discarded when they are visited
  */
 
-/* the ready instruction queue */
-static struct RS_link *ready_queue;
+/* ready queue run, a list of ready instructions in issue order */
+struct readyq_run {
+  INST_SEQ_TYPE seq;			/* seq of the first inst of the run */
+  struct RS_link *head, *tail;		/* ready insts, x.seq holds their seq */
+};
 
-/* initialize the event queue structures */
+/* a ready instruction queue, a binary heap of NUM runs */
+struct readyq_t {
+  struct readyq_run *runs;		/* run heap, lowest seq first */
+  int num;				/* number of runs in the heap */
+};
+
+/* the ready instruction queue, and the spare run heap it is rebuilt into
+   while it is issued from */
+static struct readyq_t ready_queue;
+static struct readyq_run *readyq_spare;
+
+/* initialize the ready queue structures */
 static void
 readyq_init(void)
 {
-  ready_queue = NULL;
+  /* every run holds an RS link, so the links bound the queue size */
+  ready_queue.runs =
+    (struct readyq_run *)calloc(MAX_RS_LINKS, sizeof(struct readyq_run));
+  readyq_spare =
+    (struct readyq_run *)calloc(MAX_RS_LINKS, sizeof(struct readyq_run));
+  if (!ready_queue.runs || !readyq_spare)
+    fatal("out of virtual memory");
+  ready_queue.num = 0;
 }
 
 /* dump the contents of the ready queue */
 static void
 readyq_dump(FILE *stream)			/* output stream */
 {
+  int i;
   struct RS_link *link;
 
   if (!stream)
@@ -1958,19 +2832,88 @@ readyq_dump(FILE *stream)			/* output stream */
 
   fprintf(stream, "** ready queue state **\n");
 
-  for (link = ready_queue; link != NULL; link = link->next)
+  for (i=0; i<ready_queue.num; i++)
     {
-      /* is entry still valid? */
-      if (RSLINK_VALID(link))
+      for (link = ready_queue.runs[i].head; link != NULL; link = link->next)
 	{
-	  struct RUU_station *rs = RSLINK_RS(link);
+	  /* is entry still valid? */
+	  if (RSLINK_VALID(link))
+	    {
+	      struct RUU_station *rs = RSLINK_RS(link);
 
-	  ruu_dumpent(rs, rs - (rs->in_LSQ ? LSQ : RUU),
-		      stream, /* header */TRUE);
+	      ruu_dumpent(rs, rs - (rs->in_LSQ ? LSQ : RUU),
+			  stream, /* header */TRUE);
+	    }
 	}
     }
 }
 
+/* insert run RUN into the run heap of ready queue Q */
+static void
+readyq_push(struct readyq_t *q,			/* ready queue */
+	    struct readyq_run run)		/* run to insert */
+{
+  int i, parent;
+
+  if (q->num >= MAX_RS_LINKS)
+    panic("ready queue overflow");
+
+  /* sift up from the new leaf */
+  for (i=q->num++; i > 0; i=parent)
+    {
+      parent = (i - 1) / 2;
+      if (q->runs[parent].seq < run.seq)
+	break;
+      q->runs[i] = q->runs[parent];
+    }
+  q->runs[i] = run;
+}
+
+/* remove the first run of ready queue Q into *RUN, returns zero if the
+   ready queue is empty */
+static int
+readyq_pop(struct readyq_t *q,			/* ready queue */
+	   struct readyq_run *run)		/* removed run */
+{
+  int i, child;
+  struct readyq_run last;
+
+  if (q->num == 0)
+    return FALSE;
+
+  *run = q->runs[0];
+
+  /* sift the last leaf down from the root */
+  last = q->runs[--q->num];
+  for (i=0; (child = 2*i + 1) < q->num; i=child)
+    {
+      if (child + 1 < q->num && q->runs[child+1].seq < q->runs[child].seq)
+	child++;
+      if (last.seq < q->runs[child].seq)
+	break;
+      q->runs[i] = q->runs[child];
+    }
+  q->runs[i] = last;
+
+  return TRUE;
+}
+
+/* return the next ready queue entry of Q in issue order, *RUN is the run
+   being visited and must start out empty, returns NULL when Q is empty */
+static struct RS_link *
+readyq_next(struct readyq_t *q,			/* ready queue */
+	    struct readyq_run *run)		/* run being visited */
+{
+  struct RS_link *link;
+
+  if (!run->head && !readyq_pop(q, run))
+    return NULL;
+
+  link = run->head;
+  run->head = link->next;
+  return link;
+}
+
 /* insert ready node into the ready list using ready instruction scheduling
    policy; currently the following scheduling policy is enforced:
 
@@ -1983,11 +2926,12 @@ readyq_dump(FILE *stream)			/* output stream */
   this policy works well because branches pass through the machine quicker
   which works to reduce branch misprediction latencies, and very long latency
   instructions (such loads and multiplies) get priority since they are very
-  likely on the program's critical path */
+  likely on the program's critical path; the first are put at the head of
+  the ready list, the others ahead of the first younger inst in the list */
 static void
 readyq_enqueue(struct RUU_station *rs)		/* RS to enqueue */
 {
-  struct RS_link *prev, *node, *new_node;
+  struct readyq_run run, next;
 
   /* node is now queued */
   if (rs->queued)
@@ -1995,36 +2939,349 @@ readyq_enqueue(struct RUU_station *rs)		/* RS to enqueue */
   rs->queued = TRUE;
 
   /* get a free ready list node */
-  RSLINK_NEW(new_node, rs);
-  new_node->x.seq = rs->seq;
+  RSLINK_NEW(run.head, rs);
+  run.head->x.seq = rs->seq;
+  run.tail = run.head;
+  run.seq = rs->seq;
 
-  /* locate insertion point */
   if (rs->in_LSQ || MD_OP_FLAGS(rs->op) & (F_LONGLAT|F_CTRL))
     {
-      /* insert loads/stores and long latency ops at the head of the queue */
-      prev = NULL;
-      node = ready_queue;
+      /* insert loads/stores and long latency ops at the head of the queue,
+	 the runs of older insts are now led by this one */
+      while (ready_queue.num > 0 && ready_queue.runs[0].seq < rs->seq)
+	{
+	  readyq_pop(&ready_queue, &next);
+	  run.tail->next = next.head;
+	  run.tail = next.tail;
+	}
     }
+  /* else, the first younger inst in the list starts a run, so the inst
+     starts a run of its own just ahead of it */
+
+  readyq_push(&ready_queue, run);
+}
+
+/* discard all ready queue entries, used when the pipeline is flushed */
+static void
+readyq_flush(void)
+{
+  int i;
+
+  for (i=0; i<ready_queue.num; i++)
+    RSLINK_FREE_LIST(ready_queue.runs[i].head);
+  ready_queue.num = 0;
+}
+
+
+/*
+ * the LSQ memory dependence index tracks which loads may issue without
+ * rescanning the LSQ each cycle: loads older than the oldest store with an
+ * unknown address are checked once against the youngest older store to the
+ * same address, found through a store address hash, and if that store's
+ * value is still unknown the load waits on the store's wait list
+ *
+ * with a store set predictor (-lsq:storeset), loads also issue past stores
+ * with unknown addresses, unless the store set identifier table (SSIT)
+ * groups the load with a store in flight, found in the last fetched store
+ * table (LFST); when a store address becomes known, any later load to the
+ * same address that has already issued is a memory order violation, the
+ * load and all later insts are squashed and the load and store are put in
+ * the same store set (G. Chrysos and J. Emer, ISCA 1998)
+ */
+
+/* position of LSQ entry RS, counted from the LSQ head */
+#define LSQ_POS(RS)	((int)(((RS) - LSQ) + LSQ_size - LSQ_head) % LSQ_size)
+
+/* LSQ entry RS is a store (load)? */
+#define LSQ_IS_STORE(RS)						\
+  ((MD_OP_FLAGS((RS)->op) & (F_MEM|F_STORE)) == (F_MEM|F_STORE))
+#define LSQ_IS_LOAD(RS)							\
+  ((MD_OP_FLAGS((RS)->op) & (F_MEM|F_LOAD)) == (F_MEM|F_LOAD))
+
+/* SSIT, maps an inst PC to a store set id, -1 for none */
+static int *ss_ssit;
+
+/* LFST, the last dispatched store of each store set */
+static struct RS_link *ss_lfst;
+
+/* next store set id to allocate */
+static int ss_next_id;
+
+/* cycle of the next periodic SSIT clear, which forgets stale store sets */
+static tick_t ss_clear_cycle;
+
+/* SSIT clear interval, in cycles */
+#define SS_CLEAR_INTERVAL		1000000
+
+/* SSIT entry of inst PC */
+#define SS_SSIT(PC)							\
+  ss_ssit[((PC) / sizeof(md_inst_t)) & (storeset_config[0] - 1)]
+
+/* the oldest load found by lsq_store_addr_known() to have violated memory
+   order this cycle, and the PC of the store it violated */
+static struct RS_link lsq_violation = RSLINK_NULL_DATA;
+static md_addr_t lsq_violation_st_PC;
+
+/* allocate and initialize the store set predictor, if configured */
+static void
+ss_init(void)
+{
+  int i;
+
+  lsq_violation = RSLINK_NULL;
+  if (!storeset_config[0])
+    return;
+
+  ss_ssit = calloc(storeset_config[0], sizeof(int));
+  ss_lfst = calloc(storeset_config[1], sizeof(struct RS_link));
+  if (!ss_ssit || !ss_lfst)
+    fatal("out of virtual memory");
+
+  for (i=0; i < storeset_config[0]; i++)
+    ss_ssit[i] = -1;
+  for (i=0; i < storeset_config[1]; i++)
+    ss_lfst[i] = RSLINK_NULL;
+  ss_next_id = 0;
+  ss_clear_cycle = SS_CLEAR_INTERVAL;
+}
+
+/* put the load at LD_PC and the store at ST_PC, which it violated, in the
+   same store set, merging their sets if both already have one */
+static void
+ss_train(md_addr_t ld_PC,			/* PC of violating load */
+	 md_addr_t st_PC)			/* PC of violated store */
+{
+  int *ld_ss = &SS_SSIT(ld_PC), *st_ss = &SS_SSIT(st_PC);
+
+  if (*ld_ss < 0 && *st_ss < 0)
+    {
+      /* new store set */
+      *ld_ss = *st_ss = ss_next_id;
+      ss_next_id = (ss_next_id + 1) % storeset_config[1];
+    }
+  else if (*ld_ss < 0)
+    *ld_ss = *st_ss;
+  else if (*st_ss < 0)
+    *st_ss = *ld_ss;
   else
     {
-      /* otherwise insert in program order (earliest seq first) */
-      for (prev=NULL, node=ready_queue;
-	   node && node->x.seq < rs->seq;
-	   prev=node, node=node->next);
+      /* both have a set, the smaller id wins so sets converge */
+      *ld_ss = *st_ss = MIN(*ld_ss, *st_ss);
     }
+}
 
-  if (prev)
+/* look up dispatched LSQ entry RS in the store set predictor: a load in a
+   store set depends on the last dispatched store of its set, a store
+   becomes the last dispatched store of its set */
+static void
+ss_dispatch(struct RUU_station *rs)		/* LSQ entry */
+{
+  int i, id;
+  struct RS_link *lfst;
+
+  rs->ss_dep = NULL;
+  rs->ss_dep_tag = 0;
+  if (!storeset_config[0])
+    return;
+
+  if (sim_cycle >= ss_clear_cycle)
     {
-      /* insert middle or end */
-      new_node->next = prev->next;
-      prev->next = new_node;
+      for (i=0; i < storeset_config[0]; i++)
+	ss_ssit[i] = -1;
+      ss_clear_cycle = sim_cycle + SS_CLEAR_INTERVAL;
+    }
+
+  id = SS_SSIT(rs->PC);
+  if (id < 0)
+    return;
+  lfst = &ss_lfst[id];
+
+  if (LSQ_IS_STORE(rs))
+    RSLINK_INIT(*lfst, rs);
+  else if (LSQ_IS_LOAD(rs)
+	   && !RSLINK_IS_NULL(lfst) && RSLINK_VALID(lfst))
+    {
+      rs->ss_dep = RSLINK_RS(lfst);
+      rs->ss_dep_tag = lfst->tag;
+      lsq_ss_deps++;
     }
+}
+
+/* add LSQ entry RS, the youngest entry in the LSQ, to the address index of
+   its kind, loads are only indexed with a store set predictor */
+static void
+lsq_addr_insert(struct RUU_station *rs)		/* LSQ entry to add */
+{
+  struct RUU_station **bucket;
+
+  rs->addr_older = NULL;
+  rs->ld_waiters = NULL;
+  if (LSQ_IS_STORE(rs))
+    bucket = &lsq_st_hash[LSQ_ADDR_HASH(rs->addr)];
+  else if (LSQ_IS_LOAD(rs) && lsq_ld_hash)
+    bucket = &lsq_ld_hash[LSQ_ADDR_HASH(rs->addr)];
+  else
+    return;
+
+  rs->addr_older = *bucket;
+  *bucket = rs;
+}
+
+/* remove LSQ entry RS from the address index, RS is either the youngest
+   (squashed) or the oldest (committed) entry of its bucket */
+static void
+lsq_addr_remove(struct RUU_station *rs)		/* LSQ entry to remove */
+{
+  struct RUU_station **prev;
+
+  if (LSQ_IS_STORE(rs))
+    prev = &lsq_st_hash[LSQ_ADDR_HASH(rs->addr)];
+  else if (LSQ_IS_LOAD(rs) && lsq_ld_hash)
+    prev = &lsq_ld_hash[LSQ_ADDR_HASH(rs->addr)];
   else
+    return;
+
+  for (; *prev != rs; prev = &(*prev)->addr_older)
     {
-      /* insert at beginning */
-      new_node->next = ready_queue;
-      ready_queue = new_node;
+      if (!*prev)
+	panic("LSQ entry not in the LSQ address index");
     }
+  *prev = rs->addr_older;
+  rs->addr_older = NULL;
+
+  /* any loads still waiting on the store are squashed with it */
+  RSLINK_FREE_LIST(rs->ld_waiters);
+  rs->ld_waiters = NULL;
+}
+
+/* the register operands of LSQ entry RS are now ready, schedule the loads
+   whose memory readiness this may change for the next lsq_refresh() */
+static void
+lsq_wakeup(struct RUU_station *rs)		/* LSQ entry */
+{
+  struct RS_link *link;
+
+  if (LSQ_IS_STORE(rs))
+    {
+      /* store value is known, recheck the loads waiting on it */
+      if (rs->ld_waiters)
+	{
+	  for (link = rs->ld_waiters; link->next != NULL; link = link->next);
+	  link->next = lsq_wakeups;
+	  lsq_wakeups = rs->ld_waiters;
+	  rs->ld_waiters = NULL;
+	}
+    }
+  else if (LSQ_IS_LOAD(rs))
+    {
+      /* load address is known, check the load */
+      RSLINK_NEW(link, rs);
+      link->next = lsq_wakeups;
+      lsq_wakeups = link;
+    }
+}
+
+/* return the youngest store older than load RS with a known address that
+   matches the load's, or NULL if there is none */
+static struct RUU_station *
+lsq_store_before(struct RUU_station *rs)	/* load */
+{
+  struct RUU_station *st;
+
+  for (st = lsq_st_hash[LSQ_ADDR_HASH(rs->addr)]; st; st = st->addr_older)
+    {
+      if (st->seq < rs->seq && st->addr == rs->addr && STORE_ADDR_READY(st))
+	break;
+    }
+  return st;
+}
+
+/* return the store load RS must wait for before it can issue, i.e., its
+   store set dependence or the youngest older store to its address, if the
+   store's operands are not yet known, else NULL */
+static struct RUU_station *
+lsq_load_blocker(struct RUU_station *rs)	/* load */
+{
+  struct RUU_station *st;
+
+  if (rs->ss_dep && rs->ss_dep->tag == rs->ss_dep_tag
+      && !OPERANDS_READY(rs->ss_dep))
+    return rs->ss_dep;
+
+  st = lsq_store_before(rs);
+  if (st && !OPERANDS_READY(st))
+    return st;
+
+  return NULL;
+}
+
+/* check if load RS, which no unknown store address blocks, can issue:
+   enqueue it if its address is known and no store it depends on lacks its
+   value, else wait on that store */
+static void
+lsq_check_load(struct RUU_station *rs)		/* load to check */
+{
+  struct RUU_station *st;
+  struct RS_link *link;
+
+  if (rs->queued || rs->issued || rs->completed || !OPERANDS_READY(rs))
+    return;
+
+  if ((st = lsq_load_blocker(rs)) != NULL)
+    {
+      /* STD unknown, check the load again once the store value is known */
+      RSLINK_NEW(link, rs);
+      link->next = st->ld_waiters;
+      st->ld_waiters = link;
+    }
+  else
+    {
+      /* no STA or STD unknown conflicts, put load on ready queue */
+      readyq_enqueue(rs);
+    }
+}
+
+/* the address of store ST just became known, look for later loads to the
+   same address that have already issued and thus read a stale value */
+static void
+lsq_store_addr_known(struct RUU_station *st)	/* store */
+{
+  struct RUU_station *ld;
+
+  for (ld = lsq_ld_hash[LSQ_ADDR_HASH(st->addr)];
+       ld && ld->seq > st->seq;
+       ld = ld->addr_older)
+    {
+      if (ld->addr != st->addr || !ld->issued || ld->spec_mode
+	  || lsq_store_before(ld) != st)
+	continue;
+
+      /* violation, keep the oldest violating load */
+      if (RSLINK_IS_NULL(&lsq_violation) || !RSLINK_VALID(&lsq_violation)
+	  || ld->seq < RSLINK_RS(&lsq_violation)->seq)
+	{
+	  RSLINK_INIT(lsq_violation, ld);
+	  lsq_violation_st_PC = st->PC;
+	}
+    }
+}
+
+/* discard the LSQ memory dependence state, used when the LSQ is emptied */
+static void
+lsq_deps_flush(void)
+{
+  int i;
+
+  for (i=0; i <= lsq_addr_hash_mask; i++)
+    {
+      lsq_st_hash[i] = NULL;
+      if (lsq_ld_hash)
+	lsq_ld_hash[i] = NULL;
+    }
+  RSLINK_FREE_LIST(lsq_wakeups);
+  lsq_wakeups = NULL;
+  lsq_scanned = 0;
+  lsq_violation = RSLINK_NULL;
 }
 
 
@@ -2126,6 +3383,147 @@ cv_dump(FILE *stream)				/* output stream */
  *  RUU_COMMIT() - instruction retirement pipeline stage
  */
 
+/* the CPI stack component that keeps the RUU head from retiring, or, if the
+   RUU is empty, the last stall of the front end, *PC is set to the address
+   of the inst charged */
+static enum cpi_comp_t
+cpi_stall(md_addr_t *PC)		/* address of inst charged */
+{
+  enum cpi_comp_t comp;
+  struct RUU_station *rs;
+
+  if (RUU_num == 0)
+    {
+      comp = cpi_front;
+      *PC = cpi_front_PC;
+    }
+  else
+    {
+      /* a completed load/store address computation waits for its
+	 memory access */
+      rs = &RUU[RUU_head];
+      *PC = rs->PC;
+      if (rs->completed && rs->ea_comp && !LSQ[LSQ_head].completed)
+	rs = &LSQ[LSQ_head];
+
+      if (rs->completed)
+	{
+	  /* a store found no store port */
+	  comp = cpi_fu;
+	}
+      else if (rs->issued)
+	comp = rs->cpi_comp;
+      else if (rs->queued)
+	{
+	  /* ready, but found no FU or MSHR */
+	  comp = cpi_fu;
+	}
+      else
+	comp = cpi_dep;
+
+      /* the window filled up behind the head */
+      if (comp == cpi_dep && RUU_num == RUU_size)
+	comp = cpi_ruu_full;
+      else if (comp == cpi_dep && LSQ_num == LSQ_size)
+	comp = cpi_lsq_full;
+    }
+
+  return comp;
+}
+
+/* charge N commit slots that retired no inst to CPI stack component COMP,
+   the inst at PC is blamed for them */
+static void
+cpi_charge(enum cpi_comp_t comp,	/* component to charge */
+	   md_addr_t PC,		/* address of inst charged */
+	   counter_t n)			/* number of commit slots */
+{
+  cpi_slots[comp] += n;
+  cpi_last = comp;
+  if (cpi_pc_sdists[comp])
+    stat_add_samples(cpi_pc_sdists[comp], PC, n);
+}
+
+/* charge the commit slots of the cycle that ends */
+static void
+cpi_cycle_end(void)
+{
+  cpi_slots[cpi_base] += cpi_cycle_base;
+  if (cpi_cycle_base < ruu_commit_width)
+    cpi_charge(cpi_cycle_comp, cpi_cycle_PC,
+	       ruu_commit_width - cpi_cycle_base);
+}
+
+/* the core stops with insts in flight, which sim_num_insn counts as they
+   were executed at dispatch, but which never retire: charge each of them a
+   base slot, taken from the lost slots, those of the component last charged
+   first, so that the stack still sums to the commit slots of the cycles
+   simulated, EXITING is set if the program exits in the current cycle */
+static void
+cpi_drain(int exiting)			/* program exits in this cycle? */
+{
+  int i;
+  counter_t n, m;
+  enum cpi_comp_t comp;
+
+  /* the non-speculative insts in the RUU or waiting for replay, and the
+     NOPs not yet retired */
+  n = cpi_nops + replay_num;
+  for (i=0; i < RUU_num; i++)
+    {
+      if (!RUU[(RUU_head + i) % RUU_size].spec_mode)
+	n++;
+    }
+  cpi_nops = 0;
+
+  /* the cycle the program exits in is not counted, neither are the insts
+     retired in it, and the exit system call is never dispatched */
+  if (exiting)
+    {
+      n += cpi_cycle_base + 1;
+      cpi_cycle_base = ruu_commit_width;
+    }
+
+  for (i=0, comp=cpi_last; n > 0 && i < cpi_NUM; i++)
+    {
+      if (comp != cpi_base)
+	{
+	  m = MIN(n, cpi_slots[comp]);
+	  cpi_slots[comp] -= m;
+	  cpi_slots[cpi_base] += m;
+	  n -= m;
+	}
+      comp = (enum cpi_comp_t)((comp + 1) % cpi_NUM);
+    }
+}
+
+/* check that the CPI stack charged each commit slot of the cycles simulated
+   once, and one base slot to each inst */
+static void
+cpi_check(void)
+{
+  int i;
+  counter_t slots = 0;
+
+  for (i=0; i < cpi_NUM; i++)
+    slots += cpi_slots[i];
+  if (slots != ruu_commit_width * sim_cycle)
+    panic("CPI stack charged %.0f commit slots in %.0f cycles",
+	  (double)slots, (double)sim_cycle);
+  if (cpi_slots[cpi_base] != sim_num_insn)
+    panic("CPI stack charged %.0f base slots for %.0f insts",
+	  (double)cpi_slots[cpi_base], (double)sim_num_insn);
+}
+
+/* close the CPI stack when the core stops, EXITING is set if its program
+   exits in the current cycle */
+static void
+cpi_finish(int exiting)			/* program exits in this cycle? */
+{
+  cpi_drain(exiting);
+  cpi_check();
+}
+
 /* this function commits the results of the oldest completed entries from the
    RUU and LSQ to the architected reg file, stores in the LSQ will commit
    their store data to the data cache at this point as well */
@@ -2134,6 +3532,7 @@ ruu_commit(void)
 {
   int i, lat, events, committed = 0;
   static counter_t sim_ret_insn = 0;
+  counter_t nops;
 
   /* all values must be retired to the architected reg file in program order */
   while (RUU_num > 0 && committed < ruu_commit_width)
@@ -2179,7 +3578,7 @@ ruu_commit(void)
 		    panic("functional unit already in use");
 
 		  /* schedule functional unit release event */
-		  fu->master->busy = fu->issuelat;
+		  res_reserve(fu_pool, fu);
 
 		  /* go to the data cache */
 		  if (cache_dl1)
@@ -2187,7 +3586,7 @@ ruu_commit(void)
 		      /* commit store value to D-cache */
 		      lat =
 			cache_access(cache_dl1, Write, (LSQ[LSQ_head].addr&~3),
-				     NULL, 4, sim_cycle, NULL, NULL);
+				     NULL, 4, sim_cycle, NULL, NULL, 0);
 		      if (lat > cache_dl1_lat)
 			events |= PEV_CACHEMISS;
 		    }
@@ -2198,7 +3597,7 @@ ruu_commit(void)
 		      /* access the D-TLB */
 		      lat =
 			cache_access(dtlb, Read, (LSQ[LSQ_head].addr & ~3),
-				     NULL, 4, sim_cycle, NULL, NULL);
+				     NULL, 4, sim_cycle, NULL, NULL, 0);
 		      if (lat > 1)
 			events |= PEV_TLBMISS;
 		    }
@@ -2210,6 +3609,9 @@ ruu_commit(void)
 		}
 	    }
 
+	  /* retired loads and stores leave the address index */
+	  lsq_addr_remove(&LSQ[LSQ_head]);
+
 	  /* invalidate load/store operation instance */
 	  LSQ[LSQ_head].tag++;
           sim_slip += (sim_cycle - LSQ[LSQ_head].slip);
@@ -2221,6 +3623,8 @@ ruu_commit(void)
 	  /* commit head of LSQ as well */
 	  LSQ_head = (LSQ_head + 1) % LSQ_size;
 	  LSQ_num--;
+	  if (lsq_scanned > 0)
+	    lsq_scanned--;
 	}
 
       if (pred
@@ -2271,6 +3675,15 @@ ruu_commit(void)
 	    panic ("retired instruction has odeps\n");
         }
     }
+
+  /* retire the NOPs dispatched in the commit slots left free, the slots
+     still free are charged to the component that holds up the RUU head,
+     when the cycle ends */
+  nops = MIN(cpi_nops, ruu_commit_width - committed);
+  cpi_nops -= nops;
+  cpi_cycle_base = committed + nops;
+  if (cpi_cycle_base < ruu_commit_width)
+    cpi_cycle_comp = cpi_stall(&cpi_cycle_PC);
 }
 
 
@@ -2320,6 +3733,9 @@ ruu_recover(int branch_index)			/* index of mis-pred branch */
 	      LSQ[LSQ_index].odep_list[i] = NULL;
 	    }
       
+	  /* squashed loads and stores leave the address index */
+	  lsq_addr_remove(&LSQ[LSQ_index]);
+
 	  /* squash this LSQ entry */
 	  LSQ[LSQ_index].tag++;
 
@@ -2355,6 +3771,8 @@ ruu_recover(int branch_index)			/* index of mis-pred branch */
   /* reset head/tail pointers to point to the mis-predicted branch */
   RUU_tail = RUU_prev_tail;
   LSQ_tail = LSQ_prev_tail;
+  if (lsq_scanned > LSQ_num)
+    lsq_scanned = LSQ_num;
 
   /* revert create vector back to last precise create vector state, NOTE:
      this is accomplished by resetting all the copied-on-write bits in the
@@ -2371,6 +3789,7 @@ ruu_recover(int branch_index)			/* index of mis-pred branch */
 
 /* forward declarations */
 static void tracer_recover(void);
+static void ruu_replay_squash(struct RUU_station *ld);
 
 /* writeback completed operation results from the functional units to RUU,
    at this point, the output dependency chains of completing instructions
@@ -2402,10 +3821,14 @@ ruu_writeback(void)
 	  /* recover processor state and reinit fetch to correct path */
 	  ruu_recover(rs - RUU);
 	  tracer_recover();
-	  bpred_recover(pred, rs->PC, rs->stack_recover_idx);
+	  bpred_recover(pred, rs->PC,
+			/* taken? */rs->next_PC != (rs->PC + sizeof(md_inst_t)),
+			&rs->dir_update, rs->stack_recover_idx);
 
 	  /* stall fetch until I-fetch and I-decode recover */
 	  ruu_fetch_issue_delay = ruu_branch_penalty;
+	  cpi_front = cpi_bpred;
+	  cpi_front_PC = rs->PC;
 
 	  /* continue writeback of the branch/control instruction */
 	}
@@ -2485,6 +3908,14 @@ ruu_writeback(void)
 		      /* input is now ready */
 		      olink->rs->idep_ready[olink->x.opnum] = TRUE;
 
+		      /* a store address is now known, with store sets
+			 later loads may have issued past it */
+		      if (lsq_ld_hash
+			  && olink->rs->in_LSQ
+			  && olink->x.opnum == STORE_ADDR_INDEX
+			  && LSQ_IS_STORE(olink->rs))
+			lsq_store_addr_known(olink->rs);
+
 		      /* are all the register operands of target ready? */
 		      if (OPERANDS_READY(olink->rs))
 			{
@@ -2496,6 +3927,10 @@ ruu_writeback(void)
 				  == (F_MEM|F_STORE)))
 			    readyq_enqueue(olink->rs);
 			  /* else, ld op, issued when no mem conflict */
+
+			  /* recheck the loads this may unblock */
+			  if (olink->rs->in_LSQ)
+			    lsq_wakeup(olink->rs);
 			}
 		    }
 
@@ -2514,6 +3949,14 @@ ruu_writeback(void)
 
    } /* for all writeback events */
 
+  /* squash the oldest load that read memory ahead of a store to the same
+     address, and all later insts */
+  if (!RSLINK_IS_NULL(&lsq_violation))
+    {
+      if (RSLINK_VALID(&lsq_violation))
+	ruu_replay_squash(RSLINK_RS(&lsq_violation));
+      lsq_violation = RSLINK_NULL;
+    }
 }
 
 
@@ -2522,77 +3965,48 @@ ruu_writeback(void)
  */
 
 /* this function locates ready instructions whose memory dependencies have
-   been satisfied, this is accomplished by walking the LSQ for loads, looking
-   for blocking memory dependency condition (e.g., earlier store with an
-   unknown address) */
-#define MAX_STD_UNKNOWNS		64
+   been satisfied; a load may issue once all earlier stores have a known
+   address (STA) and the latest earlier store to its address, if any, has a
+   known value (STD), the LSQ memory dependence index above tracks this
+   incrementally: the scan from the head only advances past stores as their
+   addresses become known, and loads are otherwise only rechecked when their
+   address or the value of the store they wait on becomes known */
 static void
 lsq_refresh(void)
 {
-  int i, j, index, n_std_unknowns;
-  md_addr_t std_unknowns[MAX_STD_UNKNOWNS];
-
-  /* scan entire queue for ready loads: scan from oldest instruction
-     (head) until we reach the tail or an unresolved store, after which no
-     other instruction will become ready */
-  for (i=0, index=LSQ_head, n_std_unknowns=0;
-       i < LSQ_num;
-       i++, index=(index + 1) % LSQ_size)
-    {
-      /* terminate search for ready loads after first unresolved store,
-	 as no later load could be resolved in its presence */
-      if (/* store? */
-	  (MD_OP_FLAGS(LSQ[index].op) & (F_MEM|F_STORE)) == (F_MEM|F_STORE))
-	{
-	  if (!STORE_ADDR_READY(&LSQ[index]))
-	    {
-	      /* FIXME: a later STD + STD known could hide the STA unknown */
-	      /* sta unknown, blocks all later loads, stop search */
-	      break;
-	    }
-	  else if (!OPERANDS_READY(&LSQ[index]))
-	    {
-	      /* sta known, but std unknown, may block a later store, record
-		 this address for later referral, we use an array here because
-		 for most simulations the number of entries to search will be
-		 very small */
-	      if (n_std_unknowns == MAX_STD_UNKNOWNS)
-		fatal("STD unknown array overflow, increase MAX_STD_UNKNOWNS");
-	      std_unknowns[n_std_unknowns++] = LSQ[index].addr;
-	    }
-	  else /* STORE_ADDR_READY() && OPERANDS_READY() */
-	    {
-	      /* a later STD known hides an earlier STD unknown */
-	      for (j=0; j<n_std_unknowns; j++)
-		{
-		  if (std_unknowns[j] == /* STA/STD known */LSQ[index].addr)
-		    std_unknowns[j] = /* bogus addr */0;
-		}
-	    }
-	}
+  int index;
+  struct RUU_station *rs;
+  struct RS_link *link, *next;
 
-      if (/* load? */
-	  ((MD_OP_FLAGS(LSQ[index].op) & (F_MEM|F_LOAD)) == (F_MEM|F_LOAD))
-	  && /* queued? */!LSQ[index].queued
-	  && /* waiting? */!LSQ[index].issued
-	  && /* completed? */!LSQ[index].completed
-	  && /* regs ready? */OPERANDS_READY(&LSQ[index]))
+  /* advance the scan up to the oldest unresolved store, as no later load
+     can be resolved in its presence, unless store sets predict which
+     loads may go ahead */
+  for (; lsq_scanned < LSQ_num; lsq_scanned++)
+    {
+      index = (LSQ_head + lsq_scanned) % LSQ_size;
+      rs = &LSQ[index];
+      if (LSQ_IS_STORE(rs))
 	{
-	  /* no STA unknown conflict (because we got to this check), check for
-	     a STD unknown conflict */
-	  for (j=0; j<n_std_unknowns; j++)
-	    {
-	      /* found a relevant STD unknown? */
-	      if (std_unknowns[j] == LSQ[index].addr)
-		break;
-	    }
-	  if (j == n_std_unknowns)
-	    {
-	      /* no STA or STD unknown conflicts, put load on ready queue */
-	      readyq_enqueue(&LSQ[index]);
-	    }
+	  /* FIXME: a later STD + STD known could hide the STA unknown */
+	  /* sta unknown, blocks all later loads, stop search */
+	  if (!STORE_ADDR_READY(rs) && !storeset_config[0])
+	    break;
 	}
+      else if (LSQ_IS_LOAD(rs))
+	lsq_check_load(rs);
     }
+
+  /* check loads whose address or blocking store value became known, loads
+     not yet reached by the scan are checked when it passes them */
+  for (link = lsq_wakeups; link; link = next)
+    {
+      next = link->next;
+      if (RSLINK_VALID(link)
+	  && LSQ_POS(RSLINK_RS(link)) < lsq_scanned)
+	lsq_check_load(RSLINK_RS(link));
+      RSLINK_FREE(link);
+    }
+  lsq_wakeups = NULL;
 }
 
 
@@ -2610,28 +4024,29 @@ lsq_refresh(void)
 static void
 ruu_issue(void)
 {
-  int i, load_lat, tlb_lat, n_issued;
-  struct RS_link *node, *next_node;
+  int load_lat, tlb_lat, n_issued;
+  struct RS_link *node, *link;
+  struct RUU_station *st;
+  struct readyq_t visit;
+  struct readyq_run run;
   struct res_template *fu;
 
-  /* FIXME: could be a little more efficient when scanning the ready queue */
-
-  /* copy and then blow away the ready list, NOTE: the ready list is
-     always totally reclaimed each cycle, and instructions that are not
-     issue are explicitly reinserted into the ready instruction queue,
-     this management strategy ensures that the ready instruction queue
-     is always properly sorted */
-  node = ready_queue;
-  ready_queue = NULL;
+  /* take the ready queue and rebuild it from the insts that do not issue,
+     NOTE: every inst not issued is explicitly reinserted into the ready
+     queue, this management strategy ensures that the ready instruction
+     queue is always properly sorted */
+  visit = ready_queue;
+  ready_queue.runs = readyq_spare;
+  ready_queue.num = 0;
+  run.head = NULL;
 
   /* visit all ready instructions (i.e., insts whose register input
      dependencies have been satisfied, stop issue when no more instructions
      are available or issue bandwidth is exhausted */
   for (n_issued=0;
-       node && n_issued < ruu_issue_width;
-       node = next_node)
+       n_issued < ruu_issue_width && (node = readyq_next(&visit, &run));
+       /* nada */)
     {
-      next_node = node->next;
 
       /* still valid? */
       if (RSLINK_VALID(node))
@@ -2646,6 +4061,33 @@ ruu_issue(void)
 	  /* node is now un-queued */
 	  rs->queued = FALSE;
 
+	  /* with store sets, the address of a store the load depends on
+	     may have become known since the load was queued, if so the
+	     load waits for the store value */
+	  if (storeset_config[0] && rs->in_LSQ && LSQ_IS_LOAD(rs)
+	      && (st = lsq_load_blocker(rs)) != NULL)
+	    {
+	      RSLINK_NEW(link, rs);
+	      link->next = st->ld_waiters;
+	      st->ld_waiters = link;
+	      RSLINK_FREE(node);
+	      continue;
+	    }
+
+	  /* a load that would miss in the D-cache waits while all of its
+	     MSHRs are busy, it is retried next cycle */
+	  if (rs->in_LSQ && LSQ_IS_LOAD(rs)
+	      && cache_dl1 && MD_VALID_ADDR(rs->addr)
+	      && cache_mshr_full(cache_dl1, sim_cycle)
+	      && !cache_probe(cache_dl1, rs->addr & ~3)
+	      && !lsq_store_before(rs))
+	    {
+	      lsq_mshr_stalls++;
+	      readyq_enqueue(rs);
+	      RSLINK_FREE(node);
+	      continue;
+	    }
+
 	  if (rs->in_LSQ
 	      && ((MD_OP_FLAGS(rs->op) & (F_MEM|F_STORE)) == (F_MEM|F_STORE)))
 	    {
@@ -2682,7 +4124,7 @@ ruu_issue(void)
 			panic("functional unit already in use");
 
 		      /* schedule functional unit release event */
-		      fu->master->busy = fu->issuelat;
+		      res_reserve(fu_pool, fu);
 
 		      /* schedule a result writeback event */
 		      if (rs->in_LSQ
@@ -2695,27 +4137,12 @@ ruu_issue(void)
 			     first scan LSQ to see if a store forward is
 			     possible, if not, access the data cache */
 			  load_lat = 0;
-			  i = (rs - LSQ);
-			  if (i != LSQ_head)
+			  /* FIXME: not dealing with partials! */
+			  if (lsq_store_before(rs))
 			    {
-			      for (;;)
-				{
-				  /* go to next earlier LSQ entry */
-				  i = (i + (LSQ_size-1)) % LSQ_size;
-
-				  /* FIXME: not dealing with partials! */
-				  if ((MD_OP_FLAGS(LSQ[i].op) & F_STORE)
-				      && (LSQ[i].addr == rs->addr))
-				    {
-				      /* hit in the LSQ */
-				      load_lat = 1;
-				      break;
-				    }
-
-				  /* scan finished? */
-				  if (i == LSQ_head)
-				    break;
-				}
+			      /* hit in the LSQ */
+			      load_lat = 1;
+			      lsq_forwards++;
 			    }
 
 			  /* was the value store forwared from the LSQ? */
@@ -2733,9 +4160,16 @@ ruu_issue(void)
 				  load_lat =
 				    cache_access(cache_dl1, Read,
 						 (rs->addr & ~3), NULL, 4,
-						 sim_cycle, NULL, NULL);
+						 sim_cycle, NULL, NULL, 0);
 				  if (load_lat > cache_dl1_lat)
-				    events |= PEV_CACHEMISS;
+				    {
+				      events |= PEV_CACHEMISS;
+				      rs->cpi_comp =
+					((cache_dl2
+					  && load_lat > (cache_dl1_lat
+							 + cache_dl2_lat))
+					 ? cpi_dl2 : cpi_dl1);
+				    }
 				}
 			      else
 				{
@@ -2751,9 +4185,11 @@ ruu_issue(void)
 				 initiate speculative TLB misses */
 			      tlb_lat =
 				cache_access(dtlb, Read, (rs->addr & ~3),
-					     NULL, 4, sim_cycle, NULL, NULL);
+					     NULL, 4, sim_cycle, NULL, NULL, 0);
 			      if (tlb_lat > 1)
 				events |= PEV_TLBMISS;
+			      if (tlb_lat > 1 && tlb_lat > load_lat)
+				rs->cpi_comp = cpi_dtlb;
 
 			      /* D-cache/D-TLB accesses occur in parallel */
 			      load_lat = MAX(tlb_lat, load_lat);
@@ -2811,37 +4247,31 @@ ruu_issue(void)
 
       /* reclaim ready list entry, NOTE: this is done whether or not the
          instruction issued, since the instruction was once again reinserted
-         into the ready queue if it did not issue, this ensures that the ready
-         queue is always properly sorted */
+         into the ready queue if it did not issue */
       RSLINK_FREE(node);
     }
 
   /* put any instruction not issued back into the ready queue, go through
      normal channels to ensure instruction stay ordered correctly */
-  for (; node; node = next_node)
+  while ((node = readyq_next(&visit, &run)) != NULL)
     {
-      next_node = node->next;
-
       /* still valid? */
       if (RSLINK_VALID(node))
-        {
+	{
 	  struct RUU_station *rs = RSLINK_RS(node);
 
-          /* node is now un-queued */
-          rs->queued = FALSE;
+	  /* node is now un-queued */
+	  rs->queued = FALSE;
 
 	  /* not issued, put operation back onto the ready list, we'll try to
 	     issue it again next cycle */
-          readyq_enqueue(rs);
-        }
+	  readyq_enqueue(rs);
+	}
       /* else, RUU entry was squashed */
 
-      /* reclaim ready list entry, NOTE: this is done whether or not the
-         instruction issued, since the instruction was once again reinserted
-         into the ready queue if it did not issue, this ensures that the ready
-         queue is always properly sorted */
       RSLINK_FREE(node);
     }
+  readyq_spare = visit.runs;
 }
 
 
@@ -2940,6 +4370,7 @@ static md_addr_t fetch_pred_PC;
 /* IFETCH -> DISPATCH instruction queue definition */
 struct fetch_rec {
   md_inst_t IR;				/* inst register */
+  struct predec_inst_t *dec;		/* predecoded inst */
   md_addr_t regs_PC, pred_PC;		/* current PC, predicted next PC */
   struct bpred_update_t dir_update;	/* bpred direction update info */
   int stack_recover_idx;		/* branch predictor RSB index */
@@ -3348,47 +4779,6 @@ ruu_install_odep(struct RUU_station *rs,	/* creating RUU station */
 }
 
 
-/*
- * configure the instruction decode engine
- */
-
-#define DNA			(0)
-
-#if defined(TARGET_PISA)
-
-/* general register dependence decoders */
-#define DGPR(N)			(N)
-#define DGPR_D(N)		((N) &~1)
-
-/* floating point register dependence decoders */
-#define DFPR_L(N)		(((N)+32)&~1)
-#define DFPR_F(N)		(((N)+32)&~1)
-#define DFPR_D(N)		(((N)+32)&~1)
-
-/* miscellaneous register dependence decoders */
-#define DHI			(0+32+32)
-#define DLO			(1+32+32)
-#define DFCC			(2+32+32)
-#define DTMP			(3+32+32)
-
-#elif defined(TARGET_ALPHA)
-
-/* general register dependence decoders, $r31 maps to DNA (0) */
-#define DGPR(N)			(31 - (N)) /* was: (((N) == 31) ? DNA : (N)) */
-
-/* floating point register dependence decoders */
-#define DFPR(N)			(((N) == 31) ? DNA : ((N)+32))
-
-/* miscellaneous register dependence decoders */
-#define DFPCR			(0+32+32)
-#define DUNIQ			(1+32+32)
-#define DTMP			(2+32+32)
-
-#else
-#error No ISA target defined...
-#endif
-
-
 /*
  * configure the execution engine
  */
@@ -3567,11 +4957,32 @@ ruu_install_odep(struct RUU_station *rs,	/* creating RUU station */
   __WRITE_SPECMEM(MD_SWAPQ(SRC), (DST), temp_qword, (FAULT))
 #endif /* HOST_HAS_QWORD */
 
+/* execute a system call, EIO trace transactions are checked against the
+   total inst count, including the insts not simulated in detail */
+static void
+sim_syscall(md_inst_t inst)		/* system call inst */
+{
+  /* with multiple cores, an exiting program only stops its core */
+  if (n_cores > 1 && MD_EXIT_SYSCALL(&regs))
+    longjmp(core_exit_buf, /* exitcode + fudge */regs.regs_R[4]+1);
+
+  if (sim_eio_fd != NULL && !MD_EXIT_SYSCALL(&regs))
+    {
+      sim_num_insn += sim_fwd_insn;
+      sys_syscall(&regs, mem_access, mem, inst, TRUE);
+      sim_num_insn -= sim_fwd_insn;
+    }
+  else
+    sys_syscall(&regs, mem_access, mem, inst, TRUE);
+}
+
 /* system call handler macro */
 #define SYSCALL(INST)							\
   (/* only execute system calls in non-speculative mode */		\
    (spec_mode ? panic("speculative syscall") : (void) 0),		\
-   sys_syscall(&regs, mem_access, mem, INST, TRUE))
+   /* the program may exit in the middle of this cycle */		\
+   (MD_EXIT_SYSCALL(&regs) ? cpi_finish(/* exiting */TRUE) : (void) 0),	\
+   sim_syscall(INST))
 
 /* default register state accessor, used by DLite */
 static char *					/* err str, NULL for no err */
@@ -3690,9 +5101,297 @@ simoo_reg_obj(struct regs_t *xregs,		/* registers to access */
   return NULL;
 }
 
-/* the last operation that ruu_dispatch() attempted to dispatch, for
-   implementing in-order issue */
-static struct RS_link last_op = RSLINK_NULL_DATA;
+/* the last operation that ruu_dispatch() attempted to dispatch, for
+   implementing in-order issue */
+static struct RS_link last_op = RSLINK_NULL_DATA;
+
+/* allocate the RUU entry of instruction INST, plus an LSQ entry for loads
+   and stores, link the entries onto the output chains of the producers of
+   their input registers IN1-IN3, install them as the creators of output
+   registers OUT1-OUT2, and queue them if they are ready, returns the RUU
+   entry */
+static struct RUU_station *
+ruu_install(md_inst_t inst,			/* instruction bits */
+	    enum md_opcode op,			/* decoded opcode enum */
+	    int out1, int out2,			/* output register names */
+	    int in1, int in2, int in3,		/* input register names */
+	    md_addr_t PC,			/* inst PC */
+	    md_addr_t next_PC,			/* actual next PC */
+	    md_addr_t pred_PC,			/* predicted next PC */
+	    struct bpred_update_t *dir_update_ptr,/* bpred dir update info */
+	    int stack_recover_idx,		/* bpred retstack recovery idx */
+	    md_addr_t addr,			/* effective address of ld/st's */
+	    unsigned int pseq)			/* pipetrace sequence number */
+{
+  struct RUU_station *rs;		/* RUU station being allocated */
+  struct RUU_station *lsq;		/* LSQ station for ld/st's */
+
+  /* for load/stores:
+       idep #0     - store operand (value that is store'ed)
+       idep #1, #2 - eff addr computation inputs (addr of access)
+
+     resulting RUU/LSQ operation pair:
+       RUU (effective address computation operation):
+	 idep #0, #1 - eff addr computation inputs (addr of access)
+       LSQ (memory access operation):
+	 idep #0     - operand input (value that is store'd)
+	 idep #1     - eff addr computation result (from RUU op)
+
+     effective address computation is transfered via the reserved
+     name DTMP
+   */
+
+  /* fill in RUU reservation station */
+  rs = &RUU[RUU_tail];
+  rs->slip = sim_cycle - 1;
+  rs->IR = inst;
+  rs->op = op;
+  rs->PC = PC;
+  rs->next_PC = next_PC; rs->pred_PC = pred_PC;
+  rs->in_LSQ = FALSE;
+  rs->ea_comp = FALSE;
+  rs->recover_inst = FALSE;
+  rs->dir_update = *dir_update_ptr;
+  rs->stack_recover_idx = stack_recover_idx;
+  rs->spec_mode = spec_mode;
+  rs->addr = 0;
+  /* rs->tag is already set */
+  rs->seq = ++inst_seq;
+  rs->queued = rs->issued = rs->completed = FALSE;
+  rs->cpi_comp = cpi_dep;
+  rs->ptrace_seq = pseq;
+
+  /* the front end has delivered an inst */
+  cpi_front = cpi_fetch;
+
+  /* split ld/st's into two operations: eff addr comp + mem access */
+  if (MD_OP_FLAGS(op) & F_MEM)
+    {
+      /* convert RUU operation from ld/st to an add (eff addr comp) */
+      rs->op = MD_AGEN_OP;
+      rs->ea_comp = TRUE;
+
+      /* fill in LSQ reservation station */
+      lsq = &LSQ[LSQ_tail];
+      lsq->slip = sim_cycle - 1;
+      lsq->IR = inst;
+      lsq->op = op;
+      lsq->PC = PC;
+      lsq->next_PC = next_PC; lsq->pred_PC = pred_PC;
+      lsq->in_LSQ = TRUE;
+      lsq->ea_comp = FALSE;
+      lsq->recover_inst = FALSE;
+      lsq->dir_update.pdir1 = lsq->dir_update.pdir2 = NULL;
+      lsq->dir_update.pmeta = NULL;
+      lsq->stack_recover_idx = 0;
+      lsq->spec_mode = spec_mode;
+      lsq->addr = addr;
+      /* lsq->tag is already set */
+      lsq->seq = ++inst_seq;
+      lsq->queued = lsq->issued = lsq->completed = FALSE;
+      lsq->cpi_comp = cpi_dep;
+      lsq->ptrace_seq = ptrace_seq++;
+
+      /* pipetrace this uop */
+      ptrace_newuop(lsq->ptrace_seq, "internal ld/st", lsq->PC, 0);
+      ptrace_newstage(lsq->ptrace_seq, PST_DISPATCH, 0);
+
+      /* link eff addr computation onto operand's output chains */
+      ruu_link_idep(rs, /* idep_ready[] index */0, NA);
+      ruu_link_idep(rs, /* idep_ready[] index */1, in2);
+      ruu_link_idep(rs, /* idep_ready[] index */2, in3);
+
+      /* install output after inputs to prevent self reference */
+      ruu_install_odep(rs, /* odep_list[] index */0, DTMP);
+      ruu_install_odep(rs, /* odep_list[] index */1, NA);
+
+      /* link memory access onto output chain of eff addr operation */
+      ruu_link_idep(lsq,
+		    /* idep_ready[] index */STORE_OP_INDEX/* 0 */,
+		    in1);
+      ruu_link_idep(lsq,
+		    /* idep_ready[] index */STORE_ADDR_INDEX/* 1 */,
+		    DTMP);
+      ruu_link_idep(lsq, /* idep_ready[] index */2, NA);
+
+      /* install output after inputs to prevent self reference */
+      ruu_install_odep(lsq, /* odep_list[] index */0, out1);
+      ruu_install_odep(lsq, /* odep_list[] index */1, out2);
+
+      /* loads and stores enter the address index, their address
+	 is already known to the functional simulator */
+      lsq_addr_insert(lsq);
+      ss_dispatch(lsq);
+
+      /* install operation in the RUU and LSQ */
+      RUU_tail = (RUU_tail + 1) % RUU_size;
+      RUU_num++;
+      LSQ_tail = (LSQ_tail + 1) % LSQ_size;
+      LSQ_num++;
+
+      if (OPERANDS_READY(rs))
+	{
+	  /* eff addr computation ready, queue it on ready list */
+	  readyq_enqueue(rs);
+	}
+      /* issue may continue when the load/store is issued */
+      RSLINK_INIT(last_op, lsq);
+
+      /* issue stores only, loads are issued by lsq_refresh() */
+      if (((MD_OP_FLAGS(op) & (F_MEM|F_STORE)) == (F_MEM|F_STORE))
+	  && OPERANDS_READY(lsq))
+	{
+	  /* panic("store immediately ready"); */
+	  /* put operation on ready list, ruu_issue() issue it later */
+	  readyq_enqueue(lsq);
+	}
+    }
+  else /* !(MD_OP_FLAGS(op) & F_MEM) */
+    {
+      /* link onto producing operation */
+      ruu_link_idep(rs, /* idep_ready[] index */0, in1);
+      ruu_link_idep(rs, /* idep_ready[] index */1, in2);
+      ruu_link_idep(rs, /* idep_ready[] index */2, in3);
+
+      /* install output after inputs to prevent self reference */
+      ruu_install_odep(rs, /* odep_list[] index */0, out1);
+      ruu_install_odep(rs, /* odep_list[] index */1, out2);
+
+      /* install operation in the RUU */
+      RUU_tail = (RUU_tail + 1) % RUU_size;
+      RUU_num++;
+
+      /* issue op if all its reg operands are ready (no mem input) */
+      if (OPERANDS_READY(rs))
+	{
+	  /* put operation on ready list, ruu_issue() issue it later */
+	  readyq_enqueue(rs);
+	  /* issue may continue */
+	  last_op = RSLINK_NULL;
+	}
+      else
+	{
+	  /* could not issue this inst, stall issue until we can */
+	  RSLINK_INIT(last_op, rs);
+	}
+    }
+
+  return rs;
+}
+
+/* make RS, the youngest of the insts left in the RUU and LSQ so far, the
+   creator of its outputs, or mark them as available if it has completed */
+static void
+cv_rebuild_ent(struct RUU_station *rs)		/* RUU/LSQ station */
+{
+  int i;
+  struct CV_link cv;
+
+  for (i=0; i<MAX_ODEPS; i++)
+    {
+      if (rs->onames[i] == NA)
+	continue;
+      if (rs->completed)
+	cv = CVLINK_NULL;
+      else
+	CVLINK_INIT(cv, rs, i);
+      create_vector[rs->onames[i]] = cv;
+    }
+}
+
+/* rebuild the create vector from the insts left in the RUU and LSQ, used
+   after a squash that did not stop at the last non-speculative inst */
+static void
+cv_rebuild(void)
+{
+  int i, n, index, lsq_index;
+
+  for (i=0; i < MD_TOTAL_REGS; i++)
+    create_vector[i] = CVLINK_NULL;
+
+  for (n=0, index=RUU_head, lsq_index=LSQ_head;
+       n < RUU_num;
+       n++, index=(index + 1) % RUU_size)
+    {
+      cv_rebuild_ent(&RUU[index]);
+      if (RUU[index].ea_comp)
+	{
+	  cv_rebuild_ent(&LSQ[lsq_index]);
+	  lsq_index = (lsq_index + 1) % LSQ_size;
+	}
+    }
+}
+
+/* recover from a memory order violation of load LD: squash the load and all
+   later insts, and queue the non-speculative insts squashed for replay */
+static void
+ruu_replay_squash(struct RUU_station *ld)	/* violating load */
+{
+  int n, ea_index, index, lsq_index;
+  struct RUU_station *rs;
+  struct replay_rec *rec;
+
+  /* locate the effective address computation of the load */
+  for (n=0, ea_index=RUU_head;
+       n < RUU_num;
+       n++, ea_index=(ea_index + 1) % RUU_size)
+    {
+      if (RUU[ea_index].ea_comp && RUU[ea_index].seq + 1 == ld->seq)
+	break;
+    }
+  if (n == RUU_num || ea_index == RUU_head)
+    panic("violating load not found behind the RUU head");
+
+  /* save the insts to squash, youngest first, ahead of any insts still
+     waiting to be replayed */
+  index = RUU_tail;
+  lsq_index = LSQ_tail;
+  do {
+    index = (index + (RUU_size-1)) % RUU_size;
+    rs = &RUU[index];
+    if (rs->ea_comp)
+      lsq_index = (lsq_index + (LSQ_size-1)) % LSQ_size;
+
+    /* mis-speculated insts are simply squashed */
+    if (rs->spec_mode)
+      continue;
+
+    /* the mis-predicted branch that started the mis-speculated path, if
+       any, is squashed before it resolves, recover the predictor now */
+    if (rs->recover_inst)
+      bpred_recover(pred, rs->PC,
+		    /* taken? */rs->next_PC != (rs->PC + sizeof(md_inst_t)),
+		    &rs->dir_update, rs->stack_recover_idx);
+
+    replay_head = (replay_head + (RUU_size-1)) % RUU_size;
+    replay_num++;
+    rec = &replay_data[replay_head];
+    rec->IR = rs->IR;
+    rec->PC = rs->PC;
+    rec->next_PC = rs->next_PC;
+    rec->pred_PC = rs->pred_PC;
+    rec->addr = rs->ea_comp ? LSQ[lsq_index].addr : 0;
+    rec->dir_update = rs->dir_update;
+    rec->stack_recover_idx = rs->stack_recover_idx;
+  } while (index != ea_index);
+
+  /* fetch resumes after the last non-speculative inst */
+  if (spec_mode)
+    {
+      tracer_recover();
+      ruu_fetch_issue_delay = ruu_branch_penalty;
+    }
+
+  /* predict the dependence next time */
+  ss_train(ld->PC, lsq_violation_st_PC);
+
+  ruu_recover((ea_index + (RUU_size-1)) % RUU_size);
+  cv_rebuild();
+
+  /* replay after the squash penalty */
+  replay_cycle = sim_cycle + MAX(ruu_branch_penalty, 1);
+  lsq_violations++;
+}
 
 /* dispatch instructions from the IFETCH -> DISPATCH queue: instructions are
    first decoded, then they allocated RUU (and LSQ for load/stores) resources
@@ -3703,12 +5402,13 @@ ruu_dispatch(void)
   int i;
   int n_dispatched;			/* total insts dispatched */
   md_inst_t inst;			/* actual instruction bits */
+  struct predec_inst_t *dec;		/* predecoded inst */
+  struct replay_rec *rec;		/* inst to replay */
   enum md_opcode op;			/* decoded opcode enum */
   int out1, out2, in1, in2, in3;	/* output/input register names */
   md_addr_t target_PC;			/* actual next/target PC address */
   md_addr_t addr;			/* effective address, if load/store */
   struct RUU_station *rs;		/* RUU station being allocated */
-  struct RUU_station *lsq;		/* LSQ station for ld/st's */
   struct bpred_update_t *dir_update_ptr;/* branch predictor dir update ptr */
   int stack_recover_idx;		/* bpred retstack recovery index */
   unsigned int pseq;			/* pipetrace sequence number */
@@ -3726,10 +5426,42 @@ ruu_dispatch(void)
 
   made_check = FALSE;
   n_dispatched = 0;
+
+  /* re-dispatch the insts squashed by a memory order violation first, the
+     functional simulator has already executed them */
+  while (replay_num != 0
+	 && sim_cycle >= replay_cycle
+	 && n_dispatched < (ruu_decode_width * fetch_speed)
+	 && RUU_num < RUU_size && LSQ_num < LSQ_size)
+    {
+      /* if issuing in-order, block until last op issues if inorder issue */
+      if (ruu_inorder_issue
+	  && (last_op.rs && RSLINK_VALID(&last_op)
+	      && !OPERANDS_READY(last_op.rs)))
+	break;
+
+      rec = &replay_data[replay_head];
+      dec = PREDEC_LOOKUP(pd, rec->PC);
+      pseq = ptrace_seq++;
+      ptrace_newinst(pseq, rec->IR, rec->PC, rec->addr);
+      ruu_install(rec->IR, dec->op,
+		  dec->out1, dec->out2, dec->in1, dec->in2, dec->in3,
+		  rec->PC, rec->next_PC, rec->pred_PC,
+		  &rec->dir_update, rec->stack_recover_idx, rec->addr, pseq);
+      ptrace_newstage(pseq, PST_DISPATCH, 0);
+
+      replay_head = (replay_head + 1) % RUU_size;
+      replay_num--;
+      n_dispatched++;
+      lsq_replays++;
+    }
+
   while (/* instruction decode B/W left? */
 	 n_dispatched < (ruu_decode_width * fetch_speed)
 	 /* RUU and LSQ not full? */
 	 && RUU_num < RUU_size && LSQ_num < LSQ_size
+	 /* no insts waiting to be replayed? */
+	 && replay_num == 0
 	 /* insts still available from fetch unit? */
 	 && fetch_num != 0
 	 /* on an acceptable trace path */
@@ -3746,14 +5478,15 @@ ruu_dispatch(void)
 
       /* get the next instruction from the IFETCH -> DISPATCH queue */
       inst = fetch_data[fetch_head].IR;
+      dec = fetch_data[fetch_head].dec;
       regs.regs_PC = fetch_data[fetch_head].regs_PC;
       pred_PC = fetch_data[fetch_head].pred_PC;
       dir_update_ptr = &(fetch_data[fetch_head].dir_update);
       stack_recover_idx = fetch_data[fetch_head].stack_recover_idx;
       pseq = fetch_data[fetch_head].ptrace_seq;
 
-      /* decode the inst */
-      MD_SET_OPCODE(op, inst);
+      /* the inst was decoded when it was fetched */
+      op = dec->op;
 
       /* compute default next PC */
       regs.regs_NPC = regs.regs_PC + sizeof(md_inst_t);
@@ -3793,9 +5526,9 @@ ruu_dispatch(void)
 	{
 #define DEFINST(OP,MSK,NAME,OPFORM,RES,CLASS,O1,O2,I1,I2,I3)		\
 	case OP:							\
-	  /* compute output/input dependencies to out1-2 and in1-3 */	\
-	  out1 = O1; out2 = O2;						\
-	  in1 = I1; in2 = I2; in3 = I3;					\
+	  /* output/input dependencies to out1-2 and in1-3 predecoded */\
+	  out1 = dec->out1; out2 = dec->out2;				\
+	  in1 = dec->in1; in2 = dec->in2; in3 = dec->in3;		\
 	  /* execute the instruction */					\
 	  SYMCAT(OP,_IMPL);						\
 	  break;
@@ -3897,152 +5630,26 @@ ruu_dispatch(void)
       /* is this a NOP */
       if (op != MD_NOP_OP)
 	{
-	  /* for load/stores:
-	       idep #0     - store operand (value that is store'ed)
-	       idep #1, #2 - eff addr computation inputs (addr of access)
-
-	     resulting RUU/LSQ operation pair:
-	       RUU (effective address computation operation):
-		 idep #0, #1 - eff addr computation inputs (addr of access)
-	       LSQ (memory access operation):
-		 idep #0     - operand input (value that is store'd)
-		 idep #1     - eff addr computation result (from RUU op)
-
-	     effective address computation is transfered via the reserved
-	     name DTMP
-	   */
-
-	  /* fill in RUU reservation station */
-	  rs = &RUU[RUU_tail];
-          rs->slip = sim_cycle - 1;
-	  rs->IR = inst;
-	  rs->op = op;
-	  rs->PC = regs.regs_PC;
-	  rs->next_PC = regs.regs_NPC; rs->pred_PC = pred_PC;
-	  rs->in_LSQ = FALSE;
-	  rs->ea_comp = FALSE;
-	  rs->recover_inst = FALSE;
-          rs->dir_update = *dir_update_ptr;
-	  rs->stack_recover_idx = stack_recover_idx;
-	  rs->spec_mode = spec_mode;
-	  rs->addr = 0;
-	  /* rs->tag is already set */
-	  rs->seq = ++inst_seq;
-	  rs->queued = rs->issued = rs->completed = FALSE;
-	  rs->ptrace_seq = pseq;
-
-	  /* split ld/st's into two operations: eff addr comp + mem access */
-	  if (MD_OP_FLAGS(op) & F_MEM)
-	    {
-	      /* convert RUU operation from ld/st to an add (eff addr comp) */
-	      rs->op = MD_AGEN_OP;
-	      rs->ea_comp = TRUE;
-
-	      /* fill in LSQ reservation station */
-	      lsq = &LSQ[LSQ_tail];
-              lsq->slip = sim_cycle - 1;
-	      lsq->IR = inst;
-	      lsq->op = op;
-	      lsq->PC = regs.regs_PC;
-	      lsq->next_PC = regs.regs_NPC; lsq->pred_PC = pred_PC;
-	      lsq->in_LSQ = TRUE;
-	      lsq->ea_comp = FALSE;
-	      lsq->recover_inst = FALSE;
-	      lsq->dir_update.pdir1 = lsq->dir_update.pdir2 = NULL;
-	      lsq->dir_update.pmeta = NULL;
-	      lsq->stack_recover_idx = 0;
-	      lsq->spec_mode = spec_mode;
-	      lsq->addr = addr;
-	      /* lsq->tag is already set */
-	      lsq->seq = ++inst_seq;
-	      lsq->queued = lsq->issued = lsq->completed = FALSE;
-	      lsq->ptrace_seq = ptrace_seq++;
-
-	      /* pipetrace this uop */
-	      ptrace_newuop(lsq->ptrace_seq, "internal ld/st", lsq->PC, 0);
-	      ptrace_newstage(lsq->ptrace_seq, PST_DISPATCH, 0);
-
-	      /* link eff addr computation onto operand's output chains */
-	      ruu_link_idep(rs, /* idep_ready[] index */0, NA);
-	      ruu_link_idep(rs, /* idep_ready[] index */1, in2);
-	      ruu_link_idep(rs, /* idep_ready[] index */2, in3);
-
-	      /* install output after inputs to prevent self reference */
-	      ruu_install_odep(rs, /* odep_list[] index */0, DTMP);
-	      ruu_install_odep(rs, /* odep_list[] index */1, NA);
-
-	      /* link memory access onto output chain of eff addr operation */
-	      ruu_link_idep(lsq,
-			    /* idep_ready[] index */STORE_OP_INDEX/* 0 */,
-			    in1);
-	      ruu_link_idep(lsq,
-			    /* idep_ready[] index */STORE_ADDR_INDEX/* 1 */,
-			    DTMP);
-	      ruu_link_idep(lsq, /* idep_ready[] index */2, NA);
-
-	      /* install output after inputs to prevent self reference */
-	      ruu_install_odep(lsq, /* odep_list[] index */0, out1);
-	      ruu_install_odep(lsq, /* odep_list[] index */1, out2);
-
-	      /* install operation in the RUU and LSQ */
-	      n_dispatched++;
-	      RUU_tail = (RUU_tail + 1) % RUU_size;
-	      RUU_num++;
-	      LSQ_tail = (LSQ_tail + 1) % LSQ_size;
-	      LSQ_num++;
-
-	      if (OPERANDS_READY(rs))
-		{
-		  /* eff addr computation ready, queue it on ready list */
-		  readyq_enqueue(rs);
-		}
-	      /* issue may continue when the load/store is issued */
-	      RSLINK_INIT(last_op, lsq);
+	  rs = ruu_install(inst, op, out1, out2, in1, in2, in3,
+			   regs.regs_PC, regs.regs_NPC, pred_PC,
+			   dir_update_ptr, stack_recover_idx, addr, pseq);
+	  n_dispatched++;
 
-	      /* issue stores only, loads are issued by lsq_refresh() */
-	      if (((MD_OP_FLAGS(op) & (F_MEM|F_STORE)) == (F_MEM|F_STORE))
-		  && OPERANDS_READY(lsq))
-		{
-		  /* panic("store immediately ready"); */
-		  /* put operation on ready list, ruu_issue() issue it later */
-		  readyq_enqueue(lsq);
-		}
-	    }
-	  else /* !(MD_OP_FLAGS(op) & F_MEM) */
+	  /* a mis-fetched branch stalls the front end as a mispredict */
+	  if (fetch_redirected && !pred_perfect)
 	    {
-	      /* link onto producing operation */
-	      ruu_link_idep(rs, /* idep_ready[] index */0, in1);
-	      ruu_link_idep(rs, /* idep_ready[] index */1, in2);
-	      ruu_link_idep(rs, /* idep_ready[] index */2, in3);
-
-	      /* install output after inputs to prevent self reference */
-	      ruu_install_odep(rs, /* odep_list[] index */0, out1);
-	      ruu_install_odep(rs, /* odep_list[] index */1, out2);
-
-	      /* install operation in the RUU */
-	      n_dispatched++;
-	      RUU_tail = (RUU_tail + 1) % RUU_size;
-	      RUU_num++;
-
-	      /* issue op if all its reg operands are ready (no mem input) */
-	      if (OPERANDS_READY(rs))
-		{
-		  /* put operation on ready list, ruu_issue() issue it later */
-		  readyq_enqueue(rs);
-		  /* issue may continue */
-		  last_op = RSLINK_NULL;
-		}
-	      else
-		{
-		  /* could not issue this inst, stall issue until we can */
-		  RSLINK_INIT(last_op, rs);
-		}
+	      cpi_front = cpi_bpred;
+	      cpi_front_PC = regs.regs_PC;
 	    }
 	}
       else
 	{
 	  /* this is a NOP, no need to update RUU/LSQ state */
 	  rs = NULL;
+
+	  /* it is retired in a free commit slot */
+	  if (!spec_mode)
+	    cpi_nops++;
 	}
 
       /* one more instruction executed, speculative or otherwise */
@@ -4153,6 +5760,10 @@ fetch_init(void)
   fetch_tail = fetch_head = 0;
   IFQ_count = 0;
   IFQ_fcount = 0;
+
+  /* the front end has yet to deliver the first inst */
+  cpi_front = cpi_fetch;
+  cpi_front_PC = 0;
 }
 
 /* dump contents of fetch stage registers and fetch queue */
@@ -4202,6 +5813,7 @@ ruu_fetch(void)
 {
   int i, lat, tlb_lat, done = FALSE;
   md_inst_t inst;
+  struct predec_inst_t *dec;
   int stack_recover_idx;
   int branch_cnt;
 
@@ -4222,8 +5834,9 @@ ruu_fetch(void)
 	  && fetch_regs_PC < (ld_text_base+ld_text_size)
 	  && !(fetch_regs_PC & (sizeof(md_inst_t)-1)))
 	{
-	  /* read instruction from memory */
-	  MD_FETCH_INST(inst, mem, fetch_regs_PC);
+	  /* read instruction from memory, decoding it if not yet decoded */
+	  dec = PREDEC_LOOKUP(pd, fetch_regs_PC);
+	  inst = dec->inst;
 
 	  /* address is within program text, read instruction from memory */
 	  lat = cache_il1_lat;
@@ -4233,7 +5846,7 @@ ruu_fetch(void)
 	      lat =
 		cache_access(cache_il1, Read, IACOMPRESS(fetch_regs_PC),
 			     NULL, ISCOMPRESS(sizeof(md_inst_t)), sim_cycle,
-			     NULL, NULL);
+			     NULL, NULL, 0);
 	      if (lat > cache_il1_lat)
 		last_inst_missed = TRUE;
 	    }
@@ -4245,7 +5858,7 @@ ruu_fetch(void)
 	      tlb_lat =
 		cache_access(itlb, Read, IACOMPRESS(fetch_regs_PC),
 			     NULL, ISCOMPRESS(sizeof(md_inst_t)), sim_cycle,
-			     NULL, NULL);
+			     NULL, NULL, 0);
 	      if (tlb_lat > 1)
 		last_inst_tmissed = TRUE;
 
@@ -4258,6 +5871,8 @@ ruu_fetch(void)
 	    {
 	      /* I-cache miss, block fetch until it is resolved */
 	      ruu_fetch_issue_delay += lat - 1;
+	      cpi_front = cpi_icache;
+	      cpi_front_PC = fetch_regs_PC;
 	      break;
 	    }
 	  /* else, I-cache/I-TLB hit */
@@ -4265,6 +5880,7 @@ ruu_fetch(void)
       else
 	{
 	  /* fetch PC is bogus, send a NOP down the pipeline */
+	  dec = &pd->nop;
 	  inst = MD_NOP_INST;
 	}
 
@@ -4273,11 +5889,8 @@ ruu_fetch(void)
       /* possibly use the BTB target */
       if (pred)
 	{
-	  enum md_opcode op;
+	  enum md_opcode op = dec->op;
 
-	  /* pre-decode instruction, used for bpred stats recording */
-	  MD_SET_OPCODE(op, inst);
-	  
 	  /* get the next predicted fetch address; only use branch predictor
 	     result for branches (assumes pre-decode bits); NOTE: returned
 	     value may be 1 if bpred can only predict a direction */
@@ -4317,6 +5930,7 @@ ruu_fetch(void)
 
       /* commit this instruction to the IFETCH -> DISPATCH queue */
       fetch_data[fetch_tail].IR = inst;
+      fetch_data[fetch_tail].dec = dec;
       fetch_data[fetch_tail].regs_PC = fetch_regs_PC;
       fetch_data[fetch_tail].pred_PC = fetch_pred_PC;
       fetch_data[fetch_tail].stack_recover_idx = stack_recover_idx;
@@ -4421,186 +6035,988 @@ simoo_mstate_obj(FILE *stream,			/* output stream */
 }
 
 
-/* start simulation, program loaded, processor precise state initialized */
-void
-sim_main(void)
+/*
+ * multi-core simulation, each additional core is a copy of the configured
+ * core running its own program, all cores share the L2 caches; the state of
+ * the running core lives in the simulator globals, core_switch() parks it
+ * in the core's record and moves the state of another core in
+ */
+
+/* maximum number of arguments of a program run on an additional core */
+#define MAX_CORE_ARGS			64
+
+/* a simulated core */
+struct core_t {
+  int halted;				/* core has stopped? */
+
+  /* architected state */
+  struct regs_t regs;
+  struct mem_t *mem;
+  struct predec_t *pd;
+  md_addr_t ld_text_base;
+  unsigned int ld_text_size;
+  md_addr_t ld_data_base;
+  unsigned int ld_data_size;
+  md_addr_t ld_brk_point;
+  md_addr_t ld_stack_base;
+  unsigned int ld_stack_size;
+  md_addr_t ld_stack_min;
+  char *ld_prog_fname;
+  md_addr_t ld_prog_entry;
+  md_addr_t ld_environ_base;
+
+  /* private caches, TLBs, predictor and functional units */
+  struct cache_t *cache_il1;
+  struct cache_t *cache_dl1;
+  struct cache_t *itlb;
+  struct cache_t *dtlb;
+  struct bpred_t *pred;
+  struct res_pool *fu_pool;
+  struct core_page_t **core_ptab;
+
+  /* pipeline state */
+  struct RUU_station *RUU;
+  int RUU_head, RUU_tail, RUU_num;
+  struct RUU_station *LSQ;
+  int LSQ_head, LSQ_tail, LSQ_num;
+  int lsq_scanned;
+  struct RUU_station **lsq_st_hash, **lsq_ld_hash;
+  struct RS_link *lsq_wakeups;
+  int *ss_ssit;
+  struct RS_link *ss_lfst;
+  int ss_next_id;
+  tick_t ss_clear_cycle;
+  struct replay_rec *replay_data;
+  int replay_head, replay_num;
+  tick_t replay_cycle;
+  struct RS_link *rslink_free_list;
+  struct RS_link *event_wheel[EVENTQ_WHEEL_SIZE];
+  struct RS_link *event_overflow;
+  tick_t eventq_cycle;
+  struct readyq_t ready_queue;
+  struct readyq_run *readyq_spare;
+  BITMAP_TYPE(MD_TOTAL_REGS, use_spec_cv);
+  struct CV_link create_vector[MD_TOTAL_REGS];
+  struct CV_link spec_create_vector[MD_TOTAL_REGS];
+  tick_t create_vector_rt[MD_TOTAL_REGS];
+  tick_t spec_create_vector_rt[MD_TOTAL_REGS];
+  BITMAP_TYPE(MD_NUM_IREGS, use_spec_R);
+  md_gpr_t spec_regs_R;
+  BITMAP_TYPE(MD_NUM_FREGS, use_spec_F);
+  md_fpr_t spec_regs_F;
+  BITMAP_TYPE(MD_NUM_FREGS, use_spec_C);
+  md_ctrl_t spec_regs_C;
+  struct spec_mem_ent *store_htable[STORE_HASH_SIZE];
+  struct spec_mem_ent *bucket_free_list;
+  md_addr_t pred_PC, recover_PC;
+  md_addr_t fetch_regs_PC, fetch_pred_PC;
+  struct fetch_rec *fetch_data;
+  int fetch_num, fetch_tail, fetch_head;
+  struct RS_link last_op;
+  int last_inst_missed, last_inst_tmissed;
+  unsigned int inst_seq, ptrace_seq;
+  int spec_mode;
+  unsigned ruu_fetch_issue_delay;
+  int ptrace_active;
+  enum cpi_comp_t cpi_front;
+  md_addr_t cpi_front_PC;
+  int cpi_cycle_base;
+  enum cpi_comp_t cpi_cycle_comp;
+  md_addr_t cpi_cycle_PC;
+  enum cpi_comp_t cpi_last;
+  counter_t cpi_nops;
+
+  /* statistics */
+  counter_t sim_num_insn;
+  counter_t sim_num_refs, sim_num_loads, sim_num_branches;
+  counter_t sim_total_insn, sim_total_refs, sim_total_loads;
+  counter_t sim_total_branches;
+  counter_t sim_slip;
+  tick_t sim_cycle;
+  counter_t IFQ_count, IFQ_fcount;
+  counter_t RUU_count, RUU_fcount;
+  counter_t LSQ_count, LSQ_fcount;
+  counter_t lsq_forwards, lsq_ss_deps, lsq_violations, lsq_replays;
+  counter_t lsq_mshr_stalls;
+  counter_t cpi_slots[cpi_NUM];
+  counter_t sim_invalid_addrs;
+  counter_t sim_fwd_insn;
+};
+
+/* per-core state moved by core_switch(), NOTE: update this list and
+   struct core_t together */
+#define CORE_STATE							\
+  CORE_VAR(regs) CORE_VAR(mem) CORE_VAR(pd)				\
+  CORE_VAR(ld_text_base) CORE_VAR(ld_text_size)				\
+  CORE_VAR(ld_data_base) CORE_VAR(ld_data_size)				\
+  CORE_VAR(ld_brk_point) CORE_VAR(ld_stack_base)			\
+  CORE_VAR(ld_stack_size) CORE_VAR(ld_stack_min)			\
+  CORE_VAR(ld_prog_fname) CORE_VAR(ld_prog_entry)			\
+  CORE_VAR(ld_environ_base)						\
+  CORE_VAR(cache_il1) CORE_VAR(cache_dl1) CORE_VAR(itlb) CORE_VAR(dtlb)	\
+  CORE_VAR(pred) CORE_VAR(fu_pool) CORE_VAR(core_ptab)			\
+  CORE_VAR(RUU) CORE_VAR(RUU_head) CORE_VAR(RUU_tail) CORE_VAR(RUU_num)	\
+  CORE_VAR(LSQ) CORE_VAR(LSQ_head) CORE_VAR(LSQ_tail) CORE_VAR(LSQ_num)	\
+  CORE_VAR(lsq_scanned) CORE_VAR(lsq_st_hash) CORE_VAR(lsq_ld_hash)	\
+  CORE_VAR(lsq_wakeups)							\
+  CORE_VAR(ss_ssit) CORE_VAR(ss_lfst) CORE_VAR(ss_next_id)		\
+  CORE_VAR(ss_clear_cycle)						\
+  CORE_VAR(replay_data) CORE_VAR(replay_head) CORE_VAR(replay_num)	\
+  CORE_VAR(replay_cycle)						\
+  CORE_VAR(rslink_free_list)						\
+  CORE_VAR(event_wheel) CORE_VAR(event_overflow) CORE_VAR(eventq_cycle)	\
+  CORE_VAR(ready_queue) CORE_VAR(readyq_spare)				\
+  CORE_VAR(use_spec_cv) CORE_VAR(create_vector)				\
+  CORE_VAR(spec_create_vector) CORE_VAR(create_vector_rt)		\
+  CORE_VAR(spec_create_vector_rt)					\
+  CORE_VAR(use_spec_R) CORE_VAR(spec_regs_R)				\
+  CORE_VAR(use_spec_F) CORE_VAR(spec_regs_F)				\
+  CORE_VAR(use_spec_C) CORE_VAR(spec_regs_C)				\
+  CORE_VAR(store_htable) CORE_VAR(bucket_free_list)			\
+  CORE_VAR(pred_PC) CORE_VAR(recover_PC)				\
+  CORE_VAR(fetch_regs_PC) CORE_VAR(fetch_pred_PC)			\
+  CORE_VAR(fetch_data) CORE_VAR(fetch_num)				\
+  CORE_VAR(fetch_tail) CORE_VAR(fetch_head)				\
+  CORE_VAR(last_op) CORE_VAR(last_inst_missed) CORE_VAR(last_inst_tmissed)\
+  CORE_VAR(inst_seq) CORE_VAR(ptrace_seq) CORE_VAR(spec_mode)		\
+  CORE_VAR(ruu_fetch_issue_delay) CORE_VAR(ptrace_active)		\
+  CORE_VAR(cpi_front) CORE_VAR(cpi_front_PC)				\
+  CORE_VAR(cpi_cycle_base) CORE_VAR(cpi_cycle_comp)			\
+  CORE_VAR(cpi_cycle_PC) CORE_VAR(cpi_last) CORE_VAR(cpi_nops)		\
+  CORE_VAR(sim_num_insn) CORE_VAR(sim_num_refs) CORE_VAR(sim_num_loads)	\
+  CORE_VAR(sim_num_branches) CORE_VAR(sim_total_insn)			\
+  CORE_VAR(sim_total_refs) CORE_VAR(sim_total_loads)			\
+  CORE_VAR(sim_total_branches) CORE_VAR(sim_slip) CORE_VAR(sim_cycle)	\
+  CORE_VAR(IFQ_count) CORE_VAR(IFQ_fcount)				\
+  CORE_VAR(RUU_count) CORE_VAR(RUU_fcount)				\
+  CORE_VAR(LSQ_count) CORE_VAR(LSQ_fcount)				\
+  CORE_VAR(lsq_forwards) CORE_VAR(lsq_ss_deps)				\
+  CORE_VAR(lsq_violations) CORE_VAR(lsq_replays)			\
+  CORE_VAR(lsq_mshr_stalls) CORE_VAR(cpi_slots)			\
+  CORE_VAR(sim_invalid_addrs) CORE_VAR(sim_fwd_insn)
+
+/* all simulated cores, the running core's record is stale */
+static struct core_t *cores = NULL;
+
+/* make core C the running core */
+static void
+core_switch(int c)			/* core to run */
 {
-  /* ignore any floating point exceptions, they may occur on mis-speculated
-     execution paths */
-  signal(SIGFPE, SIG_IGN);
+  struct core_t *core;
+
+  if (c == core_num)
+    return;
+
+  /* park the state of the running core */
+  core = &cores[core_num];
+#define CORE_VAR(VAR)							\
+  assert(sizeof(core->VAR) == sizeof(VAR));				\
+  memcpy(&core->VAR, &VAR, sizeof(VAR));
+  CORE_STATE
+#undef CORE_VAR
+
+  /* and move in the state of core C */
+  core = &cores[c];
+#define CORE_VAR(VAR)							\
+  memcpy(&VAR, &core->VAR, sizeof(VAR));
+  CORE_STATE
+#undef CORE_VAR
+
+  core_num = c;
+}
 
-  /* set up program entry state */
-  regs.regs_PC = ld_prog_entry;
-  regs.regs_NPC = regs.regs_PC + sizeof(md_inst_t);
-
-  /* check for DLite debugger entry condition */
-  if (dlite_check_break(regs.regs_PC, /* no access */0, /* addr */0, 0, 0))
-    dlite_main(regs.regs_PC, regs.regs_PC + sizeof(md_inst_t),
-	       sim_cycle, &regs, mem);
-
-  /* fast forward simulator loop, performs functional simulation for
-     FASTFWD_COUNT insts, then turns on performance (timing) simulation */
-  if (fastfwd_count > 0)
-    {
-      int icount;
-      md_inst_t inst;			/* actual instruction bits */
-      enum md_opcode op;		/* decoded opcode enum */
-      md_addr_t target_PC;		/* actual next/target PC address */
-      md_addr_t addr;			/* effective address, if load/store */
-      int is_write;			/* store? */
-      byte_t temp_byte = 0;		/* temp variable for spec mem access */
-      half_t temp_half = 0;		/* " ditto " */
-      word_t temp_word = 0;		/* " ditto " */
-#ifdef HOST_HAS_QWORD
-      qword_t temp_qword = 0;		/* " ditto " */
-#endif /* HOST_HAS_QWORD */
-      enum md_fault_type fault;
+/* create a private copy of cache (or TLB) CP for core C */
+static struct cache_t *			/* cache created */
+core_cache_clone(struct cache_t *cp,	/* cache to copy */
+		 int c)			/* core using the copy */
+{
+  struct cache_t *clone;
+  char name[128];
+
+  if (!cp)
+    return NULL;
+
+  sprintf(name, "c%d.%s", c, cp->name);
+  clone = cache_create(name, cp->nsets, cp->bsize, cp->balloc, cp->usize,
+		       cp->assoc, cp->policy, cp->blk_access_fn,
+		       cp->hit_latency, cp->prefetch_type);
+  cache_set_mshrs(clone, cp->mshr_nentries, cp->mshr_ntargets);
+  return clone;
+}
+
+/* create the additional cores, and load their programs */
+static void
+cores_create(char **envp)		/* program environment */
+{
+  char *progs, *cmd, *next, *argv[MAX_CORE_ARGS+1], name[128];
+  int c, argc;
 
-      fprintf(stderr, "sim: ** fast forwarding %d insts **\n", fastfwd_count);
+  if (sim_eio_fd != NULL)
+    fatal("EIO traces cannot be simulated on multiple cores");
 
-      for (icount=0; icount < fastfwd_count; icount++)
+  cores = (struct core_t *)calloc(n_cores, sizeof(struct core_t));
+  if (!cores)
+    fatal("out of virtual memory");
+
+  /* the first core maps its pages as well */
+  core_ptab = (struct core_page_t **)
+    calloc(CORE_PTAB_SIZE, sizeof(struct core_page_t *));
+  if (!core_ptab)
+    fatal("out of virtual memory");
+
+  /* split the command lines, the arguments are kept for the programs */
+  progs = mystrdup(cores_progs);
+  for (c=1, cmd=progs; c < n_cores; c++, cmd=next)
+    {
+      next = strchr(cmd, ';');
+      if (next)
+	*next++ = '\0';
+
+      argc = 0;
+      for (argv[argc] = strtok(cmd, " \t\n");
+	   argv[argc] != NULL;
+	   argv[argc] = strtok(NULL, " \t\n"))
 	{
-	  /* maintain $r0 semantics */
-	  regs.regs_R[MD_REG_ZERO] = 0;
-#ifdef TARGET_ALPHA
-	  regs.regs_F.d[MD_REG_ZERO] = 0.0;
-#endif /* TARGET_ALPHA */
+	  if (++argc == MAX_CORE_ARGS)
+	    fatal("too many arguments for the program of core %d", c);
+	}
+      if (argc == 0)
+	fatal("no program specified for core %d in `-cores:progs'", c);
+
+      /* the new core starts out with cleared state */
+      core_switch(c);
+
+      /* load the program in its own address space */
+      regs_init(&regs);
+      sprintf(name, "c%d.mem", c);
+      mem = mem_create(name);
+      mem_init(mem);
+      ld_stack_base = MD_STACK_BASE;
+      ld_stack_min = (md_addr_t)-1;
+      ld_load_prog(argv[0], argc, argv, envp, &regs, mem, TRUE);
+      if (sim_eio_fd != NULL)
+	fatal("EIO traces cannot be simulated on multiple cores");
+      pd = predec_create(mem, ld_text_base, ld_text_size);
+
+      /* private caches, TLBs and predictor, configured as the first core's,
+	 the L2 caches are shared */
+      cache_dl1 = core_cache_clone(cores[0].cache_dl1, c);
+      if (cores[0].cache_il1 && cores[0].cache_il1 == cores[0].cache_dl1)
+	cache_il1 = cache_dl1;
+      else
+	cache_il1 = core_cache_clone(cores[0].cache_il1, c);
+      itlb = core_cache_clone(cores[0].itlb, c);
+      dtlb = core_cache_clone(cores[0].dtlb, c);
+      pred = sim_pred_create();
+      core_ptab = (struct core_page_t **)
+	calloc(CORE_PTAB_SIZE, sizeof(struct core_page_t *));
+      if (!core_ptab)
+	fatal("out of virtual memory");
+
+      engine_init();
+    }
+
+  core_switch(0);
+}
+
+/* register the stats of the additional cores */
+static void
+cores_reg_stats(struct stat_sdb_t *sdb)	/* stats database */
+{
+  char buf[512], buf1[512], *ipc;
+  struct core_t *core;
+  int c;
+
+  /* the first core's stats are registered as usual, the other cores are
+     parked in their records when the stats are printed */
+  ipc = (char *)calloc(n_cores, 32);
+  if (!ipc)
+    fatal("out of virtual memory");
+  strcpy(ipc, "sim_IPC");
+  for (c=1; c < n_cores; c++)
+    {
+      core = &cores[c];
+
+      sprintf(buf, "c%d.sim_num_insn", c);
+      stat_reg_counter(sdb, buf, "total number of instructions committed",
+		       &core->sim_num_insn, core->sim_num_insn, NULL);
+      sprintf(buf, "c%d.sim_num_refs", c);
+      stat_reg_counter(sdb, buf, "total number of loads and stores committed",
+		       &core->sim_num_refs, 0, NULL);
+      sprintf(buf, "c%d.sim_num_loads", c);
+      stat_reg_counter(sdb, buf, "total number of loads committed",
+		       &core->sim_num_loads, 0, NULL);
+      sprintf(buf, "c%d.sim_num_branches", c);
+      stat_reg_counter(sdb, buf, "total number of branches committed",
+		       &core->sim_num_branches, 0, NULL);
+      sprintf(buf, "c%d.sim_total_insn", c);
+      stat_reg_counter(sdb, buf, "total number of instructions executed",
+		       &core->sim_total_insn, 0, NULL);
+      sprintf(buf, "c%d.sim_cycle", c);
+      stat_reg_counter(sdb, buf, "total simulation time in cycles",
+		       &core->sim_cycle, 0, NULL);
+      if (storeset_config[0])
+	{
+	  sprintf(buf, "c%d.lsq_violations", c);
+	  stat_reg_counter(sdb, buf, "total number of memory order violations",
+			   &core->lsq_violations, 0, NULL);
+	}
+      if (core->cache_dl1 && core->cache_dl1->mshrs)
+	{
+	  sprintf(buf, "c%d.lsq_mshr_stalls", c);
+	  stat_reg_counter(sdb, buf,
+			   "total number of load issues held by full l1 MSHRs",
+			   &core->lsq_mshr_stalls, 0, NULL);
+	}
+      sprintf(buf, "c%d.sim_IPC", c);
+      sprintf(buf1, "c%d.sim_num_insn / c%d.sim_cycle", c, c);
+      stat_reg_formula(sdb, buf, "instructions per cycle", buf1, NULL);
+      sprintf(buf, "c%d.sim_CPI", c);
+      sprintf(buf1, "c%d.sim_cycle / c%d.sim_num_insn", c, c);
+      stat_reg_formula(sdb, buf, "cycles per instruction", buf1, NULL);
+      sprintf(buf, "c%d.", c);
+      cpi_reg_stats(sdb, buf, core->cpi_slots);
+
+      if (core->pred)
+	{
+	  sprintf(buf, "c%d.bpred.lookups", c);
+	  stat_reg_counter(sdb, buf, "total number of bpred lookups",
+			   &core->pred->lookups, 0, NULL);
+	  sprintf(buf, "c%d.bpred.dir_hits", c);
+	  stat_reg_counter(sdb, buf,
+			   "total number of direction-predicted hits "
+			   "(includes addr-hits)",
+			   &core->pred->dir_hits, 0, NULL);
+	  sprintf(buf, "c%d.bpred.misses", c);
+	  stat_reg_counter(sdb, buf, "total number of misses",
+			   &core->pred->misses, 0, NULL);
+	  sprintf(buf, "c%d.bpred.bpred_dir_rate", c);
+	  sprintf(buf1, "c%d.bpred.dir_hits / c%d.bpred.lookups", c, c);
+	  stat_reg_formula(sdb, buf, "branch direction-prediction rate "
+			   "(i.e., all-hits/updates)", buf1, "%9.4f");
+	}
 
-	  /* get the next instruction to execute */
-	  MD_FETCH_INST(inst, mem, regs.regs_PC);
+      if (core->cache_il1 && core->cache_il1 != core->cache_dl1)
+	cache_reg_stats(core->cache_il1, sdb);
+      if (core->cache_dl1)
+	cache_reg_stats(core->cache_dl1, sdb);
+      if (core->itlb)
+	cache_reg_stats(core->itlb, sdb);
+      if (core->dtlb)
+	cache_reg_stats(core->dtlb, sdb);
+      mem_reg_stats(core->mem, sdb);
+
+      /* add this core to the throughput */
+      sprintf(ipc + strlen(ipc), " + c%d.sim_IPC", c);
+    }
 
-	  /* set default reference address */
-	  addr = 0; is_write = FALSE;
+  stat_reg_formula(sdb, "cores.IPC",
+		   "instructions per cycle of all cores (sum of sim_IPC's)",
+		   ipc, NULL);
+  free(ipc);
+}
 
-	  /* set default fault - none */
-	  fault = md_fault_none;
 
-	  /* decode the instruction */
-	  MD_SET_OPCODE(op, inst);
+/* warm caches and predictors while fast forwarding? */
+static int fastfwd_warm = FALSE;
 
-	  /* execute the instruction */
-	  switch (op)
-	    {
-#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
-	    case OP:							\
-	      SYMCAT(OP,_IMPL);						\
-	      break;
-#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
-	    case OP:							\
-	      panic("attempted to execute a linking opcode");
-#define CONNECT(OP)
-#undef DECLARE_FAULT
-#define DECLARE_FAULT(FAULT)						\
-	      { fault = (FAULT); break; }
-#include "machine.def"
-	    default:
-	      panic("attempted to execute a bogus opcode");
-	    }
+/* warm the I-TLB and I-cache as instruction fetch would */
+static INLINE void
+fastfwd_fetch(md_addr_t PC)		/* address of fetched inst */
+{
+  if (fastfwd_warm)
+    {
+      if (itlb)
+	cache_access(itlb, Read, IACOMPRESS(PC),
+		     NULL, ISCOMPRESS(sizeof(md_inst_t)), sim_cycle,
+		     NULL, NULL, 0);
+      if (cache_il1)
+	cache_access(cache_il1, Read, IACOMPRESS(PC),
+		     NULL, ISCOMPRESS(sizeof(md_inst_t)), sim_cycle,
+		     NULL, NULL, 0);
+    }
+}
+
+/* train the branch predictor with the actual outcome of control inst DEC,
+   TARGET_PC is its target address */
+static INLINE void
+fastfwd_branch(struct predec_inst_t *dec, /* executed control inst */
+	       md_addr_t target_PC)	/* branch target address */
+{
+  md_inst_t inst = dec->inst;		/* for MD_IS_RETURN() */
+  md_addr_t pred_PC;			/* predicted next PC */
+  struct bpred_update_t dir_update;	/* branch predictor dir update */
+  int stack_recover_idx;		/* bpred retstack recovery index */
 
-	  if (fault != md_fault_none)
-	    fatal("fault (%d) detected @ 0x%08p", fault, regs.regs_PC);
+  if (!fastfwd_warm || !pred)
+    return;
+
+  pred_PC = bpred_lookup(pred,
+			 /* branch address */regs.regs_PC,
+			 /* target address */target_PC,
+			 /* opcode */dec->op,
+			 /* call? */MD_IS_CALL(dec->op),
+			 /* return? */MD_IS_RETURN(dec->op),
+			 /* updt */&dir_update,
+			 /* RSB index */&stack_recover_idx);
+  if (!pred_PC)
+    pred_PC = regs.regs_PC + sizeof(md_inst_t);
+
+  /* repair speculative predictor history on a mis-predicted
+     direction, the ret-addr stack is left unchanged */
+  if ((dec->flags & F_COND)
+      && ((pred_PC != regs.regs_PC + sizeof(md_inst_t))
+	  != (regs.regs_NPC != regs.regs_PC + sizeof(md_inst_t))))
+    bpred_recover(pred, regs.regs_PC,
+		  /* taken? */regs.regs_NPC != (regs.regs_PC +
+					      sizeof(md_inst_t)),
+		  &dir_update, stack_recover_idx);
+
+  bpred_update(pred,
+	       /* branch address */regs.regs_PC,
+	       /* actual target address */regs.regs_NPC,
+	       /* taken? */regs.regs_NPC != (regs.regs_PC +
+					   sizeof(md_inst_t)),
+	       /* pred taken? */pred_PC != (regs.regs_PC +
+					    sizeof(md_inst_t)),
+	       /* correct pred? */pred_PC == regs.regs_NPC,
+	       /* opcode */dec->op,
+	       /* predictor update pointer */&dir_update);
+}
 
-	  /* update memory access stats */
-	  if (MD_OP_FLAGS(op) & F_MEM)
-	    {
-	      if (MD_OP_FLAGS(op) & F_STORE)
-		is_write = TRUE;
-	    }
+/* warm the D-TLB and D-cache with fast forwarded inst DEC as issue and
+   commit would */
+static INLINE void
+fastfwd_inst(struct predec_inst_t *dec,	/* executed inst */
+	     md_addr_t addr,		/* effective address, if load/store */
+	     int is_write)		/* store? */
+{
+  if (fastfwd_warm && (dec->flags & F_MEM) && MD_VALID_ADDR(addr))
+    {
+      if (dtlb)
+	cache_access(dtlb, Read, (addr & ~3), NULL, 4, sim_cycle,
+		     NULL, NULL, 0);
+      if (cache_dl1)
+	cache_access(cache_dl1, is_write ? Write : Read, (addr & ~3),
+		     NULL, 4, sim_cycle, NULL, NULL, 0);
+    }
+
+  /* fast forwarded insts count towards the sampled simulation total */
+  if (sample_period > 0)
+    sample_fwd_insn++;
+}
 
-	  /* check for DLite debugger entry condition */
-	  if (dlite_check_break(regs.regs_NPC,
-				is_write ? ACCESS_WRITE : ACCESS_READ,
-				addr, sim_num_insn, sim_num_insn))
-	    dlite_main(regs.regs_PC, regs.regs_NPC, sim_num_insn, &regs, mem);
+/* fast forwarded insts are counted outside of timing simulation */
+#define EXEC_INSN_CNT			sim_fwd_insn
 
-	  /* go to the next instruction */
-	  regs.regs_PC = regs.regs_NPC;
-	  regs.regs_NPC += sizeof(md_inst_t);
-	}
+#define EXEC_ON_FETCH(PC)		fastfwd_fetch(PC)
+#define EXEC_ON_BRANCH(DEC, TPC)	fastfwd_branch((DEC), (TPC))
+#define EXEC_ON_INST(DEC, ADDR, IS_WRITE)				\
+  fastfwd_inst((DEC), (ADDR), (IS_WRITE))
+#define EXEC_ON_SYSCALL(INST)		sim_syscall(INST)
+
+/* the shared execution engine replaces the speculative state accessors
+   above, none are used beyond this point */
+#include "exec.h"
+
+/* functionally simulate the next COUNT insts, as when fast forwarding,
+   if WARM is non-zero, the caches, TLBs and branch predictor are accessed
+   and updated by each inst as they would be in timing simulation, so they
+   are warm when timing simulation resumes */
+static void
+sim_fastfwd(counter_t count,		/* insts to simulate */
+	    int warm)			/* warm caches and predictors? */
+{
+  if (count <= 0)
+    return;
+
+  fastfwd_warm = warm;
+  exec_insts(count);
+  fastfwd_warm = FALSE;
+}
+
+/* fast forward from the end of a sample to the detailed warm-up of the
+   next one, returns zero if the instruction limit is reached */
+static int
+sample_fastfwd(void)
+{
+  counter_t count = sample_period - sample_warmup - sample_size;
+
+  if (max_insts)
+    {
+      if (sim_num_insn + sample_fwd_insn >= max_insts)
+	return FALSE;
+      count = MIN(count, max_insts - (sim_num_insn + sample_fwd_insn));
     }
 
-  fprintf(stderr, "sim: ** starting performance simulation **\n");
+  sim_fastfwd(count, sample_fwarm);
 
-  /* set up timing simulation entry state */
+  return !max_insts || sim_num_insn + sample_fwd_insn < max_insts;
+}
+
+/* set up timing simulation entry state, fetch starts at regs.regs_PC */
+static void
+timing_start(void)
+{
   fetch_regs_PC = regs.regs_PC - sizeof(md_inst_t);
   fetch_pred_PC = regs.regs_PC;
   regs.regs_PC = regs.regs_PC - sizeof(md_inst_t);
+}
 
-  /* main simulator loop, NOTE: the pipe stages are traverse in reverse order
-     to eliminate this/next state synchronization and relaxation problems */
-  for (;;)
+/* drop all in-flight insts from the pipeline, leaving the precise state of
+   the last non-speculative inst dispatched in regs, ready for functional
+   simulation; the insts dropped were already executed at dispatch, so only
+   their remaining timing (and commit-time cache and predictor updates) is
+   lost */
+static void
+ruu_flush(void)
+{
+  int i;
+  md_addr_t resume_PC;
+  struct RUU_station *rs;
+
+  if (spec_mode)
+    {
+      /* resume after the mis-predicted branch, and repair the return
+	 address stack as its recovery would */
+      for (i=0; i<RUU_num; i++)
+	{
+	  rs = &RUU[(RUU_head + i) % RUU_size];
+	  if (rs->recover_inst)
+	    {
+	      if (pred)
+		bpred_recover(pred, rs->PC,
+			      /* taken? */rs->next_PC != (rs->PC
+							  + sizeof(md_inst_t)),
+			      &rs->dir_update, rs->stack_recover_idx);
+	      break;
+	    }
+	}
+      resume_PC = recover_PC;
+
+      /* discard wrong path state, also empties the IFETCH -> DISPATCH queue */
+      tracer_recover();
+    }
+  else
+    {
+      resume_PC = regs.regs_NPC;
+
+      /* squash the IFETCH -> DISPATCH queue */
+      while (fetch_num != 0)
+	{
+	  ptrace_endinst(fetch_data[fetch_head].ptrace_seq);
+	  fetch_head = (fetch_head+1) & (ruu_ifq_size - 1);
+	  fetch_num--;
+	}
+      fetch_tail = fetch_head = 0;
+    }
+
+  /* squash all RUU and LSQ entries */
+  for (; RUU_num > 0; RUU_num--)
     {
-      /* RUU/LSQ sanity checks */
-      if (RUU_num < LSQ_num)
-	panic("RUU_num < LSQ_num");
-      if (((RUU_head + RUU_num) % RUU_size) != RUU_tail)
-	panic("RUU_head/RUU_tail wedged");
-      if (((LSQ_head + LSQ_num) % LSQ_size) != LSQ_tail)
-	panic("LSQ_head/LSQ_tail wedged");
+      rs = &RUU[RUU_head];
+      for (i=0; i<MAX_ODEPS; i++)
+	{
+	  RSLINK_FREE_LIST(rs->odep_list[i]);
+	  rs->odep_list[i] = NULL;
+	}
+      rs->tag++;
+      ptrace_endinst(rs->ptrace_seq);
+      RUU_head = (RUU_head + 1) % RUU_size;
+    }
+  for (; LSQ_num > 0; LSQ_num--)
+    {
+      rs = &LSQ[LSQ_head];
+      for (i=0; i<MAX_ODEPS; i++)
+	{
+	  RSLINK_FREE_LIST(rs->odep_list[i]);
+	  rs->odep_list[i] = NULL;
+	}
+      RSLINK_FREE_LIST(rs->ld_waiters);
+      rs->ld_waiters = NULL;
+      rs->addr_older = NULL;
+      rs->tag++;
+      ptrace_endinst(rs->ptrace_seq);
+      LSQ_head = (LSQ_head + 1) % LSQ_size;
+    }
+  if (RUU_head != RUU_tail || LSQ_head != LSQ_tail)
+    panic("RUU/LSQ head/tail wedged in flush");
+  lsq_deps_flush();
 
-      /* check if pipetracing is still active */
-      ptrace_check_active(regs.regs_PC, sim_num_insn, sim_cycle);
+  /* all in-flight events and ready insts are now stale, reclaim them */
+  eventq_flush();
+  readyq_flush();
+
+  /* all registers are again valid in the architected register file */
+  cv_init();
 
-      /* indicate new cycle in pipetrace */
-      ptrace_newcycle(sim_cycle);
+  /* release all functional units */
+  res_release_all(fu_pool);
 
-      /* commit entries from RUU/LSQ to architected register file */
-      ruu_commit();
+  last_op = RSLINK_NULL;
+  ruu_fetch_issue_delay = 0;
+  cpi_front = cpi_fetch;
+  replay_num = 0;
 
-      /* service function unit release events */
-      ruu_release_fu();
+  /* functional simulation continues at the resume PC */
+  regs.regs_PC = resume_PC;
+  regs.regs_NPC = resume_PC + sizeof(md_inst_t);
+}
 
-      /* ==> may have ready queue entries carried over from previous cycles */
 
-      /* service result completions, also readies dependent operations */
-      /* ==> inserts operations into ready queue --> register deps resolved */
-      ruu_writeback();
+/* simulate one cycle of the running core, NOTE: the pipe stages are
+   traversed in reverse order to eliminate this/next state synchronization
+   and relaxation problems */
+static void
+ruu_cycle(void)
+{
+  /* RUU/LSQ sanity checks */
+  if (RUU_num < LSQ_num)
+    panic("RUU_num < LSQ_num");
+  if (((RUU_head + RUU_num) % RUU_size) != RUU_tail)
+    panic("RUU_head/RUU_tail wedged");
+  if (((LSQ_head + LSQ_num) % LSQ_size) != LSQ_tail)
+    panic("LSQ_head/LSQ_tail wedged");
 
-      if (!bugcompat_mode)
+  /* check if pipetracing is still active, only the first core is traced */
+  if (core_num == 0)
+    ptrace_check_active(regs.regs_PC, sim_num_insn, sim_cycle);
+
+  /* indicate new cycle in pipetrace */
+  ptrace_newcycle(sim_cycle);
+
+  /* commit entries from RUU/LSQ to architected register file */
+  ruu_commit();
+
+  /* service function unit release events */
+  ruu_release_fu();
+
+  /* ==> may have ready queue entries carried over from previous cycles */
+
+  /* service result completions, also readies dependent operations */
+  /* ==> inserts operations into ready queue --> register deps resolved */
+  ruu_writeback();
+
+  if (!bugcompat_mode)
+    {
+      /* try to locate memory operations that are ready to execute */
+      /* ==> inserts operations into ready queue --> mem deps resolved */
+      lsq_refresh();
+
+      /* issue operations ready to execute from a previous cycle */
+      /* <== drains ready queue <-- ready operations commence execution */
+      ruu_issue();
+    }
+
+  /* decode and dispatch new operations */
+  /* ==> insert ops w/ no deps or all regs ready --> reg deps resolved */
+  ruu_dispatch();
+
+  if (bugcompat_mode)
+    {
+      /* try to locate memory operations that are ready to execute */
+      /* ==> inserts operations into ready queue --> mem deps resolved */
+      lsq_refresh();
+
+      /* issue operations ready to execute from a previous cycle */
+      /* <== drains ready queue <-- ready operations commence execution */
+      ruu_issue();
+    }
+
+  /* call instruction fetch unit if it is not blocked */
+  if (!ruu_fetch_issue_delay)
+    ruu_fetch();
+  else
+    ruu_fetch_issue_delay--;
+
+  /* update buffer occupancy stats */
+  IFQ_count += fetch_num;
+  IFQ_fcount += ((fetch_num == ruu_ifq_size) ? 1 : 0);
+  RUU_count += RUU_num;
+  RUU_fcount += ((RUU_num == RUU_size) ? 1 : 0);
+  LSQ_count += LSQ_num;
+  LSQ_fcount += ((LSQ_num == LSQ_size) ? 1 : 0);
+
+  /* charge the commit slots of this cycle to the CPI stack */
+  cpi_cycle_end();
+
+  /* go to next cycle */
+  sim_cycle++;
+}
+
+/* if no pipe stage can make progress until the next event completes or the
+   fetch unit unblocks, advance the simulation directly to that cycle; the
+   buffer occupancy stats of the skipped cycles are accounted in bulk */
+static void
+ruu_skip_stalled(void)
+{
+  tick_t next, skip;
+  counter_t nops;
+  enum cpi_comp_t comp;
+  md_addr_t PC;
+
+  /* can commit retire the RUU head? */
+  if (RUU_num > 0
+      && RUU[RUU_head].completed
+      && (!RUU[RUU_head].ea_comp || LSQ[LSQ_head].completed))
+    return;
+
+  /* can issue start any operation? */
+  if (ready_queue.num != 0)
+    return;
+
+  /* are squashed insts waiting to be replayed? */
+  if (replay_num != 0)
+    return;
+
+  /* can dispatch take any instruction from the IFQ? */
+  if (fetch_num != 0
+      && RUU_num < RUU_size && LSQ_num < LSQ_size
+      && (ruu_include_spec || !spec_mode))
+    return;
+
+  /* can fetch access the I-cache? */
+  if (!ruu_fetch_issue_delay && fetch_num < ruu_ifq_size)
+    return;
+
+  /* nothing can happen before the next event or the fetch unblocks */
+  next = eventq_next_time();
+  if (ruu_fetch_issue_delay
+      && (!next || sim_cycle + ruu_fetch_issue_delay < next))
+    next = sim_cycle + ruu_fetch_issue_delay;
+  if (next <= sim_cycle)
+    return;
+  skip = next - sim_cycle;
+
+  /* update buffer occupancy stats and the CPI stack for the skipped
+     cycles, no inst retires in them, but NOPs still waiting for a commit
+     slot do */
+  nops = MIN(cpi_nops, ruu_commit_width * skip);
+  cpi_nops -= nops;
+  cpi_slots[cpi_base] += nops;
+  comp = cpi_stall(&PC);
+  cpi_charge(comp, PC, ruu_commit_width * skip - nops);
+  IFQ_count += fetch_num * skip;
+  IFQ_fcount += ((fetch_num == ruu_ifq_size) ? skip : 0);
+  RUU_count += RUU_num * skip;
+  RUU_fcount += ((RUU_num == RUU_size) ? skip : 0);
+  LSQ_count += LSQ_num * skip;
+  LSQ_fcount += ((LSQ_num == LSQ_size) ? skip : 0);
+
+  /* the skipped cycles only count down the fetch and FU busy times */
+  if (ruu_fetch_issue_delay)
+    ruu_fetch_issue_delay -= skip;
+  res_advance(fu_pool, skip);
+
+  /* all wheel slots before the next event are empty */
+  sim_cycle = next;
+  sim_skip_cycle += skip;
+  eventq_cycle = next;
+  eventq_migrate();
+}
+
+/* simulate one cycle of the running core, returns zero once the core has
+   stopped, i.e., its program exited or it reached the inst limit */
+static int
+core_cycle(void)
+{
+  int exit_code;
+
+  if ((exit_code = setjmp(core_exit_buf)) != 0)
+    {
+      /* special handling as longjmp cannot pass 0 */
+      myfprintf(stderr, "sim: core %d program exited with code %d "
+		"@ cycle %n\n", core_num, exit_code-1, sim_cycle);
+      return FALSE;
+    }
+
+  ruu_cycle();
+
+  if (max_insts && sim_num_insn >= max_insts)
+    {
+      cpi_finish(/* !exiting */FALSE);
+      return FALSE;
+    }
+  return TRUE;
+}
+
+/* simulate all cores cycle by cycle until they have all stopped, the order
+   in which the cores are stepped rotates each cycle, so that no core is
+   always the first to access the shared L2 caches */
+static void
+cores_main(void)
+{
+  int c, i, first, running;
+
+  for (c=0; c < n_cores; c++)
+    {
+      core_switch(c);
+      timing_start();
+    }
+
+  for (first=0, running=n_cores; running > 0; first = (first+1) % n_cores)
+    {
+      for (i=0; i < n_cores; i++)
 	{
-	  /* try to locate memory operations that are ready to execute */
-	  /* ==> inserts operations into ready queue --> mem deps resolved */
-	  lsq_refresh();
+	  c = (first + i) % n_cores;
+	  if (cores[c].halted)
+	    continue;
+
+	  core_switch(c);
+	  if (!core_cycle())
+	    {
+	      cores[c].halted = TRUE;
+	      running--;
+	    }
 
-	  /* issue operations ready to execute from a previous cycle */
-	  /* <== drains ready queue <-- ready operations commence execution */
-	  ruu_issue();
+	  /* dump interval stats? the registered stats are those of the
+	     first core, while it is switched in */
+	  if (c == 0)
+	    SIM_STATS_CHECK();
 	}
+    }
+
+  /* the stats of the first core are in the globals */
+  core_switch(0);
+}
 
-      /* decode and dispatch new operations */
-      /* ==> insert ops w/ no deps or all regs ready --> reg deps resolved */
-      ruu_dispatch();
+/* start simulation, program loaded, processor precise state initialized */
+void
+sim_main(void)
+{
+  int sample_measuring;			/* measuring the current sample? */
+  counter_t sample_begin_insn;		/* inst count at start of sample */
+  tick_t sample_begin_cycle;		/* cycle at start of sample */
+  int c;
+
+  /* ignore any floating point exceptions, they may occur on mis-speculated
+     execution paths */
+  signal(SIGFPE, SIG_IGN);
 
-      if (bugcompat_mode)
+  /* each core runs its own program, starting at its entry point */
+  for (c=0; c < n_cores; c++)
+    {
+      core_switch(c);
+
+      /* set up program entry state */
+      regs.regs_PC = ld_prog_entry;
+      regs.regs_NPC = regs.regs_PC + sizeof(md_inst_t);
+
+      /* check for DLite debugger entry condition */
+      if (dlite_check_break(regs.regs_PC, /* no access */0, /* addr */0,
+			    0, 0))
+	dlite_main(regs.regs_PC, regs.regs_PC + sizeof(md_inst_t),
+		   sim_cycle, &regs, mem);
+
+      /* fast forward simulator loop, performs functional simulation for
+	 FASTFWD_COUNT insts, then turns on performance (timing) simulation */
+      if (fastfwd_count > 0)
 	{
-	  /* try to locate memory operations that are ready to execute */
-	  /* ==> inserts operations into ready queue --> mem deps resolved */
-	  lsq_refresh();
+	  if (core_num == 0)
+	    fprintf(stderr, "sim: ** fast forwarding %d insts **\n",
+		    fastfwd_count);
+	  sim_fastfwd(fastfwd_count,
+		      /* warm */sample_period > 0 && sample_fwarm);
+	}
 
-	  /* issue operations ready to execute from a previous cycle */
-	  /* <== drains ready queue <-- ready operations commence execution */
-	  ruu_issue();
+      /* warm up caches and predictors, e.g., after restoring a checkpoint,
+	 warm-up accesses are not counted in the cache and predictor stats */
+      if (warmup_count > 0)
+	{
+	  if (core_num == 0)
+	    fprintf(stderr, "sim: ** warming up %d insts **\n", warmup_count);
+	  sim_fastfwd(warmup_count, /* warm */TRUE);
+
+	  cache_after_priming(cache_il1);
+	  cache_after_priming(cache_il2);
+	  cache_after_priming(cache_dl1);
+	  cache_after_priming(cache_dl2);
+	  cache_after_priming(itlb);
+	  cache_after_priming(dtlb);
+	  bpred_after_priming(pred);
 	}
+    }
+  core_switch(0);
 
-      /* call instruction fetch unit if it is not blocked */
-      if (!ruu_fetch_issue_delay)
-	ruu_fetch();
-      else
-	ruu_fetch_issue_delay--;
+  if (sample_period > 0)
+    {
+      fprintf(stderr, "sim: ** starting sampled performance simulation **\n");
+
+      /* functionally simulate up to the first sample */
+      if (!sample_fastfwd())
+	return;
+    }
+  else
+    fprintf(stderr, "sim: ** starting performance simulation **\n");
+
+  if (n_cores > 1)
+    {
+      cores_main();
+      return;
+    }
+
+  /* set up timing simulation entry state */
+  timing_start();
+  sample_measuring = FALSE;
+  sample_begin_insn = sim_num_insn + sample_warmup;
+  sample_begin_cycle = sim_cycle;
+
+  /* main simulator loop, NOTE: the pipe stages are traverse in reverse order
+     to eliminate this/next state synchronization and relaxation problems */
+  for (;;)
+    {
+      /* simulate one cycle */
+      ruu_cycle();
 
-      /* update buffer occupancy stats */
-      IFQ_count += fetch_num;
-      IFQ_fcount += ((fetch_num == ruu_ifq_size) ? 1 : 0);
-      RUU_count += RUU_num;
-      RUU_fcount += ((RUU_num == RUU_size) ? 1 : 0);
-      LSQ_count += LSQ_num;
-      LSQ_fcount += ((LSQ_num == LSQ_size) ? 1 : 0);
+      /* skip the following cycles if the pipeline is stalled, pipetraces
+	 still see every cycle */
+      if (skip_stalls && !ptrace_outfd)
+	ruu_skip_stalled();
 
-      /* go to next cycle */
-      sim_cycle++;
+      /* dump interval stats? */
+      SIM_STATS_CHECK();
 
       /* finish early? */
-      if (max_insts && sim_num_insn >= max_insts)
-	return;
+      if (max_insts && sim_num_insn + sample_fwd_insn >= max_insts)
+	{
+	  cpi_finish(/* !exiting */FALSE);
+	  return;
+	}
+
+      /* sampled simulation, start or finish measuring the current sample */
+      if (sample_period > 0)
+	{
+	  if (!sample_measuring)
+	    {
+	      /* detailed warm-up done? */
+	      if (sim_num_insn >= sample_begin_insn)
+		{
+		  sample_measuring = TRUE;
+		  sample_begin_insn = sim_num_insn;
+		  sample_begin_cycle = sim_cycle;
+		}
+	    }
+	  else if (sim_num_insn - sample_begin_insn >= sample_size)
+	    {
+	      /* sample done, record its CPI */
+	      stat_add_value(sample_cpi,
+			     (double)(sim_cycle - sample_begin_cycle)
+			     / (double)(sim_num_insn - sample_begin_insn));
+
+	      /* drop the in-flight insts and fast forward to the next
+		 sample, whose detailed warm-up then begins */
+	      cpi_drain(/* !exiting */FALSE);
+	      ruu_flush();
+	      if (!sample_fastfwd())
+		{
+		  cpi_check();
+		  return;
+		}
+
+	      timing_start();
+	      sample_measuring = FALSE;
+	      sample_begin_insn = sim_num_insn + sample_warmup;
+	    }
+	}
     }
 }
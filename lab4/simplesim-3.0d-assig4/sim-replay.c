@@ -0,0 +1,336 @@
+/* sim-replay.c - trace-driven cache simulator implementation */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "regs.h"
+#include "memory.h"
+#include "cache.h"
+#include "memtrace.h"
+#include "hier.h"
+#include "options.h"
+#include "stats.h"
+#include "sim.h"
+
+#ifdef HOST_HAS_THREADS
+#include <pthread.h>
+#endif /* HOST_HAS_THREADS */
+
+/*
+ * This file implements a trace-driven cache simulator.  Rather than executing
+ * a program, it replays a memory reference trace written by sim-cache (see
+ * sim-cache's -trace:mem option) into any number of independent cache
+ * hierarchies.  Each hierarchy has the same form as the one simulated by
+ * sim-cache, i.e., up to two levels of instruction and data cache (with any
+ * levels unified) and one level of instruction and data TLBs, so the results
+ * of a hierarchy match those of sim-cache run with the same configuration.
+ *
+ * The hierarchies are divided among worker threads, each thread streams the
+ * trace on its own and feeds its share of the hierarchies, so a sweep of many
+ * cache configurations completes in about the time it takes to replay the
+ * trace into a few of them.
+ */
+
+/* maximum number of cache hierarchies replayed at once */
+#define MAX_HIERS		64
+
+/* the cache hierarchies being replayed */
+static struct hier_t hiers[MAX_HIERS];
+
+/* worker thread state */
+struct worker_t
+{
+  int first;			/* first hierarchy fed by this worker */
+  int last;			/* last hierarchy fed by this worker, +1 */
+  counter_t num_insn;		/* instruction fetches replayed */
+  counter_t num_refs;		/* loads and stores replayed */
+};
+
+/* memory reference trace file name */
+static char *trace_fname = NULL;
+
+/* track number of refs */
+static counter_t sim_num_refs = 0;
+
+/* cache hierarchy options */
+static int hier_nelt = 0;
+static char *hier_opts[MAX_HIERS];
+
+/* default cache hierarchy, used when none are given, the same as the
+   sim-cache defaults */
+static char *hier_default[] = {
+  "il1=il1:256:32:1:l:0,il2=dl2,dl1=dl1:256:32:1:l:0,dl2=ul2:1024:64:4:l:0,"
+  "itlb=itlb:16:4096:4:l:0,dtlb=dtlb:32:4096:4:l:0"
+};
+
+/* number of worker threads, 0 for one per hierarchy */
+static int num_threads;
+
+/* return the PC of the reference being replayed, used by the prefetchers */
+md_addr_t
+get_PC()
+{
+  return hier_pc;
+}
+
+/* register simulator-specific options */
+void
+sim_reg_options(struct opt_odb_t *odb)	/* options database */
+{
+  opt_reg_header(odb, 
+"sim-replay: This simulator implements a trace-driven cache simulator.  A\n"
+"memory reference trace, written by sim-cache with the `-trace:mem' option,\n"
+"is replayed into one or more independent cache hierarchies, in parallel\n"
+"worker threads.  Give the trace file in place of the program to execute.\n"
+		 );
+
+  opt_reg_string_list(odb, "-hier",
+		      "cache hierarchy config(s), i.e., <level>=<config>,...",
+		      hier_opts, MAX_HIERS, &hier_nelt, /* default */NULL,
+		      /* print */TRUE, /* format */NULL, /* accrue */TRUE);
+  opt_reg_note(odb,
+"  Each use of `-hier' defines one cache hierarchy, as a comma separated\n"
+"  list of <level>=<config> pairs, where <level> is one of il1, il2, dl1,\n"
+"  dl2, itlb or dtlb, and <config> is a cache config in the same format as\n"
+"  sim-cache's `-cache:dl1' option.  As in sim-cache, il1 may be given as\n"
+"  `dl1' or `dl2', and il2 as `dl2', to unify levels.  Levels not listed\n"
+"  are not simulated.  The caches of hierarchy <n> are reported with the\n"
+"  prefix `h<n>.', e.g., h0.dl1.misses.  Without `-hier', a single\n"
+"  hierarchy with the sim-cache default caches and TLBs is replayed.\n"
+"\n"
+"    Example:   -hier il1=dl1,dl1=dl1:256:64:4:l:0,dtlb=dtlb:32:4096:4:l:0\n"
+"\n"
+"  NOTE: caches with random replacement share one random number stream, so\n"
+"  their results vary between runs when more than one thread is used.\n"
+	       );
+  opt_reg_int(odb, "-threads",
+	      "number of worker threads (0 for one per hierarchy)",
+	      &num_threads, /* default */0, /* print */TRUE, /* format */NULL);
+}
+
+/* check simulator-specific option values */
+void
+sim_check_options(struct opt_odb_t *odb,	/* options database */
+		  int argc, char **argv)	/* command line arguments */
+{
+  int h;
+  char prefix[32];
+
+  if (num_threads < 0)
+    fatal("number of worker threads must be non-negative");
+
+  if (hier_nelt == 0)
+    hier_opts[hier_nelt++] = hier_default[0];
+
+  for (h=0; h<hier_nelt; h++)
+    {
+      sprintf(prefix, "h%d.", h);
+      hier_create(&hiers[h], prefix, hier_opts[h]);
+    }
+}
+
+/* register simulator-specific statistics */
+void
+sim_reg_stats(struct stat_sdb_t *sdb)	/* stats database */
+{
+  int h;
+
+  /* register baseline stats */
+  stat_reg_counter(sdb, "sim_num_insn",
+		   "total number of instructions replayed",
+		   &sim_num_insn, sim_num_insn, NULL);
+  stat_reg_counter(sdb, "sim_num_refs",
+		   "total number of data references replayed",
+		   &sim_num_refs, 0, NULL);
+  stat_reg_int(sdb, "sim_elapsed_time",
+	       "total simulation time in seconds",
+	       &sim_elapsed_time, 0, NULL);
+  stat_reg_formula(sdb, "sim_inst_rate",
+		   "simulation speed (in insts/sec)",
+		   "sim_num_insn / sim_elapsed_time", NULL);
+
+  /* register cache stats */
+  for (h=0; h<hier_nelt; h++)
+    hier_reg_stats(&hiers[h], sdb);
+}
+
+/* initialize the simulator */
+void
+sim_init(void)
+{
+  sim_num_refs = 0;
+}
+
+/* load program into simulated state, for this simulator the "program" is
+   the memory reference trace, which is checked here and replayed later */
+void
+sim_load_prog(char *fname,		/* program to load */
+	      int argc, char **argv,	/* program arguments */
+	      char **envp)		/* program environment */
+{
+  if (argc > 1)
+    fatal("sim-replay takes no arguments after the trace file name");
+
+  trace_fname = fname;
+
+  /* open the trace once to validate it */
+  mtrace_close(mtrace_open(trace_fname, "r"));
+}
+
+/* print simulator-specific configuration information */
+void
+sim_aux_config(FILE *stream)		/* output stream */
+{
+  int h;
+
+  fprintf(stream, "replay: trace `%s', %d hierarchies\n",
+	  trace_fname, hier_nelt);
+  for (h=0; h<hier_nelt; h++)
+    fprintf(stream, "replay: h%d: %s\n", h, hier_opts[h]);
+}
+
+/* dump simulator-specific auxiliary simulator statistics */
+void
+sim_aux_stats(FILE *stream)		/* output stream */
+{
+  /* nada */
+}
+
+/* un-initialize the simulator */
+void
+sim_uninit(void)
+{
+  /* nada */
+}
+
+/* worker thread, replays the whole trace into hierarchies FIRST to LAST-1 */
+static void *
+replay_worker(void *arg)		/* worker state */
+{
+  struct worker_t *w = (struct worker_t *)arg;
+  struct mtrace_t *mt;
+  struct mtrace_rec_t rec;
+  int h;
+
+  mt = mtrace_open(trace_fname, "r");
+  while (mtrace_read(mt, &rec))
+    {
+      if (rec.kind == mt_ifetch)
+	w->num_insn++;
+      else
+	w->num_refs++;
+
+      for (h=w->first; h<w->last; h++)
+	hier_access(&hiers[h], rec.kind, rec.pc, rec.addr, rec.nbytes);
+    }
+  mtrace_close(mt);
+
+  return NULL;
+}
+
+/* start simulation, program loaded, processor precise state initialized */
+void
+sim_main(void)
+{
+  struct worker_t *workers;
+  int i, nworkers;
+#ifdef HOST_HAS_THREADS
+  pthread_t *tids;
+#endif /* HOST_HAS_THREADS */
+
+  fprintf(stderr, "sim: ** starting trace-driven cache simulation **\n");
+
+  nworkers = (num_threads == 0) ? hier_nelt : MIN(num_threads, hier_nelt);
+#ifndef HOST_HAS_THREADS
+  nworkers = 1;
+#endif /* !HOST_HAS_THREADS */
+  nworkers = MAX(nworkers, 1);
+
+  /* divide the hierarchies evenly among the workers */
+  workers = (struct worker_t *)calloc(nworkers, sizeof(struct worker_t));
+  if (!workers)
+    fatal("out of virtual memory");
+  for (i=0; i<nworkers; i++)
+    {
+      workers[i].first = (i * hier_nelt) / nworkers;
+      workers[i].last = ((i+1) * hier_nelt) / nworkers;
+    }
+
+#ifdef HOST_HAS_THREADS
+  tids = (pthread_t *)calloc(nworkers, sizeof(pthread_t));
+  if (!tids)
+    fatal("out of virtual memory");
+  for (i=1; i<nworkers; i++)
+    {
+      if (pthread_create(&tids[i], NULL, replay_worker, &workers[i]) != 0)
+	fatal("could not create replay worker thread");
+    }
+#endif /* HOST_HAS_THREADS */
+
+  /* the main thread is worker zero */
+  replay_worker(&workers[0]);
+
+#ifdef HOST_HAS_THREADS
+  for (i=1; i<nworkers; i++)
+    pthread_join(tids[i], NULL);
+  free(tids);
+#endif /* HOST_HAS_THREADS */
+
+  /* every worker replays the entire trace, any of them can be counted */
+  sim_num_insn = workers[0].num_insn;
+  sim_num_refs = workers[0].num_refs;
+  free(workers);
+}
@@ -58,6 +58,7 @@
 #include "machine.h"
 #include "regs.h"
 #include "memory.h"
+#include "predec.h"
 #include "loader.h"
 #include "syscall.h"
 #include "dlite.h"
@@ -78,6 +79,9 @@ static struct regs_t regs;
 /* simulated memory */
 static struct mem_t *mem = NULL;
 
+/* predecoded program text */
+static struct predec_t *pd = NULL;
+
 /* track number of refs */
 static counter_t sim_num_refs = 0;
 
@@ -128,6 +132,7 @@ sim_reg_stats(struct stat_sdb_t *sdb)
 		   "sim_num_insn / sim_elapsed_time", NULL);
   ld_reg_stats(sdb);
   mem_reg_stats(mem, sdb);
+  predec_reg_stats(pd, sdb);
 }
 
 /* initialize the simulator */
@@ -153,6 +158,9 @@ sim_load_prog(char *fname,		/* program to load */
   /* load program text and data, set up environment, memory, and regs */
   ld_load_prog(fname, argc, argv, envp, &regs, mem, TRUE);
 
+  /* predecode the program text as it is executed */
+  pd = predec_create(mem, ld_text_base, ld_text_size);
+
   /* initialize the DLite debugger */
   dlite_init(md_reg_obj, dlite_mem_obj, dlite_mstate_obj);
 }
@@ -183,92 +191,38 @@ sim_uninit(void)
  * configure the execution engine
  */
 
-/*
- * precise architected register accessors
- */
+/* trace and count each executed inst */
+static INLINE void
+safe_inst(struct predec_inst_t *dec,	/* executed inst */
+	  md_addr_t addr)		/* effective address, if load/store */
+{
+  if (verbose)
+    {
+      myfprintf(stderr, "%10n [xor: 0x%08x] @ 0x%08p: ",
+		sim_num_insn, md_xor_regs(&regs), regs.regs_PC);
+      md_print_insn(dec->inst, regs.regs_PC, stderr);
+      if (dec->flags & F_MEM)
+	myfprintf(stderr, "  mem: 0x%08p", addr);
+      fprintf(stderr, "\n");
+      /* fflush(stderr); */
+    }
 
-/* next program counter */
-#define SET_NPC(EXPR)		(regs.regs_NPC = (EXPR))
-
-/* current program counter */
-#define CPC			(regs.regs_PC)
-
-/* general purpose registers */
-#define GPR(N)			(regs.regs_R[N])
-#define SET_GPR(N,EXPR)		(regs.regs_R[N] = (EXPR))
-
-#if defined(TARGET_PISA)
-
-/* floating point registers, L->word, F->single-prec, D->double-prec */
-#define FPR_L(N)		(regs.regs_F.l[(N)])
-#define SET_FPR_L(N,EXPR)	(regs.regs_F.l[(N)] = (EXPR))
-#define FPR_F(N)		(regs.regs_F.f[(N)])
-#define SET_FPR_F(N,EXPR)	(regs.regs_F.f[(N)] = (EXPR))
-#define FPR_D(N)		(regs.regs_F.d[(N) >> 1])
-#define SET_FPR_D(N,EXPR)	(regs.regs_F.d[(N) >> 1] = (EXPR))
-
-/* miscellaneous register accessors */
-#define SET_HI(EXPR)		(regs.regs_C.hi = (EXPR))
-#define HI			(regs.regs_C.hi)
-#define SET_LO(EXPR)		(regs.regs_C.lo = (EXPR))
-#define LO			(regs.regs_C.lo)
-#define FCC			(regs.regs_C.fcc)
-#define SET_FCC(EXPR)		(regs.regs_C.fcc = (EXPR))
-
-#elif defined(TARGET_ALPHA)
-
-/* floating point registers, L->word, F->single-prec, D->double-prec */
-#define FPR_Q(N)		(regs.regs_F.q[N])
-#define SET_FPR_Q(N,EXPR)	(regs.regs_F.q[N] = (EXPR))
-#define FPR(N)			(regs.regs_F.d[(N)])
-#define SET_FPR(N,EXPR)		(regs.regs_F.d[(N)] = (EXPR))
-
-/* miscellaneous register accessors */
-#define FPCR			(regs.regs_C.fpcr)
-#define SET_FPCR(EXPR)		(regs.regs_C.fpcr = (EXPR))
-#define UNIQ			(regs.regs_C.uniq)
-#define SET_UNIQ(EXPR)		(regs.regs_C.uniq = (EXPR))
-
-#else
-#error No ISA target defined...
-#endif
-
-/* precise architected memory state accessor macros */
-#define READ_BYTE(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_BYTE(mem, addr))
-#define READ_HALF(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_HALF(mem, addr))
-#define READ_WORD(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_WORD(mem, addr))
-#ifdef HOST_HAS_QWORD
-#define READ_QWORD(SRC, FAULT)						\
-  ((FAULT) = md_fault_none, addr = (SRC), MEM_READ_QWORD(mem, addr))
-#endif /* HOST_HAS_QWORD */
-
-#define WRITE_BYTE(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_BYTE(mem, addr, (SRC)))
-#define WRITE_HALF(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_HALF(mem, addr, (SRC)))
-#define WRITE_WORD(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_WORD(mem, addr, (SRC)))
-#ifdef HOST_HAS_QWORD
-#define WRITE_QWORD(SRC, DST, FAULT)					\
-  ((FAULT) = md_fault_none, addr = (DST), MEM_WRITE_QWORD(mem, addr, (SRC)))
-#endif /* HOST_HAS_QWORD */
-
-/* system call handler macro */
-#define SYSCALL(INST)	sys_syscall(&regs, mem_access, mem, INST, TRUE)
+  if (dec->flags & F_MEM)
+    sim_num_refs++;
+
+  /* dump interval stats? */
+  SIM_STATS_CHECK();
+}
+
+#define EXEC_ON_INST(DEC, ADDR, IS_WRITE)	safe_inst((DEC), (ADDR))
+#define EXEC_STOP()		(max_insts && sim_num_insn >= max_insts)
+
+#include "exec.h"
 
 /* start simulation, program loaded, processor precise state initialized */
 void
 sim_main(void)
 {
-  md_inst_t inst;
-  register md_addr_t addr;
-  enum md_opcode op;
-  register int is_write;
-  enum md_fault_type fault;
-
   fprintf(stderr, "sim: ** starting functional simulation **\n");
 
   /* set up initial default next PC */
@@ -279,80 +233,6 @@ sim_main(void)
     dlite_main(regs.regs_PC - sizeof(md_inst_t),
 	       regs.regs_PC, sim_num_insn, &regs, mem);
 
-  while (TRUE)
-    {
-      /* maintain $r0 semantics */
-      regs.regs_R[MD_REG_ZERO] = 0;
-#ifdef TARGET_ALPHA
-      regs.regs_F.d[MD_REG_ZERO] = 0.0;
-#endif /* TARGET_ALPHA */
-
-      /* get the next instruction to execute */
-      MD_FETCH_INST(inst, mem, regs.regs_PC);
-
-      /* keep an instruction count */
-      sim_num_insn++;
-
-      /* set default reference address and access mode */
-      addr = 0; is_write = FALSE;
-
-      /* set default fault - none */
-      fault = md_fault_none;
-
-      /* decode the instruction */
-      MD_SET_OPCODE(op, inst);
-
-      /* execute the instruction */
-      switch (op)
-	{
-#define DEFINST(OP,MSK,NAME,OPFORM,RES,FLAGS,O1,O2,I1,I2,I3)		\
-	case OP:							\
-          SYMCAT(OP,_IMPL);						\
-          break;
-#define DEFLINK(OP,MSK,NAME,MASK,SHIFT)					\
-        case OP:							\
-          panic("attempted to execute a linking opcode");
-#define CONNECT(OP)
-#define DECLARE_FAULT(FAULT)						\
-	  { fault = (FAULT); break; }
-#include "machine.def"
-	default:
-	  panic("attempted to execute a bogus opcode");
-      }
-
-      if (fault != md_fault_none)
-	fatal("fault (%d) detected @ 0x%08p", fault, regs.regs_PC);
-
-      if (verbose)
-	{
-	  myfprintf(stderr, "%10n [xor: 0x%08x] @ 0x%08p: ",
-		    sim_num_insn, md_xor_regs(&regs), regs.regs_PC);
-	  md_print_insn(inst, regs.regs_PC, stderr);
-	  if (MD_OP_FLAGS(op) & F_MEM)
-	    myfprintf(stderr, "  mem: 0x%08p", addr);
-	  fprintf(stderr, "\n");
-	  /* fflush(stderr); */
-	}
-
-      if (MD_OP_FLAGS(op) & F_MEM)
-	{
-	  sim_num_refs++;
-	  if (MD_OP_FLAGS(op) & F_STORE)
-	    is_write = TRUE;
-	}
-
-      /* check for DLite debugger entry condition */
-      if (dlite_check_break(regs.regs_NPC,
-			    is_write ? ACCESS_WRITE : ACCESS_READ,
-			    addr, sim_num_insn, sim_num_insn))
-	dlite_main(regs.regs_PC, regs.regs_NPC, sim_num_insn, &regs, mem);
-
-      /* go to the next instruction */
-      regs.regs_PC = regs.regs_NPC;
-      regs.regs_NPC += sizeof(md_inst_t);
-
-      /* finish early? */
-      if (max_insts && sim_num_insn >= max_insts)
-	return;
-    }
+  /* execute until the program exits, or the inst limit is reached */
+  exec_insts(0);
 }
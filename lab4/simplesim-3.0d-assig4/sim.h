@@ -88,11 +88,35 @@ extern struct opt_odb_t *sim_odb;
 /* stats database */
 extern struct stat_sdb_t *sim_sdb;
 
+/* counter stat the stats interval is counted in, NULL for no interval stats,
+   and its value at the next interval stats dump */
+extern counter_t *sim_stats_var;
+extern counter_t sim_stats_next;
+
+/* called before any stats are printed, if set, simulators that update
+   stats in the background (e.g., in worker threads) bring them up to date */
+extern void (*sim_stats_hook)(void);
+
+/* dump interval stats, called through SIM_STATS_CHECK() */
+void sim_stats_interval(void);
+
+/* dump interval stats if the interval counter has reached the next dump or
+   a SIGUSR1 was caught, called from the simulator main loop */
+#define SIM_STATS_CHECK()						\
+  do {									\
+    if (sim_dump_stats							\
+	|| (sim_stats_var && *sim_stats_var >= sim_stats_next))		\
+      sim_stats_interval();						\
+  } while (0)
+
 /* EIO interfaces */
 extern char *sim_eio_fname;
 extern char *sim_chkpt_fname;
 extern FILE *sim_eio_fd;
 
+/* cached post-load program image file name, NULL if none */
+extern char *sim_image_fname;
+
 /* redirected program/simulator output file names */
 extern FILE *sim_progfd;
 
@@ -0,0 +1,328 @@
+#!/local/bin/perl
+
+#
+# simpar - checkpoint-based parallel sim-outorder driver
+#
+
+# SimpleScalar(TM) Tool Suite
+# Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+# All Rights Reserved. 
+#
+# THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+# YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+#
+# No portion of this work may be used by any commercial entity, or for any
+# commercial purpose, without the prior, written permission of SimpleScalar,
+# LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+# as described below.
+#
+# 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+# or implied. The user of the program accepts full responsibility for the
+# application of the program and the use of any results.
+#
+# 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+# downloaded, compiled, executed, copied, and modified solely for nonprofit,
+# educational, noncommercial research, and noncommercial scholarship
+# purposes provided that this notice in its entirety accompanies all copies.
+# Copies of the modified software can be delivered to persons who use it
+# solely for nonprofit, educational, noncommercial research, and
+# noncommercial scholarship purposes provided that this notice in its
+# entirety accompanies all copies.
+#
+# 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+# PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+#
+# 4. No nonprofit user may place any restrictions on the use of this software,
+# including as modified by the user, by any other authorized user.
+#
+# 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+# in compiled or executable form as set forth in Section 2, provided that
+# either: (A) it is accompanied by the corresponding machine-readable source
+# code, or (B) it is accompanied by a written offer, with no time limit, to
+# give anyone a machine-readable copy of the corresponding source code in
+# return for reimbursement of the cost of distribution. This written offer
+# must permit verbatim duplication by anyone, or (C) it is distributed by
+# someone who received only the executable form, and is accompanied by a
+# copy of the written offer of source code.
+#
+# 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+# currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+# 2395 Timbercrest Court, Ann Arbor, MI 48105.
+#
+# Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+#
+
+
+#
+# config parms
+#
+$sim_eio = "./sim-eio";
+$sim_outorder = "./sim-outorder";
+
+#
+# parse commands
+#
+$jobs = 2;
+$interval = 10000000;
+$warmup = 0;
+$simpoints = "";
+$weights = "";
+$work_dir = "simpar.d";
+while (@ARGV && $ARGV[0] =~ /^-/)
+  {
+    $opt = shift(@ARGV);
+    last if ($opt eq "--");
+    if ($opt eq "-j") { $jobs = shift(@ARGV); }
+    elsif ($opt eq "-interval") { $interval = shift(@ARGV); }
+    elsif ($opt eq "-warmup") { $warmup = shift(@ARGV); }
+    elsif ($opt eq "-simpoints") { $simpoints = shift(@ARGV); }
+    elsif ($opt eq "-weights") { $weights = shift(@ARGV); }
+    elsif ($opt eq "-dir") { $work_dir = shift(@ARGV); }
+    elsif ($opt eq "-sim") { $sim_outorder = shift(@ARGV); }
+    elsif ($opt eq "-eio") { $sim_eio = shift(@ARGV); }
+    else { @ARGV = (); last; }
+  }
+if (@ARGV < 1 || $jobs < 1 || $interval <= $warmup
+    || ($simpoints eq "") != ($weights eq ""))
+  {
+     print STDERR
+"Usage: simpar [-j <jobs>] [-interval <insts>] [-warmup <insts>]\n".
+"              [-simpoints <file> -weights <file>] [-dir <work_dir>]\n".
+"              [-sim <sim-outorder>] [-eio <sim-eio>]\n".
+"              [--] <sim-outorder options> <EIO file>\n".
+"\n".
+"         Simulates the EIO trace <EIO file> with sim-outorder, split into\n".
+"         intervals of <insts> instructions (default 10000000) that are\n".
+"         simulated concurrently, by up to <jobs> (default 2) processes.\n".
+"         First, sim-eio writes a checkpoint <warmup> insts before the start\n".
+"         of each interval into <work_dir> (default simpar.d), then\n".
+"         sim-outorder simulates each interval from its checkpoint,\n".
+"         warming the caches and predictors over the <warmup> insts.  The\n".
+"         interval statistics are merged into whole program statistics,\n".
+"         which are printed to stdout.\n".
+"\n".
+"         If SimPoint <file>s are specified, only the intervals selected by\n".
+"         SimPoint are simulated, and their statistics are weighted by the\n".
+"         weight of their cluster.  Counters are summed (weighted) and\n".
+"         scaled to the total program inst count; IPC and CPI are computed\n".
+"         from the merged counters, other rates and averages are averaged\n".
+"         over the intervals, weighted by their inst counts.\n".
+"\n".
+"         Example usage:\n".
+"\n".
+"           simpar -j 4 -interval 1000000 -warmup 100000 -- \\\n".
+"             -fetch:ifqsize 8 anagram.eio\n".
+"\n";
+     exit -1;
+  }
+$eio_file = pop(@ARGV);
+@sim_opts = @ARGV;
+
+if (! -d $work_dir)
+  {
+    mkdir($work_dir, 0755)
+	|| die "Cannot create work directory `$work_dir'";
+  }
+
+#
+# read SimPoint intervals and weights
+#
+@intervals = ();
+if ($simpoints ne "")
+  {
+    open(WEIGHTS, $weights)
+	|| die "Cannot open SimPoint weights file `$weights'";
+    while (<WEIGHTS>)
+      {
+	if (/^\s*([0-9.eE+-]+)\s+(\d+)\s*$/)
+	  {
+	    $cluster_weight{$2} = $1;
+	  }
+      }
+    close(WEIGHTS);
+
+    open(SIMPOINTS, $simpoints)
+	|| die "Cannot open SimPoint file `$simpoints'";
+    while (<SIMPOINTS>)
+      {
+	if (/^\s*(\d+)\s+(\d+)\s*$/)
+	  {
+	    defined($cluster_weight{$2})
+		|| die "No weight for SimPoint cluster $2";
+	    @intervals = (@intervals, $1);
+	    $weight{$1} = $cluster_weight{$2};
+	  }
+      }
+    close(SIMPOINTS);
+  }
+
+#
+# write the interval checkpoints, and get the total inst count
+#
+@eio_cmd = ($sim_eio, "-redir:sim", "$work_dir/sim-eio.out",
+	    "-redir:prog", "$work_dir/sim-eio.prog",
+	    "-perdump", "$work_dir/chkpt.%d", $interval,
+	    "-perdump:warmup", $warmup);
+@eio_cmd = (@eio_cmd, "-simpoints", $simpoints) if ($simpoints ne "");
+print STDERR "simpar: writing checkpoints: @eio_cmd $eio_file\n";
+system(@eio_cmd, $eio_file) == 0
+    || die "Checkpoint generation failed: @eio_cmd $eio_file";
+%eio_stats = &read_stats("$work_dir/sim-eio.out");
+$total_insn = $eio_stats{"sim_num_insn"};
+
+if ($simpoints eq "")
+  {
+    # simulate every interval, all weighted alike
+    for ($i=0; $i * $interval < $total_insn; $i++)
+      {
+	@intervals = (@intervals, $i);
+	$weight{$i} = 1;
+      }
+  }
+
+#
+# simulate the intervals, at most $jobs at a time
+#
+$running = 0;
+foreach $i (@intervals)
+  {
+    if ($running == $jobs)
+      {
+	&wait_job;
+      }
+
+    @cmd = ($sim_outorder, "-redir:sim", "$work_dir/interval.$i.out",
+	    "-redir:prog", "$work_dir/interval.$i.prog", "-max:inst", $interval);
+    if ($i > 0)
+      {
+	@cmd = (@cmd, "-chkpt", "$work_dir/chkpt.$i", "-warmup", $warmup);
+      }
+    @cmd = (@cmd, @sim_opts, $eio_file);
+
+    print STDERR "simpar: interval $i: @cmd\n";
+    $pid = fork();
+    defined($pid) || die "Cannot fork interval $i";
+    if ($pid == 0)
+      {
+	exec(@cmd);
+	die "Cannot execute `$sim_outorder'";
+      }
+    $job_interval{$pid} = $i;
+    $running++;
+  }
+while ($running > 0)
+  {
+    &wait_job;
+  }
+
+#
+# merge the interval statistics
+#
+@names = ();
+foreach $i (@intervals)
+  {
+    %stats = &read_stats("$work_dir/interval.$i.out");
+    defined($stats{"sim_num_insn"})
+	|| die "No statistics for interval $i";
+    $w = $weight{$i};
+    $insn = $stats{"sim_num_insn"};
+    $sum_insn += $w * $insn;
+
+    foreach $name (@stat_names)
+      {
+	next if ($name =~ /^(sim_elapsed_time|sim_inst_rate|sim_fwd_insn|ld_.*|mem\..*)$/);
+
+	if (!defined($merged{$name}))
+	  {
+	    @names = (@names, $name);
+	    $merged{$name} = 0;
+	    $desc{$name} = $stat_desc{$name};
+	    $is_float{$name} = 0;
+	  }
+	$is_float{$name} = 1 if ($stats{$name} =~ /\./);
+	$merged{$name} += $w * $stats{$name};
+	$merged_avg{$name} += $w * $insn * $stats{$name};
+      }
+    printf STDERR "simpar: interval %d: weight %g, %d insts, %d cycles\n",
+      $i, $w, $insn, $stats{"sim_cycle"};
+  }
+$sum_insn > 0 || die "No insts simulated";
+$scale = $total_insn / $sum_insn;
+
+print "\nsimpar: ** merged simulation statistics **\n";
+printf "%-22s %15d # %s\n", "simpar.intervals", scalar(@intervals),
+  "number of intervals simulated";
+printf "%-22s %15d # %s\n", "simpar.interval_size", $interval,
+  "interval size in insts";
+foreach $name (@names)
+  {
+    # counters, and formulas of counters, are totals, they are whole
+    # numbers once scaled
+    if (!$is_float{$name} || $desc{$name} =~ /^total number of /)
+      {
+	$val = int($merged{$name} * $scale + 0.5);
+	printf "%-22s %15d # %s\n", $name, $val, $desc{$name};
+	$counter{$name} = $val;
+      }
+    elsif ($name eq "sim_IPC" || $name eq "sim_exec_BW")
+      {
+	$num = ($name eq "sim_IPC") ? "sim_num_insn" : "sim_total_insn";
+	printf "%-22s %15.4f # %s\n", $name,
+	  $counter{$num} / $counter{"sim_cycle"}, $desc{$name};
+      }
+    elsif ($name eq "sim_CPI")
+      {
+	printf "%-22s %15.4f # %s\n", $name,
+	  $counter{"sim_cycle"} / $counter{"sim_num_insn"}, $desc{$name};
+      }
+    else
+      {
+	printf "%-22s %15.4f # %s\n", $name,
+	  $merged_avg{$name} / $sum_insn, $desc{$name};
+      }
+  }
+exit 0;
+
+#
+# wait for a running interval simulation to finish
+#
+sub wait_job
+{
+  local($pid);
+
+  $pid = wait();
+  $pid > 0 || die "Lost interval simulations";
+  $? == 0 || die "Interval $job_interval{$pid} simulation failed";
+  $running--;
+}
+
+#
+# read the scalar statistics from simulator output file $_[0], the names
+# are left in @stat_names (in order) and the descriptions in %stat_desc
+#
+sub read_stats
+{
+  local($fname) = @_;
+  local(%vals, $in_stats);
+
+  open(SIM_OUTPUT, $fname)
+      || die "Cannot open simulator output file `$fname'";
+  @stat_names = ();
+  $in_stats = 0;
+  while (<SIM_OUTPUT>)
+    {
+      if (/^sim: \*\* simulation statistics \*\*/)
+	{
+	  $in_stats = 1;
+	}
+      elsif ($in_stats && /^(\S+)\s+(-?[0-9][0-9.]*)\s+# (.*)$/)
+	{
+	  @stat_names = (@stat_names, $1);
+	  $vals{$1} = $2;
+	  $stat_desc{$1} = $3;
+	}
+    }
+  close(SIM_OUTPUT);
+
+  return %vals;
+}
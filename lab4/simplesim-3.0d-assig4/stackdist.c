@@ -0,0 +1,443 @@
+/* stackdist.c - LRU stack distance module routines */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "stackdist.h"
+
+/* stack distance access macros */
+#define SDIST_SET(sdp, addr)	(((addr) >> (sdp)->set_shift) & (sdp)->set_mask)
+#define SDIST_BADDR(sdp, addr)	((addr) & ~(sdp)->blk_mask)
+
+/* block address hashing macro, used to index the family's hash table */
+#define SDIST_HASH(sdp, key)						\
+  ((((key) >> 24) ^ ((key) >> 16) ^ ((key) >> 8) ^ (key)) & ((sdp)->hsize-1))
+
+/* number of entries in the order-statistic (sub)tree rooted at T */
+#define TREE_SIZE(T)		((T) ? (T)->size : 0)
+
+/* get the next tree priority, a private xorshift generator */
+static unsigned int
+next_prio(struct sdist_t *sdp)		/* stack distance family */
+{
+  unsigned int x = sdp->seed;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  sdp->seed = x;
+  return x;
+}
+
+/* count the entries in tree ROOT referenced after time STAMP, this is the
+   LRU stack distance of the entry last referenced at STAMP */
+static int
+tree_newer(struct sdist_blk_t *root,	/* tree to search */
+	   counter_t stamp)		/* time of reference */
+{
+  int n = 0;
+
+  while (root)
+    {
+      if (root->stamp > stamp)
+	{
+	  /* this entry and all newer entries are above STAMP in the stack */
+	  n += 1 + TREE_SIZE(root->right);
+	  root = root->left;
+	}
+      else if (root->stamp < stamp)
+	root = root->right;
+      else
+	{
+	  n += TREE_SIZE(root->right);
+	  break;
+	}
+    }
+  return n;
+}
+
+/* return the least recently referenced entry in tree ROOT */
+static struct sdist_blk_t *
+tree_oldest(struct sdist_blk_t *root)	/* tree to search */
+{
+  assert(root);
+  while (root->left)
+    root = root->left;
+  return root;
+}
+
+/* insert BLK into tree ROOT, BLK must be newer than all entries in ROOT,
+   returns the new root of the tree */
+static struct sdist_blk_t *
+tree_insert(struct sdist_blk_t *root,	/* tree to update */
+	    struct sdist_blk_t *blk)	/* entry to insert */
+{
+  if (!root || blk->prio > root->prio)
+    {
+      /* BLK roots this subtree, everything in it is older than BLK */
+      blk->left = root;
+      blk->right = NULL;
+      blk->size = 1 + TREE_SIZE(root);
+      return blk;
+    }
+
+  /* newest entries are always inserted down the right spine */
+  root->right = tree_insert(root->right, blk);
+  root->size++;
+  return root;
+}
+
+/* join trees A and B, all entries in A are older than all entries in B,
+   returns the root of the joined tree */
+static struct sdist_blk_t *
+tree_join(struct sdist_blk_t *a,	/* older tree */
+	  struct sdist_blk_t *b)	/* newer tree */
+{
+  if (!a)
+    return b;
+  if (!b)
+    return a;
+
+  if (a->prio > b->prio)
+    {
+      a->right = tree_join(a->right, b);
+      a->size = 1 + TREE_SIZE(a->left) + TREE_SIZE(a->right);
+      return a;
+    }
+  else
+    {
+      b->left = tree_join(a, b->left);
+      b->size = 1 + TREE_SIZE(b->left) + TREE_SIZE(b->right);
+      return b;
+    }
+}
+
+/* remove the entry last referenced at STAMP from tree ROOT, the entry must
+   exist, returns the new root of the tree */
+static struct sdist_blk_t *
+tree_remove(struct sdist_blk_t *root,	/* tree to update */
+	    counter_t stamp)		/* key of the entry to remove */
+{
+  assert(root);
+  if (root->stamp == stamp)
+    return tree_join(root->left, root->right);
+
+  if (stamp < root->stamp)
+    root->left = tree_remove(root->left, stamp);
+  else
+    root->right = tree_remove(root->right, stamp);
+  root->size--;
+  return root;
+}
+
+/* unlink BLK from the family's hash table bucket chain */
+static void
+unlink_htab_ent(struct sdist_t *sdp,		/* family to update */
+		struct sdist_blk_t *blk)	/* block to unlink */
+{
+  struct sdist_blk_t *prev, *ent;
+  int index = SDIST_HASH(sdp, blk->baddr);
+
+  /* locate the block in the hash table bucket chain */
+  for (prev=NULL,ent=sdp->hash[index];
+       ent;
+       prev=ent,ent=ent->hash_next)
+    {
+      if (ent == blk)
+	break;
+    }
+  assert(ent);
+
+  /* unlink the block from the hash table bucket chain */
+  if (!prev)
+    sdp->hash[index] = ent->hash_next;
+  else
+    prev->hash_next = ent->hash_next;
+  ent->hash_next = NULL;
+}
+
+/* create and initialize an LRU stack distance family */
+struct sdist_t *			/* pointer to family created */
+sdist_create(char *name,		/* name of the family */
+	     int nsets,			/* total number of sets */
+	     int bsize,			/* block (line) size */
+	     int max_assoc)		/* largest associativity to track */
+{
+  struct sdist_t *sdp;
+  struct sdist_blk_t *blks;
+  int i;
+
+  /* check all family parameters, same rules as the cache module */
+  if (nsets <= 0)
+    fatal("cache size (in sets) `%d' must be non-zero", nsets);
+  if ((nsets & (nsets-1)) != 0)
+    fatal("cache size (in sets) `%d' is not a power of two", nsets);
+  if (bsize < 8)
+    fatal("cache block size (in bytes) `%d' must be 8 or greater", bsize);
+  if ((bsize & (bsize-1)) != 0)
+    fatal("cache block size (in bytes) `%d' must be a power of two", bsize);
+  if (max_assoc <= 0)
+    fatal("cache associativity `%d' must be non-zero and positive", max_assoc);
+  if ((max_assoc & (max_assoc-1)) != 0)
+    fatal("cache associativity `%d' must be a power of two", max_assoc);
+
+  /* allocate the family structure */
+  sdp = (struct sdist_t *)
+    calloc(1, sizeof(struct sdist_t) + (nsets-1)*sizeof(struct sdist_set_t));
+  if (!sdp)
+    fatal("out of virtual memory");
+
+  /* initialize user parameters */
+  sdp->name = mystrdup(name);
+  sdp->nsets = nsets;
+  sdp->bsize = bsize;
+  sdp->max_assoc = max_assoc;
+
+  /* compute derived parameters */
+  sdp->blk_mask = bsize-1;
+  sdp->set_shift = log_base2(bsize);
+  sdp->set_mask = nsets-1;
+  sdp->nconfigs = log_base2(max_assoc) + 1;
+
+  /* the hash table holds at most NSETS*MAX_ASSOC blocks, size it for an
+     average chain length of at most one */
+  for (sdp->hsize = 1; sdp->hsize < nsets * max_assoc; sdp->hsize <<= 1)
+    /* nada */;
+  sdp->hash = (struct sdist_blk_t **)
+    calloc(sdp->hsize, sizeof(struct sdist_blk_t *));
+  if (!sdp->hash)
+    fatal("out of virtual memory");
+
+  sdp->clock = 0;
+  sdp->seed = 0x2545f491;
+
+  /* initialize family stats */
+  sdp->accesses = 0;
+  sdp->hits = (counter_t *)calloc(sdp->nconfigs, sizeof(counter_t));
+  sdp->misses = (counter_t *)calloc(sdp->nconfigs, sizeof(counter_t));
+  if (!sdp->hits || !sdp->misses)
+    fatal("out of virtual memory");
+  sdp->dist = NULL;
+
+  /* allocate the LRU stack entries, and slice them up between the sets */
+  blks = (struct sdist_blk_t *)
+    calloc(nsets * max_assoc, sizeof(struct sdist_blk_t));
+  if (!blks)
+    fatal("out of virtual memory");
+  for (i=0; i<nsets; i++)
+    {
+      sdp->sets[i].root = NULL;
+      sdp->sets[i].blks = &blks[i * max_assoc];
+      sdp->sets[i].nblks = 0;
+    }
+
+  return sdp;
+}
+
+/* print stack distance family configuration */
+void
+sdist_config(struct sdist_t *sdp,	/* stack distance family */
+	     FILE *stream)		/* output stream */
+{
+  fprintf(stream,
+	  "sdist: %s: %d sets, %d byte blocks, LRU, 1- to %d-way "
+	  "(%d to %d bytes)\n",
+	  sdp->name, sdp->nsets, sdp->bsize, sdp->max_assoc,
+	  sdp->nsets * sdp->bsize, sdp->nsets * sdp->bsize * sdp->max_assoc);
+}
+
+/* check that stat NAME of stack distance family SDP is not yet registered,
+   e.g., by a cache of the same name */
+static void
+sdist_check_name(struct sdist_t *sdp,	/* stack distance family */
+		 struct stat_sdb_t *sdb,/* stats database */
+		 char *name)		/* stat name */
+{
+  if (stat_find_stat(sdb, name))
+    fatal("stack distance family `%s' stat `%s' is already defined, "
+	  "choose another family name", sdp->name, name);
+}
+
+/* register stack distance family stats */
+void
+sdist_reg_stats(struct sdist_t *sdp,	/* stack distance family */
+		struct stat_sdb_t *sdb)	/* stats database */
+{
+  char buf[512], buf1[1024], cname[256], **imap;
+  int i;
+
+  snprintf(buf, sizeof(buf), "%s.accesses", sdp->name);
+  sdist_check_name(sdp, sdb, buf);
+  stat_reg_counter(sdb, buf, "total number of references",
+		   &sdp->accesses, 0, NULL);
+
+  /* stack distance buckets, bucket I holds the references that first hit in
+     the 1 << I way cache, the last bucket holds the references that miss in
+     every cache of the family */
+  imap = (char **)calloc(sdp->nconfigs + 1, sizeof(char *));
+  if (!imap)
+    fatal("out of virtual memory");
+  for (i=0; i<sdp->nconfigs; i++)
+    {
+      if (i < 2)
+	sprintf(buf, "%d", i);
+      else
+	sprintf(buf, "%d-%d", 1 << (i-1), (1 << i) - 1);
+      imap[i] = mystrdup(buf);
+    }
+  imap[sdp->nconfigs] = "miss";
+
+  snprintf(buf, sizeof(buf), "%s.stack_dist", sdp->name);
+  sdist_check_name(sdp, sdb, buf);
+  sdp->dist = stat_reg_dist(sdb, buf, "LRU stack distance distribution",
+			    /* init */0, /* arr sz */sdp->nconfigs + 1,
+			    /* bucket sz */1, /* print */PF_ALL,
+			    /* format */NULL, /* index map */imap,
+			    /* print fn */NULL);
+
+  /* register one cache's worth of stats for each associativity, these
+     follow the naming used by cache_reg_stats() */
+  for (i=0; i<sdp->nconfigs; i++)
+    {
+      snprintf(cname, sizeof(cname), "%s_%dway", sdp->name, 1 << i);
+
+      snprintf(buf, sizeof(buf), "%s.accesses", cname);
+      sdist_check_name(sdp, sdb, buf);
+      snprintf(buf1, sizeof(buf1), "%s.hits + %s.misses", cname, cname);
+      stat_reg_formula(sdb, buf, "total number of accesses", buf1, "%12.0f");
+      snprintf(buf, sizeof(buf), "%s.hits", cname);
+      sdist_check_name(sdp, sdb, buf);
+      stat_reg_counter(sdb, buf, "total number of hits",
+		       &sdp->hits[i], 0, NULL);
+      snprintf(buf, sizeof(buf), "%s.misses", cname);
+      sdist_check_name(sdp, sdb, buf);
+      stat_reg_counter(sdb, buf, "total number of misses",
+		       &sdp->misses[i], 0, NULL);
+      snprintf(buf, sizeof(buf), "%s.miss_rate", cname);
+      sdist_check_name(sdp, sdb, buf);
+      snprintf(buf1, sizeof(buf1), "%s.misses / %s.accesses", cname, cname);
+      stat_reg_formula(sdb, buf, "miss rate (i.e., misses/ref)", buf1, NULL);
+    }
+}
+
+/* record a reference to address ADDR, returns the LRU stack distance of the
+   reference, or MAX_ASSOC if the block is not held in the LRU stack */
+int					/* LRU stack distance */
+sdist_access(struct sdist_t *sdp,	/* stack distance family */
+	     md_addr_t addr)		/* address of access */
+{
+  md_addr_t baddr = SDIST_BADDR(sdp, addr);
+  struct sdist_set_t *set = &sdp->sets[SDIST_SET(sdp, addr)];
+  int hindex = SDIST_HASH(sdp, baddr);
+  struct sdist_blk_t *blk;
+  int i, dist;
+
+  sdp->accesses++;
+  sdp->clock++;
+
+  /* locate the block in the LRU stack */
+  for (blk=sdp->hash[hindex]; blk; blk=blk->hash_next)
+    {
+      if (blk->baddr == baddr)
+	break;
+    }
+
+  if (blk)
+    {
+      /* found, its depth in the stack is the stack distance, pull it out of
+	 the stack, it is pushed back on top below */
+      dist = tree_newer(set->root, blk->stamp);
+      set->root = tree_remove(set->root, blk->stamp);
+    }
+  else
+    {
+      /* not in the stack, this reference misses in every cache */
+      dist = sdp->max_assoc;
+
+      if (set->nblks < sdp->max_assoc)
+	{
+	  /* stack not yet full, grab a free entry */
+	  blk = &set->blks[set->nblks++];
+	}
+      else
+	{
+	  /* stack is full, the bottom (LRU) entry falls off */
+	  blk = tree_oldest(set->root);
+	  set->root = tree_remove(set->root, blk->stamp);
+	  unlink_htab_ent(sdp, blk);
+	}
+
+      blk->baddr = baddr;
+      blk->prio = next_prio(sdp);
+      blk->hash_next = sdp->hash[hindex];
+      sdp->hash[hindex] = blk;
+    }
+
+  /* push the block on top of the stack */
+  blk->stamp = sdp->clock;
+  set->root = tree_insert(set->root, blk);
+
+  /* a reference at distance DIST hits in every cache with more than DIST
+     ways, and misses in all others */
+  for (i=sdp->nconfigs-1; i >= 0 && (1 << i) > dist; i--)
+    sdp->hits[i]++;
+  if (sdp->dist)
+    stat_add_sample(sdp->dist, i+1);
+  for (; i >= 0; i--)
+    sdp->misses[i]++;
+
+  return dist;
+}
@@ -0,0 +1,167 @@
+/* stackdist.h - LRU stack distance module interfaces */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#ifndef STACKDIST_H
+#define STACKDIST_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "machine.h"
+#include "stats.h"
+
+/*
+ * This module implements single-pass simulation of a whole family of LRU
+ * caches using Mattson's stack algorithm.  A family is the set of all LRU
+ * caches that share the same number of sets and the same block size, these
+ * caches differ only in their associativity (and thus their size).  For every
+ * reference the module computes the LRU stack distance of the referenced
+ * block within its set, i.e., the number of distinct blocks in the set that
+ * were referenced since the last reference to this block.  A reference with
+ * stack distance D hits in every cache of the family with more than D ways,
+ * so one pass over the reference stream yields the hit and miss counts of
+ * every associativity from 1 up to the family's maximum associativity.
+ *
+ * Each set keeps its LRU stack in an order-statistic tree (a treap keyed by
+ * the time of last reference, augmented with subtree sizes), so the stack
+ * distance of a reference is found in O(log assoc) time.  Blocks that fall
+ * off the bottom of the stack (i.e., beyond the maximum associativity) are
+ * discarded, they would miss in every cache of the family anyway, this keeps
+ * the storage bounded by the size of the largest cache in the family.
+ *
+ * Hit and miss counts are reported for every power-of-two associativity up to
+ * the maximum, using the same statistics names as the cache module, e.g., a
+ * family named "dl1" reports "dl1_4way.misses", "dl1_4way.miss_rate", etc...
+ */
+
+/* LRU stack entry, one for each block held in a set's LRU stack */
+struct sdist_blk_t
+{
+  struct sdist_blk_t *left;	/* order-statistic tree, older references */
+  struct sdist_blk_t *right;	/* order-statistic tree, newer references */
+  struct sdist_blk_t *hash_next;/* next block in the hash bucket chain */
+  md_addr_t baddr;		/* block address */
+  counter_t stamp;		/* time of last reference, the tree key */
+  unsigned int prio;		/* random tree priority, max-heap ordered */
+  unsigned int size;		/* number of entries in this subtree */
+};
+
+/* LRU stack set definition */
+struct sdist_set_t
+{
+  struct sdist_blk_t *root;	/* root of the set's order-statistic tree */
+  struct sdist_blk_t *blks;	/* stack entries, allocated sequentially */
+  int nblks;			/* number of stack entries in use */
+};
+
+/* LRU stack distance family definition */
+struct sdist_t
+{
+  /* parameters */
+  char *name;			/* family name */
+  int nsets;			/* number of sets */
+  int bsize;			/* block size in bytes */
+  int max_assoc;		/* maximum associativity tracked */
+
+  /* derived data, for fast decoding */
+  md_addr_t blk_mask;
+  int set_shift;
+  md_addr_t set_mask;		/* use *after* shift */
+  int nconfigs;			/* number of associativities reported, i.e.,
+				   log2(MAX_ASSOC) + 1 */
+
+  /* block address -> stack entry hash table */
+  int hsize;			/* hash table size, a power of two */
+  struct sdist_blk_t **hash;	/* hash table buckets */
+
+  /* logical time, advances on each reference */
+  counter_t clock;
+
+  /* tree priority generator state, private to keep the simulator's random
+     number stream (used for random cache replacement) undisturbed */
+  unsigned int seed;
+
+  /* per-family stats */
+  counter_t accesses;		/* total number of references */
+  counter_t *hits;		/* hits for associativity 1 << i */
+  counter_t *misses;		/* misses for associativity 1 << i */
+  struct stat_stat_t *dist;	/* stack distance distribution */
+
+  /* NOTE: this is a variable-size tail array, this must be the LAST field
+     defined in this structure! */
+  struct sdist_set_t sets[1];	/* each entry is a set */
+};
+
+/* create and initialize an LRU stack distance family */
+struct sdist_t *			/* pointer to family created */
+sdist_create(char *name,		/* name of the family */
+	     int nsets,			/* total number of sets */
+	     int bsize,			/* block (line) size */
+	     int max_assoc);		/* largest associativity to track */
+
+/* print stack distance family configuration */
+void
+sdist_config(struct sdist_t *sdp,	/* stack distance family */
+	     FILE *stream);		/* output stream */
+
+/* register stack distance family stats */
+void
+sdist_reg_stats(struct sdist_t *sdp,	/* stack distance family */
+		struct stat_sdb_t *sdb);/* stats database */
+
+/* record a reference to address ADDR, returns the LRU stack distance of the
+   reference, or MAX_ASSOC if the block is not held in the LRU stack */
+int					/* LRU stack distance */
+sdist_access(struct sdist_t *sdp,	/* stack distance family */
+	     md_addr_t addr);		/* address of access */
+
+#endif /* STACKDIST_H */
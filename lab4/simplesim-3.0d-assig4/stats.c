@@ -51,6 +51,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
 #include <math.h>
 
@@ -60,6 +61,52 @@
 #include "eval.h"
 #include "stats.h"
 
+/* hash stat name NAME into the stat name hash table */
+static unsigned int
+stat_hash(char *name)			/* stat name */
+{
+  unsigned int hash = 0;
+
+  while (*name)
+    hash = hash * 33 + (unsigned char)*name++;
+  return hash & (STAT_HTAB_SZ - 1);
+}
+
+/* does stat variable STAT hold a single counter or value, i.e., is it
+   printed as its change since the last snapshot in delta mode? */
+#define STAT_IS_SCALAR(STAT)						\
+  ((STAT)->sc != sc_dist && (STAT)->sc != sc_sdist			\
+   && (STAT)->sc != sc_formula && (STAT)->sc != sc_mean)
+
+/* return the current value of scalar stat variable STAT */
+static double
+stat_scalar(struct stat_stat_t *stat)	/* stat variable */
+{
+  switch (stat->sc)
+    {
+    case sc_int:
+      return (double)*stat->variant.for_int.var;
+    case sc_uint:
+      return (double)*stat->variant.for_uint.var;
+#ifdef HOST_HAS_QWORD
+    case sc_qword:
+#ifdef _MSC_VER /* FIXME: MSC does not implement qword_t to dbl conversion */
+      return (double)(sqword_t)*stat->variant.for_qword.var;
+#else /* !_MSC_VER */
+      return (double)*stat->variant.for_qword.var;
+#endif /* _MSC_VER */
+    case sc_sqword:
+      return (double)*stat->variant.for_sqword.var;
+#endif /* HOST_HAS_QWORD */
+    case sc_float:
+      return (double)*stat->variant.for_float.var;
+    case sc_double:
+      return *stat->variant.for_double.var;
+    default:
+      panic("stat variable is not a scalar");
+    }
+}
+
 /* evaluate a stat as an expression */
 struct eval_value_t
 stat_eval_ident(struct eval_state_t *es)/* an expression evaluator */
@@ -70,14 +117,7 @@ stat_eval_ident(struct eval_state_t *es)/* an expression evaluator */
   struct eval_value_t val;
 
   /* locate the stat variable */
-  for (stat = sdb->stats; stat != NULL; stat = stat->next)
-    {
-      if (!strcmp(stat->name, es->tok_buf))
-	{
-	  /* found it! */
-	  break;
-	}
-    }
+  stat = stat_find_stat(sdb, es->tok_buf);
   if (!stat)
     {
       /* could not find stat variable */
@@ -86,6 +126,14 @@ stat_eval_ident(struct eval_state_t *es)/* an expression evaluator */
     }
   /* else, return the value of stat */
 
+  /* in delta mode, scalars evaluate to their change since the snapshot */
+  if (sdb->delta && STAT_IS_SCALAR(stat))
+    {
+      val.type = et_double;
+      val.value.as_double = stat_scalar(stat) - stat->snap;
+      return val;
+    }
+
   /* convert the stat variable value to a typed expression value */
   switch (stat->sc)
     {
@@ -125,6 +173,10 @@ stat_eval_ident(struct eval_state_t *es)/* an expression evaluator */
     case sc_sdist:
       fatal("stat distributions not allowed in formula expressions");
       break;
+    case sc_mean:
+      val.type = et_double;
+      val.value.as_double = stat->variant.for_mean.mean;
+      break;
     case sc_formula:
       {
 	/* instantiate a new evaluator to avoid recursion problems */
@@ -159,6 +211,12 @@ stat_new(void)
     fatal("out of virtual memory");
 
   sdb->stats = NULL;
+  sdb->stats_tail = NULL;
+  sdb->htab =
+    (struct stat_stat_t **)calloc(STAT_HTAB_SZ, sizeof(struct stat_stat_t *));
+  if (!sdb->htab)
+    fatal("out of virtual memory");
+  sdb->delta = FALSE;
   sdb->evaluator = eval_new(stat_eval_ident, sdb);
 
   return sdb;
@@ -190,6 +248,7 @@ stat_delete(struct stat_sdb_t *sdb)	/* stats database */
 	case sc_float:
 	case sc_double:
 	case sc_formula:
+	case sc_mean:
 	  /* no other storage to deallocate */
 	  break;
 	case sc_dist:
@@ -219,9 +278,14 @@ stat_delete(struct stat_sdb_t *sdb)	/* stats database */
 	  panic("bogus stat class");
 	}
       /* free stat variable record */
+      if (stat->snap_arr)
+	free(stat->snap_arr);
       free(stat);
     }
   sdb->stats = NULL;
+  sdb->stats_tail = NULL;
+  free(sdb->htab);
+  sdb->htab = NULL;
   eval_delete(sdb->evaluator);
   sdb->evaluator = NULL;
   free(sdb);
@@ -232,18 +296,27 @@ static void
 add_stat(struct stat_sdb_t *sdb,	/* stat database */
 	 struct stat_stat_t *stat)	/* stat variable */
 {
-  struct stat_stat_t *elt, *prev;
-
-  /* append at end of stat database list */
-  for (prev=NULL, elt=sdb->stats; elt != NULL; prev=elt, elt=elt->next)
-    /* nada */;
+  int hindex;
 
   /* append stat to stats chain */
-  if (prev != NULL)
-    prev->next = stat;
-  else /* prev == NULL */
+  if (sdb->stats_tail != NULL)
+    sdb->stats_tail->next = stat;
+  else /* sdb->stats_tail == NULL */
     sdb->stats = stat;
+  sdb->stats_tail = stat;
   stat->next = NULL;
+
+  /* index the stat by name, the first stat registered with a name is the
+     one found by name */
+  stat->hash_next = NULL;
+  stat->snap = 0.0;
+  stat->snap_arr = NULL;
+  if (!stat_find_stat(sdb, stat->name))
+    {
+      hindex = stat_hash(stat->name);
+      stat->hash_next = sdb->htab[hindex];
+      sdb->htab[hindex] = stat;
+    }
 }
 
 /* register an integer statistical variable */
@@ -627,6 +700,57 @@ stat_reg_formula(struct stat_sdb_t *sdb,/* stat database */
   return stat;
 }
 
+/* register a sampled mean statistic, values are added individually with
+   stat_add_value() and the mean of all values added is printed along with
+   the number of samples, their standard deviation and the confidence interval
+   of the mean at Z standard deviations (e.g., 1.96 for 95% or 3.0 for 99.7%
+   confidence), the mean is used when the stat is referenced in a formula */
+struct stat_stat_t *
+stat_reg_mean(struct stat_sdb_t *sdb,	/* stat database */
+	      char *name,		/* stat variable name */
+	      char *desc,		/* stat variable description */
+	      double z,			/* confidence interval width in std devs */
+	      char *format)		/* optional variable output format */
+{
+  struct stat_stat_t *stat;
+
+  stat = (struct stat_stat_t *)calloc(1, sizeof(struct stat_stat_t));
+  if (!stat)
+    fatal("out of virtual memory");
+
+  stat->name = mystrdup(name);
+  stat->desc = mystrdup(desc);
+  stat->format = format ? format : "%12.4f";
+  stat->sc = sc_mean;
+  stat->variant.for_mean.z = z;
+  stat->variant.for_mean.nsamples = 0;
+  stat->variant.for_mean.mean = 0.0;
+  stat->variant.for_mean.m2 = 0.0;
+
+  /* link onto SDB chain */
+  add_stat(sdb, stat);
+
+  return stat;
+}
+
+/* add a single value to sampled mean statistic STAT */
+void
+stat_add_value(struct stat_stat_t *stat,/* stat variable */
+	       double value)		/* sampled value */
+{
+  double delta;
+
+  if (stat->sc != sc_mean)
+    panic("stat variable is not a sampled mean");
+
+  /* update the running mean and squared differences incrementally, this
+     stays accurate over very many samples */
+  stat->variant.for_mean.nsamples++;
+  delta = value - stat->variant.for_mean.mean;
+  stat->variant.for_mean.mean += delta / stat->variant.for_mean.nsamples;
+  stat->variant.for_mean.m2 += delta * (value - stat->variant.for_mean.mean);
+}
+
 
 /* compare two indicies in a sparse array hash table, used by qsort() */
 static int
@@ -646,6 +770,7 @@ compare_fn(void *p1, void *p2)
 /* print an array distribution */
 static void
 print_dist(struct stat_stat_t *stat,	/* stat variable */
+	   unsigned int *arr,		/* bucket counts to print */
 	   FILE *fd)			/* output stream */
 {
   unsigned int i, bcount, imax, imin;
@@ -658,10 +783,10 @@ print_dist(struct stat_stat_t *stat,	/* stat variable */
   for (i=0; i<stat->variant.for_dist.arr_sz; i++)
     {
       bcount++;
-      btotal += stat->variant.for_dist.arr[i];
+      btotal += arr[i];
       /* on-line variance computation, tres cool, no!?! */
-      bsqsum += ((double)stat->variant.for_dist.arr[i] *
-		 (double)stat->variant.for_dist.arr[i]);
+      bsqsum += ((double)arr[i] *
+		 (double)arr[i]);
       bavg = btotal / MAX((double)bcount, 1.0);
       bvar = (bsqsum - ((double)bcount * bavg * bavg)) / 
 	(double)(((bcount - 1) > 0) ? (bcount - 1) : 1);
@@ -710,12 +835,12 @@ print_dist(struct stat_stat_t *stat,	/* stat variable */
       bsum = 0.0;
       for (i=0; i<bcount; i++)
 	{
-	  bsum += (double)stat->variant.for_dist.arr[i];
+	  bsum += (double)arr[i];
 	  if (stat->variant.for_dist.print_fn)
 	    {
 	      stat->variant.for_dist.print_fn(stat,
 					      i,
-					      stat->variant.for_dist.arr[i],
+					      arr[i],
 					      bsum,
 					      btotal);
 	    }
@@ -729,10 +854,10 @@ print_dist(struct stat_stat_t *stat,	/* stat variable */
 		    fprintf(fd, "%16u ",
 			    i * stat->variant.for_dist.bucket_sz);
 		  if (pf & PF_COUNT)
-		    fprintf(fd, "%10u ", stat->variant.for_dist.arr[i]);
+		    fprintf(fd, "%10u ", arr[i]);
 		  if (pf & PF_PDF)
 		    fprintf(fd, "%6.2f ",
-			    (double)stat->variant.for_dist.arr[i] /
+			    (double)arr[i] /
 			    MAX(btotal, 1.0) * 100.0);
 		  if (pf & PF_CDF)
 		    fprintf(fd, "%6.2f ", bsum/MAX(btotal, 1.0) * 100.0);
@@ -744,15 +869,15 @@ print_dist(struct stat_stat_t *stat,	/* stat variable */
 		      if (stat->variant.for_dist.imap)
 		        fprintf(fd, stat->format,
 			        stat->variant.for_dist.imap[i],
-			        stat->variant.for_dist.arr[i],
-			        (double)stat->variant.for_dist.arr[i] /
+			        arr[i],
+			        (double)arr[i] /
 			        MAX(btotal, 1.0) * 100.0,
 			        bsum/MAX(btotal, 1.0) * 100.0);
 		      else
 		        fprintf(fd, stat->format,
 			        i * stat->variant.for_dist.bucket_sz,
-			        stat->variant.for_dist.arr[i],
-			        (double)stat->variant.for_dist.arr[i] /
+			        arr[i],
+			        (double)arr[i] /
 			        MAX(btotal, 1.0) * 100.0,
 			        bsum/MAX(btotal, 1.0) * 100.0);
 		    }
@@ -914,6 +1039,55 @@ print_sdist(struct stat_stat_t *stat,	/* stat variable */
   fprintf(fd, "%s.end_dist\n", stat->name);
 }
 
+/* compute the sample standard deviation *STDDEV and the confidence interval
+   of the mean *CI of sampled mean statistic STAT */
+static void
+mean_stats(struct stat_stat_t *stat,	/* stat variable */
+	   double *stddev,		/* standard deviation of the samples */
+	   double *ci)			/* confidence interval of the mean */
+{
+  unsigned int n = stat->variant.for_mean.nsamples;
+
+  *stddev = (n > 1) ? sqrt(stat->variant.for_mean.m2 / (n - 1)) : 0.0;
+  *ci = (n > 0) ? stat->variant.for_mean.z * *stddev / sqrt((double)n) : 0.0;
+}
+
+/* print a sampled mean statistic */
+static void
+print_mean(struct stat_stat_t *stat,	/* stat variable */
+	   FILE *fd)			/* output stream */
+{
+  char name[512];
+  unsigned int n = stat->variant.for_mean.nsamples;
+  double mean = stat->variant.for_mean.mean, stddev, ci;
+
+  /* sample standard deviation and confidence interval of the mean */
+  mean_stats(stat, &stddev, &ci);
+
+  fprintf(fd, "%-22s ", stat->name);
+  myfprintf(fd, stat->format, mean);
+  fprintf(fd, " # %s\n", stat->desc);
+
+  sprintf(name, "%s.samples", stat->name);
+  fprintf(fd, "%-22s %12u # number of samples\n", name, n);
+
+  sprintf(name, "%s.stddev", stat->name);
+  fprintf(fd, "%-22s ", name);
+  myfprintf(fd, stat->format, stddev);
+  fprintf(fd, " # standard deviation of the samples\n");
+
+  sprintf(name, "%s.ci", stat->name);
+  fprintf(fd, "%-22s ", name);
+  myfprintf(fd, stat->format, ci);
+  fprintf(fd, " # confidence interval of the mean (+/-, %.2f std devs)\n",
+	  stat->variant.for_mean.z);
+
+  sprintf(name, "%s.rel_ci", stat->name);
+  fprintf(fd, "%-22s ", name);
+  myfprintf(fd, stat->format, (mean != 0.0) ? ci / mean : 0.0);
+  fprintf(fd, " # relative confidence interval (i.e., ci/mean)");
+}
+
 /* print the value of stat variable STAT */
 void
 stat_print_stat(struct stat_sdb_t *sdb,	/* stat database */
@@ -922,6 +1096,19 @@ stat_print_stat(struct stat_sdb_t *sdb,	/* stat database */
 {
   struct eval_value_t val;
 
+  /* in delta mode, scalars are printed as their change since the snapshot,
+     the stat's own format may not suit the change */
+  if (sdb->delta && STAT_IS_SCALAR(stat))
+    {
+      fprintf(fd, "%-22s ", stat->name);
+      if (stat->sc == sc_float || stat->sc == sc_double)
+	fprintf(fd, "%12.4f", stat_scalar(stat) - stat->snap);
+      else
+	fprintf(fd, "%12.0f", stat_scalar(stat) - stat->snap);
+      fprintf(fd, " # %s\n", stat->desc);
+      return;
+    }
+
   switch (stat->sc)
     {
     case sc_int:
@@ -965,7 +1152,21 @@ stat_print_stat(struct stat_sdb_t *sdb,	/* stat database */
       fprintf(fd, " # %s", stat->desc);
       break;
     case sc_dist:
-      print_dist(stat, fd);
+      if (sdb->delta && stat->snap_arr)
+	{
+	  unsigned int i, *arr;
+
+	  arr = (unsigned int *)
+	    calloc(stat->variant.for_dist.arr_sz, sizeof(unsigned int));
+	  if (!arr)
+	    fatal("out of virtual memory");
+	  for (i=0; i < stat->variant.for_dist.arr_sz; i++)
+	    arr[i] = stat->variant.for_dist.arr[i] - stat->snap_arr[i];
+	  print_dist(stat, arr, fd);
+	  free(arr);
+	}
+      else
+	print_dist(stat, stat->variant.for_dist.arr, fd);
       break;
     case sc_sdist:
       print_sdist(stat, fd);
@@ -988,6 +1189,9 @@ stat_print_stat(struct stat_sdb_t *sdb,	/* stat database */
 	eval_delete(es);
       }
       break;
+    case sc_mean:
+      print_mean(stat, fd);
+      break;
     default:
       panic("bogus stat class");
     }
@@ -1011,6 +1215,311 @@ stat_print_stats(struct stat_sdb_t *sdb,/* stat database */
     stat_print_stat(sdb, stat, fd);
 }
 
+/* evaluate formula stat STAT into *VAL, returns non-zero on success */
+static int
+eval_formula(struct stat_sdb_t *sdb,	/* stat database */
+	     struct stat_stat_t *stat,	/* formula stat variable */
+	     double *val)		/* formula value */
+{
+  /* instantiate a new evaluator to avoid recursion problems */
+  struct eval_state_t *es = eval_new(stat_eval_ident, sdb);
+  struct eval_value_t res;
+  char *endp;
+  int ok;
+
+  res = eval_expr(es, stat->variant.for_formula.formula, &endp);
+  ok = (eval_error == ERR_NOERR && *endp == '\0');
+  if (ok)
+    *val = eval_as_double(res);
+
+  /* done with the evaluator */
+  eval_delete(es);
+
+  return ok;
+}
+
+/* return the bucket count I of array distribution STAT, in delta mode the
+   change since the snapshot */
+static unsigned int
+dist_count(struct stat_sdb_t *sdb,	/* stat database */
+	   struct stat_stat_t *stat,	/* array distribution */
+	   unsigned int i)		/* bucket index */
+{
+  if (sdb->delta && stat->snap_arr)
+    return stat->variant.for_dist.arr[i] - stat->snap_arr[i];
+  return stat->variant.for_dist.arr[i];
+}
+
+/* print string STR as a JSON string */
+static void
+json_string(FILE *fd,			/* output stream */
+	    char *str)			/* string to print */
+{
+  fputc('"', fd);
+  for (; *str; str++)
+    {
+      if (*str == '"' || *str == '\\')
+	fprintf(fd, "\\%c", *str);
+      else if ((unsigned char)*str < 0x20)
+	fprintf(fd, "\\u%04x", (unsigned char)*str);
+      else
+	fputc(*str, fd);
+    }
+  fputc('"', fd);
+}
+
+/* print VAL as a JSON number, non-finite values are printed as null */
+static void
+json_number(FILE *fd,			/* output stream */
+	    double val)			/* value to print */
+{
+  if (val != val || val - val != 0.0)
+    fprintf(fd, "null");
+  else if (val == floor(val) && fabs(val) < 1e15)
+    fprintf(fd, "%.0f", val);
+  else
+    fprintf(fd, "%.10g", val);
+}
+
+/* print the value of all stat variables in stat database SDB as a single
+   JSON object, without a trailing newline, distributions and sampled means
+   are printed as nested objects, formulas that cannot be evaluated as null */
+void
+stat_print_json(struct stat_sdb_t *sdb,	/* stat database */
+		FILE *fd)		/* output stream */
+{
+  struct stat_stat_t *stat;
+  struct bucket_t *bucket;
+  double val, stddev, ci, total;
+  unsigned int i;
+  int first;
+
+  fprintf(fd, "{");
+  for (stat=sdb ? sdb->stats : NULL; stat != NULL; stat=stat->next)
+    {
+      json_string(fd, stat->name);
+      fprintf(fd, ":");
+
+      switch (stat->sc)
+	{
+	case sc_dist:
+	  total = 0.0;
+	  for (i=0; i < stat->variant.for_dist.arr_sz; i++)
+	    total += dist_count(sdb, stat, i);
+	  fprintf(fd, "{\"bucket_size\":%u,\"total\":%.0f,\"overflows\":%u,"
+		  "\"buckets\":[",
+		  stat->variant.for_dist.bucket_sz, total,
+		  stat->variant.for_dist.overflows);
+	  for (i=0; i < stat->variant.for_dist.arr_sz; i++)
+	    fprintf(fd, "%s%u", i ? "," : "", dist_count(sdb, stat, i));
+	  fprintf(fd, "]}");
+	  break;
+	case sc_sdist:
+	  total = 0.0;
+	  fprintf(fd, "{\"buckets\":{");
+	  for (first=TRUE, i=0; i < HTAB_SZ; i++)
+	    {
+	      for (bucket = stat->variant.for_sdist.sarr[i];
+		   bucket != NULL;
+		   bucket = bucket->next)
+		{
+		  myfprintf(fd, "%s\"0x%p\":%u",
+			    first ? "" : ",", bucket->index, bucket->count);
+		  total += bucket->count;
+		  first = FALSE;
+		}
+	    }
+	  fprintf(fd, "},\"total\":%.0f}", total);
+	  break;
+	case sc_mean:
+	  mean_stats(stat, &stddev, &ci);
+	  fprintf(fd, "{\"mean\":");
+	  json_number(fd, stat->variant.for_mean.mean);
+	  fprintf(fd, ",\"samples\":%u,\"stddev\":",
+		  stat->variant.for_mean.nsamples);
+	  json_number(fd, stddev);
+	  fprintf(fd, ",\"ci\":");
+	  json_number(fd, ci);
+	  fprintf(fd, "}");
+	  break;
+	case sc_formula:
+	  if (eval_formula(sdb, stat, &val))
+	    json_number(fd, val);
+	  else
+	    fprintf(fd, "null");
+	  break;
+	default:
+	  val = stat_scalar(stat);
+	  if (sdb->delta)
+	    val -= stat->snap;
+	  json_number(fd, val);
+	  break;
+	}
+
+      if (stat->next)
+	fprintf(fd, ",");
+    }
+  fprintf(fd, "}");
+}
+
+/* print the leading columns of a CSV row of stat NAME */
+static void
+csv_name(FILE *fd,			/* output stream */
+	 char *prefix,			/* leading columns, NULL for none */
+	 char *name)			/* stat name */
+{
+  if (prefix)
+    fprintf(fd, "%s,", prefix);
+  if (strpbrk(name, ",\"\n"))
+    {
+      /* quote the name, doubling embedded quotes */
+      fputc('"', fd);
+      for (; *name; name++)
+	{
+	  if (*name == '"')
+	    fputc('"', fd);
+	  fputc(*name, fd);
+	}
+      fputc('"', fd);
+    }
+  else
+    fprintf(fd, "%s", name);
+  fprintf(fd, ",");
+}
+
+/* print one CSV row of stat NAME with value VAL, non-finite values are
+   left empty */
+static void
+csv_row(FILE *fd,			/* output stream */
+	char *prefix,			/* leading columns, NULL for none */
+	char *name,			/* stat name */
+	double val)			/* stat value */
+{
+  csv_name(fd, prefix, name);
+  if (val == val && val - val == 0.0)
+    fprintf(fd, (val == floor(val) && fabs(val) < 1e15) ? "%.0f" : "%.10g",
+	    val);
+  fprintf(fd, "\n");
+}
+
+/* print the value of all stat variables in stat database SDB as CSV rows of
+   the form `[PREFIX,]<name>,<value>', distribution buckets are printed as
+   `<name>[<index>]' rows */
+void
+stat_print_csv(struct stat_sdb_t *sdb,	/* stat database */
+	       FILE *fd,		/* output stream */
+	       char *prefix)		/* leading columns, NULL for none */
+{
+  struct stat_stat_t *stat;
+  struct bucket_t *bucket;
+  char name[1024];
+  double val, stddev, ci;
+  unsigned int i;
+
+  for (stat=sdb ? sdb->stats : NULL; stat != NULL; stat=stat->next)
+    {
+      switch (stat->sc)
+	{
+	case sc_dist:
+	  for (i=0; i < stat->variant.for_dist.arr_sz; i++)
+	    {
+	      sprintf(name, "%.1000s[%u]",
+		      stat->name, i * stat->variant.for_dist.bucket_sz);
+	      csv_row(fd, prefix, name, dist_count(sdb, stat, i));
+	    }
+	  break;
+	case sc_sdist:
+	  for (i=0; i < HTAB_SZ; i++)
+	    {
+	      for (bucket = stat->variant.for_sdist.sarr[i];
+		   bucket != NULL;
+		   bucket = bucket->next)
+		{
+		  sprintf(name, "%.1000s", stat->name);
+		  mysprintf(name + strlen(name), "[0x%p]", bucket->index);
+		  csv_row(fd, prefix, name, bucket->count);
+		}
+	    }
+	  break;
+	case sc_mean:
+	  mean_stats(stat, &stddev, &ci);
+	  csv_row(fd, prefix, stat->name, stat->variant.for_mean.mean);
+	  sprintf(name, "%.1000s.samples", stat->name);
+	  csv_row(fd, prefix, name, stat->variant.for_mean.nsamples);
+	  sprintf(name, "%.1000s.stddev", stat->name);
+	  csv_row(fd, prefix, name, stddev);
+	  sprintf(name, "%.1000s.ci", stat->name);
+	  csv_row(fd, prefix, name, ci);
+	  break;
+	case sc_formula:
+	  if (eval_formula(sdb, stat, &val))
+	    csv_row(fd, prefix, stat->name, val);
+	  else
+	    {
+	      csv_name(fd, prefix, stat->name);
+	      fprintf(fd, "\n");
+	    }
+	  break;
+	default:
+	  val = stat_scalar(stat);
+	  if (sdb->delta)
+	    val -= stat->snap;
+	  csv_row(fd, prefix, stat->name, val);
+	  break;
+	}
+    }
+}
+
+/* print the value of all stat variables in stat database SDB in format FMT */
+void
+stat_print_fmt(struct stat_sdb_t *sdb,	/* stat database */
+	       FILE *fd,		/* output stream */
+	       enum stat_fmt_t fmt)	/* output format */
+{
+  switch (fmt)
+    {
+    case sf_text:
+      stat_print_stats(sdb, fd);
+      break;
+    case sf_json:
+      stat_print_json(sdb, fd);
+      fprintf(fd, "\n");
+      break;
+    case sf_csv:
+      fprintf(fd, "stat,value\n");
+      stat_print_csv(sdb, fd, NULL);
+      break;
+    default:
+      panic("bogus stat output format");
+    }
+}
+
+/* record the current value of all stat variables in stat database SDB, the
+   changes from these values are printed while SDB->DELTA is set */
+void
+stat_snapshot(struct stat_sdb_t *sdb)	/* stat database */
+{
+  struct stat_stat_t *stat;
+
+  for (stat=sdb->stats; stat != NULL; stat=stat->next)
+    {
+      if (STAT_IS_SCALAR(stat))
+	stat->snap = stat_scalar(stat);
+      else if (stat->sc == sc_dist)
+	{
+	  if (!stat->snap_arr)
+	    {
+	      stat->snap_arr = (unsigned int *)
+		calloc(stat->variant.for_dist.arr_sz, sizeof(unsigned int));
+	      if (!stat->snap_arr)
+		fatal("out of virtual memory");
+	    }
+	  memcpy(stat->snap_arr, stat->variant.for_dist.arr,
+		 stat->variant.for_dist.arr_sz * sizeof(unsigned int));
+	}
+    }
+}
+
 /* find a stat variable, returns NULL if it is not found */
 struct stat_stat_t *
 stat_find_stat(struct stat_sdb_t *sdb,	/* stat database */
@@ -1018,7 +1527,9 @@ stat_find_stat(struct stat_sdb_t *sdb,	/* stat database */
 {
   struct stat_stat_t *stat;
 
-  for (stat = sdb->stats; stat != NULL; stat = stat->next)
+  for (stat = sdb->htab[stat_hash(stat_name)];
+       stat != NULL;
+       stat = stat->hash_next)
     {
       if (!strcmp(stat->name, stat_name))
 	break;
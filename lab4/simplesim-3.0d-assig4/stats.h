@@ -66,7 +66,14 @@
  * allocate and manipulate distributions (histograms) and general expression
  * of other statistical variables constants.  Statistical variables can be
  * located by name using stat_find_stat().  And, statistics can be print in
- * a highly standardized and stylized fashion using stat_print_stats().
+ * a highly standardized and stylized fashion using stat_print_stats(), or in
+ * a machine-readable form using stat_print_json() and stat_print_csv().
+ *
+ * For periodic dumps, stat_snapshot() records the current value of all
+ * stats, while the database's DELTA flag is set, stats are printed (and
+ * referenced in formulas) as their change since the last snapshot, e.g., a
+ * CPI formula then gives the CPI of the interval.  Sampled means and sparse
+ * array distributions are always printed in full.
  */
 
 /* stat variable classes */
@@ -82,9 +89,21 @@ enum stat_class_t {
   sc_dist,			/* array distribution stat */
   sc_sdist,			/* sparse array distribution stat */
   sc_formula,			/* stat expression formula */
+  sc_mean,			/* sampled mean w/ confidence interval */
   sc_NUM
 };
 
+/* stat output formats */
+enum stat_fmt_t {
+  sf_text = 0,			/* stylized text, see stat_print_stats() */
+  sf_json,			/* JSON object, see stat_print_json() */
+  sf_csv,			/* CSV rows, see stat_print_csv() */
+  sf_NUM
+};
+
+/* stats are located by name with a hash table */
+#define STAT_HTAB_SZ		1024
+
 /* sparse array distributions are implemented with a hash table */
 #define HTAB_SZ			1024
 #define HTAB_HASH(I)		((((I) >> 8) ^ (I)) & (HTAB_SZ - 1))
@@ -118,6 +137,7 @@ typedef void
 /* statistical variable definition */
 struct stat_stat_t {
   struct stat_stat_t *next;	/* pointer to next stat in database list */
+  struct stat_stat_t *hash_next;/* next stat in name hash bucket chain */
   char *name;			/* stat name */
   char *desc;			/* stat description */
   char *format;			/* stat output print format */
@@ -177,12 +197,29 @@ struct stat_stat_t {
     struct stat_for_formula_t {
       char *formula;		/* stat formula, see eval.h for format */
     } for_formula;
+
+    /* sc == sc_mean */
+    struct stat_for_mean_t {
+      double z;			/* confidence interval half-width, in
+				   standard deviations of the mean */
+      unsigned int nsamples;	/* number of samples */
+      double mean;		/* running mean of the samples */
+      double m2;		/* running sum of squared differences from
+				   the mean */
+    } for_mean;
   } variant;
+
+  /* value at the last snapshot, see stat_snapshot() */
+  double snap;			/* scalar stat value */
+  unsigned int *snap_arr;	/* array distribution counts */
 };
 
 /* statistical database */
 struct stat_sdb_t {
   struct stat_stat_t *stats;		/* list of stats in database */
+  struct stat_stat_t *stats_tail;	/* last stat in database list */
+  struct stat_stat_t **htab;		/* stat name hash table */
+  int delta;				/* print changes since snapshot? */
   struct eval_state_t *evaluator;	/* an expression evaluator */
 };
 
@@ -312,6 +349,23 @@ stat_reg_formula(struct stat_sdb_t *sdb,/* stat database */
 		 char *formula,		/* formula expression */
 		 char *format);		/* optional variable output format */
 
+/* register a sampled mean statistic, values are added individually with
+   stat_add_value() and the mean of all values added is printed along with
+   the number of samples, their standard deviation and the confidence interval
+   of the mean at Z standard deviations (e.g., 1.96 for 95% or 3.0 for 99.7%
+   confidence), the mean is used when the stat is referenced in a formula */
+struct stat_stat_t *
+stat_reg_mean(struct stat_sdb_t *sdb,	/* stat database */
+	      char *name,		/* stat variable name */
+	      char *desc,		/* stat variable description */
+	      double z,			/* confidence interval width in std devs */
+	      char *format);		/* optional variable output format */
+
+/* add a single value to sampled mean statistic STAT */
+void
+stat_add_value(struct stat_stat_t *stat,/* stat variable */
+	       double value);		/* sampled value */
+
 /* print the value of stat variable STAT */
 void
 stat_print_stat(struct stat_sdb_t *sdb,	/* stat database */
@@ -324,6 +378,32 @@ stat_print_stats(struct stat_sdb_t *sdb,/* stat database */
 		 FILE *fd);		/* output stream */
 
 
+/* print the value of all stat variables in stat database SDB as a single
+   JSON object, without a trailing newline, distributions and sampled means
+   are printed as nested objects, formulas that cannot be evaluated as null */
+void
+stat_print_json(struct stat_sdb_t *sdb,	/* stat database */
+		FILE *fd);		/* output stream */
+
+/* print the value of all stat variables in stat database SDB as CSV rows of
+   the form `[PREFIX,]<name>,<value>', distribution buckets are printed as
+   `<name>[<index>]' rows */
+void
+stat_print_csv(struct stat_sdb_t *sdb,	/* stat database */
+	       FILE *fd,		/* output stream */
+	       char *prefix);		/* leading columns, NULL for none */
+
+/* print the value of all stat variables in stat database SDB in format FMT */
+void
+stat_print_fmt(struct stat_sdb_t *sdb,	/* stat database */
+	       FILE *fd,		/* output stream */
+	       enum stat_fmt_t fmt);	/* output format */
+
+/* record the current value of all stat variables in stat database SDB, the
+   changes from these values are printed while SDB->DELTA is set */
+void
+stat_snapshot(struct stat_sdb_t *sdb);	/* stat database */
+
 /* find a stat variable, returns NULL if it is not found */
 struct stat_stat_t *
 stat_find_stat(struct stat_sdb_t *sdb,	/* stat database */
@@ -0,0 +1,281 @@
+/* sweep.c - configuration sweep routines */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host.h"
+#include "misc.h"
+#include "stats.h"
+#include "sweep.h"
+
+#ifdef HOST_HAS_THREADS
+
+/* worker thread state */
+struct sweep_worker_t
+{
+  struct sweep_t *sw;		/* sweep being applied */
+  int first;			/* first configuration of this worker */
+  int last;			/* last configuration of this worker, +1 */
+  pthread_t tid;		/* worker thread */
+};
+
+/* non-zero in worker threads */
+static THREAD_LOCAL int sweep_in_worker = FALSE;
+
+/* worker thread, applies every batch handed off to its configurations */
+static void *
+sweep_worker(void *arg)			/* worker state */
+{
+  struct sweep_worker_t *w = (struct sweep_worker_t *)arg;
+  struct sweep_t *sw = w->sw;
+  counter_t seen = 0;
+  byte_t *batch;
+  int c, nevs;
+
+  sweep_in_worker = TRUE;
+  for (;;)
+    {
+      /* wait for the next batch */
+      pthread_mutex_lock(&sw->lock);
+      while (sw->nbatches == seen && !sw->quit)
+	pthread_cond_wait(&sw->go, &sw->lock);
+      if (sw->nbatches == seen)
+	{
+	  pthread_mutex_unlock(&sw->lock);
+	  break;
+	}
+      seen = sw->nbatches;
+      batch = sw->batch;
+      nevs = sw->batch_nevs;
+      pthread_mutex_unlock(&sw->lock);
+
+      for (c=w->first; c < w->last; c++)
+	sw->apply_fn(c, batch, nevs);
+
+      /* the last worker done releases the batch */
+      pthread_mutex_lock(&sw->lock);
+      if (--sw->busy == 0)
+	pthread_cond_signal(&sw->done);
+      pthread_mutex_unlock(&sw->lock);
+    }
+
+  return NULL;
+}
+
+#endif /* HOST_HAS_THREADS */
+
+/* create a sweep of NCONFIGS configurations with events of EV_SIZE bytes,
+   applied by APPLY_FN in NTHREADS worker threads (0 for one per
+   configuration) */
+struct sweep_t *
+sweep_create(int nconfigs,		/* number of configurations */
+	     int ev_size,		/* size of an event in bytes */
+	     sweep_apply_fn apply_fn,	/* applies events to a config */
+	     int nthreads)		/* number of worker threads */
+{
+  struct sweep_t *sw;
+  int i;
+
+  if (nconfigs <= 0)
+    panic("sweep has no configurations");
+  if (nthreads < 0)
+    fatal("number of sweep worker threads must be non-negative");
+
+  sw = (struct sweep_t *)calloc(1, sizeof(struct sweep_t));
+  if (!sw)
+    fatal("out of virtual memory");
+
+  sw->nconfigs = nconfigs;
+  sw->ev_size = ev_size;
+  sw->apply_fn = apply_fn;
+  sw->buf[0] = (byte_t *)calloc(SWEEP_BATCH, ev_size);
+  sw->buf[1] = (byte_t *)calloc(SWEEP_BATCH, ev_size);
+  if (!sw->buf[0] || !sw->buf[1])
+    fatal("out of virtual memory");
+  sw->fill = sw->buf[0];
+  sw->nevs = 0;
+  sw->nbatches = 0;
+
+#ifdef HOST_HAS_THREADS
+  sw->nworkers = (nthreads == 0) ? nconfigs : MIN(nthreads, nconfigs);
+
+  pthread_mutex_init(&sw->lock, NULL);
+  pthread_cond_init(&sw->go, NULL);
+  pthread_cond_init(&sw->done, NULL);
+  sw->batch = NULL;
+  sw->batch_nevs = 0;
+  sw->busy = 0;
+  sw->quit = FALSE;
+
+  /* divide the configurations evenly among the workers */
+  sw->workers = (struct sweep_worker_t *)
+    calloc(sw->nworkers, sizeof(struct sweep_worker_t));
+  if (!sw->workers)
+    fatal("out of virtual memory");
+  for (i=0; i < sw->nworkers; i++)
+    {
+      sw->workers[i].sw = sw;
+      sw->workers[i].first = (i * nconfigs) / sw->nworkers;
+      sw->workers[i].last = ((i+1) * nconfigs) / sw->nworkers;
+      if (pthread_create(&sw->workers[i].tid, NULL,
+			 sweep_worker, &sw->workers[i]) != 0)
+	fatal("could not create sweep worker thread");
+    }
+#else /* !HOST_HAS_THREADS */
+  sw->nworkers = 0;
+#endif /* HOST_HAS_THREADS */
+
+  return sw;
+}
+
+/* hand the events of sweep SW written so far to the workers, the events
+   may not yet be applied on return */
+void
+sweep_flush(struct sweep_t *sw)		/* configuration sweep */
+{
+  int c;
+
+  if (sw->nevs == 0)
+    return;
+
+#ifdef HOST_HAS_THREADS
+  if (sw->nworkers > 0)
+    {
+      /* wait for the previous batch, its buffer is filled next */
+      pthread_mutex_lock(&sw->lock);
+      while (sw->busy)
+	pthread_cond_wait(&sw->done, &sw->lock);
+
+      sw->batch = sw->fill;
+      sw->batch_nevs = sw->nevs;
+      sw->busy = sw->nworkers;
+      sw->nbatches++;
+      pthread_cond_broadcast(&sw->go);
+      pthread_mutex_unlock(&sw->lock);
+
+      sw->fill = (sw->fill == sw->buf[0]) ? sw->buf[1] : sw->buf[0];
+      sw->nevs = 0;
+      return;
+    }
+#endif /* HOST_HAS_THREADS */
+
+  /* no workers, apply the batch here */
+  for (c=0; c < sw->nconfigs; c++)
+    sw->apply_fn(c, sw->fill, sw->nevs);
+  sw->nbatches++;
+  sw->nevs = 0;
+}
+
+/* apply all events of sweep SW written so far, this has no effect when
+   called by a worker thread */
+void
+sweep_sync(struct sweep_t *sw)		/* configuration sweep */
+{
+#ifdef HOST_HAS_THREADS
+  /* a worker cannot wait for itself, e.g., if it reports a fatal error */
+  if (sweep_in_worker)
+    return;
+#endif /* HOST_HAS_THREADS */
+
+  sweep_flush(sw);
+
+#ifdef HOST_HAS_THREADS
+  pthread_mutex_lock(&sw->lock);
+  while (sw->busy)
+    pthread_cond_wait(&sw->done, &sw->lock);
+  pthread_mutex_unlock(&sw->lock);
+#endif /* HOST_HAS_THREADS */
+}
+
+/* apply all events of sweep SW, stop its worker threads and release it */
+void
+sweep_destroy(struct sweep_t *sw)	/* configuration sweep */
+{
+#ifdef HOST_HAS_THREADS
+  int i;
+#endif /* HOST_HAS_THREADS */
+
+  sweep_sync(sw);
+
+#ifdef HOST_HAS_THREADS
+  pthread_mutex_lock(&sw->lock);
+  sw->quit = TRUE;
+  pthread_cond_broadcast(&sw->go);
+  pthread_mutex_unlock(&sw->lock);
+  for (i=0; i < sw->nworkers; i++)
+    pthread_join(sw->workers[i].tid, NULL);
+  free(sw->workers);
+  pthread_cond_destroy(&sw->done);
+  pthread_cond_destroy(&sw->go);
+  pthread_mutex_destroy(&sw->lock);
+#endif /* HOST_HAS_THREADS */
+
+  free(sw->buf[0]);
+  free(sw->buf[1]);
+  free(sw);
+}
+
+/* register the statistics of sweep SW */
+void
+sweep_reg_stats(struct sweep_t *sw,	/* configuration sweep */
+		struct stat_sdb_t *sdb)	/* stats database */
+{
+  stat_reg_int(sdb, "sweep.configs",
+	       "number of configurations swept",
+	       &sw->nconfigs, sw->nconfigs, NULL);
+  stat_reg_int(sdb, "sweep.workers",
+	       "number of sweep worker threads (0 if none)",
+	       &sw->nworkers, sw->nworkers, NULL);
+  stat_reg_counter(sdb, "sweep.batches",
+		   "total number of event batches applied",
+		   &sw->nbatches, 0, NULL);
+}
@@ -0,0 +1,147 @@
+/* sweep.h - configuration sweep interfaces */
+
+/* SimpleScalar(TM) Tool Suite
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ * All Rights Reserved. 
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING SIMPLESCALAR,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of SimpleScalar,
+ * LLC (info@simplescalar.com). Nonprofit and noncommercial use is permitted
+ * as described below.
+ * 
+ * 1. SimpleScalar is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the program accepts full responsibility for the
+ * application of the program and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. SimpleScalar may be
+ * downloaded, compiled, executed, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM SIMPLESCALAR, LLC (info@simplescalar.com).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of SimpleScalar
+ * in compiled or executable form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. SimpleScalar was developed by Todd M. Austin, Ph.D. The tool suite is
+ * currently maintained by SimpleScalar LLC (info@simplescalar.com). US Mail:
+ * 2395 Timbercrest Court, Ann Arbor, MI 48105.
+ * 
+ * Copyright (C) 1994-2003 by Todd M. Austin, Ph.D. and SimpleScalar, LLC.
+ */
+
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdio.h>
+
+#include "host.h"
+#include "misc.h"
+#include "stats.h"
+
+#ifdef HOST_HAS_THREADS
+#include <pthread.h>
+#endif /* HOST_HAS_THREADS */
+
+/*
+ * This module drives any number of independent model configurations (e.g.,
+ * cache hierarchies or branch predictors) from one functional execution
+ * stream.  The simulator appends an event (e.g., a memory reference) to a
+ * batch for every action of the simulated program that the configurations
+ * model; full batches are handed to worker threads, each of which applies
+ * the batch to its share of the configurations, while the simulator fills
+ * the next batch.  Configurations only see events in order, so their
+ * results match those of simulating each configuration on its own.
+ *
+ * Before configuration state is examined, e.g., when stats are printed,
+ * sweep_sync() must be called to apply all outstanding events.  On hosts
+ * without worker threads (see host.h), batches are applied in turn on the
+ * simulator thread.
+ */
+
+/* number of events in a batch */
+#define SWEEP_BATCH		16384
+
+/* apply the NEVS events at EVS to configuration CONFIG */
+typedef void
+(*sweep_apply_fn)(int config,		/* configuration index */
+		  void *evs,		/* batch of events */
+		  int nevs);		/* number of events in batch */
+
+/* configuration sweep */
+struct sweep_t
+{
+  int nconfigs;			/* number of configurations */
+  int ev_size;			/* size of an event in bytes */
+  sweep_apply_fn apply_fn;	/* applies events to a configuration */
+  byte_t *buf[2];		/* event batches, filled and applied in turn */
+  byte_t *fill;			/* batch being filled */
+  int nevs;			/* events in the batch being filled */
+  int nworkers;			/* number of worker threads, zero if none */
+  counter_t nbatches;		/* batches applied so far */
+#ifdef HOST_HAS_THREADS
+  struct sweep_worker_t *workers;/* worker thread state */
+  pthread_mutex_t lock;		/* protects the fields below */
+  pthread_cond_t go;		/* signaled when a batch is handed off */
+  pthread_cond_t done;		/* signaled when a batch is applied */
+  byte_t *batch;		/* batch being applied by the workers */
+  int batch_nevs;		/* events in batch being applied */
+  int busy;			/* workers still applying the batch */
+  int quit;			/* non-zero when the workers must exit */
+#endif /* HOST_HAS_THREADS */
+};
+
+/* get space for the next event of sweep SW, of type TYPE, the event is
+   applied to every configuration some time after it is written */
+#define SWEEP_EVENT(SW, TYPE)						\
+  ((SW)->nevs == SWEEP_BATCH ? sweep_flush(SW) : (void)0,		\
+   &((TYPE *)(SW)->fill)[(SW)->nevs++])
+
+/* create a sweep of NCONFIGS configurations with events of EV_SIZE bytes,
+   applied by APPLY_FN in NTHREADS worker threads (0 for one per
+   configuration) */
+struct sweep_t *
+sweep_create(int nconfigs,		/* number of configurations */
+	     int ev_size,		/* size of an event in bytes */
+	     sweep_apply_fn apply_fn,	/* applies events to a config */
+	     int nthreads);		/* number of worker threads */
+
+/* hand the events of sweep SW written so far to the workers, the events
+   may not yet be applied on return */
+void
+sweep_flush(struct sweep_t *sw);	/* configuration sweep */
+
+/* apply all events of sweep SW written so far, this has no effect when
+   called by a worker thread */
+void
+sweep_sync(struct sweep_t *sw);		/* configuration sweep */
+
+/* apply all events of sweep SW, stop its worker threads and release it */
+void
+sweep_destroy(struct sweep_t *sw);	/* configuration sweep */
+
+/* register the statistics of sweep SW */
+void
+sweep_reg_stats(struct sweep_t *sw,	/* configuration sweep */
+		struct stat_sdb_t *sdb);/* stats database */
+
+#endif /* SWEEP_H */
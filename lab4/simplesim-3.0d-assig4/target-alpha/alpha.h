@@ -194,7 +194,7 @@ extern md_inst_t MD_NOP_INST;
 
 /* fetch an instruction */
 #define MD_FETCH_INST(INST, MEM, PC)					\
-  { (INST) = MEM_READ_WORD((MEM), (PC)); }
+  { (INST) = MEM_IREAD_WORD((MEM), (PC)); }
 
 /*
  * target-dependent loader module configuration
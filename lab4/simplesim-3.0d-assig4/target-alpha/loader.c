@@ -229,6 +229,8 @@ ld_load_prog(char *fname,		/* program to load */
 
   if (sim_chkpt_fname != NULL)
     fatal("checkpoints only supported while EIO tracing");
+  if (sim_image_fname != NULL)
+    fatal("program images are only supported by the PISA loader");
 
 #ifdef BFD_LOADER
 
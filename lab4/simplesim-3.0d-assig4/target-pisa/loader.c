@@ -51,6 +51,17 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+/* program executables and images are mapped copy-on-write on hosts with
+   mmap(), elsewhere program sections are copied into simulated memory */
+#if !defined(__CYGWIN32__) && !defined(_MSC_VER)
+#define LD_MMAP
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif /* !__CYGWIN32__ && !_MSC_VER */
 
 #include "host.h"
 #include "misc.h"
@@ -146,6 +157,265 @@ ld_reg_stats(struct stat_sdb_t *sdb)	/* stats data base */
 }
 
 
+#ifdef LD_MMAP
+
+/*
+ * program images: the simulated memory pages of a loaded program, before its
+ * stack is set up, written to a file so that later runs of the same
+ * executable can map them copy-on-write instead of loading the executable;
+ * the file holds a header page, the page addresses padded to a page
+ * boundary, and then the pages, in host byte order
+ */
+
+#define LD_IMAGE_MAGIC		"SSLDIMG"
+#define LD_IMAGE_VERSION	1
+
+/* file offset of the pages of an image holding N pages */
+#define LD_IMAGE_PAGES(N)						\
+  (MD_PAGE_SIZE + ROUND_UP((N) * sizeof(md_addr_t), MD_PAGE_SIZE))
+
+/* program image header */
+struct ld_image_hdr_t {
+  char magic[8];			/* LD_IMAGE_MAGIC */
+  word_t version;			/* LD_IMAGE_VERSION */
+  word_t page_size;			/* MD_PAGE_SIZE */
+  word_t zero_bss;			/* were bss segments zeroed? */
+  word_t npages;			/* number of pages in the image */
+  sqword_t prog_dev;			/* executable device, inode, size */
+  sqword_t prog_ino;			/*   and modification time, the */
+  sqword_t prog_size;			/*   image is stale if any of */
+  sqword_t prog_mtime;			/*   these change */
+  md_addr_t text_base;			/* loaded ld_* segment variables */
+  word_t text_size;
+  md_addr_t data_base;
+  word_t data_size;
+  md_addr_t prog_entry;
+  word_t target_big_endian;
+};
+
+/* map all SIZE bytes of open file FD copy-on-write, returns NULL if the
+   file cannot be mapped, the mapping is never released */
+static byte_t *
+ld_map_file(FILE *fd,			/* open file */
+	    long size)			/* size of the file */
+{
+  void *p;
+
+  if (size <= 0)
+    return NULL;
+
+  p = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fileno(fd), 0);
+  return (p == MAP_FAILED) ? NULL : (byte_t *)p;
+}
+
+/* fill in the program image header HDR for loading executable FNAME with
+   ZERO_BSS_SEGS, returns FALSE if the executable cannot be found */
+static int
+ld_image_hdr(struct ld_image_hdr_t *hdr,/* header to fill in */
+	     char *fname,		/* program executable */
+	     int zero_bss_segs)		/* zero uninit data segment? */
+{
+  struct stat sbuf;
+
+  if (stat(fname, &sbuf) == -1)
+    return FALSE;
+
+  memset(hdr, 0, sizeof(*hdr));
+  strcpy(hdr->magic, LD_IMAGE_MAGIC);
+  hdr->version = LD_IMAGE_VERSION;
+  hdr->page_size = MD_PAGE_SIZE;
+  hdr->zero_bss = zero_bss_segs;
+  hdr->prog_dev = (sqword_t)sbuf.st_dev;
+  hdr->prog_ino = (sqword_t)sbuf.st_ino;
+  hdr->prog_size = (sqword_t)sbuf.st_size;
+  hdr->prog_mtime = (sqword_t)sbuf.st_mtime;
+  return TRUE;
+}
+
+/* map the text and data of executable FNAME into memory space MEM from
+   program image IMAGE, returns FALSE if the image is missing or was not
+   made from the current executable */
+static int
+ld_image_map(char *image,		/* program image file */
+	     char *fname,		/* program executable */
+	     int zero_bss_segs,		/* zero uninit data segment? */
+	     struct mem_t *mem)		/* memory space to map into */
+{
+  FILE *fd;
+  struct stat sbuf;
+  struct ld_image_hdr_t hdr, want;
+  byte_t *map;
+  md_addr_t *addrs;
+  long size;
+  int i;
+
+  if (!ld_image_hdr(&want, fname, zero_bss_segs))
+    return FALSE;
+
+  fd = fopen(image, "r");
+  if (!fd)
+    return FALSE;
+
+  if (fread(&hdr, sizeof(hdr), 1, fd) < 1 || fstat(fileno(fd), &sbuf) == -1)
+    {
+      fclose(fd);
+      return FALSE;
+    }
+
+  /* the image must match the executable and hold all of its pages */
+  want.npages = hdr.npages;
+  size = LD_IMAGE_PAGES(hdr.npages) + (long)hdr.npages * MD_PAGE_SIZE;
+  if (memcmp(&hdr, &want, (char *)&want.text_base - (char *)&want) != 0
+      || sbuf.st_size != size
+      || !(map = ld_map_file(fd, size)))
+    {
+      fclose(fd);
+      return FALSE;
+    }
+  fclose(fd);
+
+  /* map the pages in place, the first write to each page copies it */
+  addrs = (md_addr_t *)(map + MD_PAGE_SIZE);
+  for (i=0; i < hdr.npages; i++)
+    mem_map_page(mem, addrs[i],
+		 map + LD_IMAGE_PAGES(hdr.npages) + (long)i * MD_PAGE_SIZE);
+
+  ld_text_base = hdr.text_base;
+  ld_text_size = hdr.text_size;
+  ld_data_base = hdr.data_base;
+  ld_data_size = hdr.data_size;
+  ld_prog_entry = hdr.prog_entry;
+  ld_target_big_endian = hdr.target_big_endian;
+
+  return TRUE;
+}
+
+/* write the loaded text and data of executable FNAME in memory space MEM
+   to program image IMAGE, the image is written to a temporary file and
+   renamed, so concurrent runs never see a partial image */
+static void
+ld_image_save(char *image,		/* program image file */
+	      char *fname,		/* program executable */
+	      int zero_bss_segs,	/* zero uninit data segment? */
+	      struct mem_t *mem)	/* memory space holding the program */
+{
+  FILE *fd;
+  char *tmpname;
+  struct ld_image_hdr_t hdr;
+  struct mem_pte_t *pte;
+  md_addr_t addr;
+  int i, n, err;
+
+  if (!ld_image_hdr(&hdr, fname, zero_bss_segs))
+    return;
+
+  tmpname = malloc(strlen(image) + 32);
+  if (!tmpname)
+    fatal("out of virtual memory");
+  sprintf(tmpname, "%s.%d", image, (int)getpid());
+
+  fd = fopen(tmpname, "w");
+  if (!fd)
+    {
+      warn("could not create program image `%s'", tmpname);
+      free(tmpname);
+      return;
+    }
+
+  hdr.npages = mem->page_count;
+  hdr.text_base = ld_text_base;
+  hdr.text_size = ld_text_size;
+  hdr.data_base = ld_data_base;
+  hdr.data_size = ld_data_size;
+  hdr.prog_entry = ld_prog_entry;
+  hdr.target_big_endian = ld_target_big_endian;
+  err = (fwrite(&hdr, sizeof(hdr), 1, fd) < 1);
+
+  /* page addresses, then the pages, in page table order */
+  n = 0;
+  err |= (fseek(fd, MD_PAGE_SIZE, SEEK_SET) == -1);
+  MEM_FORALL(mem, i, pte)
+    {
+      addr = MEM_PTE_ADDR(pte, i);
+      err |= (fwrite(&addr, sizeof(addr), 1, fd) < 1);
+      n++;
+    }
+  err |= (fseek(fd, LD_IMAGE_PAGES(hdr.npages), SEEK_SET) == -1);
+  MEM_FORALL(mem, i, pte)
+    {
+      err |= (fwrite(pte->page, MD_PAGE_SIZE, 1, fd) < 1);
+    }
+  if (n != hdr.npages)
+    panic("memory space `%s' page count is inconsistent", mem->name);
+
+  err |= (fclose(fd) != 0);
+  if (err || rename(tmpname, image) == -1)
+    {
+      warn("could not write program image `%s'", image);
+      unlink(tmpname);
+    }
+  free(tmpname);
+}
+
+#endif /* LD_MMAP */
+
+#ifndef BFD_LOADER
+
+/* load the SIZE bytes at file offset OFFSET of executable FOBJ into memory
+   space MEM at address ADDR, if the executable is mapped at FMAP (FSIZE
+   bytes) and the section is page-aligned in the file, the pages wholly in
+   the section are mapped copy-on-write rather than copied */
+static void
+ld_load_sect(struct mem_t *mem,		/* memory space to load into */
+	     FILE *fobj,		/* program executable */
+	     byte_t *fmap,		/* mapped executable, or NULL */
+	     long fsize,		/* size of mapped executable */
+	     md_addr_t addr,		/* target address of section */
+	     long offset,		/* file offset of section */
+	     int size)			/* section size in bytes */
+{
+  md_addr_t base, bound, page;
+  char *p;
+
+  if (fmap && offset + size <= fsize)
+    {
+      base = ROUND_UP(addr, MD_PAGE_SIZE);
+      bound = ROUND_DOWN(addr + size, MD_PAGE_SIZE);
+      if (MEM_OFFSET(addr) != MEM_OFFSET(offset) || base >= bound)
+	{
+	  /* not page-aligned, or no whole pages, copy all of it */
+	  base = bound = addr + size;
+	}
+
+      /* copy the partial first and last pages, they may hold other
+	 sections, map the rest */
+      mem_bcopy(mem_access, mem, Write, addr, fmap + offset, base - addr);
+      for (page=base; page < bound; page += MD_PAGE_SIZE)
+	mem_map_page(mem, page, fmap + offset + (page - addr));
+      mem_bcopy(mem_access, mem, Write,
+		bound, fmap + offset + (bound - addr), (addr + size) - bound);
+      return;
+    }
+
+  p = calloc(size, sizeof(char));
+  if (!p)
+    fatal("out of virtual memory");
+
+  if (fseek(fobj, offset, 0) == -1)
+    fatal("could not read section from executable");
+  if (fread(p, size, 1, fobj) < 1)
+    fatal("could not read section from executable");
+
+  /* copy program section into simulator target memory */
+  mem_bcopy(mem_access, mem, Write, addr, p, size);
+
+  /* release the section buffer */
+  free(p);
+}
+
+#endif /* !BFD_LOADER */
+
+
 /* load program text and initialized data into simulated virtual memory
    space and initialize program segment range variables */
 void
@@ -156,7 +426,7 @@ ld_load_prog(char *fname,		/* program to load */
 	     struct mem_t *mem,		/* memory space to load prog into */
 	     int zero_bss_segs)		/* zero uninit data segment? */
 {
-  int i;
+  int i, mapped;
   word_t temp;
   md_addr_t sp, data_break = 0, null_ptr = 0, argv_addr, envp_addr;
 
@@ -224,21 +494,38 @@ ld_load_prog(char *fname,		/* program to load */
   if (sim_chkpt_fname != NULL)
     fatal("checkpoints only supported while EIO tracing");
 
+  /* set up a local stack pointer, this is where the argv and envp
+     data is written into program memory */
+  ld_stack_base = MD_STACK_BASE;
+  sp = ROUND_DOWN(MD_STACK_BASE - MD_MAX_ENVIRON, sizeof(dfloat_t));
+  ld_stack_size = ld_stack_base - sp;
+
+  /* initial stack pointer value */
+  ld_environ_base = sp;
+
+  /* record profile file name */
+  ld_prog_fname = argv[0];
+
+  /* map the program from its cached image, if it is current */
+  mapped = FALSE;
+  if (sim_image_fname != NULL)
+    {
+#ifdef LD_MMAP
+      mapped = ld_image_map(sim_image_fname, argv[0], zero_bss_segs, mem);
+      if (mapped)
+	fprintf(stderr, "sim: mapped program image: %s\n", sim_image_fname);
+#else /* !LD_MMAP */
+      fatal("program images are not supported on this host");
+#endif /* LD_MMAP */
+    }
+
 #ifdef BFD_LOADER
 
+  if (!mapped)
   {
     bfd *abfd;
     asection *sect;
 
-    /* set up a local stack pointer, this is where the argv and envp
-       data is written into program memory */
-    ld_stack_base = MD_STACK_BASE;
-    sp = ROUND_DOWN(MD_STACK_BASE - MD_MAX_ENVIRON, sizeof(dfloat_t));
-    ld_stack_size = ld_stack_base - sp;
-
-    /* initial stack pointer value */
-    ld_environ_base = sp;
-
     /* load the program into memory, try both endians */
     if (!(abfd = bfd_openr(argv[0], "ss-coff-big")))
       if (!(abfd = bfd_openr(argv[0], "ss-coff-little")))
@@ -253,9 +540,6 @@ ld_load_prog(char *fname,		/* program to load */
 	fatal("cannot open executable `%s'", argv[0]);
       }
 
-    /* record profile file name */
-    ld_prog_fname = argv[0];
-
     /* record endian of target */
     ld_target_big_endian = abfd->xvec->byteorder_big_p;
 
@@ -364,25 +648,15 @@ ld_load_prog(char *fname,		/* program to load */
 
 #else /* !BFD_LOADER, i.e., standalone loader */
 
+  if (!mapped)
   {
     FILE *fobj;
-    long floc;
+    long floc, fsize = 0;
+    byte_t *fmap = NULL;
     struct ecoff_filehdr fhdr;
     struct ecoff_aouthdr ahdr;
     struct ecoff_scnhdr shdr;
 
-    /* set up a local stack pointer, this is where the argv and envp
-       data is written into program memory */
-    ld_stack_base = MD_STACK_BASE;
-    sp = ROUND_DOWN(MD_STACK_BASE - MD_MAX_ENVIRON, sizeof(dfloat_t));
-    ld_stack_size = ld_stack_base - sp;
-
-    /* initial stack pointer value */
-    ld_environ_base = sp;
-
-    /* record profile file name */
-    ld_prog_fname = argv[0];
-
     /* load the program into memory, try both endians */
 #if defined(__CYGWIN32__) || defined(_MSC_VER)
     fobj = fopen(argv[0], "rb");
@@ -392,6 +666,19 @@ ld_load_prog(char *fname,		/* program to load */
     if (!fobj)
       fatal("cannot open executable `%s'", argv[0]);
 
+#ifdef LD_MMAP
+    /* map the executable, so aligned sections need not be copied */
+    {
+      struct stat sbuf;
+
+      if (fstat(fileno(fobj), &sbuf) != -1)
+	{
+	  fsize = sbuf.st_size;
+	  fmap = ld_map_file(fobj, fsize);
+	}
+    }
+#endif /* LD_MMAP */
+
     if (fread(&fhdr, sizeof(struct ecoff_filehdr), 1, fobj) < 1)
       fatal("cannot read header from executable `%s'", argv[0]);
 
@@ -433,8 +720,6 @@ ld_load_prog(char *fname,		/* program to load */
     floc = ftell(fobj);
     for (i = 0; i < fhdr.f_nscns; i++)
       {
-	char *p;
-
 	if (fseek(fobj, floc, 0) == -1)
 	  fatal("could not reset location in executable");
 	if (fread(&shdr, sizeof(struct ecoff_scnhdr), 1, fobj) < 1)
@@ -447,24 +732,13 @@ ld_load_prog(char *fname,		/* program to load */
 	    ld_text_size = ((shdr.s_vaddr + shdr.s_size) - MD_TEXT_BASE) 
 	      + TEXT_TAIL_PADDING;
 
-	    p = calloc(shdr.s_size, sizeof(char));
-	    if (!p)
-	      fatal("out of virtual memory");
-
-	    if (fseek(fobj, shdr.s_scnptr, 0) == -1)
-	      fatal("could not read `.text' from executable", i);
-	    if (fread(p, shdr.s_size, 1, fobj) < 1)
-	      fatal("could not read text section from executable");
-
-	    /* copy program section into simulator target memory */
-	    mem_bcopy(mem_access, mem, Write, shdr.s_vaddr, p, shdr.s_size);
+	    /* load program section into simulator target memory */
+	    ld_load_sect(mem, fobj, fmap, fsize,
+			 shdr.s_vaddr, shdr.s_scnptr, shdr.s_size);
 
 	    /* create tail padding and copy into simulator target memory */
 	    mem_bzero(mem_access, mem,
 		      shdr.s_vaddr + shdr.s_size, TEXT_TAIL_PADDING);
-  
-	    /* release the section buffer */
-	    free(p);
 
 #if 0
 	    Text_seek = shdr.s_scnptr;
@@ -497,20 +771,9 @@ ld_load_prog(char *fname,		/* program to load */
 	    Sdata_seek = shdr.s_scnptr;
 #endif
 
-	    p = calloc(shdr.s_size, sizeof(char));
-	    if (!p)
-	      fatal("out of virtual memory");
-
-	    if (fseek(fobj, shdr.s_scnptr, 0) == -1)
-	      fatal("could not read `.text' from executable", i);
-	    if (fread(p, shdr.s_size, 1, fobj) < 1)
-	      fatal("could not read text section from executable");
-
-	    /* copy program section it into simulator target memory */
-	    mem_bcopy(mem_access, mem, Write, shdr.s_vaddr, p, shdr.s_size);
-
-	    /* release the section buffer */
-	    free(p);
+	    /* load program section into simulator target memory */
+	    ld_load_sect(mem, fobj, fmap, fsize,
+			 shdr.s_vaddr, shdr.s_scnptr, shdr.s_size);
 
 	    break;
 
@@ -534,6 +797,12 @@ ld_load_prog(char *fname,		/* program to load */
   }
 #endif /* BFD_LOADER */
 
+#ifdef LD_MMAP
+  /* cache the loaded program for later runs */
+  if (sim_image_fname != NULL && !mapped)
+    ld_image_save(sim_image_fname, argv[0], zero_bss_segs, mem);
+#endif /* LD_MMAP */
+
   /* perform sanity checks on segment ranges */
   if (!ld_text_base || !ld_text_size)
     fatal("executable is missing a `.text' section");
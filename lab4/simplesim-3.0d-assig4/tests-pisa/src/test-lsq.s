@@ -0,0 +1,81 @@
+#
+#	test-lsq.s: Test load/store queue memory order violations.
+#
+#	Each loop iteration stores to BUF through an address that is
+#	computed by a slow MULT/DIV chain, then loads back through an
+#	address that is ready at once.  A first pass loads BUF+4 and warms
+#	up the caches and predictors, the second pass loads BUF.  With a
+#	store set predictor (sim-outorder -lsq:storeset), the aliasing load
+#	issues before the store address is known, the store finds the
+#	violation, the load and all later insts are squashed and replayed,
+#	and the pair is trained into one store set.  The loop is followed by
+#	independent loads from four more D-cache blocks, which fill a small
+#	MSHR file (sim-outorder -cache:dl1mshr).  The program prints the sum
+#	of the loaded values, 500500.
+#
+#	NOTE: the binary in bin.little was assembled by hand, so keep this
+#	listing and the binary in step.
+#
+	.data
+buf:	.word		0
+	.space		284
+
+	.text
+	.global		__start
+__start:
+	lui	$16, 0x1000		# $16 = &buf
+	addu	$18, $0, $0		# sum of loaded values
+	addiu	$19, $0, 7
+	addiu	$22, $16, 4		# first pass, load address misses buf
+	addiu	$17, $0, 100		# iterations
+
+loop:
+	mult	$17, $19		# $8 = &buf + ((i * 7) / 7 - i), slowly
+	mflo	$9
+	div	$9, $19
+	mflo	$10
+	subu	$10, $10, $17
+	addu	$8, $16, $10
+	sw	$17, 0($8)		# store, address known late
+	lw	$11, 0($22)		# load, address known at once
+	addu	$18, $18, $11
+	addiu	$17, $17, -1
+	bne	$17, $0, loop
+	beq	$22, $16, print
+	addu	$22, $16, $0		# second pass, load aliases the store
+	addiu	$17, $0, 1000
+	beq	$0, $0, loop
+
+print:
+	lw	$9, 64($16)		# four misses at once, all loads of 0
+	lw	$10, 128($16)
+	lw	$11, 192($16)
+	lw	$12, 256($16)
+	addu	$9, $9, $10
+	addu	$11, $11, $12
+	addu	$9, $9, $11
+	addu	$18, $18, $9
+
+	addiu	$20, $16, 32		# print the sum in decimal, backwards
+	addiu	$21, $0, 10
+	addiu	$20, $20, -1
+	sb	$21, 0($20)		# '\n'
+digit:
+	divu	$18, $21
+	mfhi	$9
+	mflo	$18
+	addiu	$9, $9, 48		# '0'
+	addiu	$20, $20, -1
+	sb	$9, 0($20)
+	bne	$18, $0, digit
+
+	addiu	$2, $0, 4		# write(1, $20, &buf + 32 - $20)
+	addiu	$4, $0, 1
+	addu	$5, $20, $0
+	addiu	$6, $16, 32
+	subu	$6, $6, $20
+	syscall
+
+	addiu	$2, $0, 1		# exit(0)
+	addu	$4, $0, $0
+	syscall